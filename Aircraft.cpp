@@ -9,6 +9,10 @@ Aircraft::Aircraft() {
   m_chargeTimeTicks = 0;
   m_numChargeSessions = 0;
   m_numFaults = 0;
+  m_maintenanceTimeTicks = 0;
+  m_stateStartTick = 0;
+  m_legEndTick = 0;
+  m_stateOfCharge = 1.0f; // every aircraft starts the run fully charged
 }
 
 Aircraft::Aircraft(aircraft_id_t id)
@@ -20,6 +24,10 @@ Aircraft::Aircraft(aircraft_id_t id)
   m_chargeTimeTicks = 0;
   m_numChargeSessions = 0;
   m_numFaults = 0;
+  m_maintenanceTimeTicks = 0;
+  m_stateStartTick = 0;
+  m_legEndTick = 0;
+  m_stateOfCharge = 1.0f; // every aircraft starts the run fully charged
 }
 
 void Aircraft::print(uint32_t cruiseSpeedMph, uint32_t numPassengers) const {
@@ -37,6 +45,7 @@ void Aircraft::print(uint32_t cruiseSpeedMph, uint32_t numPassengers) const {
     "\nCharge time: " << chargeTimeMin << " min" <<
     "\nCharge sessions: " << m_numChargeSessions <<
     "\nNum faults: " << m_numFaults <<
+    "\nMaintenance time: " << (m_maintenanceTimeTicks / (float) LOOP_TICKS_PER_MIN) << " min" <<
     "\nDistance traveled: " << distanceTraveled << " miles" <<
     "\nPassenger miles: " << passengerMiles <<
     "\n-------------------\n" <<
@@ -5,14 +5,18 @@
 #include <iostream>
 #include <cstdint>
 
-typedef enum {
+/** An aircraft id is the index of its company in the loaded company catalog, see
+ * AircraftCompanyCommon.h. The named ids are the companies of the built-in catalog;
+ * a catalog file can define any number of companies, so the enum is 32 bits wide to
+ * hold every index. */
+typedef enum : uint32_t {
   AIRCRAFT_ID_ALPHA = 0u,
   AIRCRAFT_ID_BRAVO,
   AIRCRAFT_ID_CHARLIE,
   AIRCRAFT_ID_DELTA,
   AIRCRAFT_ID_ECHO,
 
-  TOTAL_AIRCRAFT_COMPANIES
+  TOTAL_BUILTIN_AIRCRAFT_COMPANIES
 } aircraft_id_t;
 
 typedef enum {
@@ -20,6 +24,7 @@ typedef enum {
   AIRCRAFT_STATE_FLYING,
   AIRCRAFT_STATE_CHARGING,
   AIRCRAFT_STATE_WAITING_TO_CHARGE,
+  AIRCRAFT_STATE_MAINTENANCE, // grounded by a fault in flight, in line for or in a repair bay, see Maintenance.h
 } aircraft_state_t;
 
 class Aircraft
@@ -37,4 +42,8 @@ public:
   uint32_t m_chargeTimeTicks; // this is in units of loop-step-ticks
   uint32_t m_numChargeSessions; // number of times the aircraft went to the charging station
   uint32_t m_numFaults;
+  uint32_t m_maintenanceTimeTicks; // grounded by faults, in line for a repair bay included
+  uint32_t m_stateStartTick; // tick the current state was entered, used by the event-driven engine
+  uint32_t m_legEndTick; // tick the current flight or charge session ends, set when it starts
+  float m_stateOfCharge; // battery state of charge when the current state was entered, 0 to 1, see AircraftCompanyCommon.h
 };
\ No newline at end of file
@@ -1,21 +1,161 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
 #include "AircraftCompanyCommon.h"
 
 /** Define data common to aircraft of the same company.
- * Use the aircraft id to index through this array. */
-const aircraft_company_common_t G_AircraftCompanyCommon[TOTAL_AIRCRAFT_COMPANIES] = {
-  {ALPHA_CRUISE_SPEED_MPH, ALPHA_FLIGHT_DUR_TICKS, ALPHA_CHARGE_DUR_TICKS, ALPHA_PASSENGER_COUNT, ALPHA_FAULT_PROB_PER_HR},
-  {BRAVO_CRUISE_SPEED_MPH, BRAVO_FLIGHT_DUR_TICKS, BRAVO_CHARGE_DUR_TICKS, BRAVO_PASSENGER_COUNT, BRAVO_FAULT_PROB_PER_HR},
-  {CHARLIE_CRUISE_SPEED_MPH, CHARLIE_FLIGHT_DUR_TICKS, CHARLIE_CHARGE_DUR_TICKS, CHARLIE_PASSENGER_COUNT, CHARLIE_FAULT_PROB_PER_HR},
-  {DELTA_CRUISE_SPEED_MPH, DELTA_FLIGHT_DUR_TICKS, DELTA_CHARGE_DUR_TICKS, DELTA_PASSENGER_COUNT, DELTA_FAULT_PROB_PER_HR},
-  {ECHO_CRUISE_SPEED_MPH, ECHO_FLIGHT_DUR_TICKS, ECHO_CHARGE_DUR_TICKS, ECHO_PASSENGER_COUNT, ECHO_FAULT_PROB_PER_HR},
+ * Use the aircraft id to index through this array. Only the first GetNumCompanies()
+ * entries are valid. */
+aircraft_company_common_t G_AircraftCompanyCommon[MAX_AIRCRAFT_COMPANIES];
+
+// Specs and names of the loaded companies, only read outside of the simulation loop
+static std::vector<aircraft_company_spec_t> companySpecs;
+
+// name, cruise speed mph, battery kWh, energy use kWh/mile, charge time hours, passengers, fault probability per hour
+static const aircraft_company_spec_t builtinCompanySpecs[TOTAL_BUILTIN_AIRCRAFT_COMPANIES] = {
+  {"Alpha",   120u, 320.0, 1.6, 0.6,  4u, 0.25},
+  {"Bravo",   100u, 100.0, 1.5, 0.2,  5u, 0.10},
+  {"Charlie", 160u, 220.0, 2.2, 0.8,  3u, 0.05},
+  {"Delta",    90u, 120.0, 0.8, 0.62, 2u, 0.22},
+  {"Echo",     30u, 150.0, 5.8, 0.3,  2u, 0.61},
 };
 
-bool IsBatteryDead(Aircraft* plane) {
-    return ((plane->m_airTimeTicks % G_AircraftCompanyCommon[plane->m_id].flightDurationTicks) == 0);
+// the tables are filled before main() runs, so the simulation works without any loading step
+static const bool builtinCatalogLoaded = (LoadBuiltinCompanyCatalog(), true);
+
+void LoadBuiltinCompanyCatalog(void) {
+    std::vector<aircraft_company_spec_t> specs(builtinCompanySpecs, builtinCompanySpecs + TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+    SetCompanyCatalog(specs);
+}
+
+bool DeriveCompanyCommon(const aircraft_company_spec_t& spec, aircraft_company_common_t* common) {
+    if ((spec.name.empty()) || (spec.cruiseSpeedMph == 0) || (spec.batteryCapacityKwh <= 0.0) ||
+        (spec.energyUseKwhPerMile <= 0.0) || (spec.chargeTimeHours <= 0.0) || (spec.passengerCount == 0) ||
+        (spec.faultProbabilityPerHour < 0.0) || (spec.faultProbabilityPerHour > 1.0)) {
+        return false;
+    }
+
+    double rangeMiles = spec.batteryCapacityKwh / spec.energyUseKwhPerMile;
+    double flightDurMin = (rangeMiles / spec.cruiseSpeedMph) * 60.0;
+    double flightDurTicks = std::round(flightDurMin * LOOP_TICKS_PER_MIN);
+    double chargeDurTicks = std::round(spec.chargeTimeHours * LOOP_TICKS_PER_HOUR);
+    // a leg has to last at least one tick, and the tick counters are 32 bits wide
+    if ((flightDurTicks < 1.0) || (chargeDurTicks < 1.0) || (flightDurTicks >= UINT32_MAX) || (chargeDurTicks >= UINT32_MAX)) {
+        return false;
+    }
+
+    common->cruiseSpeedMph = spec.cruiseSpeedMph;
+    common->flightDurationTicks = (uint32_t) flightDurTicks;
+    common->chargeDurationTicks = (uint32_t) chargeDurTicks;
+    common->passengerCount = spec.passengerCount;
+    common->faultProbabilityPerHour = (float) spec.faultProbabilityPerHour;
+    common->batteryKwh = (float) spec.batteryCapacityKwh;
+    common->kwhPerMile = (float) spec.energyUseKwhPerMile;
+    return true;
+}
+
+bool SetCompanyCatalog(const std::vector<aircraft_company_spec_t>& specs) {
+    if ((specs.empty()) || (specs.size() > MAX_AIRCRAFT_COMPANIES)) {
+        std::cout << "ERROR - a company catalog needs 1 to " << MAX_AIRCRAFT_COMPANIES << " companies." << std::endl;
+        return false;
+    }
+
+    aircraft_company_common_t derived[MAX_AIRCRAFT_COMPANIES];
+    for (size_t i = 0; i < specs.size(); i++) {
+        if (DeriveCompanyCommon(specs[i], &derived[i]) == false) {
+            std::cout << "ERROR - company " << specs[i].name << " has invalid specs." << std::endl;
+            return false;
+        }
+    }
+
+    // only replace the tables once the whole catalog is known to be valid
+    for (size_t i = 0; i < specs.size(); i++) {
+        G_AircraftCompanyCommon[i] = derived[i];
+    }
+    companySpecs = specs;
+    return true;
+}
+
+static bool ParseCatalogLine(const std::string& line, aircraft_company_spec_t* spec) {
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ',')) {
+        field.erase(0, field.find_first_not_of(" \t"));
+        field.erase(field.find_last_not_of(" \t\r") + 1);
+        fields.push_back(field);
+    }
+    if (fields.size() != 7) {
+        return false;
+    }
+
+    char* end = nullptr;
+    const char* numbers[6];
+    for (uint8_t i = 0; i < 6; i++) {
+        numbers[i] = fields[i + 1].c_str();
+        strtod(numbers[i], &end);
+        if ((fields[i + 1].empty()) || (*end != '\0')) {
+            return false;
+        }
+    }
+    spec->name = fields[0];
+    spec->cruiseSpeedMph = (uint32_t) strtoul(numbers[0], nullptr, 10);
+    spec->batteryCapacityKwh = strtod(numbers[1], nullptr);
+    spec->energyUseKwhPerMile = strtod(numbers[2], nullptr);
+    spec->chargeTimeHours = strtod(numbers[3], nullptr);
+    spec->passengerCount = (uint32_t) strtoul(numbers[4], nullptr, 10);
+    spec->faultProbabilityPerHour = strtod(numbers[5], nullptr);
+    // the speed and passenger count are whole numbers
+    return (strtod(numbers[0], nullptr) == spec->cruiseSpeedMph) && (strtod(numbers[4], nullptr) == spec->passengerCount);
+}
+
+/** A catalog file has one company per line, in the order of the aircraft ids:
+ *  name, cruise speed mph, battery kWh, energy use kWh/mile, charge time hours, passengers, fault probability per hour
+ * Blank lines and anything after a # are ignored. See AircraftCatalog.csv. */
+bool LoadCompanyCatalog(const char* path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cout << "ERROR - could not open company catalog " << path << std::endl;
+        return false;
+    }
+
+    std::vector<aircraft_company_spec_t> specs;
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        aircraft_company_spec_t spec;
+        if (ParseCatalogLine(line, &spec) == false) {
+            std::cout << "ERROR - " << path << ":" << lineNumber << " expected 7 comma separated fields" << std::endl;
+            return false;
+        }
+        specs.push_back(spec);
+    }
+    return SetCompanyCatalog(specs);
+}
+
+uint32_t GetNumCompanies(void) {
+    return (uint32_t) companySpecs.size();
 }
 
-bool IsChargingComplete(Aircraft* plane) {
-    return ((plane->m_chargeTimeTicks % G_AircraftCompanyCommon[plane->m_id].chargeDurationTicks) == 0);
+const aircraft_company_spec_t& GetCompanySpec(aircraft_id_t id) {
+    return companySpecs[id];
+}
+
+const char* GetCompanyName(aircraft_id_t id) {
+    return companySpecs[id].name.c_str();
 }
 
 uint32_t GetFlightDurTicks(aircraft_id_t id) {
@@ -26,6 +166,52 @@ uint32_t GetChargeDurTicks(aircraft_id_t id) {
     return G_AircraftCompanyCommon[id].chargeDurationTicks;
 }
 
+uint32_t GetFlightTicks(aircraft_id_t id, float stateOfCharge) {
+    const aircraft_company_common_t& common = G_AircraftCompanyCommon[id];
+    if (stateOfCharge >= 1.0f) {
+        return common.flightDurationTicks; // exactly the full flight of the catalog
+    }
+    double rangeMiles = (std::max(stateOfCharge, 0.0f) * (double) common.batteryKwh) / common.kwhPerMile;
+    double ticks = std::round((rangeMiles / common.cruiseSpeedMph) * LOOP_TICKS_PER_HOUR);
+    return std::max((uint32_t) ticks, 1u);
+}
+
+uint32_t GetChargeTicks(aircraft_id_t id, float fromStateOfCharge, float toStateOfCharge) {
+    const aircraft_company_common_t& common = G_AircraftCompanyCommon[id];
+    if ((fromStateOfCharge <= 0.0f) && (toStateOfCharge >= 1.0f)) {
+        return common.chargeDurationTicks; // exactly the full charge of the catalog
+    }
+    // state of charge gained per tick at constant current, so that empty to full takes chargeDurationTicks
+    double rate = (CHARGE_CV_START_SOC + ((1.0 - CHARGE_CV_START_SOC) * std::log(1.0 / CHARGE_CV_CUTOFF))) / common.chargeDurationTicks;
+    double tau = (1.0 - CHARGE_CV_START_SOC) / rate;
+    double from = std::min(std::max((double) fromStateOfCharge, 0.0), 1.0);
+    double to = std::min(std::max((double) toStateOfCharge, 0.0), 1.0);
+
+    double ticks = 0.0;
+    double constantCurrentEnd = std::min(to, CHARGE_CV_START_SOC);
+    if (from < constantCurrentEnd) {
+        ticks += (constantCurrentEnd - from) / rate;
+    }
+    if (to > CHARGE_CV_START_SOC) {
+        double missingAtStart = 1.0 - std::max(from, CHARGE_CV_START_SOC);
+        double missingAtEnd = std::max(1.0 - to, (1.0 - CHARGE_CV_START_SOC) * CHARGE_CV_CUTOFF); // full once the current is at the cutoff
+        if (missingAtStart > missingAtEnd) {
+            ticks += tau * std::log(missingAtStart / missingAtEnd);
+        }
+    }
+    return std::max((uint32_t) std::round(ticks), 1u);
+}
+
+uint32_t GetTripTicks(aircraft_id_t id, double miles) {
+    double ticks = std::round((miles / G_AircraftCompanyCommon[id].cruiseSpeedMph) * LOOP_TICKS_PER_HOUR);
+    return std::max((uint32_t) ticks, 1u);
+}
+
+float GetTripStateOfCharge(aircraft_id_t id, double miles) {
+    const aircraft_company_common_t& common = G_AircraftCompanyCommon[id];
+    return (float) ((miles * common.kwhPerMile) / common.batteryKwh);
+}
+
 uint32_t GetCruiseSpeedMph(aircraft_id_t id) {
     return G_AircraftCompanyCommon[id].cruiseSpeedMph;
 }
@@ -36,4 +222,63 @@ uint32_t GetPassengerCount(aircraft_id_t id) {
 
 float GetFaultProbabilityPerHour(aircraft_id_t id) {
     return G_AircraftCompanyCommon[id].faultProbabilityPerHour;
-}
\ No newline at end of file
+}
+
+/** Function to test the company catalog. The durations derived for the built-in
+ * catalog must equal the ticks that used to be hand-computed in this header:
+ * flights of 100, 40, 37.5, 100 and 51.72 min, charges of 36, 12, 48, 37.2 and 18 min.
+ * A catalog file with a sixth company must load, an invalid one must be rejected
+ * without changing the loaded catalog, and the built-in catalog is restored after.
+ * The state of charge model has to give the same durations for a full flight and a
+ * full charge, half the flight on half a charge, a charge curve that only grows with
+ * the target, the constant current part up to CHARGE_CV_START_SOC taking 57 % of a
+ * full charge, and a charge split in two taking as long as in one go. */
+void CompanyCatalogTest(void) {
+    const uint32_t expectedFlightTicks[TOTAL_BUILTIN_AIRCRAFT_COMPANIES] = {5000u, 2000u, 1875u, 5000u, 2586u};
+    const uint32_t expectedChargeTicks[TOTAL_BUILTIN_AIRCRAFT_COMPANIES] = {1800u, 600u, 2400u, 1860u, 900u};
+
+    LoadBuiltinCompanyCatalog();
+    bool builtinPass = (GetNumCompanies() == TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+    for (uint8_t i = 0; i < TOTAL_BUILTIN_AIRCRAFT_COMPANIES; i++) {
+        builtinPass = builtinPass && (GetFlightDurTicks((aircraft_id_t) i) == expectedFlightTicks[i]) &&
+                      (GetChargeDurTicks((aircraft_id_t) i) == expectedChargeTicks[i]);
+    }
+
+    bool socPass = true;
+    for (uint8_t i = 0; i < TOTAL_BUILTIN_AIRCRAFT_COMPANIES; i++) {
+        aircraft_id_t id = (aircraft_id_t) i;
+        double constantCurrentShare = CHARGE_CV_START_SOC / (CHARGE_CV_START_SOC + ((1.0 - CHARGE_CV_START_SOC) * std::log(1.0 / CHARGE_CV_CUTOFF)));
+        socPass = socPass && (GetFlightTicks(id, 1.0f) == expectedFlightTicks[i]) && (GetChargeTicks(id, 0.0f, 1.0f) == expectedChargeTicks[i]) &&
+                  (std::abs((int32_t) GetFlightTicks(id, 0.5f) - (int32_t) (expectedFlightTicks[i] / 2u)) <= 1) &&
+                  (std::abs((double) GetChargeTicks(id, 0.0f, CHARGE_CV_START_SOC) - (constantCurrentShare * expectedChargeTicks[i])) <= 1.0) &&
+                  (std::abs((int32_t) GetChargeTicks(id, 0.0f, 0.9f) - (int32_t) (GetChargeTicks(id, 0.0f, 0.5f) + GetChargeTicks(id, 0.5f, 0.9f))) <= 1);
+        for (uint32_t percent = 5; percent < 100; percent += 5) {
+            socPass = socPass && (GetChargeTicks(id, 0.0f, percent / 100.0f) <= GetChargeTicks(id, 0.0f, (percent + 5u) / 100.0f));
+        }
+    }
+
+    std::string path = (std::filesystem::temp_directory_path() / "evtolsim_catalog_test.csv").string();
+    std::ofstream file(path);
+    file << "# name, mph, kWh, kWh/mile, charge hours, passengers, fault probability\n";
+    for (uint8_t i = 0; i < TOTAL_BUILTIN_AIRCRAFT_COMPANIES; i++) {
+        const aircraft_company_spec_t& spec = builtinCompanySpecs[i];
+        file << spec.name << ", " << spec.cruiseSpeedMph << ", " << spec.batteryCapacityKwh << ", " << spec.energyUseKwhPerMile <<
+            ", " << spec.chargeTimeHours << ", " << spec.passengerCount << ", " << spec.faultProbabilityPerHour << "\n";
+    }
+    file << "Foxtrot, 150, 200, 1.0, 0.5, 6, 0.15 # 80 min flights, 30 min charges\n";
+    file.close();
+    bool filePass = LoadCompanyCatalog(path.c_str()) && (GetNumCompanies() == 6u) &&
+                    (GetFlightDurTicks((aircraft_id_t) 5) == 80u * LOOP_TICKS_PER_MIN) &&
+                    (GetChargeDurTicks((aircraft_id_t) 5) == 30u * LOOP_TICKS_PER_MIN) &&
+                    (std::string(GetCompanyName((aircraft_id_t) 5)) == "Foxtrot") &&
+                    (GetFlightDurTicks(AIRCRAFT_ID_ECHO) == expectedFlightTicks[AIRCRAFT_ID_ECHO]);
+
+    std::cout << "(the catalog test expects the next error)" << std::endl;
+    std::vector<aircraft_company_spec_t> invalid(1, builtinCompanySpecs[0]);
+    invalid[0].energyUseKwhPerMile = 0.0;
+    filePass = filePass && (SetCompanyCatalog(invalid) == false) && (GetNumCompanies() == 6u);
+    std::filesystem::remove(path);
+
+    LoadBuiltinCompanyCatalog();
+    std::cout << "Company catalog test: " << ((builtinPass && filePass && socPass) ? "PASS" : "FAIL") << std::endl;
+}
@@ -5,64 +5,98 @@
  * 
  * If each tick is 0.02s, then there will be 50 ticks per simulation minute.
  * 
- * Note that the FLIGHT_DUR_TICKS come from the following equation:
+ * The companies come from a catalog loaded at startup, the built-in one below or a
+ * CSV file given with --catalog, with any number of companies up to
+ * MAX_AIRCRAFT_COMPANIES. A catalog lists each company's specs, and the flight and
+ * charge durations are derived from them:
  *  ((Battery capacity [kWh] / energy use at cruise [kWh/mile]) / cruise speed [miles/hour]) * 60 [min/hour] = flightDurMin
- *  => FLIGHT_DUR_TICKS = flightDurMin * LOOP_TICKS_PER_MIN
+ *  => flightDurationTicks = flightDurMin * LOOP_TICKS_PER_MIN, rounded to the nearest tick
+ *  => chargeDurationTicks = charge time [hours] * LOOP_TICKS_PER_HOUR, rounded to the nearest tick
+ *
+ * The simulation only reads the derived values, from G_AircraftCompanyCommon, a flat
+ * array indexed by aircraft id just like the old compile-time table. The specs and
+ * names are kept apart from it so the hot table stays small.
+ *
+ * Every aircraft has a battery state of charge, 0 to 1. A flight drains it linearly,
+ * at the energy use of the company, until the battery is dead, so a flight from a
+ * partial charge is that fraction of a full one. Charging follows a CC-CV curve:
+ * constant current up to CHARGE_CV_START_SOC, then constant voltage with the current
+ * decaying with the charge still missing, until it falls to CHARGE_CV_CUTOFF of the
+ * constant current and the battery counts as full. The rate is set so a charge from
+ * empty to full takes exactly chargeDurationTicks. Time between two states of charge
+ * is closed form on each segment,
+ *  constant current  (to - from) / rate
+ *  constant voltage  tau * ln((1 - from) / (1 - to)), tau = (1 - CHARGE_CV_START_SOC) / rate
+ * so a leg's length is worked out once when it starts and nothing is integrated per
+ * tick. Chargers release an aircraft at the charge target of the run, --charge-target,
+ * full by default.
  */
 
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "Aircraft.h"
 
-#define TOTAL_AIRCRAFTS_IN_SIMULATION   (20u)
+#define DEFAULT_AIRCRAFTS_IN_SIMULATION (20u) // overridden at runtime with --aircraft, see Config.h
 
 #define LOOP_TICKS_PER_MIN              (50u)
+#define LOOP_TICKS_PER_HOUR             (60u * LOOP_TICKS_PER_MIN)
 
-#define ALPHA_CRUISE_SPEED_MPH          (120u)
-#define ALPHA_FLIGHT_DUR_TICKS          (100u * LOOP_TICKS_PER_MIN) // 100 min
-#define ALPHA_CHARGE_DUR_TICKS          (36u * LOOP_TICKS_PER_MIN)
-#define ALPHA_PASSENGER_COUNT           (4u)
-#define ALPHA_FAULT_PROB_PER_HR         (0.25f) // fault probability per hour
+#define MAX_AIRCRAFT_COMPANIES          (64u) // size of the hot table, 1.75 KB
 
-#define BRAVO_CRUISE_SPEED_MPH          (100u)
-#define BRAVO_FLIGHT_DUR_TICKS          (40u * LOOP_TICKS_PER_MIN)
-#define BRAVO_CHARGE_DUR_TICKS          (12u * LOOP_TICKS_PER_MIN)
-#define BRAVO_PASSENGER_COUNT           (5u)
-#define BRAVO_FAULT_PROB_PER_HR         (0.10f)
+#define CHARGE_CV_START_SOC             (0.8) // state of charge where constant current ends and constant voltage starts
+#define CHARGE_CV_CUTOFF                (0.05) // fraction of the constant current where constant voltage ends with a full battery
 
-#define CHARLIE_CRUISE_SPEED_MPH        (160u)
-#define CHARLIE_FLIGHT_DUR_TICKS        ((uint32_t) (37.5f * LOOP_TICKS_PER_MIN)) // casting as uint32 to ensure data type aligns with the structure defined below
-#define CHARLIE_CHARGE_DUR_TICKS        (48u * LOOP_TICKS_PER_MIN)
-#define CHARLIE_PASSENGER_COUNT         (3u)
-#define CHARLIE_FAULT_PROB_PER_HR       (0.05f)
-
-#define DELTA_CRUISE_SPEED_MPH          (90u)
-#define DELTA_FLIGHT_DUR_TICKS          (100u * LOOP_TICKS_PER_MIN)
-#define DELTA_CHARGE_DUR_TICKS          ((uint32_t) (37.2f * LOOP_TICKS_PER_MIN)) // casting as uint32 to ensure data type aligns with the structure defined below
-#define DELTA_PASSENGER_COUNT           (2u)
-#define DELTA_FAULT_PROB_PER_HR         (0.22f)
-
-#define ECHO_CRUISE_SPEED_MPH           (30u)
-#define ECHO_FLIGHT_DUR_TICKS           ((uint32_t) (51.72f * LOOP_TICKS_PER_MIN)) // casting as uint32 to ensure data type aligns with the structure defined below
-#define ECHO_CHARGE_DUR_TICKS           (18u * LOOP_TICKS_PER_MIN)
-#define ECHO_PASSENGER_COUNT            (2u)
-#define ECHO_FAULT_PROB_PER_HR          (0.61f)
+// Specs of one company as written in a catalog
+typedef struct {
+  std::string name;
+  uint32_t cruiseSpeedMph;
+  double batteryCapacityKwh;
+  double energyUseKwhPerMile; // at cruise
+  double chargeTimeHours; // from empty to full
+  uint32_t passengerCount;
+  double faultProbabilityPerHour;
+} aircraft_company_spec_t;
 
+// Values used by the simulation, derived from the specs
 typedef struct {
   uint32_t cruiseSpeedMph;
   uint32_t flightDurationTicks;
   uint32_t chargeDurationTicks;
   uint32_t passengerCount;
   float faultProbabilityPerHour;
+  float batteryKwh;
+  float kwhPerMile; // at cruise
 } aircraft_company_common_t;
 
-bool IsBatteryDead(Aircraft* plane);
-bool IsChargingComplete(Aircraft* plane);
+extern aircraft_company_common_t G_AircraftCompanyCommon[MAX_AIRCRAFT_COMPANIES];
+
+void LoadBuiltinCompanyCatalog(void); // Alpha to Echo, the catalog used when --catalog isn't given
+bool LoadCompanyCatalog(const char* path); // reads a CSV catalog, prints an error and keeps the current catalog on failure
+bool SetCompanyCatalog(const std::vector<aircraft_company_spec_t>& specs); // validates the specs and derives the hot table
+bool DeriveCompanyCommon(const aircraft_company_spec_t& spec, aircraft_company_common_t* common);
+uint32_t GetNumCompanies(void);
+const aircraft_company_spec_t& GetCompanySpec(aircraft_id_t id);
+const char* GetCompanyName(aircraft_id_t id);
 
-uint32_t GetFlightDurTicks(aircraft_id_t id);
-uint32_t GetChargeDurTicks(aircraft_id_t id);
+/** Every flight and charge session gets its end tick when it starts, from the duration
+ * of the company, so the checks made on every tick are a single compare and don't
+ * depend on the air and charge time totals lining up with whole legs. */
+inline bool IsBatteryDead(const Aircraft* plane, uint32_t tick) {return (tick >= plane->m_legEndTick);}
+inline bool IsChargingComplete(const Aircraft* plane, uint32_t tick) {return (tick >= plane->m_legEndTick);}
+inline bool IsLegInProgress(const Aircraft* plane) {return (plane->m_state == AIRCRAFT_STATE_FLYING) || (plane->m_state == AIRCRAFT_STATE_CHARGING);}
+
+uint32_t GetFlightDurTicks(aircraft_id_t id); // from full to dead
+uint32_t GetChargeDurTicks(aircraft_id_t id); // from empty to full
+uint32_t GetFlightTicks(aircraft_id_t id, float stateOfCharge); // from stateOfCharge until the battery is dead, at least one tick
+uint32_t GetChargeTicks(aircraft_id_t id, float fromStateOfCharge, float toStateOfCharge); // along the charge curve, at least one tick
+uint32_t GetTripTicks(aircraft_id_t id, double miles); // flight of the given length at cruise, at least one tick
+float GetTripStateOfCharge(aircraft_id_t id, double miles); // share of a full battery a flight of the given length uses
 uint32_t GetCruiseSpeedMph(aircraft_id_t id);
 uint32_t GetPassengerCount(aircraft_id_t id);
-float GetFaultProbabilityPerHour(aircraft_id_t id);
\ No newline at end of file
+float GetFaultProbabilityPerHour(aircraft_id_t id);
+
+void CompanyCatalogTest(void);
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "AnalyticSimulation.h"
+
+#include "AircraftCompanyCommon.h"
+#include "EventSimulation.h"
+#include "RandomGen.h"
+#include "Simulation.h"
+
+#define ANALYTIC_COUNTERS_PER_AIRCRAFT (4u)
+#define ANALYTIC_REFERENCE_STEPS_PER_AIRCRAFT (8u) // an aircraft has 2 or 3 transitions a cycle, so a reference that charges each cycle is sampled well before
+
+// 64 bit FNV-1a over the words of a state signature
+static uint64_t HashSignature(const std::vector<uint32_t>& signature) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (uint32_t word : signature) {
+    hash ^= word;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static void AppendCounters(const Aircraft* aircrafts, uint32_t numAircraft, std::vector<uint32_t>* counters) {
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    counters->push_back(aircrafts[i].m_airTimeTicks);
+    counters->push_back(aircrafts[i].m_numFlights);
+    counters->push_back(aircrafts[i].m_chargeTimeTicks);
+    counters->push_back(aircrafts[i].m_numChargeSessions);
+  }
+}
+
+// Adds the counters gained since a remembered state, times the number of skipped periods
+static void AddPeriods(Aircraft* aircrafts, uint32_t numAircraft, const uint32_t* countersAtStart, uint32_t periods) {
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    const uint32_t* start = &countersAtStart[i * ANALYTIC_COUNTERS_PER_AIRCRAFT];
+    aircrafts[i].m_airTimeTicks += periods * (aircrafts[i].m_airTimeTicks - start[0]);
+    aircrafts[i].m_numFlights += periods * (aircrafts[i].m_numFlights - start[1]);
+    aircrafts[i].m_chargeTimeTicks += periods * (aircrafts[i].m_chargeTimeTicks - start[2]);
+    aircrafts[i].m_numChargeSessions += periods * (aircrafts[i].m_numChargeSessions - start[3]);
+  }
+}
+
+// The tick loop draws faults on every whole hour after tick 0, up to and including the last tick
+static void GenerateFaultsUpTo(Aircraft* aircrafts, uint32_t numAircraft, const simulation_config_t& config) {
+  for (uint32_t hour = 1; hour <= (config.simulationTicks / LOOP_TICKS_PER_HOUR); hour++) {
+    GenerateHourlyFaults(aircrafts, numAircraft, hour, config.seed);
+  }
+}
+
+/** With at least one charger per aircraft nobody ever waits in line, so every aircraft
+ * flies its first flight on the charge it started with and then cycles through one
+ * charge session up to the charge target and one flight on its own, and its counters
+ * follow directly from the horizon. Whole cycles come first, then the partial charge
+ * session or flight of the last cycle, closed out at the horizon like the tick loop. */
+static void SolveWithoutContention(Aircraft* aircrafts, uint32_t numAircraft, uint32_t simulationTicks, float chargeTargetSoc) {
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    Aircraft* pCurCraft = &aircrafts[i];
+    uint32_t firstFlightTicks = GetFlightTicks(pCurCraft->m_id, pCurCraft->m_stateOfCharge);
+
+    pCurCraft->m_numFlights++;
+    pCurCraft->m_stateStartTick = simulationTicks;
+    if (simulationTicks < firstFlightTicks) {
+      pCurCraft->m_state = AIRCRAFT_STATE_FLYING;
+      pCurCraft->m_airTimeTicks += simulationTicks;
+      pCurCraft->m_legEndTick = firstFlightTicks;
+      continue;
+    }
+
+    uint32_t flightTicks = GetFlightTicks(pCurCraft->m_id, chargeTargetSoc);
+    uint32_t chargeTicks = GetChargeTicks(pCurCraft->m_id, 0.0f, chargeTargetSoc);
+    uint32_t cycleTicks = simulationTicks - firstFlightTicks;
+    uint32_t cycles = cycleTicks / (chargeTicks + flightTicks);
+    uint32_t remainder = cycleTicks % (chargeTicks + flightTicks);
+
+    pCurCraft->m_airTimeTicks += firstFlightTicks + cycles * flightTicks;
+    pCurCraft->m_numFlights += cycles;
+    pCurCraft->m_numChargeSessions += cycles + 1u; // the last cycle's charge session has started by the horizon
+    pCurCraft->m_chargeTimeTicks += cycles * chargeTicks;
+    if (remainder < chargeTicks) {
+      // the battery died and a charger was free on the same tick
+      pCurCraft->m_state = AIRCRAFT_STATE_CHARGING;
+      pCurCraft->m_stateOfCharge = 0.0f;
+      pCurCraft->m_chargeTimeTicks += remainder;
+      pCurCraft->m_legEndTick = simulationTicks - remainder + chargeTicks;
+    } else {
+      pCurCraft->m_state = AIRCRAFT_STATE_FLYING;
+      pCurCraft->m_stateOfCharge = chargeTargetSoc;
+      pCurCraft->m_numFlights++;
+      pCurCraft->m_chargeTimeTicks += chargeTicks;
+      pCurCraft->m_airTimeTicks += remainder - chargeTicks;
+      pCurCraft->m_legEndTick = simulationTicks - (remainder - chargeTicks) + flightTicks;
+    }
+  }
+}
+
+/** The search remembers only a hash of the state on the samples it takes, 12 bytes per
+ * sample, so long transients before the timeline settles into its cycle still fit. A
+ * repeated hash gives a candidate period. The full state and counters are then saved,
+ * and the candidate is only accepted if the exact same state comes back one candidate
+ * period later, so a hash collision can never skip ahead wrongly.
+ *
+ * Taking the state of the whole fleet costs as much as many events, so it is sampled
+ * when a charger is handed out to one reference aircraft, aircraft 0 to begin with.
+ * Once the fleet repeats, the reference gets a charger at the same point of every
+ * period, so its samples repeat with the period of the whole fleet. An aircraft a
+ * policy leaves in line for good would never be sampled, so after
+ * ANALYTIC_REFERENCE_STEPS_PER_AIRCRAFT ticks with transitions per aircraft without a
+ * sample, the next aircraft handed a charger becomes the reference.
+ *
+ * The state leaves out how long the line has waited unless the policy looks at it,
+ * see appendStateSignature(); the counters never depend on it. Some fleets still take
+ * very long to repeat at all: with the default fleet on 3 chargers, the order aircraft
+ * reach the chargers keeps drifting for about 5800 hr before the first state comes
+ * back, and until then the run is handled event by event. */
+void RunAnalyticSimulation(Aircraft* aircrafts, const simulation_config_t& config, analytic_solution_t* solution) {
+  analytic_solution_t localSolution;
+  if (solution == nullptr) {
+    solution = &localSolution;
+  }
+  *solution = {false, false, 0, 0, 0, 0};
+
+  uint32_t numAircraft = config.numAircraft;
+  if (config.numChargers >= numAircraft) {
+    solution->contentionFree = true;
+    SolveWithoutContention(aircrafts, numAircraft, config.simulationTicks, config.chargeTargetSoc);
+    GenerateFaultsUpTo(aircrafts, numAircraft, config);
+    return;
+  }
+
+  EventSimulation sim(aircrafts, config);
+  sim.start(false);
+
+  std::unordered_map<uint64_t, uint32_t> tickByHash;
+  std::vector<uint32_t> signature;
+  std::vector<uint32_t> anchorSignature; // state and counters saved when a candidate period was found
+  std::vector<uint32_t> anchorCounters;
+  uint32_t anchorTick = 0;
+  uint32_t candidateTicks = 0; // 0 while searching for a repeated hash
+  uint32_t reference = 0; // aircraft whose charge sessions are sampled
+  uint32_t stepsUnsampled = 0;
+
+  bool searching = true;
+  while (searching && sim.step(config.simulationTicks)) {
+    uint32_t tick = sim.getCurrentTick();
+    if (++stepsUnsampled > (ANALYTIC_REFERENCE_STEPS_PER_AIRCRAFT * numAircraft)) {
+      for (uint32_t i = 0; i < numAircraft; i++) {
+        if ((aircrafts[i].m_state == AIRCRAFT_STATE_CHARGING) && (aircrafts[i].m_stateStartTick == tick)) {
+          reference = i; // the reference hasn't had a charger in a long time, it may never get one again
+          break;
+        }
+      }
+    }
+    if ((aircrafts[reference].m_state != AIRCRAFT_STATE_CHARGING) || (aircrafts[reference].m_stateStartTick != tick)) {
+      continue; // only sample the state when the reference gets a charger
+    }
+    stepsUnsampled = 0;
+    signature.clear();
+    sim.appendStateSignature(&signature);
+
+    if (candidateTicks != 0) {
+      if (tick < (anchorTick + candidateTicks)) {
+        continue;
+      }
+      if ((tick == (anchorTick + candidateTicks)) && (signature == anchorSignature)) {
+        solution->periodFound = true;
+        solution->periodStartTick = anchorTick;
+        solution->periodTicks = candidateTicks;
+        solution->periodsSkipped = (config.simulationTicks - tick) / candidateTicks;
+        solution->ticksSkipped = solution->periodsSkipped * candidateTicks;
+        if (solution->periodsSkipped > 0) {
+          AddPeriods(aircrafts, numAircraft, anchorCounters.data(), solution->periodsSkipped);
+          sim.skipAhead(solution->ticksSkipped);
+        }
+        searching = false;
+        continue;
+      }
+      candidateTicks = 0; // the hashes collided, keep searching
+    }
+
+    uint64_t hash = HashSignature(signature);
+    auto match = tickByHash.find(hash);
+    if (match != tickByHash.end()) {
+      anchorTick = tick;
+      candidateTicks = tick - match->second;
+      anchorSignature = signature;
+      anchorCounters.clear();
+      AppendCounters(aircrafts, numAircraft, &anchorCounters);
+      match->second = tick;
+    } else if (tickByHash.size() < ANALYTIC_MAX_SNAPSHOTS) {
+      tickByHash.emplace(hash, tick);
+    } else {
+      searching = false; // no period short enough to remember, the rest of the run is handled event by event
+    }
+  }
+  while (sim.step(config.simulationTicks)) {
+  }
+  sim.finish(config.simulationTicks);
+
+  GenerateFaultsUpTo(aircrafts, numAircraft, config);
+}
+
+/** Function to test the analytic fast path against the event engine over horizons that
+ * are too long for the tick loop in a self test. Every case runs the default fleet, one
+ * of each company in turn, and every per-aircraft counter must match. Where the fleet
+ * is known to settle into a cycle, or needs no simulation at all, the fast path must
+ * also have found it and skipped ahead, otherwise it isn't fast. */
+void AnalyticSimulationTest(void) {
+  typedef struct {
+    uint32_t numChargers;
+    charge_policy_t policy;
+    uint32_t horizonHr;
+    bool expectSkip;
+  } analytic_test_case_t;
+  const analytic_test_case_t testCases[] = {
+    {DEFAULT_CHARGERS, CHARGE_POLICY_FIFO, 168u, false}, {DEFAULT_CHARGERS, CHARGE_POLICY_FIFO, 8760u, true},
+    {DEFAULT_CHARGERS, CHARGE_POLICY_SHORTEST_CHARGE_FIRST, 8760u, true},
+    {DEFAULT_CHARGERS, CHARGE_POLICY_MOST_PASSENGER_MILES, 8760u, true},
+    {2u, CHARGE_POLICY_AGING, 8760u, true}, {5u, CHARGE_POLICY_MOST_PASSENGER_MILES, 8760u, true},
+    {DEFAULT_AIRCRAFTS_IN_SIMULATION, CHARGE_POLICY_FIFO, 8760u, true}, // no contention, solved per aircraft
+  };
+
+  for (const analytic_test_case_t& testCase : testCases) {
+    simulation_config_t config = DefaultSimulationConfig();
+    config.numChargers = testCase.numChargers;
+    config.simulationTicks = testCase.horizonHr * LOOP_TICKS_PER_HOUR;
+    config.policy = testCase.policy;
+
+    Aircraft eventAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+    for (uint8_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+      eventAircrafts[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+    }
+    Aircraft analyticAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+    std::copy(eventAircrafts, eventAircrafts + DEFAULT_AIRCRAFTS_IN_SIMULATION, analyticAircrafts);
+
+    analytic_solution_t solution;
+    RunEventSimulation(eventAircrafts, config);
+    RunAnalyticSimulation(analyticAircrafts, config, &solution);
+
+    uint32_t mismatches = CountMismatchedAircraft(eventAircrafts, analyticAircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION);
+    bool skipped = solution.contentionFree || (solution.periodsSkipped > 0);
+    bool pass = (mismatches == 0) && ((testCase.expectSkip == false) || skipped);
+    std::cout << "Analytic test, " << config.numChargers << " chargers, " << testCase.horizonHr << " hr, " <<
+      GetChargePolicyName(config.policy) << ": " << (pass ? "PASS" : "FAIL") << " (" << mismatches << " mismatched aircraft, ";
+    if (solution.contentionFree) {
+      std::cout << "no contention)" << std::endl;
+    } else {
+      std::cout << "period " << (solution.periodTicks / (double) LOOP_TICKS_PER_MIN) << " min, " <<
+        solution.periodsSkipped << " periods skipped)" << std::endl;
+    }
+  }
+}
@@ -0,0 +1,44 @@
+/** Defines the analytic fast path. Faults only add to m_numFaults and never change
+ * when an aircraft flies or charges, so the timeline is fully set by the flight and
+ * charge durations and the contention for chargers. Such a deterministic system ends
+ * up repeating itself: once every aircraft is in the same state with the same ticks
+ * left of it, and the line in the same order, as at some earlier tick, everything
+ * after repeats with that period.
+ *
+ * The fast path runs the event-driven engine without fault checks, remembering a hash
+ * of the state each time a charger is handed out to a reference aircraft, until a
+ * state repeats. How long the line has waited is not part of the state unless the
+ * charge policy looks at it, as it changes nothing else. It then adds the counters
+ * of one period as many times as whole periods fit before the horizon, moves the
+ * simulation that far ahead, and runs the last partial period event by event. The
+ * faults are drawn afterwards, hour by hour, from the same random streams as the other
+ * engines, so the results are identical to the tick loop.
+ *
+ * With at least one charger per aircraft there is no contention at all. The fleet as
+ * a whole may then take very long to repeat, but every aircraft repeats its own flight
+ * and charge cycle, so the counters are computed per aircraft without simulating.
+ *
+ * Only the per-aircraft counters are produced, the streaming statistics of
+ * Statistics.h are not recorded in this mode. */
+
+#pragma once
+
+#include <cstdint>
+
+#include "Aircraft.h"
+#include "Config.h"
+
+// Remembered state hashes after which the fast path stops looking for a period and runs the rest event by event
+#define ANALYTIC_MAX_SNAPSHOTS (1u << 22)
+
+typedef struct {
+  bool contentionFree; // at least one charger per aircraft, every aircraft was solved on its own without simulating
+  bool periodFound;
+  uint32_t periodStartTick; // tick of the earlier of the two matching states that confirmed the period
+  uint32_t periodTicks;
+  uint32_t periodsSkipped;
+  uint32_t ticksSkipped; // periodsSkipped * periodTicks, the simulated time that was not handled event by event
+} analytic_solution_t;
+
+void RunAnalyticSimulation(Aircraft* aircrafts, const simulation_config_t& config, analytic_solution_t* solution = nullptr);
+void AnalyticSimulationTest(void);
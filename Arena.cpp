@@ -0,0 +1,81 @@
+#include "Arena.h"
+
+static thread_local std::pmr::memory_resource* t_simulationMemory = nullptr;
+
+std::pmr::memory_resource* GetSimulationMemory(void) {
+  return (t_simulationMemory != nullptr) ? t_simulationMemory : std::pmr::new_delete_resource();
+}
+
+ArenaScope::ArenaScope(SimulationArena* arena)
+{
+  m_previous = t_simulationMemory;
+  t_simulationMemory = arena;
+}
+
+ArenaScope::~ArenaScope() {
+  t_simulationMemory = m_previous;
+}
+
+SimulationArena::SimulationArena(size_t initialBytes)
+{
+  m_blocks = nullptr;
+  m_offset = 0;
+  m_bytesUsed = 0;
+  m_bytesReserved = 0;
+  m_numBlocks = 0;
+  addBlock(initialBytes);
+}
+
+SimulationArena::~SimulationArena() {
+  freeBlocks();
+}
+
+void SimulationArena::addBlock(size_t bytes) {
+  Block* block = (Block*) ::operator new(sizeof(Block) + bytes);
+  block->next = m_blocks;
+  block->bytes = bytes;
+  m_blocks = block;
+  m_offset = 0;
+  m_bytesReserved += bytes;
+  m_numBlocks++;
+}
+
+void SimulationArena::freeBlocks(void) {
+  while (m_blocks != nullptr) {
+    Block* next = m_blocks->next;
+    ::operator delete(m_blocks);
+    m_blocks = next;
+  }
+  m_offset = 0;
+  m_bytesReserved = 0;
+  m_numBlocks = 0;
+}
+
+/** Block headers are 16 bytes and blocks come from operator new, so the first byte after
+ * the header is aligned for anything up to alignof(std::max_align_t) and larger
+ * alignments are padded for like any other. */
+void* SimulationArena::do_allocate(size_t bytes, size_t alignment) {
+  uintptr_t base = (uintptr_t) (m_blocks + 1);
+  size_t start = ((base + m_offset + alignment - 1) & ~((uintptr_t) alignment - 1)) - base;
+  if (start + bytes > m_blocks->bytes) {
+    // the rest of the block is left unused, the next one at least doubles the arena
+    size_t blockBytes = (m_bytesReserved > bytes + alignment) ? m_bytesReserved : bytes + alignment;
+    m_bytesUsed += m_blocks->bytes - m_offset;
+    addBlock(blockBytes);
+    base = (uintptr_t) (m_blocks + 1);
+    start = ((base + alignment - 1) & ~((uintptr_t) alignment - 1)) - base;
+  }
+  m_bytesUsed += start + bytes - m_offset;
+  m_offset = start + bytes;
+  return (void*) (base + start);
+}
+
+void SimulationArena::reset(void) {
+  if (m_numBlocks > 1) {
+    size_t totalBytes = m_bytesReserved;
+    freeBlocks();
+    addBlock(totalBytes);
+  }
+  m_offset = 0;
+  m_bytesUsed = 0;
+}
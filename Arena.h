@@ -0,0 +1,70 @@
+/** Defines the simulation arena. A run's fleet, charge line, pending events, demand
+ * pool and SoA arrays are allocated through GetSimulationMemory(), which is the heap
+ * unless an ArenaScope made an arena current on the thread. An arena hands out memory
+ * by bumping an offset in large blocks and never frees anything on its own; reset()
+ * drops all of it at once, between replications. The first reset of an arena that had
+ * to grow merges its blocks into one as large as all of them, so from the next
+ * replication of the same size on the run allocates nothing at all.
+ *
+ * Everything allocated from an arena must be gone before it is reset. The batch runner
+ * keeps one arena per task, see RunBatch(). The tick, event, SoA and demand engines
+ * make no heap allocation once their arrays are sized at the start of a run, which
+ * ArenaTest() in HeapCounter.h checks by counting every operator new of the program;
+ * that is part of the program, not the library, so a program that embeds the library
+ * keeps its own operator new. The network engine, the timeline, checkpoints and the
+ * output files still use the heap. */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#define ARENA_MIN_BLOCK_BYTES (64u << 10)
+
+class SimulationArena : public std::pmr::memory_resource
+{
+public:
+  explicit SimulationArena(size_t initialBytes = ARENA_MIN_BLOCK_BYTES);
+  ~SimulationArena();
+  SimulationArena(const SimulationArena&) = delete;
+  SimulationArena& operator=(const SimulationArena&) = delete;
+
+  void reset(void); // frees everything allocated since the last reset
+  size_t getBytesUsed(void) const {return m_bytesUsed;}
+  size_t getBytesReserved(void) const {return m_bytesReserved;}
+  uint32_t getNumBlocks(void) const {return m_numBlocks;}
+
+private:
+  struct Block {
+    Block* next; // older block
+    size_t bytes; // usable bytes after this header
+  };
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void*, size_t, size_t) override {} // reset() frees it
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {return this == &other;}
+  void addBlock(size_t bytes);
+  void freeBlocks(void);
+
+  Block* m_blocks; // newest first, allocations come from the newest
+  size_t m_offset; // into the newest block
+  size_t m_bytesUsed; // since the last reset, alignment padding included
+  size_t m_bytesReserved; // of every block
+  uint32_t m_numBlocks;
+};
+
+// Makes arena the simulation memory of the calling thread until the scope ends
+class ArenaScope
+{
+public:
+  explicit ArenaScope(SimulationArena* arena);
+  ~ArenaScope();
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+  std::pmr::memory_resource* m_previous;
+};
+
+std::pmr::memory_resource* GetSimulationMemory(void); // the current arena of the thread, the heap outside an ArenaScope
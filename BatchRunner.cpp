@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <vector>
+
+#include "BatchRunner.h"
+
+#include "Arena.h"
+#include "Metrics.h"
+#include "RandomGen.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
+
+/** The replications are split into a fixed number of tasks, not a number based on the
+ * thread count, so the per-task duration statistics are merged in the same order and
+ * give the same summary on any number of threads. It is still small enough for stealing
+ * to even out the load. */
+#define MAX_REPLICATION_TASKS (256u)
+
+/** Runs one replication with a seed derived from the master seed. If the random fleet
+ * is missing a company, the fleet is drawn again from the next derived seed, which
+ * keeps the batch reproducible instead of stopping it. */
+void RunReplication(const simulation_config_t& config, uint32_t replication, data_avgs_and_totals_t* results, uint32_t* numFleetRedraws,
+                    SimulationStatistics* durations, ResultTables* tables, demand_summary_t* demand) {
+  simulation_config_t replicationConfig = config;
+  replicationConfig.numThreads = 1; // replications are already spread over the threads, a network runs on the one it got
+  std::pmr::vector<Aircraft> aircrafts(config.numAircraft, GetSimulationMemory());
+
+  uint32_t attempt = 0;
+  replicationConfig.seed = DeriveSeed(config.seed, replication, attempt);
+  while (CreateRandomAircraftIds(aircrafts.data(), config.numAircraft, replicationConfig.seed) == false) {
+    attempt++;
+    replicationConfig.seed = DeriveSeed(config.seed, replication, attempt);
+  }
+  *numFleetRedraws = attempt;
+
+  bool withDemand = (config.tripRequestsPerHour > 0.0);
+  demand_summary_t replicationDemand;
+  MetricsRunStart(replicationConfig);
+  RunSimulationEngine(aircrafts.data(), replicationConfig, durations, nullptr, withDemand ? &replicationDemand : nullptr);
+  MetricsRunFinish(aircrafts.data(), config.numAircraft, config.simulationTicks);
+  double passengerMiles[MAX_AIRCRAFT_COMPANIES];
+  if (withDemand) {
+    GetDemandPassengerMiles(replicationDemand, passengerMiles);
+  }
+  ComputeDataAveragesAndTotals(results, aircrafts.data(), config.numAircraft, withDemand ? passengerMiles : nullptr);
+  if (tables != nullptr) {
+    tables->addRun(replication, replicationConfig.seed, attempt, aircrafts.data(), config.numAircraft, config.simulationTicks,
+                   withDemand ? &replicationDemand : nullptr);
+  }
+  if (withDemand && (demand != nullptr)) {
+    *demand = replicationDemand;
+  }
+}
+
+void RunBatch(const simulation_config_t& config, batch_summary_t* summary, std::vector<ResultTables>* taskTables) {
+  uint32_t numReplications = config.numReplications;
+  uint32_t numCompanies = GetNumCompanies();
+  std::vector<data_avgs_and_totals_t> results((size_t) numReplications * numCompanies);
+  std::vector<uint32_t> redraws(numReplications);
+  uint32_t numTasks = std::min(numReplications, MAX_REPLICATION_TASKS);
+  std::vector<SimulationStatistics> taskDurations(numTasks);
+  bool withDemand = (config.tripRequestsPerHour > 0.0);
+  std::vector<demand_summary_t> taskDemand(withDemand ? numTasks : 0u);
+  std::vector<double> servedPercent(withDemand ? numReplications : 0u);
+  std::vector<double> loadFactor(withDemand ? numReplications : 0u);
+  if (taskTables != nullptr) {
+    taskTables->assign(numTasks, ResultTables());
+  }
+
+  MetricsBatchStart(numReplications);
+  auto start = std::chrono::steady_clock::now();
+  {
+    ThreadPool pool(config.numThreads);
+    for (uint32_t task = 0; task < numTasks; task++) {
+      // every task writes its own slots of the result arrays, so no locking is needed
+      uint32_t first = (uint32_t) (((uint64_t) numReplications * task) / numTasks);
+      uint32_t last = (uint32_t) (((uint64_t) numReplications * (task + 1)) / numTasks);
+      ResultTables* tables = (taskTables != nullptr) ? &(*taskTables)[task] : nullptr;
+      pool.submit([&config, &results, &redraws, &taskDurations, &taskDemand, &servedPercent, &loadFactor, withDemand, numCompanies, task,
+                   first, last, tables] {
+        // the replications of a task reuse one arena, after the first one it doesn't grow
+        SimulationArena arena;
+        demand_summary_t demand;
+        for (uint32_t r = first; r < last; r++) {
+          {
+            ArenaScope scope(&arena);
+            RunReplication(config, r, &results[(size_t) r * numCompanies], &redraws[r], &taskDurations[task], tables,
+                           withDemand ? &demand : nullptr);
+          }
+          arena.reset();
+          if (withDemand) {
+            double passengerMiles = 0.0, seatMiles = 0.0;
+            for (uint32_t i = 0; i < numCompanies; i++) {
+              passengerMiles += demand.companies[i].passengerMiles;
+              seatMiles += demand.companies[i].seatMiles;
+            }
+            servedPercent[r] = (demand.requests > 0) ? ((100.0 * demand.served) / demand.requests) : 0.0;
+            loadFactor[r] = (seatMiles > 0.0) ? ((100.0 * passengerMiles) / seatMiles) : 0.0;
+            MergeDemandSummary(&taskDemand[task], demand);
+          }
+        }
+      });
+    }
+    pool.wait();
+    summary->numThreads = pool.size();
+  }
+  summary->elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // reduce in replication order so the summary doesn't depend on the thread count
+  summary->numReplications = numReplications;
+  summary->numFleetRedraws = 0;
+  summary->demand = demand_summary_t();
+  for (uint32_t task = 0; task < numTasks; task++) {
+    summary->durations.merge(taskDurations[task]);
+    if (withDemand) {
+      MergeDemandSummary(&summary->demand, taskDemand[task]);
+    }
+  }
+  for (uint32_t r = 0; r < numReplications; r++) {
+    summary->numFleetRedraws += redraws[r];
+    double fleetPassengerMiles = 0.0;
+    for (uint32_t i = 0; i < numCompanies; i++) {
+      const data_avgs_and_totals_t& result = results[(size_t) r * numCompanies + i];
+      fleetPassengerMiles += result.totalPassengerMiles;
+      double values[TOTAL_BATCH_METRICS] = {
+        result.avgMinPerFlight, result.avgMinPerChargeSession,
+        (double) result.totalNumFaults, result.totalPassengerMiles
+      };
+      for (uint8_t m = 0; m < TOTAL_BATCH_METRICS; m++) {
+        // an average is undefined when a company never finished reaching a charger, e.g. on short horizons
+        if (std::isnan(values[m]) == false) {
+          summary->stats[i][m].add(values[m]);
+        }
+      }
+    }
+    summary->fleetPassengerMiles.add(fleetPassengerMiles);
+    if (withDemand) {
+      summary->demandServedPercent.add(servedPercent[r]);
+      summary->demandLoadFactor.add(loadFactor[r]);
+    }
+  }
+}
+
+void WriteBatchSummaryToOutputFile(const simulation_config_t& config, const batch_summary_t& summary) {
+  const char* metricNames[TOTAL_BATCH_METRICS] = {
+    "avg flight time (min)", "avg time charging (min)", "total num faults", "total passenger miles"
+  };
+
+  std::ofstream myfile;
+  myfile.open(config.outputPath);
+  myfile << std::fixed << std::setprecision(2) <<
+    "Batch of " << summary.numReplications << " replications, seed " << config.seed <<
+    ", " << config.numAircraft << " aircraft, " << config.numChargers << " chargers, " <<
+    (config.simulationTicks / (double) LOOP_TICKS_PER_HOUR) << " hr, " <<
+    GetChargePolicyName(config.policy) << " charging\n" <<
+    "mean, standard deviation and 95% confidence interval over replications\n" <<
+    "----------------------------------------------------------------------------------------\n";
+
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    myfile << GetCompanyName((aircraft_id_t) i) << "\n";
+    for (uint8_t m = 0; m < TOTAL_BATCH_METRICS; m++) {
+      const WelfordAccumulator& stat = summary.stats[i][m];
+      double halfWidth = stat.getConfidenceHalfWidth95();
+      myfile << "  " << std::left << std::setw(26) << metricNames[m] << std::right <<
+        "mean " << stat.getMean() <<
+        ", std dev " << std::sqrt(stat.getVariance()) <<
+        ", 95% CI [" << (stat.getMean() - halfWidth) << ", " << (stat.getMean() + halfWidth) << "]" <<
+        ", n = " << stat.getCount() << "\n";
+    }
+    if (config.mode != SIMULATION_MODE_ANALYTIC) {
+      WriteDurationStatistics(myfile, summary.durations.getCompany((aircraft_id_t) i));
+    }
+    myfile << "----------------------------------------------------------------------------------------\n";
+  }
+  double fleetHalfWidth = summary.fleetPassengerMiles.getConfidenceHalfWidth95();
+  myfile << "Fleet - total passenger miles mean " << summary.fleetPassengerMiles.getMean() <<
+    ", 95% CI [" << (summary.fleetPassengerMiles.getMean() - fleetHalfWidth) << ", " <<
+    (summary.fleetPassengerMiles.getMean() + fleetHalfWidth) << "]\n";
+  if (config.mode != SIMULATION_MODE_ANALYTIC) {
+    WriteChargeSiteStatistics(myfile, summary.durations); // the analytic fast path records no streaming statistics
+  }
+  if (config.tripRequestsPerHour > 0.0) {
+    const char* demandNames[2] = {"requests served (%)", "load factor (%)"};
+    const WelfordAccumulator* demandStats[2] = {&summary.demandServedPercent, &summary.demandLoadFactor};
+    myfile << "Demand per replication\n";
+    for (uint8_t m = 0; m < 2; m++) {
+      double halfWidth = demandStats[m]->getConfidenceHalfWidth95();
+      myfile << "  " << std::left << std::setw(26) << demandNames[m] << std::right <<
+        "mean " << demandStats[m]->getMean() <<
+        ", std dev " << std::sqrt(demandStats[m]->getVariance()) <<
+        ", 95% CI [" << (demandStats[m]->getMean() - halfWidth) << ", " << (demandStats[m]->getMean() + halfWidth) << "]" <<
+        ", n = " << demandStats[m]->getCount() << "\n";
+    }
+    WriteDemandStatistics(myfile, summary.demand); // summed over every replication
+  }
+
+  myfile.close();
+}
+
+void RunBatchSimulation(const simulation_config_t& config) {
+  std::cout << "seed: " << config.seed << std::endl; // rerun with --seed to reproduce this batch
+
+  batch_summary_t summary;
+  if (config.outputFormat == OUTPUT_FORMAT_TEXT) {
+    RunBatch(config, &summary);
+    WriteBatchSummaryToOutputFile(config, summary);
+  } else {
+    std::vector<ResultTables> taskTables;
+    RunBatch(config, &summary, &taskTables);
+    WriteResultTables(config, taskTables);
+  }
+
+  std::cout << summary.numReplications << " replications on " << summary.numThreads << " threads in " <<
+    summary.elapsedSec << " s (" << (summary.numReplications / summary.elapsedSec) << " replications/sec), " <<
+    summary.numFleetRedraws << " fleets redrawn for a missing company" << std::endl;
+}
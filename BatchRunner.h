@@ -0,0 +1,51 @@
+/** Defines the Monte Carlo batch runner. One simulation with random faults and a
+ * random fleet is a single noisy sample, so the batch runner runs many independent
+ * replications across a work-stealing thread pool and reduces the per-company
+ * results into means, variances and confidence intervals.
+ *
+ * Each replication owns its fleet, charge station and random streams, and its seed is
+ * derived from the master --seed and the replication number, so a batch gives the same
+ * summary no matter how many threads run it. */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "AircraftCompanyCommon.h"
+#include "Config.h"
+#include "Demand.h"
+#include "Output.h"
+#include "ResultWriter.h"
+#include "Statistics.h"
+
+typedef enum {
+  BATCH_METRIC_AVG_FLIGHT_MIN = 0u,
+  BATCH_METRIC_AVG_CHARGE_MIN,
+  BATCH_METRIC_TOTAL_FAULTS,
+  BATCH_METRIC_TOTAL_PASSENGER_MILES,
+
+  TOTAL_BATCH_METRICS
+} batch_metric_t;
+
+typedef struct {
+  uint32_t numReplications;
+  uint32_t numThreads;
+  uint32_t numFleetRedraws; // fleets drawn again because a company was missing
+  double elapsedSec;
+  WelfordAccumulator stats[MAX_AIRCRAFT_COMPANIES][TOTAL_BATCH_METRICS]; // one sample per replication, for the first GetNumCompanies()
+  WelfordAccumulator fleetPassengerMiles; // all companies together, one sample per replication
+  SimulationStatistics durations; // every flight, charge session and wait of every replication
+  demand_summary_t demand; // every trip request of every replication, with --demand
+  WelfordAccumulator demandServedPercent; // one sample per replication, with --demand
+  WelfordAccumulator demandLoadFactor; // percent of the seat miles flown with a passenger, one sample per replication
+} batch_summary_t;
+
+/** With --demand the passenger miles in results are those of the trips flown, and the
+ * request and trip summary of the replication goes to demand when not null. */
+void RunReplication(const simulation_config_t& config, uint32_t replication, data_avgs_and_totals_t* results, uint32_t* numFleetRedraws,
+                    SimulationStatistics* durations = nullptr, ResultTables* tables = nullptr, demand_summary_t* demand = nullptr);
+// With taskTables, every task also adds the rows of its replications to a ResultTables of its own
+void RunBatch(const simulation_config_t& config, batch_summary_t* summary, std::vector<ResultTables>* taskTables = nullptr);
+void RunBatchSimulation(const simulation_config_t& config); // runs the batch and writes the summary to the output file
+void WriteBatchSummaryToOutputFile(const simulation_config_t& config, const batch_summary_t& summary);
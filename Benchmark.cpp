@@ -0,0 +1,249 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "Benchmark.h"
+
+#include "AircraftCompanyCommon.h"
+#include "AnalyticSimulation.h"
+#include "BatchRunner.h"
+#include "ChargeStation.h"
+#include "Simulation.h"
+
+// Peak resident set size of the process in KB, or 0 where it can't be queried
+static long PeakResidentKb(void) {
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024; // reported in bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+#endif
+  return 0;
+}
+
+/** Runs both engines for a growing fleet, keeping the default ratio of 3 chargers
+ * per 20 aircraft, and reports runtime and memory for each fleet size. The horizon
+ * comes from the base config. Aircraft IDs cycle through the companies so every run
+ * has the same mix and doesn't depend on the random ID generation.
+ *
+ * The tick loop is skipped above 20k aircraft because it takes minutes there. The
+ * peak RSS column is a process-wide high-water mark, so it only grows between rows. */
+void RunScalingBenchmark(const simulation_config_t& baseConfig) {
+  const uint32_t fleetSizes[] = {20u, 200u, 2000u, 20000u, 100000u, 200000u};
+  const uint32_t maxTickLoopFleetSize = 20000u;
+
+  std::cout << "Scaling benchmark, " << (baseConfig.simulationTicks / (float) LOOP_TICKS_PER_HOUR) << " hr horizon\n" <<
+    std::setw(10) << "aircraft" << std::setw(10) << "chargers" <<
+    std::setw(14) << "tick ms" << std::setw(14) << "event ms" <<
+    std::setw(14) << "fleet KB" << std::setw(14) << "peak RSS KB" << std::endl;
+
+  for (uint32_t numAircraft : fleetSizes) {
+    simulation_config_t config = baseConfig;
+    config.numAircraft = numAircraft;
+    config.numChargers = (numAircraft * DEFAULT_CHARGERS) / DEFAULT_AIRCRAFTS_IN_SIMULATION;
+
+    std::vector<Aircraft> aircrafts(numAircraft);
+    for (uint32_t i = 0; i < numAircraft; i++) {
+      aircrafts[i].m_id = (aircraft_id_t) (i % GetNumCompanies());
+    }
+    std::vector<Aircraft> eventAircrafts = aircrafts;
+
+    double tickMs = -1.0;
+    if (numAircraft <= maxTickLoopFleetSize) {
+      auto start = std::chrono::steady_clock::now();
+      RunTickSimulation(aircrafts.data(), config);
+      tickMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    RunEventSimulation(eventAircrafts.data(), config);
+    double eventMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(2) <<
+      std::setw(10) << numAircraft << std::setw(10) << config.numChargers;
+    if (tickMs < 0.0) {
+      std::cout << std::setw(14) << "-";
+    } else {
+      std::cout << std::setw(14) << tickMs;
+    }
+    std::cout << std::setw(14) << eventMs <<
+      std::setw(14) << (numAircraft * sizeof(Aircraft)) / 1024 <<
+      std::setw(14) << PeakResidentKb() << std::endl;
+  }
+}
+
+/** Compares the SoA tick engine against the tick loop over the Aircraft array, for
+ * the same fleets and horizon. Both engines do the same work per tick, so the ratio
+ * shows what the masked per-tick kernel saves over the per-object state switch. */
+void RunSoaBenchmark(const simulation_config_t& baseConfig) {
+  const uint32_t fleetSizes[] = {20u, 200u, 2000u, 20000u, 100000u};
+
+  std::cout << "SoA benchmark, " << (baseConfig.simulationTicks / (float) LOOP_TICKS_PER_HOUR) << " hr horizon\n" <<
+    std::setw(10) << "aircraft" << std::setw(10) << "chargers" <<
+    std::setw(14) << "AoS ms" << std::setw(14) << "SoA ms" <<
+    std::setw(16) << "AoS ns/a-tick" << std::setw(16) << "SoA ns/a-tick" << std::setw(10) << "speedup" << std::endl;
+
+  for (uint32_t numAircraft : fleetSizes) {
+    simulation_config_t config = baseConfig;
+    config.numAircraft = numAircraft;
+    config.numChargers = (numAircraft * DEFAULT_CHARGERS) / DEFAULT_AIRCRAFTS_IN_SIMULATION;
+
+    std::vector<Aircraft> aosAircrafts(numAircraft);
+    for (uint32_t i = 0; i < numAircraft; i++) {
+      aosAircrafts[i].m_id = (aircraft_id_t) (i % GetNumCompanies());
+    }
+    std::vector<Aircraft> soaAircrafts = aosAircrafts;
+
+    auto start = std::chrono::steady_clock::now();
+    RunTickSimulation(aosAircrafts.data(), config);
+    double aosMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    RunSoaSimulation(soaAircrafts.data(), config);
+    double soaMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    double aircraftTicks = (double) numAircraft * (config.simulationTicks + 1);
+    std::cout << std::fixed << std::setprecision(2) <<
+      std::setw(10) << numAircraft << std::setw(10) << config.numChargers <<
+      std::setw(14) << aosMs << std::setw(14) << soaMs <<
+      std::setw(16) << (aosMs * 1e6) / aircraftTicks << std::setw(16) << (soaMs * 1e6) / aircraftTicks <<
+      std::setw(10) << aosMs / soaMs << std::endl;
+  }
+}
+
+/** Runs the same batch of replications with 1, 2, 4, ... worker threads up to the
+ * core count and reports replications/sec. Replications share nothing, so throughput
+ * should grow close to linearly until the cores run out. */
+void RunBatchBenchmark(const simulation_config_t& baseConfig) {
+  const uint32_t defaultReplications = 2000u;
+  uint32_t numCores = std::thread::hardware_concurrency();
+  if (numCores == 0) {
+    numCores = 1;
+  }
+
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t threads = 1; threads < numCores; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(numCores);
+
+  simulation_config_t config = baseConfig;
+  if (config.numReplications == 1) {
+    config.numReplications = defaultReplications;
+  }
+
+  std::cout << "Batch benchmark, " << config.numReplications << " replications of " << config.numAircraft <<
+    " aircraft, " << (config.simulationTicks / (float) LOOP_TICKS_PER_HOUR) << " hr horizon, " << numCores << " cores\n" <<
+    std::setw(10) << "threads" << std::setw(14) << "seconds" << std::setw(16) << "reps/sec" << std::setw(10) << "speedup" << std::endl;
+
+  double singleThreadRate = 0.0;
+  for (uint32_t threads : threadCounts) {
+    config.numThreads = threads;
+    batch_summary_t summary;
+    RunBatch(config, &summary);
+    double rate = summary.numReplications / summary.elapsedSec;
+    if (threads == 1) {
+      singleThreadRate = rate;
+    }
+    std::cout << std::fixed << std::setprecision(2) <<
+      std::setw(10) << threads << std::setw(14) << summary.elapsedSec <<
+      std::setw(16) << rate << std::setw(10) << (rate / singleThreadRate) << std::endl;
+  }
+}
+
+/** Runs every charger scheduling policy on the same batch of replications. The master
+ * seed, and with it every replication's fleet and fault draws, is the same for all
+ * policies, so the only difference between the rows is the order aircraft charge in.
+ * The confidence interval is on the fleet passenger miles of one replication. */
+void RunPolicyBenchmark(const simulation_config_t& baseConfig) {
+  const uint32_t defaultReplications = 500u;
+
+  simulation_config_t config = baseConfig;
+  if (config.numReplications == 1) {
+    config.numReplications = defaultReplications;
+  }
+
+  std::cout << "Charger policy benchmark, " << config.numReplications << " replications of " << config.numAircraft <<
+    " aircraft, " << config.numChargers << " chargers, " << (config.simulationTicks / (float) LOOP_TICKS_PER_HOUR) <<
+    " hr horizon, seed " << config.seed << "\n" <<
+    std::setw(10) << "policy" << std::setw(18) << "passenger miles" << std::setw(12) << "95% CI +/-" <<
+    std::setw(16) << "mean wait min" << std::setw(15) << "p99 wait min" << std::setw(14) << "max wait min" <<
+    std::setw(14) << "utilization" << std::endl;
+
+  for (uint8_t p = 0; p < TOTAL_CHARGE_POLICIES; p++) {
+    config.policy = (charge_policy_t) p;
+    batch_summary_t summary;
+    RunBatch(config, &summary);
+
+    DurationStatistic allWaits;
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+      allWaits.merge(summary.durations.getCompany((aircraft_id_t) i).waits);
+    }
+    std::cout << std::fixed << std::setprecision(2) <<
+      std::setw(10) << GetChargePolicyName(config.policy) <<
+      std::setw(18) << summary.fleetPassengerMiles.getMean() <<
+      std::setw(12) << summary.fleetPassengerMiles.getConfidenceHalfWidth95() <<
+      std::setw(16) << allWaits.getMinutes().getMean() <<
+      std::setw(15) << allWaits.getPercentileMin(99.0) <<
+      std::setw(14) << (allWaits.getHistogram().getMaxTicks() / (double) LOOP_TICKS_PER_MIN) <<
+      std::setw(13) << (100.0 * summary.durations.getChargerUtilization()) << "%" << std::endl;
+  }
+}
+
+/** Compares the analytic fast path against the event engine over a sweep of charger
+ * counts and horizons, for the fleet size of the base config with one of each company
+ * in turn. The event engine costs time in proportion to the horizon, the fast path
+ * only until it finds the period, so the speedup grows with the horizon. The period
+ * and the mismatched aircraft, which must always be 0, are reported for each row.
+ * Faults are drawn hour by hour in both engines, so they set a floor on the time. */
+void RunAnalyticBenchmark(const simulation_config_t& baseConfig) {
+  const uint32_t chargerCounts[] = {1u, 2u, 3u, 5u, 10u, 20u};
+  const uint32_t horizonsHr[] = {24u, 168u, 720u, 8760u};
+
+  std::cout << "Analytic benchmark, " << baseConfig.numAircraft << " aircraft, " <<
+    GetChargePolicyName(baseConfig.policy) << " charging\n" <<
+    std::setw(10) << "chargers" << std::setw(10) << "hours" << std::setw(14) << "event ms" <<
+    std::setw(14) << "analytic ms" << std::setw(10) << "speedup" << std::setw(14) << "period min" <<
+    std::setw(16) << "periods skipped" << std::setw(12) << "mismatched" << std::endl;
+
+  for (uint32_t numChargers : chargerCounts) {
+    for (uint32_t horizonHr : horizonsHr) {
+      simulation_config_t config = baseConfig;
+      config.numChargers = numChargers;
+      config.simulationTicks = horizonHr * LOOP_TICKS_PER_HOUR;
+
+      std::vector<Aircraft> eventAircrafts(config.numAircraft);
+      for (uint32_t i = 0; i < config.numAircraft; i++) {
+        eventAircrafts[i].m_id = (aircraft_id_t) (i % GetNumCompanies());
+      }
+      std::vector<Aircraft> analyticAircrafts = eventAircrafts;
+
+      auto start = std::chrono::steady_clock::now();
+      RunEventSimulation(eventAircrafts.data(), config);
+      double eventMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+      analytic_solution_t solution;
+      start = std::chrono::steady_clock::now();
+      RunAnalyticSimulation(analyticAircrafts.data(), config, &solution);
+      double analyticMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+      std::cout << std::fixed << std::setprecision(2) <<
+        std::setw(10) << numChargers << std::setw(10) << horizonHr <<
+        std::setw(14) << eventMs << std::setw(14) << analyticMs << std::setw(10) << eventMs / analyticMs <<
+        std::setw(14) << (solution.periodTicks / (double) LOOP_TICKS_PER_MIN) <<
+        std::setw(16) << (solution.contentionFree ? "per aircraft" : std::to_string(solution.periodsSkipped)) <<
+        std::setw(12) << CountMismatchedAircraft(eventAircrafts.data(), analyticAircrafts.data(), config.numAircraft) << std::endl;
+    }
+  }
+}
@@ -0,0 +1,11 @@
+// Defines benchmarks that measure how the simulation engines scale, the charger scheduling policy comparison and the analytic fast path
+
+#pragma once
+
+#include "Config.h"
+
+void RunScalingBenchmark(const simulation_config_t& baseConfig);
+void RunSoaBenchmark(const simulation_config_t& baseConfig);
+void RunBatchBenchmark(const simulation_config_t& baseConfig);
+void RunPolicyBenchmark(const simulation_config_t& baseConfig);
+void RunAnalyticBenchmark(const simulation_config_t& baseConfig);
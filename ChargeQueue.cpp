@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "ChargeQueue.h"
+
+#include "Arena.h"
+
+double PassengerMilesPerChargeMin(aircraft_id_t id) {
+  double flightHours = GetFlightDurTicks(id) / (double) LOOP_TICKS_PER_HOUR;
+  double chargeMin = GetChargeDurTicks(id) / (double) LOOP_TICKS_PER_MIN;
+  return (GetCruiseSpeedMph(id) * flightHours * GetPassengerCount(id)) / chargeMin;
+}
+
+// Orders the heap so the lowest key, then the earliest in line, is on top
+bool ChargeQueue::heapNodeLater(const charge_queue_node_t& a, const charge_queue_node_t& b) {
+  if (a.key != b.key) {
+    return a.key > b.key;
+  }
+  return a.sequence > b.sequence;
+}
+
+ChargeQueue::ChargeQueue(uint32_t capacity, charge_policy_t policy) :
+  m_ring(GetSimulationMemory()), m_heap(GetSimulationMemory())
+{
+  m_policy = policy;
+  m_capacity = capacity;
+  m_size = 0;
+  m_head = 0;
+  m_nextSequence = 0;
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    if (policy == CHARGE_POLICY_SHORTEST_CHARGE_FIRST) {
+      m_companyKeys[i] = GetChargeDurTicks((aircraft_id_t) i);
+    } else if ((policy == CHARGE_POLICY_MOST_PASSENGER_MILES) || (policy == CHARGE_POLICY_AGING)) {
+      m_companyKeys[i] = -PassengerMilesPerChargeMin((aircraft_id_t) i);
+    } else {
+      m_companyKeys[i] = 0.0;
+    }
+  }
+  if (policy == CHARGE_POLICY_FIFO) {
+    m_ring.resize(capacity);
+  } else {
+    m_heap.reserve(capacity);
+  }
+}
+
+double ChargeQueue::dispatchKey(aircraft_id_t id, uint32_t tick) const {
+  if (m_policy == CHARGE_POLICY_AGING) {
+    return m_companyKeys[id] + CHARGE_POLICY_AGING_PER_MIN * (tick / (double) LOOP_TICKS_PER_MIN);
+  }
+  return m_companyKeys[id];
+}
+
+bool ChargeQueue::push(uint32_t aircraftIndex, aircraft_id_t id, uint32_t tick) {
+  if (m_size == m_capacity) {
+    return false;
+  }
+  if (m_policy == CHARGE_POLICY_FIFO) {
+    uint32_t tail = m_head + m_size;
+    if (tail >= m_capacity) {
+      tail -= m_capacity;
+    }
+    m_ring[tail].aircraftIndex = aircraftIndex;
+    m_ring[tail].enqueueTick = tick;
+  } else {
+    charge_queue_node_t node;
+    node.key = dispatchKey(id, tick);
+    node.id = id;
+    node.sequence = m_nextSequence++;
+    node.entry.aircraftIndex = aircraftIndex;
+    node.entry.enqueueTick = tick;
+    m_heap.push_back(node); // within the reserved capacity, so this never allocates
+    std::push_heap(m_heap.begin(), m_heap.end(), heapNodeLater);
+  }
+  m_size++;
+  m_length.update(tick, m_size);
+  return true;
+}
+
+bool ChargeQueue::pop(uint32_t tick, charge_queue_entry_t* entry) {
+  if (m_size == 0) {
+    return false;
+  }
+  if (m_policy == CHARGE_POLICY_FIFO) {
+    *entry = m_ring[m_head];
+    m_head++;
+    if (m_head == m_capacity) {
+      m_head = 0;
+    }
+  } else {
+    std::pop_heap(m_heap.begin(), m_heap.end(), heapNodeLater);
+    *entry = m_heap.back().entry;
+    m_heap.pop_back();
+  }
+  m_size--;
+  m_length.update(tick, m_size);
+  return true;
+}
+
+ConcurrentChargeQueue::ConcurrentChargeQueue(uint32_t capacity) {
+  uint32_t roundedCapacity = 2u;
+  while (roundedCapacity < capacity) {
+    roundedCapacity <<= 1;
+  }
+  m_cells.reset(new Cell[roundedCapacity]);
+  for (uint32_t i = 0; i < roundedCapacity; i++) {
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  m_mask = roundedCapacity - 1u;
+  m_enqueuePosition.store(0, std::memory_order_relaxed);
+  m_dequeuePosition.store(0, std::memory_order_relaxed);
+}
+
+/** A cell is free for the producer at position p when its sequence equals p, and holds
+ * an entry for the consumer at position p when its sequence equals p + 1. Positions
+ * wrap around at 2^32, which the signed differences below handle. */
+bool ConcurrentChargeQueue::tryPush(const charge_queue_entry_t& entry) {
+  uint32_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+  while (true) {
+    Cell* cell = &m_cells[position & m_mask];
+    uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+    int32_t diff = (int32_t) (sequence - position);
+    if (diff == 0) {
+      if (m_enqueuePosition.compare_exchange_weak(position, position + 1u, std::memory_order_relaxed)) {
+        cell->entry = entry;
+        cell->sequence.store(position + 1u, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false; // the cell still holds an entry from the previous lap
+    } else {
+      position = m_enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool ConcurrentChargeQueue::tryPop(charge_queue_entry_t* entry) {
+  uint32_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+  while (true) {
+    Cell* cell = &m_cells[position & m_mask];
+    uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+    int32_t diff = (int32_t) (sequence - (position + 1u));
+    if (diff == 0) {
+      if (m_dequeuePosition.compare_exchange_weak(position, position + 1u, std::memory_order_relaxed)) {
+        *entry = cell->entry;
+        cell->sequence.store(position + m_mask + 1u, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      position = m_dequeuePosition.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+/** The aging keys are computed again from the new enqueue ticks, exactly as if the
+ * aircraft had got in line that much later. */
+void ChargeQueue::shiftTicks(uint32_t ticks) {
+  if (m_policy == CHARGE_POLICY_FIFO) {
+    for (uint32_t n = 0; n < m_size; n++) {
+      uint32_t position = m_head + n;
+      if (position >= m_capacity) {
+        position -= m_capacity;
+      }
+      m_ring[position].enqueueTick += ticks;
+    }
+  } else {
+    for (charge_queue_node_t& node : m_heap) {
+      node.entry.enqueueTick += ticks;
+      node.key = dispatchKey(node.id, node.entry.enqueueTick);
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), heapNodeLater);
+  }
+}
+
+void ChargeQueue::appendLineOrder(std::vector<uint32_t>* aircraftIndexes) const {
+  if (m_policy == CHARGE_POLICY_FIFO) {
+    for (uint32_t n = 0; n < m_size; n++) {
+      uint32_t position = m_head + n;
+      if (position >= m_capacity) {
+        position -= m_capacity;
+      }
+      aircraftIndexes->push_back(m_ring[position].aircraftIndex);
+    }
+  } else {
+    // a heap only has its top in place, the rest is sorted on a copy
+    std::vector<charge_queue_node_t> nodes(m_heap.begin(), m_heap.end());
+    std::sort(nodes.begin(), nodes.end(), [](const charge_queue_node_t& a, const charge_queue_node_t& b) {return heapNodeLater(b, a);});
+    for (const charge_queue_node_t& node : nodes) {
+      aircraftIndexes->push_back(node.entry.aircraftIndex);
+    }
+  }
+}
+
+void ChargeQueue::exportNodes(std::vector<charge_queue_node_t>* nodes) const {
+  nodes->clear();
+  if (m_policy == CHARGE_POLICY_FIFO) {
+    for (uint32_t n = 0; n < m_size; n++) {
+      uint32_t position = m_head + n;
+      if (position >= m_capacity) {
+        position -= m_capacity;
+      }
+      charge_queue_node_t node = {0.0, n, m_ring[position], (aircraft_id_t) 0u};
+      nodes->push_back(node);
+    }
+  } else {
+    nodes->assign(m_heap.begin(), m_heap.end());
+  }
+}
+
+bool ChargeQueue::importNodes(const charge_queue_node_t* nodes, uint32_t count, uint64_t nextSequence, const TimeWeightedStatistic& length) {
+  if ((count > m_capacity) || ((m_policy != CHARGE_POLICY_FIFO) && (std::is_heap(nodes, nodes + count, heapNodeLater) == false))) {
+    return false;
+  }
+  if (m_policy == CHARGE_POLICY_FIFO) {
+    for (uint32_t n = 0; n < count; n++) {
+      m_ring[n] = nodes[n].entry;
+    }
+    m_head = 0;
+  } else {
+    m_heap.assign(nodes, nodes + count);
+  }
+  m_size = count;
+  m_nextSequence = nextSequence;
+  m_length = length;
+  return true;
+}
+
+void RecordChargeSiteStatistics(SimulationStatistics* stats, const ChargeQueue& queue, const ChargeStation& chargers, uint32_t endTick) {
+  if (stats == nullptr) {
+    return;
+  }
+  TimeWeightedStatistic queueLength = queue.getLengthOverTime();
+  TimeWeightedStatistic chargersInUse = chargers.getChargersInUseOverTime();
+  queueLength.finish(endTick);
+  chargersInUse.finish(endTick);
+  stats->recordChargeSite(queueLength, chargersInUse, chargers.getNumChargers());
+}
+
+/** Function to test the charge queues. The ring buffer is filled and drained several
+ * times so it wraps around, and must keep first in first out order, report the wait
+ * ticks and the time-weighted length. Every policy must hand out a line of one
+ * aircraft per company in the order of its keys. The concurrent queue gets entries from several
+ * producer threads while a consumer drains it, and every entry must come out exactly
+ * once, in order per producer. */
+void ChargeQueueTest(void) {
+  bool ringPass = true;
+  ChargeQueue queue(5);
+  charge_queue_entry_t entry;
+  uint32_t tick = 0;
+  uint32_t nextIn = 0, nextOut = 0;
+  for (uint32_t lap = 0; lap < 4; lap++) {
+    while (queue.push(nextIn, AIRCRAFT_ID_ALPHA, tick)) {
+      nextIn++;
+    }
+    ringPass = ringPass && (queue.size() == queue.capacity());
+    tick += 10; // the full line is held for 10 ticks
+    while (queue.pop(tick, &entry)) {
+      ringPass = ringPass && (entry.aircraftIndex == nextOut) && ((tick - entry.enqueueTick) == 10u);
+      nextOut++;
+    }
+  }
+  TimeWeightedStatistic length = queue.getLengthOverTime();
+  length.finish(tick + 10);
+  // full for 4 x 10 ticks, then empty for 10 ticks
+  ringPass = ringPass && (nextOut == 20u) && (length.getMax() == 5u) && (length.getTotalTicks() == 50u) &&
+             (length.getLevelTicks() == 200u);
+
+  // one aircraft of each company in line on the same tick, see the key table in ChargeQueue.h
+  const aircraft_id_t lineup[TOTAL_BUILTIN_AIRCRAFT_COMPANIES] = {AIRCRAFT_ID_ECHO, AIRCRAFT_ID_CHARLIE, AIRCRAFT_ID_ALPHA, AIRCRAFT_ID_BRAVO, AIRCRAFT_ID_DELTA};
+  const uint32_t expectedOrder[TOTAL_CHARGE_POLICIES][TOTAL_BUILTIN_AIRCRAFT_COMPANIES] = {
+    {0, 1, 2, 3, 4}, // fifo
+    {3, 0, 2, 4, 1}, // shortest: Bravo 12, Echo 18, Alpha 36, Delta 37.2, Charlie 48 min
+    {3, 2, 4, 1, 0}, // value: Bravo, Alpha, Delta, Charlie, Echo
+    {3, 2, 4, 1, 0}, // aging: same as value when everyone got in line together
+  };
+  bool policyPass = true;
+  for (uint8_t p = 0; p < TOTAL_CHARGE_POLICIES; p++) {
+    ChargeQueue policyQueue(TOTAL_BUILTIN_AIRCRAFT_COMPANIES, (charge_policy_t) p);
+    for (uint32_t i = 0; i < TOTAL_BUILTIN_AIRCRAFT_COMPANIES; i++) {
+      policyQueue.push(i, lineup[i], 0);
+    }
+    for (uint32_t n = 0; n < TOTAL_BUILTIN_AIRCRAFT_COMPANIES; n++) {
+      policyPass = policyPass && policyQueue.pop(0, &entry) && (entry.aircraftIndex == expectedOrder[p][n]);
+    }
+  }
+  // under aging, an Echo that has waited 60 minutes more than a Bravo goes first, but not after only 40
+  const uint32_t bravoEnqueueMin[2] = {60, 40};
+  const uint32_t expectedFirst[2] = {0, 1};
+  for (uint8_t n = 0; n < 2; n++) {
+    ChargeQueue agingQueue(2, CHARGE_POLICY_AGING);
+    agingQueue.push(0, AIRCRAFT_ID_ECHO, 0);
+    agingQueue.push(1, AIRCRAFT_ID_BRAVO, bravoEnqueueMin[n] * LOOP_TICKS_PER_MIN);
+    policyPass = policyPass && (agingQueue.front().aircraftIndex == expectedFirst[n]);
+  }
+
+  const uint32_t numProducers = 4;
+  const uint32_t entriesPerProducer = 50000;
+  ConcurrentChargeQueue concurrentQueue(64); // small, so producers regularly find it full
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < numProducers; p++) {
+    producers.emplace_back([&concurrentQueue, p, entriesPerProducer] {
+      for (uint32_t n = 0; n < entriesPerProducer; n++) {
+        charge_queue_entry_t newEntry = {p, n}; // producer in the index, sequence in the tick
+        while (concurrentQueue.tryPush(newEntry) == false) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  bool concurrentPass = true;
+  std::vector<uint32_t> nextSequence(numProducers, 0);
+  uint32_t received = 0;
+  while (received < (numProducers * entriesPerProducer)) {
+    if (concurrentQueue.tryPop(&entry)) {
+      concurrentPass = concurrentPass && (entry.aircraftIndex < numProducers) &&
+                       (entry.enqueueTick == nextSequence[entry.aircraftIndex]);
+      if (entry.aircraftIndex < numProducers) {
+        nextSequence[entry.aircraftIndex]++;
+      }
+      received++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+  concurrentPass = concurrentPass && (concurrentQueue.tryPop(&entry) == false);
+
+  std::cout << "Charge queue ring buffer test: " << (ringPass ? "PASS" : "FAIL") << std::endl;
+  std::cout << "Charge scheduling policy test: " << (policyPass ? "PASS" : "FAIL") << std::endl;
+  std::cout << "Concurrent charge queue test: " << (concurrentPass ? "PASS" : "FAIL") << std::endl;
+}
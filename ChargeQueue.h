@@ -0,0 +1,122 @@
+/** Defines the line of aircraft waiting for a charger. ChargeQueue is sized once for
+ * the whole fleet, since an aircraft can only be in line once, so pushing and popping
+ * never allocate. Its arrays come from the simulation memory, see Arena.h. Every entry keeps the tick it got in line, which gives the wait time
+ * when it is popped, and the queue tracks its length over time for the output.
+ *
+ * The order aircraft leave the line is set by the charger scheduling policy. FIFO
+ * uses a ring buffer. The other policies give every entry a dispatch key when it is
+ * pushed and keep the entries in a binary heap, lowest key first; aircraft with the
+ * same key leave in the order they got in line. A key never changes while an aircraft
+ * waits, the aging policy works because every waiting aircraft ages at the same rate,
+ * so only the tick it got in line matters:
+ *  fifo      first in line first
+ *  shortest  charge duration of the company
+ *  value     minus the passenger miles flown on one charge per minute of charging
+ *  aging     value key + CHARGE_POLICY_AGING_PER_MIN * minute it got in line
+ *
+ * ConcurrentChargeQueue is the multi-site variant: a bounded lock-free queue that any
+ * number of threads can push to and pop from, for sites simulated in parallel that
+ * hand aircraft to each other. */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "AircraftCompanyCommon.h"
+#include "ChargeStation.h"
+#include "Config.h"
+#include "Statistics.h"
+
+/** Passenger miles per charge minute an aircraft gains for every minute it waits under
+ * the aging policy. At 0.5, an Echo (about 3) overtakes a Bravo (about 28) after
+ * roughly 50 minutes in line, so low value aircraft are never starved. */
+#define CHARGE_POLICY_AGING_PER_MIN (0.5)
+
+typedef struct {
+  uint32_t aircraftIndex;
+  uint32_t enqueueTick;
+} charge_queue_entry_t;
+
+// An entry of the heap of the non-FIFO policies, also the form a line is exported in for checkpoints
+typedef struct {
+  double key;
+  uint64_t sequence; // breaks ties between equal keys in the order aircraft got in line
+  charge_queue_entry_t entry;
+  aircraft_id_t id; // only used by the heap, 0 for an exported FIFO line
+} charge_queue_node_t;
+
+class ChargeQueue
+{
+public:
+  ChargeQueue(uint32_t capacity, charge_policy_t policy = CHARGE_POLICY_FIFO);
+  uint32_t capacity(void) const {return m_capacity;}
+  uint32_t size(void) const {return m_size;}
+  bool empty(void) const {return (m_size == 0);}
+  charge_policy_t getPolicy(void) const {return m_policy;}
+  const charge_queue_entry_t& front(void) const {return (m_policy == CHARGE_POLICY_FIFO) ? m_ring[m_head] : m_heap[0].entry;}
+  const TimeWeightedStatistic& getLengthOverTime(void) const {return m_length;}
+
+  bool push(uint32_t aircraftIndex, aircraft_id_t id, uint32_t tick); // false when full
+  bool pop(uint32_t tick, charge_queue_entry_t* entry); // removes the next aircraft to charge, false when empty
+  void shiftTicks(uint32_t ticks); // adds ticks to every enqueue tick, the order of the line doesn't change
+  void appendLineOrder(std::vector<uint32_t>* aircraftIndexes) const; // of every aircraft in line, in the order they will leave it
+
+  /** Checkpoint support, see Checkpoint.h. A FIFO line is exported front first; a heap
+   * is exported in heap order, so importing it needs no sorting. */
+  void exportNodes(std::vector<charge_queue_node_t>* nodes) const;
+  bool importNodes(const charge_queue_node_t* nodes, uint32_t count, uint64_t nextSequence, const TimeWeightedStatistic& length); // false if over capacity or not a heap
+  uint64_t getNextSequence(void) const {return m_nextSequence;}
+
+private:
+  static bool heapNodeLater(const charge_queue_node_t& a, const charge_queue_node_t& b);
+  double dispatchKey(aircraft_id_t id, uint32_t tick) const;
+
+  charge_policy_t m_policy;
+  uint32_t m_capacity;
+  uint32_t m_size;
+  uint32_t m_head; // FIFO only
+  uint64_t m_nextSequence;
+  double m_companyKeys[MAX_AIRCRAFT_COMPANIES]; // the part of the key that only depends on the company
+  std::pmr::vector<charge_queue_entry_t> m_ring; // FIFO only
+  std::pmr::vector<charge_queue_node_t> m_heap; // every other policy
+  TimeWeightedStatistic m_length;
+};
+
+// Passenger miles flown on one full charge divided by the minutes that charge takes
+double PassengerMilesPerChargeMin(aircraft_id_t id);
+
+/** Bounded multi-producer multi-consumer queue after Dmitry Vyukov's design. Every
+ * cell carries a sequence number that tells producers and consumers whose turn it is,
+ * so a push or pop is one compare-and-swap on the shared position plus a release store
+ * on the cell, with no locks. The capacity is rounded up to a power of two. */
+class ConcurrentChargeQueue
+{
+public:
+  explicit ConcurrentChargeQueue(uint32_t capacity);
+  ConcurrentChargeQueue(const ConcurrentChargeQueue&) = delete;
+  ConcurrentChargeQueue& operator=(const ConcurrentChargeQueue&) = delete;
+
+  uint32_t capacity(void) const {return m_mask + 1u;}
+  bool tryPush(const charge_queue_entry_t& entry); // false when full
+  bool tryPop(charge_queue_entry_t* entry); // false when empty
+
+private:
+  struct Cell {
+    std::atomic<uint32_t> sequence;
+    charge_queue_entry_t entry;
+  };
+
+  std::unique_ptr<Cell[]> m_cells;
+  uint32_t m_mask;
+  alignas(64) std::atomic<uint32_t> m_enqueuePosition; // own cache lines so producers and consumers don't false share
+  alignas(64) std::atomic<uint32_t> m_dequeuePosition;
+};
+
+// Closes the queue length and chargers in use at the end of the run and adds them to stats
+void RecordChargeSiteStatistics(SimulationStatistics* stats, const ChargeQueue& queue, const ChargeStation& chargers, uint32_t endTick);
+
+void ChargeQueueTest(void);
@@ -1,33 +1,43 @@
-/** Defines the charge station class. Only 3 chargers are availbe for use.
- * Note that only one instance of this class will be used in the application. */
+/** Defines the charge station class. The number of chargers is chosen at runtime,
+ * 3 by default. Note that only one instance of this class will be used per simulation.
+ * The station also tracks how many chargers were in use over time, for the charger
+ * utilization in the output. */
 
 #pragma once
 
 #include <cstdint>
 
-#define TOTAL_CHARGERS (3u)
+#include "Statistics.h"
+
+#define DEFAULT_CHARGERS (3u)
 
 class ChargeStation
 {
 private:
-  uint8_t m_numChargersInUse;
+  uint32_t m_numChargers;
+  uint32_t m_numChargersInUse;
+  TimeWeightedStatistic m_chargersInUse;
 public:
-  ChargeStation() {m_numChargersInUse = 0;}
-  uint8_t getNumChargersInUse(void) const {return m_numChargersInUse;}
-  bool isChargerAvailable(void) const {return (m_numChargersInUse < TOTAL_CHARGERS);}
-  bool addAircraft(void) {
+  ChargeStation(uint32_t numChargers = DEFAULT_CHARGERS) {m_numChargers = numChargers; m_numChargersInUse = 0;}
+  uint32_t getNumChargers(void) const {return m_numChargers;}
+  void setNumChargers(uint32_t numChargers) {m_numChargers = numChargers;}
+  uint32_t getNumChargersInUse(void) const {return m_numChargersInUse;}
+  const TimeWeightedStatistic& getChargersInUseOverTime(void) const {return m_chargersInUse;}
+  bool isChargerAvailable(void) const {return (m_numChargersInUse < m_numChargers);}
+  bool addAircraft(uint32_t tick) {
     if (isChargerAvailable()) {
       m_numChargersInUse++;
+      m_chargersInUse.update(tick, m_numChargersInUse);
       return true;
     }
     return false;
   }
-  bool removeAircraft(void) {
+  bool removeAircraft(uint32_t tick) {
     if (m_numChargersInUse > 0) {
       m_numChargersInUse--;
+      m_chargersInUse.update(tick, m_numChargersInUse);
       return true;
     }
     return false;
   }
 };
-
@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Checkpoint.h"
+
+#include "AircraftCompanyCommon.h"
+#include "EventSimulation.h"
+#include "Metrics.h"
+#include "Output.h"
+#include "RandomGen.h"
+#include "ResultWriter.h"
+#include "Simulation.h"
+#include "Statistics.h"
+
+uint64_t CompanyCatalogHash(void) {
+  uint64_t hash = 0xcbf29ce484222325ull; // 64 bit FNV-1a
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    uint32_t durations[2] = {GetFlightDurTicks((aircraft_id_t) i), GetChargeDurTicks((aircraft_id_t) i)};
+    for (uint32_t duration : durations) {
+      hash ^= duration;
+      hash *= 0x100000001b3ull;
+    }
+  }
+  return hash;
+}
+
+CheckpointWriter::~CheckpointWriter() {
+  if (m_file != nullptr) {
+    std::fclose(m_file); // never committed, the previous checkpoint stays in place
+    std::remove(m_tempPath.c_str());
+  }
+}
+
+bool CheckpointWriter::open(const char* path) {
+  m_path = path;
+  m_tempPath = m_path + ".tmp";
+  m_file = std::fopen(m_tempPath.c_str(), "wb");
+  if (m_file == nullptr) {
+    std::cout << "ERROR - could not open checkpoint file " << m_tempPath << std::endl;
+    return false;
+  }
+  checkpoint_header_t placeholder;
+  memset(&placeholder, 0, sizeof(placeholder));
+  m_failed = (std::fwrite(&placeholder, sizeof(placeholder), 1, m_file) != 1);
+  m_offset = sizeof(placeholder);
+  return (m_failed == false);
+}
+
+checkpoint_section_t CheckpointWriter::addSection(const void* records, size_t recordBytes, uint64_t count) {
+  static const uint8_t padding[CHECKPOINT_SECTION_ALIGNMENT] = {0};
+  uint64_t paddingBytes = (CHECKPOINT_SECTION_ALIGNMENT - (m_offset % CHECKPOINT_SECTION_ALIGNMENT)) % CHECKPOINT_SECTION_ALIGNMENT;
+  if ((paddingBytes > 0) && (std::fwrite(padding, 1, paddingBytes, m_file) != paddingBytes)) {
+    m_failed = true;
+  }
+  m_offset += paddingBytes;
+
+  checkpoint_section_t section = {m_offset, count};
+  size_t bytes = recordBytes * count;
+  if ((bytes > 0) && (std::fwrite(records, 1, bytes, m_file) != bytes)) {
+    m_failed = true;
+  }
+  m_offset += bytes;
+  return section;
+}
+
+bool CheckpointWriter::commit(const checkpoint_header_t& header) {
+  if ((m_failed == false) && (std::fseek(m_file, 0, SEEK_SET) == 0)) {
+    m_failed = (std::fwrite(&header, sizeof(header), 1, m_file) != 1);
+  } else {
+    m_failed = true;
+  }
+  m_failed = (std::fflush(m_file) != 0) || m_failed;
+#if defined(__unix__) || defined(__APPLE__)
+  m_failed = (fsync(fileno(m_file)) != 0) || m_failed; // on disk before it replaces the previous checkpoint
+#endif
+  m_failed = (std::fclose(m_file) != 0) || m_failed;
+  m_file = nullptr;
+
+  if (m_failed || (std::rename(m_tempPath.c_str(), m_path.c_str()) != 0)) {
+    std::cout << "ERROR - could not write checkpoint file " << m_path << std::endl;
+    std::remove(m_tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool CheckpointFile::open(const char* path) {
+  close();
+#if defined(__unix__) || defined(__APPLE__)
+  int fd = ::open(path, O_RDONLY);
+  struct stat fileStat;
+  if ((fd >= 0) && (fstat(fd, &fileStat) == 0) && (fileStat.st_size > 0)) {
+    void* mapping = mmap(nullptr, (size_t) fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      m_data = (uint8_t*) mapping;
+      m_bytes = (size_t) fileStat.st_size;
+      m_mapped = true;
+    }
+  }
+  if (fd >= 0) {
+    ::close(fd); // the mapping stays valid
+  }
+#endif
+  if (m_data == nullptr) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (file.is_open()) {
+      m_bytes = (size_t) file.tellg();
+      m_buffer.resize((m_bytes + sizeof(uint64_t) - 1u) / sizeof(uint64_t));
+      file.seekg(0);
+      if ((m_bytes > 0) && file.read((char*) m_buffer.data(), m_bytes)) {
+        m_data = (uint8_t*) m_buffer.data();
+      }
+    }
+  }
+  if (m_data == nullptr) {
+    std::cout << "ERROR - could not read checkpoint file " << path << std::endl;
+    close();
+    return false;
+  }
+
+  const checkpoint_header_t& header = getHeader();
+  bool valid = (m_bytes >= sizeof(checkpoint_header_t)) &&
+               (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) == 0) &&
+               (header.version == CHECKPOINT_VERSION) && (header.byteOrderMark == CHECKPOINT_BYTE_ORDER_MARK) &&
+               (header.headerBytes == sizeof(checkpoint_header_t)) && (header.aircraftBytes == sizeof(Aircraft)) &&
+               (header.eventBytes == sizeof(sim_event_t)) && (header.queueNodeBytes == sizeof(charge_queue_node_t));
+  if (valid == false) {
+    std::cout << "ERROR - " << path << " is not a checkpoint of this version and build" << std::endl;
+    close();
+    return false;
+  }
+  valid = (header.aircraft.count == header.numAircraft) && sectionFits(header.aircraft, sizeof(Aircraft)) &&
+          (header.chargeStation.count == 1u) && sectionFits(header.chargeStation, sizeof(ChargeStation)) &&
+          (header.queueLength.count == 1u) && sectionFits(header.queueLength, sizeof(TimeWeightedStatistic)) &&
+          (header.queueNodes.count <= header.numAircraft) && sectionFits(header.queueNodes, sizeof(charge_queue_node_t)) &&
+          sectionFits(header.events, sizeof(sim_event_t)) &&
+          sectionFits(header.companyStatistics, sizeof(company_statistics_t)) &&
+          sectionFits(header.chargeSiteStatistics, sizeof(charge_site_statistics_t)) &&
+          (header.policy < TOTAL_CHARGE_POLICIES) &&
+          (header.chargeTargetSoc > 0.0f) && (header.chargeTargetSoc <= 1.0f) && (header.currentTick <= header.simulationTicks);
+  if (valid == false) {
+    std::cout << "ERROR - checkpoint file " << path << " is truncated or damaged" << std::endl;
+    close();
+    return false;
+  }
+  if ((header.numCompanies != GetNumCompanies()) || (header.catalogHash != CompanyCatalogHash())) {
+    std::cout << "ERROR - checkpoint file " << path << " was written with a different company catalog" << std::endl;
+    close();
+    return false;
+  }
+  if (recordsValid() == false) {
+    std::cout << "ERROR - checkpoint file " << path << " is truncated or damaged" << std::endl;
+    close();
+    return false;
+  }
+  return true;
+}
+
+/** The engine indexes arrays with the aircraft indexes, companies and event types of the
+ * records, so every one of them is range checked before a simulation sees the file. */
+bool CheckpointFile::recordsValid(void) const {
+  const checkpoint_header_t& header = getHeader();
+  const Aircraft* aircrafts = getSection<Aircraft>(header.aircraft);
+  for (uint64_t i = 0; i < header.aircraft.count; i++) {
+    if ((aircrafts[i].m_id >= header.numCompanies) || (aircrafts[i].m_state >= AIRCRAFT_STATE_MAINTENANCE)) {
+      return false; // checkpointed runs have no repair bays
+    }
+  }
+  const ChargeStation* chargers = getSection<ChargeStation>(header.chargeStation);
+  if ((chargers->getNumChargers() != header.numChargers) || (chargers->getNumChargersInUse() > chargers->getNumChargers())) {
+    return false;
+  }
+  const charge_queue_node_t* nodes = getSection<charge_queue_node_t>(header.queueNodes);
+  for (uint64_t n = 0; n < header.queueNodes.count; n++) {
+    if ((nodes[n].entry.aircraftIndex >= header.numAircraft) || (nodes[n].id >= header.numCompanies)) {
+      return false;
+    }
+  }
+  // one per aircraft and the hourly fault check, all after the last tick handled
+  const sim_event_t* events = getSection<sim_event_t>(header.events);
+  if (header.events.count > (uint64_t) header.numAircraft + 1u) {
+    return false;
+  }
+  for (uint64_t e = 0; e < header.events.count; e++) {
+    if ((events[e].aircraftIndex >= header.numAircraft) || (events[e].tick <= header.currentTick) ||
+        ((events[e].type != SIM_EVENT_HOURLY_FAULT_CHECK) && (events[e].type != SIM_EVENT_BATTERY_DEAD) &&
+         (events[e].type != SIM_EVENT_CHARGING_COMPLETE))) {
+      return false;
+    }
+  }
+  return std::is_heap(events, events + header.events.count, SimEventLater());
+}
+
+void CheckpointFile::close(void) {
+#if defined(__unix__) || defined(__APPLE__)
+  if (m_mapped) {
+    munmap(m_data, m_bytes);
+  }
+#endif
+  m_data = nullptr;
+  m_bytes = 0;
+  m_mapped = false;
+  m_buffer.clear();
+}
+
+bool CheckpointFile::sectionFits(const checkpoint_section_t& section, size_t recordBytes) const {
+  return ((section.offset % CHECKPOINT_SECTION_ALIGNMENT) == 0) && (section.offset >= sizeof(checkpoint_header_t)) &&
+         (section.offset <= m_bytes) && (section.count <= ((m_bytes - section.offset) / recordBytes));
+}
+
+simulation_config_t CheckpointFile::getConfig(const simulation_config_t& base) const {
+  const checkpoint_header_t& header = getHeader();
+  simulation_config_t config = base;
+  config.mode = SIMULATION_MODE_EVENT;
+  config.numAircraft = header.numAircraft;
+  config.numChargers = header.numChargers;
+  config.policy = (charge_policy_t) header.policy;
+  config.chargeTargetSoc = header.chargeTargetSoc;
+  config.seed = header.seed;
+  return config;
+}
+
+bool RunCheckpointedSimulation(const simulation_config_t& baseConfig) {
+  simulation_config_t config = baseConfig;
+  std::vector<Aircraft> newAircrafts;
+  CheckpointFile resumeFile;
+  Aircraft* aircrafts;
+
+  if (config.resumePath.empty() == false) {
+    if (resumeFile.open(config.resumePath.c_str()) == false) {
+      return false;
+    }
+    config = resumeFile.getConfig(baseConfig);
+    if (config.simulationTicks < resumeFile.getHeader().currentTick) {
+      std::cout << "ERROR - the checkpoint is already at " << (resumeFile.getHeader().currentTick / (double) LOOP_TICKS_PER_HOUR) <<
+        " hr, pass --hours with a later horizon" << std::endl;
+      return false;
+    }
+    aircrafts = resumeFile.getSection<Aircraft>(resumeFile.getHeader().aircraft);
+  } else {
+    newAircrafts.resize(config.numAircraft);
+    if (CreateRandomAircraftIds(newAircrafts.data(), config.numAircraft, config.seed) == false) {
+      std::cout << "ERROR - all aircraft IDs were not generated." << std::endl;
+      WriteRandomIdErrorToOutputFile(config.outputPath);
+      return false;
+    }
+    aircrafts = newAircrafts.data();
+  }
+  std::cout << "seed: " << config.seed << std::endl; // rerun with --seed to reproduce this run
+
+  MetricsBatchStart(1);
+  MetricsRunStart(config);
+  SimulationStatistics stats;
+  EventSimulation sim(aircrafts, config, &stats);
+  if (config.resumePath.empty() == false) {
+    if (sim.restoreCheckpoint(resumeFile) == false) {
+      return false;
+    }
+  } else {
+    sim.start(true);
+  }
+
+  bool checkpoints = (config.checkpointPath.empty() == false);
+  uint32_t nextCheckpointTick = config.simulationTicks;
+  if (checkpoints) {
+    nextCheckpointTick = ((sim.getCurrentTick() / config.checkpointTicks) + 1u) * config.checkpointTicks;
+  }
+  while (true) {
+    uint32_t stopTick = std::min(nextCheckpointTick, config.simulationTicks);
+    while (sim.step(stopTick)) {
+    }
+    if (checkpoints) {
+      sim.writeCheckpoint(config.checkpointPath.c_str(), config.simulationTicks);
+    }
+    if (stopTick == config.simulationTicks) {
+      break;
+    }
+    nextCheckpointTick += config.checkpointTicks;
+  }
+  sim.finish(config.simulationTicks);
+  MetricsRunFinish(aircrafts, config.numAircraft, config.simulationTicks);
+
+  if (config.outputFormat == OUTPUT_FORMAT_TEXT) {
+    WriteDataToOutputFile(aircrafts, config.numAircraft, config.outputPath, &stats);
+  } else {
+    WriteRunResultTables(config, aircrafts);
+  }
+  return true;
+}
+
+/** Function to test checkpoints. A run that is checkpointed at 10 hr, restored from
+ * the file and run on to 24 hr must match a run straight to 24 hr, statistics included,
+ * for the FIFO line and a heap policy. A damaged checkpoint or one from another version
+ * is refused. */
+void CheckpointTest(void) {
+  const std::string path = (std::filesystem::temp_directory_path() / "evtolsim_checkpoint_test.bin").string();
+  const charge_policy_t policies[] = {CHARGE_POLICY_FIFO, CHARGE_POLICY_AGING};
+
+  for (charge_policy_t policy : policies) {
+    simulation_config_t config = DefaultSimulationConfig();
+    config.seed = 7;
+    config.policy = policy;
+    config.simulationTicks = 24u * LOOP_TICKS_PER_HOUR;
+
+    Aircraft straightAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+    for (uint8_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+      straightAircrafts[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+    }
+    Aircraft firstHalfAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+    std::copy(straightAircrafts, straightAircrafts + DEFAULT_AIRCRAFTS_IN_SIMULATION, firstHalfAircrafts);
+
+    SimulationStatistics straightStats;
+    RunEventSimulation(straightAircrafts, config, &straightStats);
+
+    SimulationStatistics firstHalfStats;
+    EventSimulation firstHalf(firstHalfAircrafts, config, &firstHalfStats);
+    firstHalf.start(true);
+    while (firstHalf.step(10u * LOOP_TICKS_PER_HOUR)) {
+    }
+    bool pass = firstHalf.writeCheckpoint(path.c_str(), config.simulationTicks);
+
+    CheckpointFile file;
+    pass = pass && file.open(path.c_str());
+    uint32_t mismatches = DEFAULT_AIRCRAFTS_IN_SIMULATION;
+    if (pass) {
+      simulation_config_t resumeConfig = file.getConfig(config);
+      Aircraft* resumedAircrafts = file.getSection<Aircraft>(file.getHeader().aircraft);
+      SimulationStatistics resumedStats;
+      EventSimulation resumed(resumedAircrafts, resumeConfig, &resumedStats);
+      pass = resumed.restoreCheckpoint(file);
+      while (resumed.step(config.simulationTicks)) {
+      }
+      resumed.finish(config.simulationTicks);
+      mismatches = CountMismatchedAircraft(straightAircrafts, resumedAircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION) +
+                   CountMismatchedStatistics(straightStats, resumedStats);
+    }
+    std::cout << "Checkpoint test, " << GetChargePolicyName(policy) << ": " << ((pass && (mismatches == 0)) ? "PASS" : "FAIL") <<
+      " (" << mismatches << " mismatched aircraft)" << std::endl;
+  }
+
+  // a checkpoint with an event out of the fleet must be refused, not crash the resumed run
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  checkpoint_header_t header;
+  file.read((char*) &header, sizeof(header));
+  for (uint64_t e = 0; e < header.events.count; e++) {
+    uint32_t badIndex = 0x7fffffffu;
+    file.seekp(header.events.offset + e * sizeof(sim_event_t) + offsetof(sim_event_t, aircraftIndex));
+    file.write((const char*) &badIndex, sizeof(badIndex));
+  }
+  file.flush();
+  std::cout << "(the checkpoint test expects the next error)" << std::endl;
+  CheckpointFile damagedFile;
+  bool damagedRefused = (damagedFile.open(path.c_str()) == false);
+  simulation_config_t resumeConfig = DefaultSimulationConfig();
+  resumeConfig.resumePath = path;
+  resumeConfig.simulationTicks = 30u * LOOP_TICKS_PER_HOUR;
+  std::cout << "(the checkpoint test expects the next error)" << std::endl;
+  damagedRefused = damagedRefused && (RunCheckpointedSimulation(resumeConfig) == false);
+  std::cout << "Checkpoint damaged file test: " << (damagedRefused ? "PASS" : "FAIL") << std::endl;
+
+  // a checkpoint written by a later version must be refused
+  uint32_t laterVersion = CHECKPOINT_VERSION + 1u;
+  file.seekp(offsetof(checkpoint_header_t, version));
+  file.write((const char*) &laterVersion, sizeof(laterVersion));
+  file.close();
+  std::cout << "(the checkpoint test expects the next error)" << std::endl;
+  CheckpointFile laterFile;
+  bool refused = (laterFile.open(path.c_str()) == false);
+  std::cout << "Checkpoint version test: " << (refused ? "PASS" : "FAIL") << std::endl;
+  std::remove(path.c_str());
+}
@@ -0,0 +1,133 @@
+/** Defines the checkpoint file of the event-driven engine. A checkpoint holds the whole
+ * state of a run between two ticks, so a long run can be resumed after a crash, or a
+ * "what if" branch can be started from a mid-run state with a different horizon.
+ *
+ * The file is a fixed header followed by sections of raw, fixed-size records, each
+ * aligned to CHECKPOINT_SECTION_ALIGNMENT bytes:
+ *  aircraft        Aircraft records, used in place from the mapped file
+ *  charge station  the ChargeStation, chargers in use over time included
+ *  queue           the line for chargers, charge_queue_node_t records
+ *  events          the pending events, sim_event_t records in heap order
+ *  statistics      company_statistics_t per company, then charge_site_statistics_t
+ *
+ * Restoring maps the file copy-on-write and points the simulation at the aircraft in
+ * the mapping, so the fleet is not parsed or copied no matter how large it is. Only the
+ * line and the event heap, which are at most one entry per aircraft, are copied.
+ *
+ * The random streams are counter based (RandomGen.h), so the seed and the pending
+ * hourly fault check event are their whole position; no generator state is saved.
+ * Records are written in the byte order of the machine, and the header records the
+ * sizes of the record types, so a file from a different build is refused, not misread.
+ * Bump CHECKPOINT_VERSION whenever the layout of a section changes. */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Aircraft.h"
+#include "Config.h"
+
+#define CHECKPOINT_MAGIC "EVTOLCKP"
+#define CHECKPOINT_VERSION (4u)
+#define CHECKPOINT_BYTE_ORDER_MARK (0x01020304u)
+#define CHECKPOINT_SECTION_ALIGNMENT (64u)
+
+typedef struct {
+  uint64_t offset; // from the start of the file
+  uint64_t count; // records, 0 for an empty section
+} checkpoint_section_t;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrderMark;
+  uint32_t headerBytes;
+  uint32_t aircraftBytes; // sizes of the record types, to refuse files from a build with a different layout
+  uint32_t eventBytes;
+  uint32_t queueNodeBytes;
+  uint32_t numAircraft;
+  uint32_t numChargers;
+  uint32_t policy; // charge_policy_t
+  uint32_t numCompanies;
+  uint64_t catalogHash; // flight and charge durations of every company, a checkpoint only resumes with the same catalog
+  uint64_t seed;
+  uint32_t simulationTicks; // horizon of the run that wrote the checkpoint
+  uint32_t currentTick; // last tick handled, every event of it and its charger dispatch included
+  uint64_t queueNextSequence;
+  uint32_t hasStatistics; // 0 when the run recorded no streaming statistics
+  float chargeTargetSoc; // state of charge every charge session ends at
+  checkpoint_section_t aircraft;
+  checkpoint_section_t chargeStation;
+  checkpoint_section_t queueLength; // one TimeWeightedStatistic
+  checkpoint_section_t queueNodes;
+  checkpoint_section_t events;
+  checkpoint_section_t companyStatistics;
+  checkpoint_section_t chargeSiteStatistics;
+} checkpoint_header_t;
+
+// Hash of the flight and charge durations of the loaded catalog
+uint64_t CompanyCatalogHash(void);
+
+/** Writes a checkpoint to a temporary file next to the final path, then renames it over
+ * the final path once it is complete and flushed, so a crash while writing leaves the
+ * previous checkpoint in place. */
+class CheckpointWriter
+{
+public:
+  CheckpointWriter() {m_file = nullptr; m_offset = 0; m_failed = false;}
+  ~CheckpointWriter();
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  bool open(const char* path); // reserves room for the header
+  checkpoint_section_t addSection(const void* records, size_t recordBytes, uint64_t count);
+  bool commit(const checkpoint_header_t& header); // writes the header, flushes and renames, false on any write error
+
+private:
+  std::FILE* m_file;
+  std::string m_path;
+  std::string m_tempPath;
+  uint64_t m_offset;
+  bool m_failed;
+};
+
+/** A checkpoint file mapped into memory and validated, see the top of this file. The
+ * mapping is private, so the simulation can change the aircraft in place without
+ * writing back to the file. The file must stay open while a simulation uses it. */
+class CheckpointFile
+{
+public:
+  CheckpointFile() {m_data = nullptr; m_bytes = 0; m_mapped = false;}
+  ~CheckpointFile() {close();}
+  CheckpointFile(const CheckpointFile&) = delete;
+  CheckpointFile& operator=(const CheckpointFile&) = delete;
+
+  bool open(const char* path); // false, with an error printed, if the file is missing, truncated, damaged or from another build
+  void close(void);
+  const checkpoint_header_t& getHeader(void) const {return *(const checkpoint_header_t*) m_data;}
+  simulation_config_t getConfig(const simulation_config_t& base) const; // base with the fleet, chargers, policy, charge target and seed of the checkpoint
+
+  template <typename T>
+  T* getSection(const checkpoint_section_t& section) const {return (T*) (m_data + section.offset);}
+
+private:
+  bool sectionFits(const checkpoint_section_t& section, size_t recordBytes) const;
+  bool recordsValid(void) const; // every index and enum of the records is in range
+
+  uint8_t* m_data;
+  size_t m_bytes;
+  bool m_mapped; // false when the file was read into m_buffer where mmap isn't available
+  std::vector<uint64_t> m_buffer; // 8 byte aligned like a mapping
+};
+
+/** Runs a single event-driven simulation that writes a checkpoint to
+ * config.checkpointPath every config.checkpointTicks and once more at the horizon,
+ * before the legs still in progress are closed out, so a finished run can be extended.
+ * With config.resumePath it starts from that checkpoint instead of tick 0 and runs to
+ * config.simulationTicks. */
+bool RunCheckpointedSimulation(const simulation_config_t& config); // false if the fleet or the checkpoint to resume from can't be used
+void CheckpointTest(void);
@@ -0,0 +1,429 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "Config.h"
+
+#include "AircraftCompanyCommon.h"
+#include "ChargeStation.h"
+#include "RandomGen.h"
+#include "Timeline.h"
+#include "Trace.h"
+
+static const char* const chargePolicyNames[TOTAL_CHARGE_POLICIES] = {
+  "fifo", "shortest", "value", "aging"
+};
+
+const char* GetChargePolicyName(charge_policy_t policy) {
+  return chargePolicyNames[policy];
+}
+
+simulation_config_t DefaultSimulationConfig(void) {
+  simulation_config_t config;
+  config.action = PROGRAM_ACTION_SIMULATE;
+  config.mode = SIMULATION_MODE_TICK;
+  config.modeGiven = false;
+  config.policy = CHARGE_POLICY_FIFO;
+  config.chargeTargetSoc = 1.0f;
+  config.numRepairBays = 0;
+  config.repairTicks = DEFAULT_REPAIR_HOURS * LOOP_TICKS_PER_HOUR;
+  config.tripRequestsPerHour = 0.0;
+  config.meanTripMiles = DEFAULT_TRIP_MILES;
+  config.maxWaitTicks = DEFAULT_MAX_WAIT_MIN * LOOP_TICKS_PER_MIN;
+  config.numAircraft = DEFAULT_AIRCRAFTS_IN_SIMULATION;
+  config.numChargers = DEFAULT_CHARGERS;
+  config.numVertiports = 1;
+  config.simulationTicks = DEFAULT_SIMULATION_HOURS * LOOP_TICKS_PER_HOUR;
+  config.seed = NewRandomSeed();
+  config.outputPath = DEFAULT_OUTPUT_PATH;
+  config.outputFormat = OUTPUT_FORMAT_TEXT;
+  config.numReplications = 1;
+  config.checkpointTicks = DEFAULT_CHECKPOINT_HOURS * LOOP_TICKS_PER_HOUR;
+  config.timelineTicks = DEFAULT_TIMELINE_SAMPLE_MIN * LOOP_TICKS_PER_MIN;
+  config.traceFormat = TRACE_FORMAT_TEXT;
+  config.numThreads = std::thread::hardware_concurrency();
+  if (config.numThreads == 0) {
+    config.numThreads = 1; // the core count can't be detected on this platform
+  }
+  return config;
+}
+
+static bool ParseUnsigned(const std::string& value, uint32_t* result) {
+  char* end = nullptr;
+  unsigned long parsed = strtoul(value.c_str(), &end, 10);
+  if ((value.empty()) || (*end != '\0') || (parsed > UINT32_MAX)) {
+    return false;
+  }
+  *result = (uint32_t) parsed;
+  return true;
+}
+
+static bool ParseSeed(const std::string& value, uint64_t* result) {
+  char* end = nullptr;
+  unsigned long long parsed = strtoull(value.c_str(), &end, 0); // accepts decimal or 0x hex
+  if ((value.empty()) || (*end != '\0') || (value[0] == '-')) {
+    return false;
+  }
+  *result = (uint64_t) parsed;
+  return true;
+}
+
+static bool ParseHours(const std::string& value, uint32_t* simulationTicks) {
+  char* end = nullptr;
+  double hours = strtod(value.c_str(), &end);
+  // the tick counters are 32 bits wide, which still covers several decades of simulated time
+  if ((value.empty()) || (*end != '\0') || (hours <= 0.0) || ((hours * LOOP_TICKS_PER_HOUR) >= UINT32_MAX)) {
+    return false;
+  }
+  *simulationTicks = (uint32_t) (hours * LOOP_TICKS_PER_HOUR + 0.5);
+  return true;
+}
+
+static bool ParsePositiveDouble(const std::string& value, double* result) {
+  char* end = nullptr;
+  double parsed = strtod(value.c_str(), &end);
+  if ((value.empty()) || (*end != '\0') || !(parsed > 0.0) || (parsed > 1e12)) {
+    return false;
+  }
+  *result = parsed;
+  return true;
+}
+
+static bool ParseMinutes(const std::string& value, uint32_t* ticks) {
+  double minutes;
+  if ((ParsePositiveDouble(value, &minutes) == false) || ((minutes * LOOP_TICKS_PER_MIN) >= UINT32_MAX)) {
+    return false;
+  }
+  *ticks = (uint32_t) (minutes * LOOP_TICKS_PER_MIN + 0.5);
+  return true;
+}
+
+// A percentage above 0 and up to 100, stored as a fraction
+static bool ParsePercent(const std::string& value, float* fraction) {
+  char* end = nullptr;
+  double percent = strtod(value.c_str(), &end);
+  if ((value.empty()) || (*end != '\0') || (percent <= 0.0) || (percent > 100.0)) {
+    return false;
+  }
+  *fraction = (float) (percent / 100.0);
+  return true;
+}
+
+// List of values separated by separator, each checked by parseValue
+static bool ParseList(const std::string& value, std::vector<uint32_t>* result, bool (*parseValue)(const std::string&, uint32_t*),
+                      char separator = ',') {
+  result->clear();
+  size_t start = 0;
+  while (start <= value.size()) {
+    size_t comma = value.find(separator, start);
+    if (comma == std::string::npos) {
+      comma = value.size();
+    }
+    uint32_t parsed;
+    if (parseValue(value.substr(start, comma - start), &parsed) == false) {
+      return false;
+    }
+    result->push_back(parsed);
+    start = comma + 1;
+  }
+  return (result->empty() == false);
+}
+
+static bool ParsePositive(const std::string& value, uint32_t* result) {
+  return ParseUnsigned(value, result) && (*result > 0);
+}
+
+// Comma separated fleet mixes, each a colon separated weight per company, e.g. 1:1:1:1:1,4:1:1:1:1
+static bool ParseMixList(const std::string& value, std::vector<std::vector<uint32_t>>* mixes) {
+  mixes->clear();
+  size_t start = 0;
+  while (start <= value.size()) {
+    size_t comma = value.find(',', start);
+    if (comma == std::string::npos) {
+      comma = value.size();
+    }
+    std::vector<uint32_t> weights;
+    if ((ParseList(value.substr(start, comma - start), &weights, ParsePositive, ':') == false) ||
+        (weights.size() > MAX_AIRCRAFT_COMPANIES)) {
+      return false;
+    }
+    for (uint32_t weight : weights) {
+      // so the sum of a mix fits the 32 bit bound it is drawn below
+      if (weight > (UINT32_MAX / MAX_AIRCRAFT_COMPANIES)) {
+        return false;
+      }
+    }
+    mixes->push_back(weights);
+    start = comma + 1;
+  }
+  return true;
+}
+
+// Applies one setting by name. Shared by the command line and the config file.
+static bool ApplySetting(const std::string& key, const std::string& value, simulation_config_t* config) {
+  if (key == "aircraft") {
+    return ParseUnsigned(value, &config->numAircraft) && (config->numAircraft > 0); // checked against the catalog after parsing
+  } else if (key == "chargers") {
+    return ParseUnsigned(value, &config->numChargers) && (config->numChargers > 0);
+  } else if (key == "vertiports") {
+    return ParsePositive(value, &config->numVertiports);
+  } else if (key == "hours") {
+    return ParseHours(value, &config->simulationTicks);
+  } else if (key == "output") {
+    config->outputPath = value;
+    return (value.empty() == false);
+  } else if (key == "format") {
+    if (value == "text") {
+      config->outputFormat = OUTPUT_FORMAT_TEXT;
+    } else if (value == "csv") {
+      config->outputFormat = OUTPUT_FORMAT_CSV;
+    } else if (value == "columnar") {
+      config->outputFormat = OUTPUT_FORMAT_COLUMNAR;
+    } else {
+      return false;
+    }
+    return true;
+  } else if (key == "replications") {
+    return ParseUnsigned(value, &config->numReplications) && (config->numReplications > 0);
+  } else if (key == "threads") {
+    return ParseUnsigned(value, &config->numThreads) && (config->numThreads > 0);
+  } else if (key == "seed") {
+    return ParseSeed(value, &config->seed);
+  } else if (key == "mode") {
+    if (value == "tick") {
+      config->mode = SIMULATION_MODE_TICK;
+    } else if (value == "event") {
+      config->mode = SIMULATION_MODE_EVENT;
+    } else if (value == "soa") {
+      config->mode = SIMULATION_MODE_SOA;
+    } else if (value == "analytic") {
+      config->mode = SIMULATION_MODE_ANALYTIC;
+    } else {
+      return false;
+    }
+    config->modeGiven = true;
+    return true;
+  } else if (key == "charge-target") {
+    return ParsePercent(value, &config->chargeTargetSoc);
+  } else if (key == "repair-bays") {
+    return ParsePositive(value, &config->numRepairBays);
+  } else if (key == "repair-hours") {
+    return ParseHours(value, &config->repairTicks);
+  } else if (key == "demand") {
+    return ParsePositiveDouble(value, &config->tripRequestsPerHour);
+  } else if (key == "trip-miles") {
+    return ParsePositiveDouble(value, &config->meanTripMiles);
+  } else if (key == "max-wait-minutes") {
+    return ParseMinutes(value, &config->maxWaitTicks);
+  } else if (key == "policy") {
+    for (uint8_t i = 0; i < TOTAL_CHARGE_POLICIES; i++) {
+      if (value == chargePolicyNames[i]) {
+        config->policy = (charge_policy_t) i;
+        return true;
+      }
+    }
+    return false;
+  } else if (key == "checkpoint") {
+    config->checkpointPath = value;
+    return (value.empty() == false);
+  } else if (key == "checkpoint-hours") {
+    return ParseHours(value, &config->checkpointTicks);
+  } else if (key == "resume") {
+    config->resumePath = value;
+    return (value.empty() == false);
+  } else if ((key == "sweep-aircraft") || (key == "sweep-chargers") || (key == "sweep-hours") || (key == "sweep-mix")) {
+    config->action = PROGRAM_ACTION_SWEEP;
+    if (key == "sweep-aircraft") {
+      return ParseList(value, &config->sweepAircraft, ParsePositive);
+    } else if (key == "sweep-chargers") {
+      return ParseList(value, &config->sweepChargers, ParsePositive);
+    } else if (key == "sweep-mix") {
+      return ParseMixList(value, &config->sweepMixes);
+    }
+    return ParseList(value, &config->sweepTicks, ParseHours);
+  } else if (key == "timeline") {
+    config->timelinePath = value;
+    return (value.empty() == false);
+  } else if (key == "timeline-minutes") {
+    uint32_t minutes;
+    if ((ParseUnsigned(value, &minutes) == false) || (minutes == 0) || (minutes > (UINT32_MAX / LOOP_TICKS_PER_MIN))) {
+      return false;
+    }
+    config->timelineTicks = minutes * LOOP_TICKS_PER_MIN;
+    return true;
+  } else if (key == "trace") {
+    if (TRACE_ENABLED == false) {
+      std::cout << "ERROR - --trace needs a build with EVTOL_TRACE=1, the trace points are compiled out" << std::endl;
+      return false;
+    }
+    config->tracePath = value;
+    return (value.empty() == false);
+  } else if (key == "metrics") {
+    config->metricsPath = value;
+    return (value.empty() == false);
+  } else if (key == "read-metrics") {
+    config->action = PROGRAM_ACTION_READ_METRICS;
+    config->readMetricsPath = value;
+    return (value.empty() == false);
+  } else if (key == "decode-trace") {
+    config->action = PROGRAM_ACTION_DECODE_TRACE;
+    config->decodeTracePath = value;
+    return (value.empty() == false);
+  } else if (key == "trace-format") {
+    if (value == "text") {
+      config->traceFormat = TRACE_FORMAT_TEXT;
+    } else if (value == "chrome") {
+      config->traceFormat = TRACE_FORMAT_CHROME;
+    } else {
+      return false;
+    }
+    return true;
+  } else if (key == "catalog") {
+    return LoadCompanyCatalog(value.c_str());
+  } else if (key == "config") {
+    return LoadConfigFile(value.c_str(), config);
+  }
+  return false;
+}
+
+static void PrintUsage(void) {
+  std::cout <<
+    "usage: evtolsim [--aircraft N] [--chargers N] [--vertiports N] [--hours H] [--mode tick|event|soa|analytic]\n"
+    "                [--policy fifo|shortest|value|aging] [--charge-target P] [--repair-bays N] [--repair-hours H]\n"
+    "                [--demand R] [--trip-miles M] [--max-wait-minutes M]\n"
+    "                [--catalog PATH] [--seed N] [--output PATH] [--format text|csv|columnar]\n"
+    "                [--replications N] [--threads N] [--config PATH] [--checkpoint PATH]\n"
+    "                [--checkpoint-hours H] [--resume PATH]\n"
+    "                [--sweep-aircraft LIST] [--sweep-chargers LIST] [--sweep-hours LIST] [--sweep-mix LIST]\n"
+    "                [--timeline PATH] [--timeline-minutes M] [--metrics PATH] [--read-metrics PATH]\n"
+    "                [--trace PATH] [--decode-trace PATH]\n"
+    "                [--trace-format text|chrome] [--bench-scaling]\n"
+    "                [--bench-soa] [--bench-batch] [--bench-policy] [--bench-analytic] [--self-test]\n"
+    "  the fleet needs at least one aircraft of each company in the catalog, " << GetNumCompanies() << " now" <<
+    std::endl;
+}
+
+bool LoadConfigFile(const char* path, simulation_config_t* config) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cout << "ERROR - could not open config file " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+    size_t equals = line.find('=');
+    if (equals == std::string::npos) {
+      if (line.find_first_not_of(" \t\r") != std::string::npos) {
+        std::cout << "ERROR - " << path << ":" << lineNumber << " expected key = value" << std::endl;
+        return false;
+      }
+      continue;
+    }
+
+    std::string key = line.substr(0, equals);
+    std::string value = line.substr(equals + 1);
+    key.erase(0, key.find_first_not_of(" \t"));
+    key.erase(key.find_last_not_of(" \t\r") + 1);
+    value.erase(0, value.find_first_not_of(" \t"));
+    value.erase(value.find_last_not_of(" \t\r") + 1);
+    if ((key == "config") || (ApplySetting(key, value, config) == false)) {
+      std::cout << "ERROR - " << path << ":" << lineNumber << " invalid setting " << key << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ParseCommandLine(int argc, char* argv[], simulation_config_t* config) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--bench-scaling") {
+      config->action = PROGRAM_ACTION_SCALING_BENCHMARK;
+    } else if (arg == "--bench-soa") {
+      config->action = PROGRAM_ACTION_SOA_BENCHMARK;
+    } else if (arg == "--bench-batch") {
+      config->action = PROGRAM_ACTION_BATCH_BENCHMARK;
+    } else if (arg == "--bench-analytic") {
+      config->action = PROGRAM_ACTION_ANALYTIC_BENCHMARK;
+    } else if (arg == "--bench-policy") {
+      config->action = PROGRAM_ACTION_POLICY_BENCHMARK;
+    } else if (arg == "--self-test") {
+      config->action = PROGRAM_ACTION_SELF_TEST;
+    } else if (arg == "--event-driven") {
+      config->mode = SIMULATION_MODE_EVENT; // kept from before --mode existed
+      config->modeGiven = true;
+    } else if ((arg.rfind("--", 0) == 0) && ((i + 1) < argc) && ApplySetting(arg.substr(2), argv[i + 1], config)) {
+      i++;
+    } else {
+      std::cout << "ERROR - invalid option " << arg << std::endl;
+      PrintUsage();
+      return false;
+    }
+  }
+
+  // checked last because --catalog can come after --aircraft, a sweep over fleet sizes doesn't use --aircraft
+  if ((config->numAircraft < GetNumCompanies()) && config->sweepAircraft.empty()) {
+    std::cout << "ERROR - " << config->numAircraft << " aircraft can't cover the " << GetNumCompanies() << " companies of the catalog" << std::endl;
+    PrintUsage();
+    return false;
+  }
+  if ((config->timelinePath.empty() == false) && ((config->mode == SIMULATION_MODE_ANALYTIC) || (config->numReplications > 1) ||
+      (config->checkpointPath.empty() == false) || (config->resumePath.empty() == false))) {
+    std::cout << "ERROR - --timeline records a single run of the tick, event or soa engine, without checkpoints" << std::endl;
+    return false;
+  }
+  if (((config->checkpointPath.empty() == false) || (config->resumePath.empty() == false)) &&
+      ((config->numReplications > 1) || (config->modeGiven && (config->mode != SIMULATION_MODE_EVENT)))) {
+    std::cout << "ERROR - --checkpoint and --resume save and restore a single run of the event engine, without --replications or another --mode" << std::endl;
+    return false;
+  }
+  if ((config->numVertiports > 1) && ((config->mode == SIMULATION_MODE_ANALYTIC) || (config->checkpointPath.empty() == false) ||
+      (config->resumePath.empty() == false) || (config->sweepAircraft.empty() == false) || (config->sweepChargers.empty() == false) ||
+      (config->sweepTicks.empty() == false) || (config->sweepMixes.empty() == false) || (config->timelinePath.empty() == false))) {
+    std::cout << "ERROR - --vertiports runs the network engine, without analytic mode, checkpoints, sweeps or a timeline" << std::endl;
+    return false;
+  }
+  if ((config->numRepairBays > 0) && (((config->mode != SIMULATION_MODE_TICK) && (config->mode != SIMULATION_MODE_EVENT)) ||
+      (config->numVertiports > 1) || (config->checkpointPath.empty() == false) || (config->resumePath.empty() == false) ||
+      (config->sweepAircraft.empty() == false) || (config->sweepChargers.empty() == false) || (config->sweepTicks.empty() == false) ||
+      (config->sweepMixes.empty() == false) || (config->timelinePath.empty() == false))) {
+    std::cout << "ERROR - --repair-bays runs the tick or event engine at a single site, without checkpoints, sweeps or a timeline" << std::endl;
+    return false;
+  }
+  if ((config->tripRequestsPerHour > 0.0) && ((config->mode == SIMULATION_MODE_ANALYTIC) || (config->numVertiports > 1) ||
+      (config->numRepairBays > 0) || (config->checkpointPath.empty() == false) || (config->resumePath.empty() == false) ||
+      (config->sweepAircraft.empty() == false) || (config->sweepChargers.empty() == false) || (config->sweepTicks.empty() == false) ||
+      (config->sweepMixes.empty() == false) || (config->timelinePath.empty() == false))) {
+    std::cout << "ERROR - --demand runs the demand engine at a single site, without analytic mode, repair bays, checkpoints, sweeps or a timeline" << std::endl;
+    return false;
+  }
+  if (((config->sweepAircraft.empty() == false) || (config->sweepChargers.empty() == false) || (config->sweepTicks.empty() == false) ||
+      (config->sweepMixes.empty() == false)) &&
+      ((config->numReplications > 1) || (config->modeGiven && (config->mode != SIMULATION_MODE_EVENT)))) {
+    std::cout << "ERROR - a sweep runs the event engine once per grid point, without --replications or another --mode" << std::endl;
+    return false;
+  }
+  for (uint32_t numAircraft : config->sweepAircraft) {
+    if (numAircraft < GetNumCompanies()) {
+      std::cout << "ERROR - a sweep fleet of " << numAircraft << " aircraft can't cover the " << GetNumCompanies() << " companies of the catalog" << std::endl;
+      PrintUsage();
+      return false;
+    }
+  }
+  for (const std::vector<uint32_t>& mix : config->sweepMixes) {
+    if (mix.size() != GetNumCompanies()) {
+      std::cout << "ERROR - a sweep fleet mix has " << mix.size() << " weights, the catalog has " << GetNumCompanies() << " companies" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,138 @@
+/** Defines the runtime settings of the simulation. Fleet size, charger count and
+ * horizon used to be compile-time macros; they are now read from the command line
+ * or a config file so large networks can be modeled without recompiling.
+ *
+ * Command line options (a config file uses the same names as "key = value" lines):
+ *  --aircraft N            number of aircraft in the fleet (at least one per company)
+ *  --chargers N            number of chargers at the charge station, or at every vertiport
+ *  --vertiports N          fly the fleet between N vertiports with their own chargers, 1 by default, see Network.h
+ *  --hours H               simulated horizon in hours, fractions allowed
+ *  --mode tick|event|soa|analytic  simulation engine, see Simulation.h
+ *  --catalog PATH          company catalog CSV, see AircraftCatalog.csv, the built-in Alpha to Echo by default
+ *  --policy NAME           charger scheduling policy: fifo, shortest, value or aging, see ChargeQueue.h
+ *  --charge-target P       chargers release an aircraft at P percent state of charge, 100 by default, see AircraftCompanyCommon.h
+ *  --repair-bays N         faults in flight ground aircraft until one of N repair bays fixes them, see Maintenance.h
+ *  --repair-hours H        mean repair time in a bay, 2 by default
+ *  --demand R              fly trips requested by passengers, R requests per hour, instead of flying nonstop, see Demand.h
+ *  --trip-miles M          mean requested trip length, 20 by default
+ *  --max-wait-minutes M    a request no aircraft takes within M minutes goes unserved, 15 by default
+ *  --seed N                seed for every random draw, a run is reproducible from it
+ *  --output PATH           file the results are written to
+ *  --format NAME           text summary, csv tables or columnar binary tables, text by default, see ResultWriter.h
+ *  --replications N        run N independent replications and report their statistics
+ *  --threads N             worker threads for replications, all cores by default
+ *  --config PATH           read settings from a file, later options override it
+ *  --checkpoint PATH       save the whole state of an event-driven run to PATH while it runs, see Checkpoint.h
+ *  --checkpoint-hours H    simulated hours between checkpoints, 24 by default
+ *  --resume PATH           go on from a checkpoint to --hours, with the fleet, chargers, policy and seed saved in it
+ *  --sweep-aircraft LIST   run a parameter sweep over these fleet sizes, e.g. 20,40,80, see Sweep.h
+ *  --sweep-chargers LIST   run a parameter sweep over these charger counts
+ *  --sweep-hours LIST      run a parameter sweep over these horizons; an axis left out uses the single value
+ *  --sweep-mix LIST        run a parameter sweep over these fleet mixes, each a weight per company, e.g. 1:1:1:1:1,4:1:1:1:1
+ *  --timeline PATH         record every state transition and write the aircraft in each state over time to PATH, see Timeline.h
+ *  --timeline-minutes M    simulated minutes between the rows of --timeline, 10 by default
+ *  --metrics PATH          publish live counters of the run to a page mapped from PATH, e.g. under /dev/shm, see Metrics.h
+ *  --read-metrics PATH     print the metrics page at PATH in the Prometheus text format instead of running a simulation
+ *  --trace PATH            write every state transition to a binary trace file, needs a build with EVTOL_TRACE=1, see Trace.h
+ *  --decode-trace PATH     decode a binary trace file to --output instead of running a simulation
+ *  --trace-format NAME     text or chrome (Chrome trace event JSON), for --decode-trace, text by default
+ *  --bench-scaling         run the fleet size scaling benchmark instead of a simulation
+ *  --bench-soa             compare the SoA tick engine against the Aircraft array tick loop
+ *  --bench-batch           measure replication throughput as worker threads are added
+ *  --bench-analytic        compare the analytic fast path against the event engine over a charger and horizon sweep
+ *  --bench-policy          run every charger scheduling policy on the same seeded replications
+ *  --self-test             run the built-in tests instead of a simulation */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define DEFAULT_SIMULATION_HOURS (3u)
+#define DEFAULT_OUTPUT_PATH "SimulationOutput.txt"
+#define DEFAULT_CHECKPOINT_HOURS (24u)
+#define DEFAULT_REPAIR_HOURS (2u)
+#define DEFAULT_TRIP_MILES (20u)
+#define DEFAULT_MAX_WAIT_MIN (15u)
+
+typedef enum {
+  SIMULATION_MODE_TICK = 0u, // step every aircraft through its state switch on every loop tick
+  SIMULATION_MODE_EVENT, // jump directly between state transitions, see EventSimulation.h
+  SIMULATION_MODE_SOA, // tick loop over structure-of-arrays fleet storage, see Fleet.h
+  SIMULATION_MODE_ANALYTIC, // find the period of the timeline and extrapolate, see AnalyticSimulation.h
+} simulation_mode_t;
+
+typedef enum {
+  CHARGE_POLICY_FIFO = 0u, // first in line charges first
+  CHARGE_POLICY_SHORTEST_CHARGE_FIRST, // shortest charge session first, frees chargers soonest
+  CHARGE_POLICY_MOST_PASSENGER_MILES, // most passenger miles flown per minute of charger time first
+  CHARGE_POLICY_AGING, // passenger miles per charge minute, plus a bonus that grows while waiting
+
+  TOTAL_CHARGE_POLICIES
+} charge_policy_t;
+
+typedef enum {
+  OUTPUT_FORMAT_TEXT = 0u, // human readable summary
+  OUTPUT_FORMAT_CSV, // a CSV file per result table
+  OUTPUT_FORMAT_COLUMNAR, // every result table in one binary file, column by column
+} output_format_t;
+
+typedef enum {
+  TRACE_FORMAT_TEXT = 0u, // one line per record
+  TRACE_FORMAT_CHROME, // Chrome trace event JSON, one track per aircraft
+} trace_format_t;
+
+typedef enum {
+  PROGRAM_ACTION_SIMULATE = 0u,
+  PROGRAM_ACTION_SCALING_BENCHMARK,
+  PROGRAM_ACTION_SOA_BENCHMARK,
+  PROGRAM_ACTION_BATCH_BENCHMARK,
+  PROGRAM_ACTION_POLICY_BENCHMARK,
+  PROGRAM_ACTION_ANALYTIC_BENCHMARK,
+  PROGRAM_ACTION_SWEEP,
+  PROGRAM_ACTION_DECODE_TRACE,
+  PROGRAM_ACTION_READ_METRICS,
+  PROGRAM_ACTION_SELF_TEST,
+} program_action_t;
+
+typedef struct {
+  program_action_t action;
+  simulation_mode_t mode;
+  bool modeGiven; // set by --mode or --event-driven, so sweeps and checkpoints, which always run the event engine, can reject another
+  charge_policy_t policy;
+  float chargeTargetSoc; // state of charge chargers release aircraft at, 0 to 1
+  uint32_t numRepairBays; // 0 unless faults ground aircraft, faults are then only counted every hour
+  uint32_t repairTicks; // mean time in a repair bay
+  double tripRequestsPerHour; // 0 unless the fleet flies requested trips
+  double meanTripMiles;
+  uint32_t maxWaitTicks; // a request unserved for longer is given up
+  uint32_t numAircraft;
+  uint32_t numChargers;
+  uint32_t numVertiports; // 1 unless the fleet flies between vertiports
+  uint32_t simulationTicks;
+  uint64_t seed;
+  std::string outputPath;
+  output_format_t outputFormat;
+  uint32_t numReplications;
+  uint32_t numThreads;
+  std::string checkpointPath; // empty unless checkpoints are written
+  uint32_t checkpointTicks;
+  std::string resumePath; // empty unless the run goes on from a checkpoint
+  std::vector<uint32_t> sweepAircraft; // the sweep axes, empty unless given
+  std::vector<uint32_t> sweepChargers;
+  std::vector<uint32_t> sweepTicks;
+  std::vector<std::vector<uint32_t>> sweepMixes; // each a weight per company of the catalog, kept in the given order
+  std::string timelinePath; // empty unless the timeline is recorded
+  uint32_t timelineTicks;
+  std::string metricsPath; // empty unless live metrics are published
+  std::string readMetricsPath;
+  std::string tracePath; // empty unless the run is traced
+  std::string decodeTracePath;
+  trace_format_t traceFormat;
+} simulation_config_t;
+
+simulation_config_t DefaultSimulationConfig(void);
+bool ParseCommandLine(int argc, char* argv[], simulation_config_t* config); // returns false and prints usage on a bad option
+bool LoadConfigFile(const char* path, simulation_config_t* config);
+const char* GetChargePolicyName(charge_policy_t policy); // same names as the --policy option
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "Demand.h"
+
+#include "Arena.h"
+#include "Metrics.h"
+#include "RandomGen.h"
+#include "Trace.h"
+
+// Orders an idle heap so the most charged aircraft, then the lowest index, is on top
+struct IdleAircraftLess {
+  const Aircraft* aircrafts;
+  bool operator()(uint32_t a, uint32_t b) const {
+    if (aircrafts[a].m_stateOfCharge != aircrafts[b].m_stateOfCharge) {
+      return aircrafts[a].m_stateOfCharge < aircrafts[b].m_stateOfCharge;
+    }
+    return a > b;
+  }
+};
+
+DemandSimulation::DemandSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats) :
+  m_battChargers(config.numChargers), m_aircraftInLineToCharge(config.numAircraft, config.policy),
+  m_events(GetSimulationMemory()), m_idleAircraft(GetSimulationMemory()), m_companiesBySeats(GetSimulationMemory()),
+  m_landingSoc(GetSimulationMemory()), m_pool(GetSimulationMemory())
+{
+  m_aircrafts = aircrafts;
+  m_numAircraft = config.numAircraft;
+  m_seed = config.seed;
+  m_chargeTargetSoc = config.chargeTargetSoc;
+  m_meanGapTicks = LOOP_TICKS_PER_HOUR / config.tripRequestsPerHour;
+  m_meanTripMiles = config.meanTripMiles;
+  m_maxWaitTicks = config.maxWaitTicks;
+  m_stats = stats;
+  m_summary = demand_summary_t();
+
+  // everything the run touches is sized here, so handling a request never allocates
+  m_events.reserve(m_numAircraft + 1u);
+  uint32_t fleetPerCompany[MAX_AIRCRAFT_COMPANIES] = {0};
+  for (uint32_t i = 0; i < m_numAircraft; i++) {
+    fleetPerCompany[m_aircrafts[i].m_id]++;
+  }
+  m_idleAircraft.resize(GetNumCompanies()); // the inner heaps take the same memory as the outer array
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    m_idleAircraft[i].reserve(fleetPerCompany[i]);
+  }
+  m_companiesBySeats.reserve(GetNumCompanies());
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    m_companiesBySeats.push_back(i);
+  }
+  // ties in catalog order, std::stable_sort would take a buffer from the heap
+  std::sort(m_companiesBySeats.begin(), m_companiesBySeats.end(), [](uint32_t a, uint32_t b) {
+    if (GetPassengerCount((aircraft_id_t) a) != GetPassengerCount((aircraft_id_t) b)) {
+      return GetPassengerCount((aircraft_id_t) a) < GetPassengerCount((aircraft_id_t) b);
+    }
+    return a < b;
+  });
+  m_landingSoc.assign(m_numAircraft, 0.0f);
+
+  double expectedWaiting = config.tripRequestsPerHour * ((double) m_maxWaitTicks / LOOP_TICKS_PER_HOUR);
+  m_pool.resize((size_t) std::min(std::max(2.0 * expectedWaiting, (double) DEMAND_MIN_POOL), (double) (UINT32_MAX >> 4)));
+  m_poolHead = 0;
+  m_poolSize = 0;
+  m_numRequestsDrawn = 0;
+  m_nextArrival = 0.0;
+  m_nextRequest = trip_request_t();
+}
+
+void DemandSimulation::run(uint32_t simulationTicks) {
+  // every aircraft waits at the pad, fully charged, for its first request
+  for (uint32_t i = 0; i < m_numAircraft; i++) {
+    m_aircrafts[i].m_state = AIRCRAFT_STATE_IDLE;
+    m_aircrafts[i].m_stateStartTick = 0;
+    m_aircrafts[i].m_stateOfCharge = 1.0f;
+    pushIdleAircraft(i);
+  }
+  scheduleNextRequest();
+
+  while ((m_events.empty() == false) && (m_events.front().tick <= simulationTicks)) {
+    uint32_t tick = m_events.front().tick;
+    sim_event_t event;
+    while (PopSimEvent(&m_events, tick, &event)) {
+      handleEvent(event);
+    }
+    // same as the event engine, chargers freed on this tick are handed out after every transition is handled
+    DispatchWaitingAircraft(m_aircrafts, tick, m_chargeTargetSoc, &m_battChargers, &m_aircraftInLineToCharge, &m_events, m_stats);
+    MetricsTick(tick, m_aircrafts, m_numAircraft);
+  }
+
+  CloseOutPartialLegs(m_aircrafts, m_numAircraft, simulationTicks);
+  expireWaitingRequests(simulationTicks);
+  for (uint32_t i = 0; i < m_poolSize; i++) {
+    m_summary.waitingAtEnd += (m_pool[(m_poolHead + i) % m_pool.size()].passengers > 0);
+  }
+  RecordChargeSiteStatistics(m_stats, m_aircraftInLineToCharge, m_battChargers, simulationTicks);
+
+  // a fault draw doesn't depend on what the aircraft does, so every hour is drawn after the run
+  for (uint32_t hour = 1; hour <= (simulationTicks / LOOP_TICKS_PER_HOUR); hour++) {
+    GenerateHourlyFaults(m_aircrafts, m_numAircraft, hour, m_seed);
+  }
+}
+
+/** Requests have the highest index of any event, so aircraft that land or finish
+ * charging on the tick a request arrives are idle before it is matched. */
+void DemandSimulation::scheduleNextRequest(void) {
+  double gapTicks;
+  double miles;
+  uint32_t passengers;
+  DrawTripRequest(m_numRequestsDrawn++, m_meanGapTicks, m_meanTripMiles, DEMAND_MAX_PARTY, m_seed, &gapTicks, &miles, &passengers);
+  m_nextArrival += gapTicks;
+  if (m_nextArrival >= (double) UINT32_MAX) {
+    return; // past any horizon
+  }
+  m_nextRequest.arrivalTick = (uint32_t) std::ceil(m_nextArrival);
+  m_nextRequest.passengers = passengers;
+  m_nextRequest.miles = (float) miles;
+  scheduleEvent(m_nextRequest.arrivalTick, UINT32_MAX, SIM_EVENT_TRIP_REQUEST);
+}
+
+void DemandSimulation::handleEvent(const sim_event_t& event) {
+  if (event.type == SIM_EVENT_TRIP_REQUEST) {
+    handleTripRequest(event.tick);
+    return;
+  }
+
+  Aircraft* pCurCraft = &m_aircrafts[event.aircraftIndex];
+  switch (event.type) {
+    case SIM_EVENT_TRIP_LANDED:
+      EndFlight(m_aircrafts, event.aircraftIndex, event.tick, m_stats);
+      pCurCraft->m_stateOfCharge = m_landingSoc[event.aircraftIndex];
+      if (pCurCraft->m_stateOfCharge >= DEMAND_RECHARGE_SOC) {
+        becomeIdle(event.aircraftIndex, event.tick);
+        break;
+      }
+      JoinChargeLine(m_aircrafts, event.aircraftIndex, event.tick, &m_aircraftInLineToCharge);
+      break;
+    case SIM_EVENT_CHARGING_COMPLETE:
+      EndChargeSession(m_aircrafts, event.aircraftIndex, event.tick, &m_battChargers, m_stats);
+      pCurCraft->m_stateOfCharge = std::max(pCurCraft->m_stateOfCharge, m_chargeTargetSoc);
+      becomeIdle(event.aircraftIndex, event.tick);
+      break;
+    default:
+      std::cout << "ERROR - default case should never execute." << std::endl;
+      break;
+  }
+}
+
+void DemandSimulation::handleTripRequest(uint32_t tick) {
+  trip_request_t request = m_nextRequest;
+  scheduleNextRequest();
+  m_summary.requests++;
+  m_summary.requestedMiles += request.miles;
+
+  uint32_t aircraftIndex = popIdleAircraft(request);
+  if (aircraftIndex != UINT32_MAX) {
+    startTrip(aircraftIndex, request, tick);
+    return;
+  }
+  expireWaitingRequests(tick);
+  if (m_poolSize == m_pool.size()) {
+    m_summary.overflowed++;
+    return;
+  }
+  m_pool[(m_poolHead + m_poolSize) % m_pool.size()] = request;
+  m_poolSize++;
+}
+
+bool DemandSimulation::canFly(uint32_t aircraftIndex, const trip_request_t& request) const {
+  const Aircraft* plane = &m_aircrafts[aircraftIndex];
+  return (GetPassengerCount(plane->m_id) >= request.passengers) &&
+         ((plane->m_stateOfCharge - GetTripStateOfCharge(plane->m_id, request.miles)) >= DEMAND_RESERVE_SOC);
+}
+
+uint32_t DemandSimulation::popIdleAircraft(const trip_request_t& request) {
+  for (uint32_t company : m_companiesBySeats) {
+    std::pmr::vector<uint32_t>& heap = m_idleAircraft[company];
+    // the most charged aircraft is on top, if it can't fly the trip no other of the company can
+    if ((heap.empty() == false) && canFly(heap.front(), request)) {
+      uint32_t aircraftIndex = heap.front();
+      std::pop_heap(heap.begin(), heap.end(), IdleAircraftLess{m_aircrafts});
+      heap.pop_back();
+      return aircraftIndex;
+    }
+  }
+  return UINT32_MAX;
+}
+
+void DemandSimulation::pushIdleAircraft(uint32_t aircraftIndex) {
+  std::pmr::vector<uint32_t>& heap = m_idleAircraft[m_aircrafts[aircraftIndex].m_id];
+  heap.push_back(aircraftIndex);
+  std::push_heap(heap.begin(), heap.end(), IdleAircraftLess{m_aircrafts});
+}
+
+void DemandSimulation::becomeIdle(uint32_t aircraftIndex, uint32_t tick) {
+  Aircraft* pCurCraft = &m_aircrafts[aircraftIndex];
+  pCurCraft->m_state = AIRCRAFT_STATE_IDLE;
+  pCurCraft->m_stateStartTick = tick;
+
+  expireWaitingRequests(tick);
+  uint32_t numScanned = std::min(m_poolSize, DEMAND_MATCH_SCAN);
+  for (uint32_t i = 0; i < numScanned; i++) {
+    trip_request_t* request = &m_pool[(m_poolHead + i) % m_pool.size()];
+    if ((request->passengers > 0) && canFly(aircraftIndex, *request)) {
+      trip_request_t taken = *request;
+      request->passengers = 0;
+      expireWaitingRequests(tick);
+      startTrip(aircraftIndex, taken, tick);
+      return;
+    }
+  }
+  // nothing to fly now, so an aircraft short of the charge target tops up instead of sitting idle
+  if (pCurCraft->m_stateOfCharge < m_chargeTargetSoc) {
+    JoinChargeLine(m_aircrafts, aircraftIndex, tick, &m_aircraftInLineToCharge);
+    return;
+  }
+  pushIdleAircraft(aircraftIndex);
+}
+
+void DemandSimulation::startTrip(uint32_t aircraftIndex, const trip_request_t& request, uint32_t tick) {
+  Aircraft* pCurCraft = &m_aircrafts[aircraftIndex];
+  pCurCraft->m_state = AIRCRAFT_STATE_FLYING;
+  pCurCraft->m_numFlights++;
+  pCurCraft->m_stateStartTick = tick;
+  pCurCraft->m_legEndTick = tick + GetTripTicks(pCurCraft->m_id, request.miles);
+  m_landingSoc[aircraftIndex] = pCurCraft->m_stateOfCharge - GetTripStateOfCharge(pCurCraft->m_id, request.miles);
+  TraceTakeoff(aircraftIndex, tick, pCurCraft->m_numFlights);
+  scheduleEvent(pCurCraft->m_legEndTick, aircraftIndex, SIM_EVENT_TRIP_LANDED);
+
+  demand_company_statistics_t* company = &m_summary.companies[pCurCraft->m_id];
+  company->trips++;
+  company->passengers += request.passengers;
+  company->passengerMiles += (double) request.passengers * request.miles;
+  company->seatMiles += (double) GetPassengerCount(pCurCraft->m_id) * request.miles;
+  m_summary.served++;
+  m_summary.waits.add(tick - request.arrivalTick);
+}
+
+void DemandSimulation::expireWaitingRequests(uint32_t tick) {
+  while (m_poolSize > 0) {
+    const trip_request_t& request = m_pool[m_poolHead];
+    if (request.passengers > 0) {
+      if ((tick - request.arrivalTick) <= m_maxWaitTicks) {
+        break;
+      }
+      m_summary.expired++;
+    }
+    m_poolHead = (m_poolHead + 1) % (uint32_t) m_pool.size();
+    m_poolSize--;
+  }
+}
+
+void RunDemandSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats, demand_summary_t* summary) {
+  DemandSimulation sim(aircrafts, config, stats);
+  sim.run(config.simulationTicks);
+  if (summary != nullptr) {
+    *summary = sim.getSummary();
+  }
+}
+
+void GetDemandPassengerMiles(const demand_summary_t& summary, double passengerMiles[MAX_AIRCRAFT_COMPANIES]) {
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    passengerMiles[i] = summary.companies[i].passengerMiles;
+  }
+}
+
+void MergeDemandSummary(demand_summary_t* into, const demand_summary_t& from) {
+  into->requests += from.requests;
+  into->served += from.served;
+  into->expired += from.expired;
+  into->overflowed += from.overflowed;
+  into->waitingAtEnd += from.waitingAtEnd;
+  into->requestedMiles += from.requestedMiles;
+  into->waits.merge(from.waits);
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    into->companies[i].trips += from.companies[i].trips;
+    into->companies[i].passengers += from.companies[i].passengers;
+    into->companies[i].passengerMiles += from.companies[i].passengerMiles;
+    into->companies[i].seatMiles += from.companies[i].seatMiles;
+  }
+}
+
+void WriteDemandStatistics(std::ostream& out, const demand_summary_t& summary) {
+  double servedPercent = (summary.requests > 0) ? ((100.0 * summary.served) / summary.requests) : 0.0;
+  out << std::fixed << std::setprecision(2) <<
+    "Demand - trip requests: " << summary.requests << ", served: " << summary.served << " (" << servedPercent << " %)" <<
+    ", unserved: " << (summary.expired + summary.overflowed) << " (" << summary.expired << " waited too long, " <<
+    summary.overflowed << " found the pool full), still waiting: " << summary.waitingAtEnd << "\n" <<
+    "  " << std::left << std::setw(26) << "wait for aircraft" << std::right <<
+    "mean " << summary.waits.getMinutes().getMean() << " min, " <<
+    "p50 " << summary.waits.getPercentileMin(50.0) << " min, " <<
+    "p99 " << summary.waits.getPercentileMin(99.0) << " min, " <<
+    "n = " << summary.waits.getMinutes().getCount() << "\n";
+
+  demand_company_statistics_t total = demand_company_statistics_t();
+  for (uint32_t i = 0; i <= GetNumCompanies(); i++) {
+    const demand_company_statistics_t& company = (i < GetNumCompanies()) ? summary.companies[i] : total;
+    double loadFactor = (company.seatMiles > 0.0) ? ((100.0 * company.passengerMiles) / company.seatMiles) : 0.0;
+    out << "  " << std::left << std::setw(26) << ((i < GetNumCompanies()) ? GetCompanyName((aircraft_id_t) i) : "all companies") <<
+      std::right << "trips " << company.trips << ", passengers " << company.passengers <<
+      ", passenger miles " << company.passengerMiles << ", load factor " << loadFactor << " %\n";
+    if (i < GetNumCompanies()) {
+      total.trips += company.trips;
+      total.passengers += company.passengers;
+      total.passengerMiles += company.passengerMiles;
+      total.seatMiles += company.seatMiles;
+    }
+  }
+  out << "----------------------------------------------------------------------------------------\n";
+}
+
+/** Function to test the demand model. The request draws must average the configured
+ * gap between requests, trip length and a party of (1 + DEMAND_MAX_PARTY) / 2, within
+ * 2 % over 100000 draws. With a request every half hour, every request must be served
+ * without waiting. With far more requests than the fleet can fly, some must go
+ * unserved, and every request must be served, unserved or still waiting at the end.
+ * Both runs must fill between none and all of the seats, and give the same results
+ * from the same seed. */
+void DemandTest(void) {
+  const uint32_t numDraws = 100000;
+  const uint64_t seed = 5;
+  double gapSum = 0.0;
+  double milesSum = 0.0;
+  uint64_t passengerSum = 0;
+  for (uint32_t i = 0; i < numDraws; i++) {
+    double gapTicks;
+    double miles;
+    uint32_t passengers;
+    DrawTripRequest(i, 100.0, DEFAULT_TRIP_MILES, DEMAND_MAX_PARTY, seed, &gapTicks, &miles, &passengers);
+    gapSum += gapTicks;
+    milesSum += miles;
+    passengerSum += passengers;
+  }
+  const double meanParty = (1.0 + DEMAND_MAX_PARTY) / 2.0;
+  bool drawPass = (std::abs((gapSum / numDraws) - 100.0) < 2.0) &&
+                  (std::abs((milesSum / numDraws) - DEFAULT_TRIP_MILES) < (0.02 * DEFAULT_TRIP_MILES)) &&
+                  (std::abs(((double) passengerSum / numDraws) - meanParty) < (0.02 * meanParty));
+
+  bool runPass = true;
+  for (double requestsPerHour : {2.0, 2000.0}) {
+    simulation_config_t config = DefaultSimulationConfig();
+    config.simulationTicks = 24u * LOOP_TICKS_PER_HOUR;
+    config.seed = seed;
+    config.tripRequestsPerHour = requestsPerHour;
+
+    demand_summary_t summaries[2];
+    for (demand_summary_t& summary : summaries) {
+      Aircraft aircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+      for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+        aircrafts[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+      }
+      RunDemandSimulation(aircrafts, config, nullptr, &summary);
+    }
+    const demand_summary_t& summary = summaries[0];
+    double passengerMiles = 0.0;
+    double seatMiles = 0.0;
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+      passengerMiles += summary.companies[i].passengerMiles;
+      seatMiles += summary.companies[i].seatMiles;
+    }
+    bool conserved = (summary.requests == (summary.served + summary.expired + summary.overflowed + summary.waitingAtEnd));
+    bool repeatable = (summary.requests == summaries[1].requests) && (summary.served == summaries[1].served) &&
+                      (summary.waits.getMinutes().getMean() == summaries[1].waits.getMinutes().getMean());
+    bool loadFactorValid = (passengerMiles > 0.0) && (passengerMiles <= seatMiles);
+    bool servedAsExpected = (requestsPerHour < 10.0) ? ((summary.served == summary.requests) && (summary.waits.getMinutes().getMean() == 0.0))
+                                                     : ((summary.expired + summary.overflowed) > 0);
+    runPass = runPass && conserved && repeatable && loadFactorValid && servedAsExpected;
+  }
+
+  std::cout << "Demand test: " << ((drawPass && runPass) ? "PASS" : "FAIL") << std::endl;
+}
@@ -0,0 +1,126 @@
+/** Defines the demand model. By default every aircraft flies nonstop with all seats
+ * full, and the passenger miles are worked out from the air time. With --demand R the
+ * fleet flies the trips passengers ask for instead:
+ *
+ * Trip requests arrive at the vertiport as a Poisson process of R requests per hour,
+ * drawn from one fleet-wide random stream by request number, see DrawTripRequest() in
+ * RandomGen.h. A request is a party of 1 to DEMAND_MAX_PARTY passengers and a trip
+ * length, log-normal with a mean of --trip-miles. The model has a single site, so a
+ * trip is flown out and back as one flight of the requested length.
+ *
+ * Aircraft start idle with a full battery. A request is matched right away through the
+ * idle index, one binary heap of idle aircraft per company with the most charged on
+ * top, the companies walked from the fewest seats up: the first company with enough
+ * seats whose top aircraft can fly the trip and land with DEMAND_RESERVE_SOC left gets
+ * it. Small parties don't tie up big aircraft, and a match costs the company count
+ * plus a heap pop, whatever the fleet size.
+ *
+ * A request no idle aircraft can take waits in the request pool, a ring allocated once
+ * for the run with room for twice the requests expected to wait at a time, so nothing
+ * is allocated per request. The arrays of the run come from the simulation memory, see
+ * Arena.h. A request waiting longer than --max-wait-minutes, or
+ * arriving to a full pool, goes unserved. An aircraft that becomes idle takes the
+ * oldest of the first DEMAND_MATCH_SCAN waiting requests it can fly. After a trip an
+ * aircraft below DEMAND_RECHARGE_SOC gets in line for a charger, and is idle again once
+ * the charger releases it at --charge-target. One above it takes a waiting request
+ * if it can fly one, and otherwise gets in line too while it is short of the target.
+ *
+ * The engine is event-driven like EventSimulation.h, with the same charge line, chargers
+ * and statistics, and hourly faults drawn after the run like the network's. */
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+#include <vector>
+
+#include "Aircraft.h"
+#include "AircraftCompanyCommon.h"
+#include "ChargeQueue.h"
+#include "ChargeStation.h"
+#include "Config.h"
+#include "EventSimulation.h"
+#include "Statistics.h"
+
+#define DEMAND_MAX_PARTY      (4u) // passengers per request
+#define DEMAND_RESERVE_SOC    (0.2f) // state of charge a trip must leave at landing
+#define DEMAND_RECHARGE_SOC   (0.5f) // below this after a trip the aircraft charges
+#define DEMAND_MATCH_SCAN     (32u) // waiting requests an aircraft that becomes idle looks at
+#define DEMAND_MIN_POOL       (64u) // request pool slots at the lowest rates
+
+typedef struct {
+  uint32_t arrivalTick;
+  uint32_t passengers; // 0 once served, the slot stays in the ring until the requests before it are gone
+  float miles;
+} trip_request_t;
+
+typedef struct {
+  uint64_t trips;
+  uint64_t passengers;
+  double passengerMiles;
+  double seatMiles; // seats flown times miles, the load factor is passenger miles over it
+} demand_company_statistics_t;
+
+typedef struct {
+  uint64_t requests;
+  uint64_t served;
+  uint64_t expired; // waited longer than --max-wait-minutes
+  uint64_t overflowed; // arrived to a full request pool
+  uint64_t waitingAtEnd;
+  double requestedMiles; // of every request, served or not
+  DurationStatistic waits; // from request to takeoff, of served requests
+  demand_company_statistics_t companies[MAX_AIRCRAFT_COMPANIES];
+} demand_summary_t;
+
+class DemandSimulation
+{
+public:
+  DemandSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats = nullptr);
+  void run(uint32_t simulationTicks);
+  const demand_summary_t& getSummary(void) const {return m_summary;}
+  uint32_t getPoolCapacity(void) const {return (uint32_t) m_pool.size();}
+
+private:
+  void scheduleEvent(uint32_t tick, uint32_t aircraftIndex, sim_event_type_t type) {ScheduleSimEvent(&m_events, tick, aircraftIndex, type);}
+  void handleEvent(const sim_event_t& event);
+  void scheduleNextRequest(void);
+  void handleTripRequest(uint32_t tick);
+  bool canFly(uint32_t aircraftIndex, const trip_request_t& request) const; // enough seats and charge
+  uint32_t popIdleAircraft(const trip_request_t& request); // UINT32_MAX if no idle aircraft can fly it
+  void pushIdleAircraft(uint32_t aircraftIndex);
+  void becomeIdle(uint32_t aircraftIndex, uint32_t tick); // takes a waiting request, charges up to the target or joins the idle index
+  void startTrip(uint32_t aircraftIndex, const trip_request_t& request, uint32_t tick);
+  void expireWaitingRequests(uint32_t tick); // also drops served slots from the front of the pool
+
+  Aircraft* m_aircrafts;
+  uint32_t m_numAircraft;
+  uint64_t m_seed;
+  float m_chargeTargetSoc;
+  double m_meanGapTicks;
+  double m_meanTripMiles;
+  uint32_t m_maxWaitTicks;
+  SimulationStatistics* m_stats; // may be null
+  ChargeStation m_battChargers;
+  ChargeQueue m_aircraftInLineToCharge;
+  std::pmr::vector<sim_event_t> m_events; // binary heap ordered by SimEventLater, at most one per aircraft and the next request
+  std::pmr::vector<std::pmr::vector<uint32_t>> m_idleAircraft; // per company, binary heap of aircraft indexes, most charged on top
+  std::pmr::vector<uint32_t> m_companiesBySeats; // fewest seats first
+  std::pmr::vector<float> m_landingSoc; // per aircraft, state of charge the trip in progress lands with
+  std::pmr::vector<trip_request_t> m_pool; // ring of waiting requests
+  uint32_t m_poolHead;
+  uint32_t m_poolSize; // served slots between waiting requests included
+  uint64_t m_numRequestsDrawn;
+  double m_nextArrival; // in ticks, not rounded, so rounding doesn't bias the rate
+  trip_request_t m_nextRequest;
+  demand_summary_t m_summary;
+};
+
+/** Runs the demand engine. The trip and request statistics are copied to summary, when
+ * not null, and the flights, charge sessions and waits for a charger go to stats. */
+void RunDemandSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats = nullptr,
+                         demand_summary_t* summary = nullptr);
+void GetDemandPassengerMiles(const demand_summary_t& summary, double passengerMiles[MAX_AIRCRAFT_COMPANIES]); // per company, for ComputeDataAveragesAndTotals()
+void MergeDemandSummary(demand_summary_t* into, const demand_summary_t& from); // adds the requests, waits and trips of another run
+void WriteDemandStatistics(std::ostream& out, const demand_summary_t& summary);
+void DemandTest(void);
@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+#include "EventSimulation.h"
+
+#include "AircraftCompanyCommon.h"
+#include "Arena.h"
+#include "Maintenance.h"
+#include "Metrics.h"
+#include "RandomGen.h"
+#include "Trace.h"
+
+void ScheduleSimEvent(std::pmr::vector<sim_event_t>* events, uint32_t tick, uint32_t aircraftIndex, sim_event_type_t type) {
+  sim_event_t event = {tick, aircraftIndex, type};
+  events->push_back(event);
+  std::push_heap(events->begin(), events->end(), SimEventLater());
+}
+
+bool PopSimEvent(std::pmr::vector<sim_event_t>* events, uint32_t tick, sim_event_t* event) {
+  if ((events->empty()) || (events->front().tick != tick)) {
+    return false;
+  }
+  std::pop_heap(events->begin(), events->end(), SimEventLater());
+  *event = events->back();
+  events->pop_back();
+  return true;
+}
+
+void EndFlight(Aircraft* aircrafts, uint32_t aircraftIndex, uint32_t tick, SimulationStatistics* stats) {
+  Aircraft* pCurCraft = &aircrafts[aircraftIndex];
+  pCurCraft->m_airTimeTicks += tick - pCurCraft->m_stateStartTick;
+  if (stats != nullptr) {
+    stats->recordFlight(pCurCraft->m_id, tick - pCurCraft->m_stateStartTick);
+  }
+  TraceBatteryDead(aircraftIndex, tick, tick - pCurCraft->m_stateStartTick);
+}
+
+void JoinChargeLine(Aircraft* aircrafts, uint32_t aircraftIndex, uint32_t tick, ChargeQueue* line) {
+  Aircraft* pCurCraft = &aircrafts[aircraftIndex];
+  pCurCraft->m_state = AIRCRAFT_STATE_WAITING_TO_CHARGE;
+  pCurCraft->m_stateStartTick = tick;
+  if (line->push(aircraftIndex, pCurCraft->m_id, tick) == false) {
+    std::cout << "ERROR - charge line is full, it should have room for the whole fleet." << std::endl;
+  }
+  TraceAddedToChargingLine(aircraftIndex, tick, line->size());
+}
+
+void EndChargeSession(Aircraft* aircrafts, uint32_t aircraftIndex, uint32_t tick, ChargeStation* chargers, SimulationStatistics* stats) {
+  Aircraft* pCurCraft = &aircrafts[aircraftIndex];
+  pCurCraft->m_chargeTimeTicks += tick - pCurCraft->m_stateStartTick;
+  if (stats != nullptr) {
+    stats->recordChargeSession(pCurCraft->m_id, tick - pCurCraft->m_stateStartTick);
+  }
+  if (chargers->removeAircraft(tick) == false) {
+    std::cout << "ERROR - removing aircraft from charger failed because no chargers are in use." << std::endl;
+  }
+  TraceFinishCharging(aircraftIndex, tick, chargers->getNumChargersInUse());
+}
+
+void DispatchWaitingAircraft(Aircraft* aircrafts, uint32_t tick, float chargeTargetSoc, ChargeStation* chargers, ChargeQueue* line,
+                             std::pmr::vector<sim_event_t>* events, SimulationStatistics* stats, TimelineRecorder* timeline) {
+  while (chargers->isChargerAvailable() && (line->empty() == false)) {
+    charge_queue_entry_t entry = line->front();
+    uint32_t aircraftIndex = entry.aircraftIndex;
+    if (chargers->addAircraft(tick)) {
+      Aircraft* pCurCraft = &aircrafts[aircraftIndex];
+      TraceStartCharging(aircraftIndex, tick, chargers->getNumChargersInUse());
+      if (timeline != nullptr) {
+        timeline->record(aircraftIndex, tick, AIRCRAFT_STATE_CHARGING);
+      }
+      line->pop(tick, &entry);
+      if (stats != nullptr) {
+        stats->recordWait(pCurCraft->m_id, tick - entry.enqueueTick);
+      }
+      pCurCraft->m_state = AIRCRAFT_STATE_CHARGING;
+      pCurCraft->m_numChargeSessions++;
+      pCurCraft->m_stateStartTick = tick;
+      pCurCraft->m_legEndTick = tick + GetChargeTicks(pCurCraft->m_id, pCurCraft->m_stateOfCharge, chargeTargetSoc);
+      ScheduleSimEvent(events, pCurCraft->m_legEndTick, aircraftIndex, SIM_EVENT_CHARGING_COMPLETE);
+    } else {
+      std::cout << "ERROR - adding aircraft to charger failed even though a charger should be available." << std::endl;
+    }
+  }
+}
+
+/** The tick loop counts flight and charge ticks up to and including the final tick,
+ * so any leg still in progress contributes the ticks elapsed since it started. */
+void CloseOutPartialLegs(Aircraft* aircrafts, uint32_t numAircraft, uint32_t simulationTicks) {
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    Aircraft* pCurCraft = &aircrafts[i];
+    if (pCurCraft->m_state == AIRCRAFT_STATE_FLYING) {
+      pCurCraft->m_airTimeTicks += simulationTicks - pCurCraft->m_stateStartTick;
+    } else if (pCurCraft->m_state == AIRCRAFT_STATE_CHARGING) {
+      pCurCraft->m_chargeTimeTicks += simulationTicks - pCurCraft->m_stateStartTick;
+    } else if (pCurCraft->m_state == AIRCRAFT_STATE_MAINTENANCE) {
+      pCurCraft->m_maintenanceTimeTicks += simulationTicks - pCurCraft->m_stateStartTick;
+    }
+    pCurCraft->m_stateStartTick = simulationTicks;
+  }
+}
+
+EventSimulation::EventSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats) :
+  m_battChargers(config.numChargers), m_aircraftInLineToCharge(config.numAircraft, config.policy),
+  m_repairBays(config.numRepairBays), m_aircraftInLineForRepair((config.numRepairBays > 0) ? config.numAircraft : 0u),
+  m_events(GetSimulationMemory())
+{
+  m_events.reserve(config.numAircraft + 1); // one per aircraft and the hourly fault check, so scheduling never allocates
+  m_aircrafts = aircrafts;
+  m_numAircraft = config.numAircraft;
+  m_seed = config.seed;
+  m_chargeTargetSoc = config.chargeTargetSoc;
+  m_repairTicks = config.repairTicks;
+  m_stats = stats;
+  m_timeline = nullptr;
+  m_currentTick = 0;
+}
+
+void EventSimulation::scheduleFlightEnd(uint32_t aircraftIndex) {
+  Aircraft* pCurCraft = &m_aircrafts[aircraftIndex];
+  pCurCraft->m_legEndTick = pCurCraft->m_stateStartTick + GetFlightLegTicks(pCurCraft, aircraftIndex, (m_repairBays.getNumChargers() > 0), m_seed);
+  bool fault = (m_repairBays.getNumChargers() > 0) && IsFaultLanding(pCurCraft, pCurCraft->m_legEndTick);
+  scheduleEvent(pCurCraft->m_legEndTick, aircraftIndex, fault ? SIM_EVENT_FLIGHT_FAULT : SIM_EVENT_BATTERY_DEAD);
+}
+
+void EventSimulation::run(uint32_t simulationTicks) {
+  start(true);
+  while (step(simulationTicks)) {
+  }
+  finish(simulationTicks);
+}
+
+void EventSimulation::start(bool drawFaults) {
+  /** Tick 0 of the tick loop moves every idle aircraft into the flying state. Flight
+   * ticks are counted starting on the next tick, so the battery dies exactly one
+   * flight duration after the tick the aircraft took off. */
+  for (uint32_t i = 0; i < m_numAircraft; i++) {
+    Aircraft* pCurCraft = &m_aircrafts[i];
+    pCurCraft->m_state = AIRCRAFT_STATE_FLYING;
+    pCurCraft->m_numFlights++;
+    pCurCraft->m_stateStartTick = 0;
+    TraceTakeoff(i, 0, pCurCraft->m_numFlights);
+    if (m_timeline != nullptr) {
+      m_timeline->record(i, 0, AIRCRAFT_STATE_FLYING);
+    }
+    scheduleFlightEnd(i);
+  }
+
+  // each fault check schedules the next one, so long horizons don't fill the queue up front
+  if (drawFaults && (m_repairBays.getNumChargers() == 0)) {
+    scheduleEvent(LOOP_TICKS_PER_HOUR, 0, SIM_EVENT_HOURLY_FAULT_CHECK);
+  }
+  m_currentTick = 0;
+}
+
+bool EventSimulation::step(uint32_t simulationTicks) {
+  if (handleNextTick(simulationTicks) == false) {
+    return false;
+  }
+  // same as the tick loop, chargers freed on this tick are handed out after every transition is handled
+  dispatch();
+  MetricsTick(m_currentTick, m_aircrafts, m_numAircraft);
+  return true;
+}
+
+bool EventSimulation::handleNextTick(uint32_t simulationTicks) {
+  if ((m_events.empty()) || (m_events.front().tick > simulationTicks)) {
+    return false;
+  }
+
+  uint32_t tick = m_events.front().tick;
+  sim_event_t event;
+  while (PopSimEvent(&m_events, tick, &event)) {
+    handleEvent(event);
+  }
+  m_currentTick = tick;
+  return true;
+}
+
+void EventSimulation::finish(uint32_t simulationTicks) {
+  CloseOutPartialLegs(m_aircrafts, m_numAircraft, simulationTicks);
+  RecordChargeSiteStatistics(m_stats, m_aircraftInLineToCharge, m_battChargers, simulationTicks);
+  if (m_repairBays.getNumChargers() > 0) {
+    RecordRepairSiteStatistics(m_stats, m_aircraftInLineForRepair, m_repairBays, simulationTicks);
+  }
+}
+
+/** Every aircraft always has exactly one pending event, so the state of every aircraft,
+ * the ticks it spent in its flight or charge session and the ticks left of it, and the
+ * line in the order it will get chargers describe the whole simulation. The ticks left
+ * matter because a leg's length depends on the state of charge. How long an aircraft
+ * has waited in line only changes who charges next under the aging policy, so it is
+ * left out otherwise: two states that only differ in it run the same from then on. */
+void EventSimulation::appendStateSignature(std::vector<uint32_t>* signature) const {
+  bool waitMatters = (m_aircraftInLineToCharge.getPolicy() == CHARGE_POLICY_AGING);
+  for (uint32_t i = 0; i < m_numAircraft; i++) {
+    bool waiting = (m_aircrafts[i].m_state == AIRCRAFT_STATE_WAITING_TO_CHARGE);
+    signature->push_back(m_aircrafts[i].m_state);
+    signature->push_back((waiting && (waitMatters == false)) ? 0u : (m_currentTick - m_aircrafts[i].m_stateStartTick));
+    signature->push_back(IsLegInProgress(&m_aircrafts[i]) ? (m_aircrafts[i].m_legEndTick - m_currentTick) : 0u);
+  }
+  m_aircraftInLineToCharge.appendLineOrder(signature);
+}
+
+void EventSimulation::skipAhead(uint32_t ticks) {
+  // every event moves by the same amount, so the heap order holds
+  for (sim_event_t& event : m_events) {
+    event.tick += ticks;
+  }
+  for (uint32_t i = 0; i < m_numAircraft; i++) {
+    m_aircrafts[i].m_stateStartTick += ticks;
+    m_aircrafts[i].m_legEndTick += ticks;
+  }
+  m_aircraftInLineToCharge.shiftTicks(ticks);
+  m_currentTick += ticks;
+}
+
+void EventSimulation::handleEvent(const sim_event_t& event) {
+  Aircraft* pCurCraft = &m_aircrafts[event.aircraftIndex];
+
+  switch (event.type) {
+    case SIM_EVENT_HOURLY_FAULT_CHECK:
+      // every aircraft draws from its own stream at position "hour", same as the tick loop
+      GenerateHourlyFaults(m_aircrafts, m_numAircraft, event.tick / LOOP_TICKS_PER_HOUR, m_seed);
+      scheduleEvent(event.tick + LOOP_TICKS_PER_HOUR, 0, SIM_EVENT_HOURLY_FAULT_CHECK);
+      break;
+    case SIM_EVENT_BATTERY_DEAD:
+      EndFlight(m_aircrafts, event.aircraftIndex, event.tick, m_stats);
+      pCurCraft->m_stateOfCharge = 0.0f;
+      JoinChargeLine(m_aircrafts, event.aircraftIndex, event.tick, &m_aircraftInLineToCharge);
+      if (m_timeline != nullptr) {
+        m_timeline->record(event.aircraftIndex, event.tick, AIRCRAFT_STATE_WAITING_TO_CHARGE);
+      }
+      break;
+    case SIM_EVENT_CHARGING_COMPLETE:
+      EndChargeSession(m_aircrafts, event.aircraftIndex, event.tick, &m_battChargers, m_stats);
+      pCurCraft->m_state = AIRCRAFT_STATE_FLYING;
+      pCurCraft->m_numFlights++;
+      pCurCraft->m_stateStartTick = event.tick;
+      pCurCraft->m_stateOfCharge = m_chargeTargetSoc;
+      TraceTakeoff(event.aircraftIndex, event.tick, pCurCraft->m_numFlights);
+      if (m_timeline != nullptr) {
+        m_timeline->record(event.aircraftIndex, event.tick, AIRCRAFT_STATE_FLYING);
+      }
+      scheduleFlightEnd(event.aircraftIndex);
+      break;
+    case SIM_EVENT_FLIGHT_FAULT:
+      pCurCraft->m_airTimeTicks += event.tick - pCurCraft->m_stateStartTick;
+      if (m_stats != nullptr) {
+        m_stats->recordFlight(pCurCraft->m_id, event.tick - pCurCraft->m_stateStartTick);
+      }
+      LandForRepair(pCurCraft, event.tick);
+      TraceFault(event.aircraftIndex, event.tick, pCurCraft->m_numFaults);
+      if (m_aircraftInLineForRepair.push(event.aircraftIndex, pCurCraft->m_id, event.tick) == false) {
+        std::cout << "ERROR - repair line is full, it should have room for the whole fleet." << std::endl;
+      }
+      break;
+    case SIM_EVENT_REPAIR_COMPLETE:
+      pCurCraft->m_maintenanceTimeTicks += event.tick - pCurCraft->m_stateStartTick;
+      if (m_stats != nullptr) {
+        m_stats->recordRepair(pCurCraft->m_id, event.tick - pCurCraft->m_stateStartTick);
+      }
+      if (m_repairBays.removeAircraft(event.tick) == false) {
+        std::cout << "ERROR - removing aircraft from repair bay failed because no bays are in use." << std::endl;
+      }
+      JoinChargeLine(m_aircrafts, event.aircraftIndex, event.tick, &m_aircraftInLineToCharge);
+      break;
+    default:
+      std::cout << "ERROR - default case should never execute." << std::endl;
+      break;
+  }
+}
+
+void EventSimulation::dispatchGroundedAircraft(uint32_t tick) {
+  charge_queue_entry_t entry;
+  while (m_repairBays.isChargerAvailable() && m_aircraftInLineForRepair.pop(tick, &entry)) {
+    Aircraft* pCurCraft = &m_aircrafts[entry.aircraftIndex];
+    m_repairBays.addAircraft(tick);
+    pCurCraft->m_legEndTick = tick + GetRepairTicks(pCurCraft, entry.aircraftIndex, m_repairTicks, m_seed);
+    scheduleEvent(pCurCraft->m_legEndTick, entry.aircraftIndex, SIM_EVENT_REPAIR_COMPLETE);
+  }
+}
+
+// Every record is written as raw bytes, so none of them may own memory or need a constructor to be valid
+static_assert(std::is_trivially_copyable<Aircraft>::value, "Aircraft must be trivially copyable for checkpoints");
+static_assert(std::is_trivially_copyable<ChargeStation>::value, "ChargeStation must be trivially copyable for checkpoints");
+static_assert(std::is_trivially_copyable<sim_event_t>::value, "sim_event_t must be trivially copyable for checkpoints");
+static_assert(std::is_trivially_copyable<charge_queue_node_t>::value, "charge_queue_node_t must be trivially copyable for checkpoints");
+static_assert(std::is_trivially_copyable<company_statistics_t>::value, "company_statistics_t must be trivially copyable for checkpoints");
+static_assert(std::is_trivially_copyable<charge_site_statistics_t>::value, "charge_site_statistics_t must be trivially copyable for checkpoints");
+
+bool EventSimulation::writeCheckpoint(const char* path, uint32_t simulationTicks) const {
+  CheckpointWriter writer;
+  if (writer.open(path) == false) {
+    return false;
+  }
+
+  checkpoint_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+  header.version = CHECKPOINT_VERSION;
+  header.byteOrderMark = CHECKPOINT_BYTE_ORDER_MARK;
+  header.headerBytes = sizeof(checkpoint_header_t);
+  header.aircraftBytes = sizeof(Aircraft);
+  header.eventBytes = sizeof(sim_event_t);
+  header.queueNodeBytes = sizeof(charge_queue_node_t);
+  header.numAircraft = m_numAircraft;
+  header.numChargers = m_battChargers.getNumChargers();
+  header.policy = m_aircraftInLineToCharge.getPolicy();
+  header.numCompanies = GetNumCompanies();
+  header.catalogHash = CompanyCatalogHash();
+  header.seed = m_seed;
+  header.chargeTargetSoc = m_chargeTargetSoc;
+  header.simulationTicks = simulationTicks;
+  header.currentTick = m_currentTick;
+  header.queueNextSequence = m_aircraftInLineToCharge.getNextSequence();
+  header.hasStatistics = (m_stats != nullptr) ? 1u : 0u;
+
+  std::vector<charge_queue_node_t> queueNodes;
+  m_aircraftInLineToCharge.exportNodes(&queueNodes);
+  header.aircraft = writer.addSection(m_aircrafts, sizeof(Aircraft), m_numAircraft);
+  header.chargeStation = writer.addSection(&m_battChargers, sizeof(ChargeStation), 1u);
+  header.queueLength = writer.addSection(&m_aircraftInLineToCharge.getLengthOverTime(), sizeof(TimeWeightedStatistic), 1u);
+  header.queueNodes = writer.addSection(queueNodes.data(), sizeof(charge_queue_node_t), queueNodes.size());
+  header.events = writer.addSection(m_events.data(), sizeof(sim_event_t), m_events.size());
+  if (m_stats != nullptr) {
+    std::vector<company_statistics_t> companies;
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+      companies.push_back(m_stats->getCompany((aircraft_id_t) i));
+    }
+    header.companyStatistics = writer.addSection(companies.data(), sizeof(company_statistics_t), companies.size());
+    header.chargeSiteStatistics = writer.addSection(&m_stats->getChargeSite(), sizeof(charge_site_statistics_t), 1u);
+  }
+  return writer.commit(header);
+}
+
+/** The aircraft were passed to the constructor straight from the mapped file, so only
+ * the charge station, the line, the pending events and the statistics are copied. */
+bool EventSimulation::restoreCheckpoint(const CheckpointFile& file) {
+  const checkpoint_header_t& header = file.getHeader();
+  if ((header.numAircraft != m_numAircraft) || (header.policy != m_aircraftInLineToCharge.getPolicy())) {
+    std::cout << "ERROR - the simulation doesn't match the fleet and policy of the checkpoint." << std::endl;
+    return false;
+  }
+
+  if (m_aircraftInLineToCharge.importNodes(file.getSection<charge_queue_node_t>(header.queueNodes), (uint32_t) header.queueNodes.count,
+                                           header.queueNextSequence, *file.getSection<TimeWeightedStatistic>(header.queueLength)) == false) {
+    std::cout << "ERROR - the charge line of the checkpoint doesn't fit the simulation." << std::endl;
+    return false;
+  }
+  m_currentTick = header.currentTick;
+  m_battChargers = *file.getSection<ChargeStation>(header.chargeStation);
+  const sim_event_t* events = file.getSection<sim_event_t>(header.events);
+  m_events.assign(events, events + header.events.count); // saved in heap order
+  if ((m_stats != nullptr) && (header.hasStatistics != 0) && (header.companyStatistics.count == GetNumCompanies())) {
+    const company_statistics_t* companies = file.getSection<company_statistics_t>(header.companyStatistics);
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+      m_stats->setCompany((aircraft_id_t) i, companies[i]);
+    }
+    m_stats->setChargeSite(*file.getSection<charge_site_statistics_t>(header.chargeSiteStatistics));
+  }
+  return true;
+}
@@ -0,0 +1,121 @@
+/** Defines the discrete-event engine. Instead of stepping every aircraft through
+ * its state switch on every loop tick, the next state transition of each aircraft
+ * is placed in a priority queue and the simulation jumps directly from one
+ * transition to the next. Runtime scales with the number of transitions rather
+ * than the simulated time.
+ *
+ * The engine reproduces the tick loop in Simulation.cpp exactly: events that fall
+ * on the same tick are handled in aircraft index order, and aircraft waiting in
+ * line are only placed on chargers after every event of that tick is handled. */
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "Aircraft.h"
+#include "ChargeQueue.h"
+#include "ChargeStation.h"
+#include "Checkpoint.h"
+#include "Config.h"
+#include "Statistics.h"
+#include "Timeline.h"
+
+typedef enum {
+  SIM_EVENT_HOURLY_FAULT_CHECK = 0u, // fleet wide, draws a possible fault for every aircraft
+  SIM_EVENT_BATTERY_DEAD,
+  SIM_EVENT_CHARGING_COMPLETE, // also frees the charger for the next aircraft in line
+  SIM_EVENT_FLIGHT_FAULT, // a fault cuts the flight short, only with repair bays, see Maintenance.h
+  SIM_EVENT_REPAIR_COMPLETE, // also frees the repair bay
+  SIM_EVENT_TRIP_REQUEST, // fleet wide, the next passenger request arrives, see Demand.h
+  SIM_EVENT_TRIP_LANDED,
+} sim_event_type_t;
+
+typedef struct {
+  uint32_t tick;
+  uint32_t aircraftIndex;
+  sim_event_type_t type;
+} sim_event_t;
+
+// Orders the event heap so the earliest tick, then the lowest aircraft index, is on top
+struct SimEventLater {
+  bool operator()(const sim_event_t& a, const sim_event_t& b) const {
+    if (a.tick != b.tick) {
+      return a.tick > b.tick;
+    }
+    if (a.aircraftIndex != b.aircraftIndex) {
+      return a.aircraftIndex > b.aircraftIndex;
+    }
+    return a.type > b.type;
+  }
+};
+
+/** What the event-driven engines do the same way at a charge site. EventSimulation, the
+ * vertiports of Network.h and DemandSimulation in Demand.h each pass in their own
+ * chargers, line and event heap; what an aircraft does once a charge session ends is up
+ * to the engine. The statistics and the timeline may be null. */
+void ScheduleSimEvent(std::pmr::vector<sim_event_t>* events, uint32_t tick, uint32_t aircraftIndex, sim_event_type_t type);
+bool PopSimEvent(std::pmr::vector<sim_event_t>* events, uint32_t tick, sim_event_t* event); // the next event, if it falls on tick
+void EndFlight(Aircraft* aircrafts, uint32_t aircraftIndex, uint32_t tick, SimulationStatistics* stats); // counts the flight that landed on tick
+void JoinChargeLine(Aircraft* aircrafts, uint32_t aircraftIndex, uint32_t tick, ChargeQueue* line);
+void EndChargeSession(Aircraft* aircrafts, uint32_t aircraftIndex, uint32_t tick, ChargeStation* chargers, SimulationStatistics* stats); // counts it and frees the charger
+void DispatchWaitingAircraft(Aircraft* aircrafts, uint32_t tick, float chargeTargetSoc, ChargeStation* chargers, ChargeQueue* line,
+                             std::pmr::vector<sim_event_t>* events, SimulationStatistics* stats, TimelineRecorder* timeline = nullptr);
+void CloseOutPartialLegs(Aircraft* aircrafts, uint32_t numAircraft, uint32_t simulationTicks); // counts the legs still in progress at the end of the run
+
+class EventSimulation
+{
+public:
+  EventSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats = nullptr);
+  void run(uint32_t simulationTicks); // same as start(), step() until it returns false, then finish()
+
+  /** The run split into steps, for callers that look at the state between ticks, like
+   * the analytic fast path in AnalyticSimulation.h. */
+  void start(bool drawFaults); // takes off every aircraft at tick 0, hourly fault checks are only scheduled if drawFaults
+  bool step(uint32_t simulationTicks); // handles every event of the next tick that has any, false when none is left up to simulationTicks
+  void finish(uint32_t simulationTicks); // counts the legs still in progress at the end of the run
+  uint32_t getCurrentTick(void) const {return m_currentTick;}
+  void appendStateSignature(std::vector<uint32_t>* signature) const; // state of every aircraft relative to the current tick, then the line
+  void skipAhead(uint32_t ticks); // moves every pending event, state start and line entry later, without touching counters
+
+  /** step() is handleNextTick() followed by dispatch(). The sweep in Sweep.h forks a
+   * copy of the simulation between the two, when more aircraft want a charger than a
+   * smaller charger count could serve. A copy keeps pointing at the aircraft and
+   * statistics of the original until rebind() is called. */
+  bool handleNextTick(uint32_t simulationTicks); // handles every event of the next tick that has any, without handing out chargers
+  void dispatch(void) {dispatchWaitingAircraft(m_currentTick); dispatchGroundedAircraft(m_currentTick);}
+  uint32_t getChargerDemand(void) const {return m_battChargers.getNumChargersInUse() + m_aircraftInLineToCharge.size();}
+  void setNumChargers(uint32_t numChargers) {m_battChargers.setNumChargers(numChargers);} // at least the chargers in use
+  void rebind(Aircraft* aircrafts, SimulationStatistics* stats) {m_aircrafts = aircrafts; m_stats = stats;}
+  void setTimeline(TimelineRecorder* timeline) {m_timeline = timeline;} // records every transition from now on, null to stop
+
+  /** Saves everything the run needs to go on to a checkpoint file, see Checkpoint.h,
+   * between steps. Restoring needs a simulation constructed on the aircraft and config
+   * of the same checkpoint file, and brings back the statistics if it has them. */
+  bool writeCheckpoint(const char* path, uint32_t simulationTicks) const;
+  bool restoreCheckpoint(const CheckpointFile& file);
+
+private:
+  void scheduleEvent(uint32_t tick, uint32_t aircraftIndex, sim_event_type_t type) {ScheduleSimEvent(&m_events, tick, aircraftIndex, type);}
+  void scheduleFlightEnd(uint32_t aircraftIndex); // battery dead or, with repair bays, a fault
+  void handleEvent(const sim_event_t& event);
+  void dispatchWaitingAircraft(uint32_t tick) {
+    DispatchWaitingAircraft(m_aircrafts, tick, m_chargeTargetSoc, &m_battChargers, &m_aircraftInLineToCharge, &m_events, m_stats, m_timeline);
+  }
+  void dispatchGroundedAircraft(uint32_t tick); // into free repair bays
+
+  Aircraft* m_aircrafts;
+  uint32_t m_numAircraft;
+  uint64_t m_seed;
+  float m_chargeTargetSoc; // state of charge every charge session ends at
+  uint32_t m_currentTick; // last tick handled by step()
+  SimulationStatistics* m_stats; // may be null
+  TimelineRecorder* m_timeline; // may be null
+  ChargeStation m_battChargers;
+  ChargeQueue m_aircraftInLineToCharge;
+  uint32_t m_repairTicks; // mean time in a repair bay
+  ChargeStation m_repairBays; // none unless faults ground aircraft
+  ChargeQueue m_aircraftInLineForRepair;
+  std::pmr::vector<sim_event_t> m_events; // binary heap ordered by SimEventLater, a plain array so checkpoints can save it as is
+};
@@ -0,0 +1,94 @@
+#include "Fleet.h"
+
+#include "Arena.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FLEET_KERNEL_SSE2
+#endif
+
+FleetSoA::FleetSoA(const Aircraft* aircrafts, uint32_t numAircraft) :
+  m_ids(numAircraft, GetSimulationMemory()), m_states(numAircraft, GetSimulationMemory()),
+  m_airTicks(numAircraft, GetSimulationMemory()), m_chargeTicks(numAircraft, GetSimulationMemory()),
+  m_legEndTicks(numAircraft, GetSimulationMemory()), m_stateOfCharge(numAircraft, GetSimulationMemory()),
+  m_numFlights(numAircraft, GetSimulationMemory()), m_numChargeSessions(numAircraft, GetSimulationMemory()),
+  m_numFaults(numAircraft, GetSimulationMemory())
+{
+  m_numAircraft = numAircraft;
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    m_ids[i] = aircrafts[i].m_id;
+    m_states[i] = aircrafts[i].m_state;
+    m_airTicks[i] = aircrafts[i].m_airTimeTicks;
+    m_chargeTicks[i] = aircrafts[i].m_chargeTimeTicks;
+    m_legEndTicks[i] = aircrafts[i].m_legEndTick;
+    m_stateOfCharge[i] = aircrafts[i].m_stateOfCharge;
+    m_numFlights[i] = aircrafts[i].m_numFlights;
+    m_numChargeSessions[i] = aircrafts[i].m_numChargeSessions;
+    m_numFaults[i] = aircrafts[i].m_numFaults;
+  }
+}
+
+void FleetSoA::storeTo(Aircraft* aircrafts) const {
+  for (uint32_t i = 0; i < m_numAircraft; i++) {
+    aircrafts[i].m_id = (aircraft_id_t) m_ids[i];
+    aircrafts[i].m_state = (aircraft_state_t) m_states[i];
+    aircrafts[i].m_airTimeTicks = m_airTicks[i];
+    aircrafts[i].m_chargeTimeTicks = m_chargeTicks[i];
+    aircrafts[i].m_legEndTick = m_legEndTicks[i];
+    aircrafts[i].m_stateOfCharge = m_stateOfCharge[i];
+    aircrafts[i].m_numFlights = m_numFlights[i];
+    aircrafts[i].m_numChargeSessions = m_numChargeSessions[i];
+    aircrafts[i].m_numFaults = m_numFaults[i];
+  }
+}
+
+uint32_t FleetTickKernel(FleetSoA& fleet, uint32_t tick, uint32_t* crossedIndices) {
+  uint32_t* states = fleet.m_states.data();
+  uint32_t* airTicks = fleet.m_airTicks.data();
+  uint32_t* chargeTicks = fleet.m_chargeTicks.data();
+  const uint32_t* legEndTicks = fleet.m_legEndTicks.data();
+  uint32_t numCrossed = 0;
+  uint32_t i = 0;
+
+#ifdef FLEET_KERNEL_SSE2
+  /** Four aircraft per iteration. A compare yields all ones (-1) in a matching lane,
+   * so subtracting the mask increments only the lanes in that state. */
+  const __m128i flyingState = _mm_set1_epi32(AIRCRAFT_STATE_FLYING);
+  const __m128i chargingState = _mm_set1_epi32(AIRCRAFT_STATE_CHARGING);
+  const __m128i currentTick = _mm_set1_epi32((int) tick);
+  for (; (i + 4) <= fleet.m_numAircraft; i += 4) {
+    __m128i state = _mm_loadu_si128((const __m128i*) &states[i]);
+    __m128i flying = _mm_cmpeq_epi32(state, flyingState);
+    __m128i charging = _mm_cmpeq_epi32(state, chargingState);
+    __m128i active = _mm_or_si128(flying, charging);
+
+    __m128i air = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) &airTicks[i]), flying);
+    __m128i charge = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) &chargeTicks[i]), charging);
+    _mm_storeu_si128((__m128i*) &airTicks[i], air);
+    _mm_storeu_si128((__m128i*) &chargeTicks[i], charge);
+
+    __m128i legEnd = _mm_loadu_si128((const __m128i*) &legEndTicks[i]);
+    __m128i crossed = _mm_and_si128(active, _mm_cmpeq_epi32(legEnd, currentTick));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(crossed));
+    while (mask != 0) {
+      int lane = __builtin_ctz(mask);
+      crossedIndices[numCrossed++] = i + lane;
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  // scalar version of the same masked update, used for the remainder and on targets without SSE2
+  for (; i < fleet.m_numAircraft; i++) {
+    uint32_t flying = (states[i] == AIRCRAFT_STATE_FLYING);
+    uint32_t charging = (states[i] == AIRCRAFT_STATE_CHARGING);
+    uint32_t active = flying | charging;
+    airTicks[i] += flying;
+    chargeTicks[i] += charging;
+    if (active & (legEndTicks[i] == tick)) {
+      crossedIndices[numCrossed++] = i;
+    }
+  }
+
+  return numCrossed;
+}
@@ -0,0 +1,47 @@
+/** Defines the structure-of-arrays fleet container used by the SoA tick engine.
+ * Each per-aircraft field lives in its own contiguous array, so the per-tick update
+ * streams through only the data it touches and can process several aircraft per
+ * instruction. The Aircraft class is still the interchange format: a fleet is
+ * loaded from, and stored back to, an array of Aircraft. The arrays come from the
+ * simulation memory, see Arena.h. */
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "Aircraft.h"
+
+class FleetSoA
+{
+public:
+  FleetSoA(const Aircraft* aircrafts, uint32_t numAircraft);
+  void storeTo(Aircraft* aircrafts) const;
+  uint32_t size(void) const {return m_numAircraft;}
+
+  // Puts an aircraft into a new flight or charge session that ends on the given tick
+  void startLeg(uint32_t index, aircraft_state_t state, uint32_t legEndTick) {
+    m_states[index] = state;
+    m_legEndTicks[index] = legEndTick;
+  }
+
+  // All of these arrays are public so the simulation can access/modify them easily, same as Aircraft
+  uint32_t m_numAircraft;
+  std::pmr::vector<uint32_t> m_ids; // aircraft_id_t, stored 32 bits wide to share lanes with the tick counters
+  std::pmr::vector<uint32_t> m_states; // aircraft_state_t
+  std::pmr::vector<uint32_t> m_airTicks;
+  std::pmr::vector<uint32_t> m_chargeTicks;
+  std::pmr::vector<uint32_t> m_legEndTicks; // tick the current flight or charge session ends, same as Aircraft::m_legEndTick
+  std::pmr::vector<float> m_stateOfCharge; // when the current state was entered, same as Aircraft::m_stateOfCharge
+  std::pmr::vector<uint32_t> m_numFlights;
+  std::pmr::vector<uint32_t> m_numChargeSessions;
+  std::pmr::vector<uint32_t> m_numFaults;
+};
+
+/** Advances every aircraft to the given tick. Flying aircraft add an air tick and
+ * charging aircraft add a charge tick, using masks instead of a branch on the state.
+ * Indices of aircraft whose leg ends on this tick are written to crossedIndices in
+ * ascending order, and the count is returned. The caller handles those transitions in
+ * scalar code. crossedIndices must hold size() entries. */
+uint32_t FleetTickKernel(FleetSoA& fleet, uint32_t tick, uint32_t* crossedIndices);
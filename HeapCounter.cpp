@@ -0,0 +1,189 @@
+/** Replaces the global operator new and delete of the program with ones that count the
+ * allocations of every thread, see HeapCounter.h, so a test can tell whether a piece of
+ * code touched the heap by reading the count before and after it, like ArenaTest() at
+ * the end of this file. Counting costs one thread-local increment per allocation. The nothrow forms of
+ * the standard library call the plain and aligned forms below, but its aligned form
+ * calls aligned_alloc() itself, so that one is replaced as well. This file is part of
+ * the program only; the library leaves operator new to the program that embeds it. */
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#include "HeapCounter.h"
+
+#include "Aircraft.h"
+#include "Arena.h"
+#include "Config.h"
+#include "RandomGen.h"
+#include "Simulation.h"
+#include "Statistics.h"
+
+static thread_local uint64_t t_heapAllocations = 0;
+
+uint64_t GetHeapAllocationCount(void) {
+  return t_heapAllocations;
+}
+
+void* operator new(std::size_t bytes) {
+  t_heapAllocations++;
+  void* memory = std::malloc((bytes > 0) ? bytes : 1);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void* operator new[](std::size_t bytes) {
+  return ::operator new(bytes);
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+/** The aligned forms need memory that the aligned deletes can give back. Windows has no
+ * usable aligned_alloc(), its CRT pairs _aligned_malloc() with _aligned_free(); elsewhere
+ * aligned_alloc() memory goes back through free(), and it wants a size that is a
+ * multiple of the alignment. */
+static void* AllocateAligned(std::size_t bytes, std::size_t alignment) {
+#if defined(_WIN32)
+  return _aligned_malloc((bytes > 0) ? bytes : 1, alignment);
+#else
+  std::size_t roundedBytes = ((bytes > 0) ? (bytes + alignment - 1) : alignment) & ~(alignment - 1);
+  return std::aligned_alloc(alignment, roundedBytes);
+#endif
+}
+
+static void FreeAligned(void* memory) {
+#if defined(_WIN32)
+  _aligned_free(memory);
+#else
+  std::free(memory);
+#endif
+}
+
+void* operator new(std::size_t bytes, std::align_val_t alignment) {
+  t_heapAllocations++;
+  void* memory = AllocateAligned(bytes, (std::size_t) alignment);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void* operator new[](std::size_t bytes, std::align_val_t alignment) {
+  return ::operator new(bytes, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+  FreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+  FreeAligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+  FreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+  FreeAligned(memory);
+}
+
+/** Runs a fleet twice through the same arena, resetting it in between, and returns the
+ * heap allocations of each run. The statistics are created before the first run, as the
+ * batch runner keeps them across the replications of a task. */
+static void RunTwiceInArena(const simulation_config_t& config, uint64_t allocations[2], uint32_t numFlights[2],
+                            uint32_t* numBlocksBeforeReset) {
+  SimulationArena arena;
+  SimulationStatistics stats;
+  for (uint32_t run = 0; run < 2; run++) {
+    uint64_t before = GetHeapAllocationCount();
+    {
+      ArenaScope scope(&arena);
+      std::pmr::vector<Aircraft> aircrafts(config.numAircraft, GetSimulationMemory());
+      CreateRandomAircraftIds(aircrafts.data(), config.numAircraft, config.seed);
+      RunSimulationEngine(aircrafts.data(), config, &stats);
+      numFlights[run] = 0;
+      for (const Aircraft& aircraft : aircrafts) {
+        numFlights[run] += aircraft.m_numFlights;
+      }
+    }
+    allocations[run] = GetHeapAllocationCount() - before;
+    if (run == 0) {
+      *numBlocksBeforeReset = arena.getNumBlocks();
+    }
+    arena.reset();
+  }
+}
+
+void ArenaTest(void) {
+  // bump allocation, alignment and a reset that merges the blocks
+  SimulationArena arena(256);
+  bool basicPass = true;
+  void* previous = nullptr;
+  for (uint32_t i = 0; i < 100; i++) {
+    size_t alignment = (size_t) 1 << (i % 7);
+    void* memory = arena.allocate(24 + i, alignment);
+    basicPass = basicPass && (((uintptr_t) memory % alignment) == 0) && (memory != previous);
+    previous = memory;
+  }
+  size_t reservedBefore = arena.getBytesReserved();
+  basicPass = basicPass && (arena.getNumBlocks() > 1) && (arena.getBytesUsed() <= reservedBefore);
+  arena.reset();
+  basicPass = basicPass && (arena.getNumBlocks() == 1) && (arena.getBytesUsed() == 0) &&
+              (arena.getBytesReserved() == reservedBefore);
+  uint64_t before = GetHeapAllocationCount();
+  for (uint32_t i = 0; i < 100; i++) {
+    previous = arena.allocate(24 + i, (size_t) 1 << (i % 7));
+  }
+  basicPass = basicPass && (GetHeapAllocationCount() == before) && (arena.getNumBlocks() == 1);
+  std::cout << "Arena allocation test: " << (basicPass ? "PASS" : "FAIL") << std::endl;
+
+  // a second replication in a reset arena makes no heap allocation, whatever the engine
+  typedef struct {
+    const char* name;
+    simulation_mode_t mode;
+    double tripRequestsPerHour;
+  } arena_test_case_t;
+  const arena_test_case_t testCases[] = {
+    {"tick", SIMULATION_MODE_TICK, 0.0}, {"event", SIMULATION_MODE_EVENT, 0.0},
+    {"SoA", SIMULATION_MODE_SOA, 0.0}, {"demand", SIMULATION_MODE_EVENT, 600.0},
+  };
+  for (const arena_test_case_t& testCase : testCases) {
+    simulation_config_t config = DefaultSimulationConfig();
+    config.numAircraft = 2000;
+    config.numChargers = 100;
+    config.simulationTicks = 6u * LOOP_TICKS_PER_HOUR;
+    config.mode = testCase.mode;
+    config.tripRequestsPerHour = testCase.tripRequestsPerHour;
+
+    uint64_t allocations[2];
+    uint32_t numFlights[2];
+    uint32_t numBlocks;
+    RunTwiceInArena(config, allocations, numFlights, &numBlocks);
+    bool pass = (allocations[0] > 0) && (numBlocks > 1) && (allocations[1] == 0) &&
+                (numFlights[0] == numFlights[1]) && (numFlights[0] > 0);
+    std::cout << "Arena " << testCase.name << " replication test: " << (pass ? "PASS" : "FAIL") <<
+      " (" << allocations[0] << " heap allocations in the first run, " << allocations[1] << " in the second)" << std::endl;
+  }
+}
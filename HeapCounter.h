@@ -0,0 +1,11 @@
+/** Declares what HeapCounter.cpp adds to the program: a count of the operator new calls
+ * of every thread, and the arena test that reads it. Neither is part of libevtolsim,
+ * which leaves operator new to the program that embeds it, so this header isn't
+ * installed with the library's. */
+
+#pragma once
+
+#include <cstdint>
+
+uint64_t GetHeapAllocationCount(void); // operator new calls the calling thread made so far
+void ArenaTest(void);
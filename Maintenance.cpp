@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "Maintenance.h"
+
+#include "AircraftCompanyCommon.h"
+#include "RandomGen.h"
+#include "Simulation.h"
+
+uint32_t GetFlightLegTicks(const Aircraft* plane, uint32_t aircraftIndex, bool faultsGround, uint64_t seed) {
+  uint32_t flightTicks = GetFlightTicks(plane->m_id, plane->m_stateOfCharge);
+  if (faultsGround == false) {
+    return flightTicks;
+  }
+  return std::min(flightTicks, DrawFlightFaultTicks(plane->m_id, aircraftIndex, plane->m_numFlights, seed));
+}
+
+bool IsFaultLanding(const Aircraft* plane, uint32_t tick) {
+  return ((tick - plane->m_stateStartTick) < GetFlightTicks(plane->m_id, plane->m_stateOfCharge));
+}
+
+void LandForRepair(Aircraft* plane, uint32_t tick) {
+  uint32_t flownTicks = tick - plane->m_stateStartTick;
+  uint32_t flightTicks = GetFlightTicks(plane->m_id, plane->m_stateOfCharge);
+  plane->m_stateOfCharge *= 1.0f - ((float) flownTicks / flightTicks);
+  plane->m_numFaults++;
+  plane->m_state = AIRCRAFT_STATE_MAINTENANCE;
+  plane->m_stateStartTick = tick;
+  plane->m_legEndTick = UINT32_MAX; // until a repair bay is free
+}
+
+uint32_t GetRepairTicks(const Aircraft* plane, uint32_t aircraftIndex, uint32_t meanTicks, uint64_t seed) {
+  return DrawRepairTicks(aircraftIndex, plane->m_numFaults, meanTicks, seed);
+}
+
+void RecordRepairSiteStatistics(SimulationStatistics* stats, const ChargeQueue& queue, const ChargeStation& bays, uint32_t endTick) {
+  if (stats == nullptr) {
+    return;
+  }
+  TimeWeightedStatistic queueLength = queue.getLengthOverTime();
+  TimeWeightedStatistic baysInUse = bays.getChargersInUseOverTime();
+  queueLength.finish(endTick);
+  baysInUse.finish(endTick);
+  stats->recordRepairSite(queueLength, baysInUse, bays.getNumChargers());
+}
+
+/** Function to test grounding faults. The flight time to a fault must average 1 / rate
+ * with the rate of -ln(1 - p) per hour, so a share p of the draws falls within the
+ * first hour, and the repair times must average the configured mean, both within 2 %
+ * over 100000 draws. The event engine must match the tick loop aircraft for aircraft,
+ * maintenance time, statistics and repair bays included, with a single bay and with
+ * one bay per aircraft, where nobody ever waits for a bay. */
+void MaintenanceTest(void) {
+  const uint32_t numDraws = 100000;
+  const uint64_t seed = 11;
+  double faultTicksSum = 0.0;
+  uint32_t faultsWithinHour = 0;
+  double repairTicksSum = 0.0;
+  for (uint32_t i = 0; i < numDraws; i++) {
+    uint32_t faultTicks = DrawFlightFaultTicks(AIRCRAFT_ID_ECHO, i, 1u, seed);
+    faultTicksSum += faultTicks;
+    faultsWithinHour += (faultTicks <= LOOP_TICKS_PER_HOUR);
+    repairTicksSum += DrawRepairTicks(i, 1u, DEFAULT_REPAIR_HOURS * LOOP_TICKS_PER_HOUR, seed);
+  }
+  double probability = GetFaultProbabilityPerHour(AIRCRAFT_ID_ECHO);
+  double expectedFaultTicks = LOOP_TICKS_PER_HOUR / -std::log1p(-probability);
+  bool drawPass = (std::abs((faultTicksSum / numDraws) - expectedFaultTicks) < (0.02 * expectedFaultTicks)) &&
+                  (std::abs(((double) faultsWithinHour / numDraws) - probability) < 0.02) &&
+                  (std::abs((repairTicksSum / numDraws) - (DEFAULT_REPAIR_HOURS * LOOP_TICKS_PER_HOUR)) < (0.02 * DEFAULT_REPAIR_HOURS * LOOP_TICKS_PER_HOUR));
+
+  bool enginePass = true;
+  for (uint32_t numRepairBays : {1u, (uint32_t) DEFAULT_AIRCRAFTS_IN_SIMULATION}) {
+    simulation_config_t config = DefaultSimulationConfig();
+    config.simulationTicks = 24u * LOOP_TICKS_PER_HOUR;
+    config.seed = seed;
+    config.numRepairBays = numRepairBays;
+
+    Aircraft tickAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+    for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+      tickAircrafts[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+    }
+    Aircraft eventAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+    std::copy(tickAircrafts, tickAircrafts + DEFAULT_AIRCRAFTS_IN_SIMULATION, eventAircrafts);
+
+    SimulationStatistics tickStats, eventStats;
+    RunTickSimulation(tickAircrafts, config, &tickStats);
+    RunEventSimulation(eventAircrafts, config, &eventStats);
+
+    uint32_t mismatches = CountMismatchedAircraft(tickAircrafts, eventAircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION) +
+                          CountMismatchedStatistics(tickStats, eventStats);
+    uint64_t maintenanceTicks = 0;
+    uint64_t repairs = 0;
+    for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+      maintenanceTicks += tickAircrafts[i].m_maintenanceTimeTicks;
+    }
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+      repairs += tickStats.getCompany((aircraft_id_t) i).repairs.getMinutes().getCount();
+    }
+    const charge_site_statistics_t& site = tickStats.getRepairSite();
+    bool sitePass = (site.chargerTicks == (uint64_t) numRepairBays * config.simulationTicks) &&
+                    ((numRepairBays < DEFAULT_AIRCRAFTS_IN_SIMULATION) || (site.queueLength.getMax() == 0));
+    enginePass = enginePass && (mismatches == 0) && sitePass && (maintenanceTicks > 0) && (repairs > 0);
+  }
+
+  std::cout << "Maintenance test: " << ((drawPass && enginePass) ? "PASS" : "FAIL") << std::endl;
+}
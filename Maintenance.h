@@ -0,0 +1,34 @@
+/** Defines faults that ground aircraft. By default a fault is only counted, from one
+ * draw per aircraft every hour, and never changes what an aircraft does. With
+ * --repair-bays N a fault cuts the flight short instead:
+ *
+ * Faults are a Poisson process in flight time. Every takeoff draws the flight time
+ * until the first fault from the aircraft's own random stream (DrawFlightFaultTicks()
+ * in RandomGen.h), so the end of a flight, battery dead or fault, is known when it
+ * takes off and is one event like any other; nothing is checked per tick or per hour.
+ * A faulted aircraft lands with the share of its charge the cut-short flight didn't
+ * use, enters AIRCRAFT_STATE_MAINTENANCE and gets in a FIFO line for one of the N
+ * repair bays, a ChargeQueue and a ChargeStation like the line and the chargers. A
+ * repair time is drawn per fault from a log-normal distribution with a mean of
+ * --repair-hours. Once repaired, the aircraft gets in line for a charger.
+ *
+ * The tick loop and the event engine support repair bays, with identical results.
+ * The time an aircraft is grounded, the wait for a bay included, is counted in
+ * m_maintenanceTimeTicks and recorded per company in the streaming statistics. */
+
+#pragma once
+
+#include <cstdint>
+
+#include "Aircraft.h"
+#include "ChargeQueue.h"
+#include "ChargeStation.h"
+#include "Statistics.h"
+
+// Ticks from the takeoff of the aircraft's current flight until the battery is dead or, if faultsGround, its first fault
+uint32_t GetFlightLegTicks(const Aircraft* plane, uint32_t aircraftIndex, bool faultsGround, uint64_t seed);
+bool IsFaultLanding(const Aircraft* plane, uint32_t tick); // the flight ending on tick was cut short by a fault
+void LandForRepair(Aircraft* plane, uint32_t tick); // counts the fault and drains the battery by the share of the flight flown
+uint32_t GetRepairTicks(const Aircraft* plane, uint32_t aircraftIndex, uint32_t meanTicks, uint64_t seed); // of the aircraft's last fault
+void RecordRepairSiteStatistics(SimulationStatistics* stats, const ChargeQueue& queue, const ChargeStation& bays, uint32_t endTick);
+void MaintenanceTest(void);
@@ -0,0 +1,320 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Metrics.h"
+
+#include "AircraftCompanyCommon.h"
+#include "Simulation.h"
+
+metrics_page_t* G_MetricsPage = nullptr;
+thread_local uint32_t t_metricsCallsLeft = METRICS_CHECK_CALLS;
+
+// What the calling thread already added to the counters for the run it is simulating
+typedef struct {
+  uint64_t lastFlushNs;
+  uint32_t flushedTicks;
+  uint64_t flushedEvents;
+  uint32_t runTicks;
+  uint32_t numChargers;
+  bool inRun; // between MetricsRunStart() and MetricsRunFinish(), engines stepped by anything else, like a sweep, aren't counted
+} metrics_thread_t;
+
+static thread_local metrics_thread_t t_metricsThread;
+
+static std::chrono::steady_clock::time_point pageCreated;
+static size_t pageMappedBytes = 0;
+static std::atomic<bool> snapshotBusy(false);
+static uint64_t lastSnapshotNs = 0; // the previous snapshot, guarded by snapshotBusy
+static uint64_t lastSnapshotTicks = 0;
+static uint64_t lastSnapshotEvents = 0;
+
+static const char* stateNames[METRICS_AIRCRAFT_STATES] = {"idle", "flying", "charging", "waiting_to_charge", "maintenance"};
+
+static uint64_t NowNs(void) {
+  return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - pageCreated).count();
+}
+
+static uint64_t DoubleBits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double BitsDouble(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+bool StartMetrics(const char* path) {
+#if defined(__unix__) || defined(__APPLE__)
+  size_t pageBytes = (sizeof(metrics_page_t) + 4095u) & ~(size_t) 4095u;
+  int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  void* mapping = MAP_FAILED;
+  if ((fd >= 0) && (ftruncate(fd, (off_t) pageBytes) == 0)) {
+    mapping = mmap(nullptr, pageBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (fd >= 0) {
+    ::close(fd); // the mapping stays valid
+  }
+  if (mapping == MAP_FAILED) {
+    std::cout << "ERROR - could not create metrics page " << path << std::endl;
+    return false;
+  }
+
+  metrics_page_t* page = new (mapping) metrics_page_t();
+  page->version = METRICS_VERSION;
+  page->pageBytes = (uint32_t) pageBytes;
+  page->pid = (uint64_t) getpid();
+  memcpy(page->magic, METRICS_MAGIC, sizeof(page->magic)); // last, a reader ignores the page until it is set
+  pageCreated = std::chrono::steady_clock::now();
+  pageMappedBytes = pageBytes;
+  lastSnapshotNs = 0;
+  lastSnapshotTicks = 0;
+  lastSnapshotEvents = 0;
+  G_MetricsPage = page;
+  return true;
+#else
+  std::cout << "ERROR - --metrics needs mmap, it isn't supported on this platform" << std::endl;
+  (void) path;
+  return false;
+#endif
+}
+
+void StopMetrics(void) {
+#if defined(__unix__) || defined(__APPLE__)
+  if (G_MetricsPage != nullptr) {
+    munmap((void*) G_MetricsPage, pageMappedBytes);
+  }
+#endif
+  G_MetricsPage = nullptr;
+}
+
+void MetricsBatchStart(uint32_t numReplications) {
+  if (G_MetricsPage != nullptr) {
+    G_MetricsPage->replicationsTotal.fetch_add(numReplications, std::memory_order_relaxed);
+  }
+}
+
+void MetricsRunStart(const simulation_config_t& config) {
+  if (G_MetricsPage == nullptr) {
+    return;
+  }
+  t_metricsThread.lastFlushNs = NowNs();
+  t_metricsThread.flushedTicks = 0;
+  t_metricsThread.flushedEvents = 0;
+  t_metricsThread.runTicks = config.simulationTicks;
+  t_metricsThread.numChargers = config.numChargers * config.numVertiports;
+  t_metricsThread.inRun = true;
+}
+
+bool MetricsFlushDue(void) {
+  return t_metricsThread.inRun && ((NowNs() - t_metricsThread.lastFlushNs) >= (METRICS_PUBLISH_MS * 1000000ull));
+}
+
+/** Adds the run's progress since the last flush to the counters and, unless another
+ * thread is at it, writes a snapshot of the fleet. */
+void MetricsFlush(uint32_t tick, const Aircraft* aircrafts, uint32_t numAircraft) {
+  metrics_page_t* page = G_MetricsPage;
+  uint64_t events = 0;
+  uint64_t aircraftInState[METRICS_AIRCRAFT_STATES] = {0};
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    events += aircrafts[i].m_numFlights + 2ull * aircrafts[i].m_numChargeSessions + aircrafts[i].m_numFaults;
+    aircraftInState[aircrafts[i].m_state]++;
+  }
+  uint64_t now = NowNs();
+  page->simulatedTicks.fetch_add(tick - t_metricsThread.flushedTicks, std::memory_order_relaxed);
+  page->events.fetch_add(events - t_metricsThread.flushedEvents, std::memory_order_relaxed);
+  t_metricsThread.lastFlushNs = now;
+  t_metricsThread.flushedTicks = tick;
+  t_metricsThread.flushedEvents = events;
+
+  if (snapshotBusy.exchange(true, std::memory_order_acquire)) {
+    return; // the other thread's snapshot is as good
+  }
+  uint64_t ticks = page->simulatedTicks.load(std::memory_order_relaxed);
+  uint64_t allEvents = page->events.load(std::memory_order_relaxed);
+  double sec = (now - lastSnapshotNs) * 1e-9;
+  double ticksPerSec = (sec > 0.0) ? ((ticks - lastSnapshotTicks) / sec) : 0.0;
+  double eventsPerSec = (sec > 0.0) ? ((allEvents - lastSnapshotEvents) / sec) : 0.0;
+  lastSnapshotNs = now;
+  lastSnapshotTicks = ticks;
+  lastSnapshotEvents = allEvents;
+
+  uint64_t sequence = page->sequence.load(std::memory_order_relaxed);
+  page->sequence.store(sequence + 1u, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  page->updateNs.store(now, std::memory_order_relaxed);
+  page->ticksPerSecBits.store(DoubleBits(ticksPerSec), std::memory_order_relaxed);
+  page->eventsPerSecBits.store(DoubleBits(eventsPerSec), std::memory_order_relaxed);
+  page->runTick.store(tick, std::memory_order_relaxed);
+  page->runTicks.store(t_metricsThread.runTicks, std::memory_order_relaxed);
+  page->numAircraft.store(numAircraft, std::memory_order_relaxed);
+  for (uint32_t s = 0; s < METRICS_AIRCRAFT_STATES; s++) {
+    page->aircraftInState[s].store(aircraftInState[s], std::memory_order_relaxed);
+  }
+  page->chargersInUse.store(aircraftInState[AIRCRAFT_STATE_CHARGING], std::memory_order_relaxed);
+  page->numChargers.store(t_metricsThread.numChargers, std::memory_order_relaxed);
+  page->chargeQueueDepth.store(aircraftInState[AIRCRAFT_STATE_WAITING_TO_CHARGE], std::memory_order_relaxed);
+  page->sequence.store(sequence + 2u, std::memory_order_release);
+  snapshotBusy.store(false, std::memory_order_release);
+}
+
+void MetricsRunFinish(const Aircraft* aircrafts, uint32_t numAircraft, uint32_t simulationTicks) {
+  if ((G_MetricsPage == nullptr) || (t_metricsThread.inRun == false)) {
+    return;
+  }
+  MetricsFlush(simulationTicks, aircrafts, numAircraft);
+  G_MetricsPage->replicationsDone.fetch_add(1u, std::memory_order_relaxed);
+  t_metricsThread.inRun = false;
+}
+
+bool ReadMetricsPage(const char* path, metrics_snapshot_t* snapshot) {
+#if defined(__unix__) || defined(__APPLE__)
+  int fd = ::open(path, O_RDONLY);
+  struct stat fileStat;
+  void* mapping = MAP_FAILED;
+  if ((fd >= 0) && (fstat(fd, &fileStat) == 0) && ((size_t) fileStat.st_size >= sizeof(metrics_page_t))) {
+    mapping = mmap(nullptr, sizeof(metrics_page_t), PROT_READ, MAP_SHARED, fd, 0);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  const metrics_page_t* page = (const metrics_page_t*) mapping;
+  if ((mapping == MAP_FAILED) || (memcmp(page->magic, METRICS_MAGIC, sizeof(page->magic)) != 0) || (page->version != METRICS_VERSION)) {
+    std::cout << "ERROR - " << path << " is not a metrics page of this version" << std::endl;
+    if (mapping != MAP_FAILED) {
+      munmap(mapping, sizeof(metrics_page_t));
+    }
+    return false;
+  }
+
+  // the writer never waits, so a reader that keeps catching it mid-snapshot just tries again
+  bool consistent = false;
+  for (uint32_t attempt = 0; (attempt < 100000u) && (consistent == false); attempt++) {
+    uint64_t sequence = page->sequence.load(std::memory_order_acquire);
+    if ((sequence & 1u) != 0) {
+      continue;
+    }
+    snapshot->updateSec = page->updateNs.load(std::memory_order_relaxed) * 1e-9;
+    snapshot->ticksPerSec = BitsDouble(page->ticksPerSecBits.load(std::memory_order_relaxed));
+    snapshot->eventsPerSec = BitsDouble(page->eventsPerSecBits.load(std::memory_order_relaxed));
+    snapshot->runTick = page->runTick.load(std::memory_order_relaxed);
+    snapshot->runTicks = page->runTicks.load(std::memory_order_relaxed);
+    snapshot->numAircraft = page->numAircraft.load(std::memory_order_relaxed);
+    for (uint32_t s = 0; s < METRICS_AIRCRAFT_STATES; s++) {
+      snapshot->aircraftInState[s] = page->aircraftInState[s].load(std::memory_order_relaxed);
+    }
+    snapshot->chargersInUse = page->chargersInUse.load(std::memory_order_relaxed);
+    snapshot->numChargers = page->numChargers.load(std::memory_order_relaxed);
+    snapshot->chargeQueueDepth = page->chargeQueueDepth.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    consistent = (page->sequence.load(std::memory_order_relaxed) == sequence);
+  }
+  snapshot->pid = page->pid;
+  snapshot->simulatedTicks = page->simulatedTicks.load(std::memory_order_relaxed);
+  snapshot->events = page->events.load(std::memory_order_relaxed);
+  snapshot->replicationsDone = page->replicationsDone.load(std::memory_order_relaxed);
+  snapshot->replicationsTotal = page->replicationsTotal.load(std::memory_order_relaxed);
+  munmap(mapping, sizeof(metrics_page_t));
+  if (consistent == false) {
+    std::cout << "ERROR - the snapshot of " << path << " kept changing while it was read" << std::endl;
+  }
+  return consistent;
+#else
+  std::cout << "ERROR - --read-metrics needs mmap, it isn't supported on this platform" << std::endl;
+  (void) path;
+  (void) snapshot;
+  return false;
+#endif
+}
+
+static void WriteMetric(std::ostream& out, const char* name, const char* type, const char* help, double value) {
+  out << "# HELP " << name << " " << help << "\n" <<
+    "# TYPE " << name << " " << type << "\n" <<
+    name << " " << value << "\n";
+}
+
+void WriteMetricsPrometheus(std::ostream& out, const metrics_snapshot_t& snapshot) {
+  out << std::setprecision(12);
+  WriteMetric(out, "evtolsim_simulated_ticks_total", "counter", "Simulated ticks of every run, 50 ticks per simulated minute.", (double) snapshot.simulatedTicks);
+  WriteMetric(out, "evtolsim_events_total", "counter", "Flights, charge starts and ends and faults simulated.", (double) snapshot.events);
+  WriteMetric(out, "evtolsim_ticks_per_second", "gauge", "Simulated ticks per wall second since the previous snapshot.", snapshot.ticksPerSec);
+  WriteMetric(out, "evtolsim_events_per_second", "gauge", "Events per wall second since the previous snapshot.", snapshot.eventsPerSec);
+  WriteMetric(out, "evtolsim_run_progress_ratio", "gauge", "Share of its horizon the run that took the snapshot had simulated.",
+              (snapshot.runTicks > 0) ? ((double) snapshot.runTick / snapshot.runTicks) : 0.0);
+  out << "# HELP evtolsim_aircraft Aircraft in each state.\n" << "# TYPE evtolsim_aircraft gauge\n";
+  for (uint32_t s = 0; s < METRICS_AIRCRAFT_STATES; s++) {
+    out << "evtolsim_aircraft{state=\"" << stateNames[s] << "\"} " << snapshot.aircraftInState[s] << "\n";
+  }
+  WriteMetric(out, "evtolsim_chargers_in_use", "gauge", "Chargers with an aircraft on them.", (double) snapshot.chargersInUse);
+  WriteMetric(out, "evtolsim_chargers", "gauge", "Chargers of the run, at every vertiport.", (double) snapshot.numChargers);
+  WriteMetric(out, "evtolsim_charge_queue_depth", "gauge", "Aircraft in line for a charger.", (double) snapshot.chargeQueueDepth);
+  WriteMetric(out, "evtolsim_replications_done_total", "counter", "Runs finished, a single run counts as a batch of one.", (double) snapshot.replicationsDone);
+  WriteMetric(out, "evtolsim_replications", "gauge", "Runs in the batch.", (double) snapshot.replicationsTotal);
+  WriteMetric(out, "evtolsim_last_update_seconds", "gauge", "Wall seconds from the start of the program to the snapshot.", snapshot.updateSec);
+  WriteMetric(out, "evtolsim_process_id", "gauge", "Process writing the page.", (double) snapshot.pid);
+}
+
+/** Function to test the metrics page. Two replications of 24 hours are run through the
+ * tick loop and the event engine with a page; the reader must then see both runs done,
+ * every tick and event they simulated counted, and a last snapshot of a whole fleet
+ * with no more chargers in use than there are. The Prometheus text must carry every
+ * state. */
+void MetricsTest(void) {
+  const char* path = "MetricsTest.page";
+  bool pass = StartMetrics(path);
+
+  simulation_config_t config = DefaultSimulationConfig();
+  config.simulationTicks = 24u * LOOP_TICKS_PER_HOUR;
+  config.seed = 3;
+  uint64_t events = 0;
+  MetricsBatchStart(2);
+  for (uint32_t engine = 0; pass && (engine < 2); engine++) {
+    Aircraft aircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+    for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+      aircrafts[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+    }
+    MetricsRunStart(config);
+    if (engine == 0) {
+      RunTickSimulation(aircrafts, config);
+    } else {
+      RunEventSimulation(aircrafts, config);
+    }
+    MetricsRunFinish(aircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION, config.simulationTicks);
+    for (const Aircraft& plane : aircrafts) {
+      events += plane.m_numFlights + 2ull * plane.m_numChargeSessions + plane.m_numFaults;
+    }
+  }
+  StopMetrics();
+
+  metrics_snapshot_t snapshot;
+  pass = pass && ReadMetricsPage(path, &snapshot);
+  if (pass) {
+    uint64_t inAnyState = 0;
+    for (uint32_t s = 0; s < METRICS_AIRCRAFT_STATES; s++) {
+      inAnyState += snapshot.aircraftInState[s];
+    }
+    std::ostringstream text;
+    WriteMetricsPrometheus(text, snapshot);
+    pass = (snapshot.replicationsDone == 2) && (snapshot.replicationsTotal == 2) &&
+           (snapshot.simulatedTicks == 2ull * config.simulationTicks) && (snapshot.events == events) &&
+           (inAnyState == DEFAULT_AIRCRAFTS_IN_SIMULATION) && (snapshot.chargersInUse <= snapshot.numChargers) &&
+           (snapshot.runTick == snapshot.runTicks) && (text.str().find("state=\"waiting_to_charge\"") != std::string::npos);
+  }
+  std::remove(path);
+
+  std::cout << "Metrics test: " << (pass ? "PASS" : "FAIL") << std::endl;
+}
@@ -0,0 +1,108 @@
+/** Defines the live metrics page. With --metrics PATH the program keeps a page of
+ * counters in a file mapped into memory, shared with any process that maps it too, so
+ * a long run or batch can be watched while it runs: simulated ticks and events with
+ * their rates, the aircraft in each state, chargers in use, the charge line and the
+ * replications done. --read-metrics PATH prints the page in the Prometheus text format,
+ * for a textfile collector or a look by hand, e.g. with watch. A path under /dev/shm
+ * keeps the page out of the disk.
+ *
+ * The engines call MetricsTick() once per tick they handle. Without a page that is one
+ * load, with one it counts down and only reads the clock every METRICS_CHECK_CALLS
+ * calls. Every METRICS_PUBLISH_MS of wall time a thread adds the ticks and events it
+ * simulated since its last flush to the counters, and takes a snapshot of its fleet
+ * into the page if no other thread is taking one. The snapshot fields are guarded by
+ * a sequence number, odd while they are written, so a reader retries instead of seeing
+ * a half written snapshot; nothing the simulation does ever waits on a reader.
+ *
+ * The tick, event and demand engines snapshot while they run; the SoA and network
+ * engines and the analytic fast path only at the end of every run. Events are the
+ * flights, charge starts and ends and faults, as in the benchmarks. */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+#include "Aircraft.h"
+#include "Config.h"
+
+#define METRICS_MAGIC "EVTOLMET"
+#define METRICS_VERSION (1u)
+#define METRICS_CHECK_CALLS (1024u) // MetricsTick() calls between two reads of the clock
+#define METRICS_PUBLISH_MS (250u) // wall time between two flushes of a thread
+#define METRICS_AIRCRAFT_STATES (AIRCRAFT_STATE_MAINTENANCE + 1u)
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t pageBytes;
+  uint64_t pid;
+  std::atomic<uint64_t> sequence; // odd while a snapshot is being written
+  // counters, updated on their own
+  std::atomic<uint64_t> simulatedTicks; // of every run, runs in progress up to their last flush
+  std::atomic<uint64_t> events;
+  std::atomic<uint64_t> replicationsDone; // a single run counts as a batch of one
+  std::atomic<uint64_t> replicationsTotal;
+  // snapshot, guarded by sequence
+  std::atomic<uint64_t> updateNs; // steady clock since the page was created
+  std::atomic<uint64_t> ticksPerSecBits; // double, over the interval since the previous snapshot
+  std::atomic<uint64_t> eventsPerSecBits;
+  std::atomic<uint64_t> runTick; // of the run that took the snapshot
+  std::atomic<uint64_t> runTicks;
+  std::atomic<uint64_t> numAircraft;
+  std::atomic<uint64_t> aircraftInState[METRICS_AIRCRAFT_STATES];
+  std::atomic<uint64_t> chargersInUse;
+  std::atomic<uint64_t> numChargers; // of every vertiport
+  std::atomic<uint64_t> chargeQueueDepth;
+} metrics_page_t;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the page is shared with other processes, its atomics can't use locks");
+
+// Plain copy of a page, as read by ReadMetricsPage()
+typedef struct {
+  uint64_t pid;
+  uint64_t simulatedTicks;
+  uint64_t events;
+  uint64_t replicationsDone;
+  uint64_t replicationsTotal;
+  double updateSec;
+  double ticksPerSec;
+  double eventsPerSec;
+  uint64_t runTick;
+  uint64_t runTicks;
+  uint64_t numAircraft;
+  uint64_t aircraftInState[METRICS_AIRCRAFT_STATES];
+  uint64_t chargersInUse;
+  uint64_t numChargers;
+  uint64_t chargeQueueDepth;
+} metrics_snapshot_t;
+
+extern metrics_page_t* G_MetricsPage; // null unless --metrics created a page, set before any run starts
+
+/** Creates the page at path, replacing any file there. StopMetrics unmaps it and leaves
+ * the file, with the final values, for readers; call it once every run has finished. */
+bool StartMetrics(const char* path);
+void StopMetrics(void);
+
+void MetricsBatchStart(uint32_t numReplications);
+void MetricsRunStart(const simulation_config_t& config); // on the thread that runs it, before the engine starts
+void MetricsRunFinish(const Aircraft* aircrafts, uint32_t numAircraft, uint32_t simulationTicks); // flushes what is left, counts a replication
+bool MetricsFlushDue(void); // reads the clock, true once METRICS_PUBLISH_MS passed since the thread's last flush
+void MetricsFlush(uint32_t tick, const Aircraft* aircrafts, uint32_t numAircraft);
+
+extern thread_local uint32_t t_metricsCallsLeft;
+
+// The chargers in use and the line are the aircraft charging and waiting to charge, so the fleet is all it needs
+inline void MetricsTick(uint32_t tick, const Aircraft* aircrafts, uint32_t numAircraft) {
+  if ((G_MetricsPage != nullptr) && (--t_metricsCallsLeft == 0)) {
+    t_metricsCallsLeft = METRICS_CHECK_CALLS;
+    if (MetricsFlushDue()) {
+      MetricsFlush(tick, aircrafts, numAircraft);
+    }
+  }
+}
+
+bool ReadMetricsPage(const char* path, metrics_snapshot_t* snapshot); // prints an error and returns false if it isn't a page
+void WriteMetricsPrometheus(std::ostream& out, const metrics_snapshot_t& snapshot);
+void MetricsTest(void);
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include "Network.h"
+
+#include "AircraftCompanyCommon.h"
+#include "RandomGen.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+Vertiport::Vertiport(NetworkSimulation* network, uint32_t siteIndex, const simulation_config_t& config) :
+  m_battChargers(config.numChargers), m_aircraftInLineToCharge(config.numAircraft, config.policy), m_inbox(config.numAircraft),
+  m_events(std::pmr::new_delete_resource())
+{
+  m_network = network;
+  m_aircrafts = network->getAircrafts();
+  m_siteIndex = siteIndex;
+  m_chargeTargetSoc = config.chargeTargetSoc;
+  m_arrivals = 0;
+  m_departures = 0;
+}
+
+void Vertiport::land(uint32_t aircraftIndex, uint32_t tick) {
+  // the inbox holds the whole fleet, so it can't be full
+  if (m_inbox.tryPush({aircraftIndex, tick}) == false) {
+    std::cout << "ERROR - vertiport inbox is full, it should have room for the whole fleet." << std::endl;
+  }
+}
+
+/** Aircraft handed over during the last window land at or after the end of it, so
+ * draining the inbox first is enough for every landing of this window to be in the
+ * heap. Aircraft that other vertiports hand over while this window runs land in a
+ * later window; they're picked up now or at the next drain, either way before the
+ * tick they land on. */
+void Vertiport::runWindow(uint32_t windowEndTick, uint32_t simulationTicks) {
+  charge_queue_entry_t entry;
+  while (m_inbox.tryPop(&entry)) {
+    scheduleEvent(entry.enqueueTick, entry.aircraftIndex, SIM_EVENT_BATTERY_DEAD);
+  }
+
+  while ((m_events.empty() == false) && (m_events.front().tick < windowEndTick) && (m_events.front().tick <= simulationTicks)) {
+    uint32_t tick = m_events.front().tick;
+    sim_event_t event;
+    while (PopSimEvent(&m_events, tick, &event)) {
+      handleEvent(event);
+    }
+    // same as the tick loop, chargers freed on this tick are handed out after every transition is handled
+    DispatchWaitingAircraft(m_aircrafts, tick, m_chargeTargetSoc, &m_battChargers, &m_aircraftInLineToCharge, &m_events, &m_stats);
+  }
+}
+
+void Vertiport::handleEvent(const sim_event_t& event) {
+  switch (event.type) {
+    case SIM_EVENT_BATTERY_DEAD:
+      // the aircraft lands here with a dead battery and gets in line
+      EndFlight(m_aircrafts, event.aircraftIndex, event.tick, &m_stats);
+      m_arrivals++;
+      m_aircrafts[event.aircraftIndex].m_stateOfCharge = 0.0f;
+      JoinChargeLine(m_aircrafts, event.aircraftIndex, event.tick, &m_aircraftInLineToCharge);
+      break;
+    case SIM_EVENT_CHARGING_COMPLETE:
+      EndChargeSession(m_aircrafts, event.aircraftIndex, event.tick, &m_battChargers, &m_stats);
+      m_aircrafts[event.aircraftIndex].m_stateOfCharge = m_chargeTargetSoc;
+      m_network->takeOff(event.aircraftIndex, m_siteIndex, event.tick);
+      m_departures++;
+      break;
+    default:
+      std::cout << "ERROR - default case should never execute." << std::endl;
+      break;
+  }
+}
+
+void Vertiport::finish(uint32_t simulationTicks) {
+  RecordChargeSiteStatistics(&m_stats, m_aircraftInLineToCharge, m_battChargers, simulationTicks);
+}
+
+void Vertiport::summarize(vertiport_summary_t* summary) const {
+  summary->arrivals = m_arrivals;
+  summary->departures = m_departures;
+  summary->stats = m_stats;
+}
+
+NetworkSimulation::NetworkSimulation(Aircraft* aircrafts, const simulation_config_t& config) {
+  m_aircrafts = aircrafts;
+  m_numAircraft = config.numAircraft;
+  m_seed = config.seed;
+  m_numThreads = std::max(1u, std::min(config.numThreads, config.numVertiports));
+
+  // a flight after a charge session is the shortest one, every aircraft starts the run on a charge at least as high
+  m_lookaheadTicks = UINT32_MAX;
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    m_lookaheadTicks = std::min(m_lookaheadTicks, GetFlightTicks((aircraft_id_t) i, config.chargeTargetSoc));
+  }
+  m_lookaheadTicks = std::max(m_lookaheadTicks, 1u);
+
+  for (uint32_t siteIndex = 0; siteIndex < config.numVertiports; siteIndex++) {
+    m_sites.emplace_back(new Vertiport(this, siteIndex, config));
+  }
+}
+
+uint32_t NetworkSimulation::getDestination(uint32_t aircraftIndex, uint32_t flight, uint32_t siteIndex) const {
+  uint32_t numSites = getNumSites();
+  if (numSites == 1) {
+    return siteIndex;
+  }
+  // a counter-based draw, so the route doesn't depend on which thread asks first
+  RandomStream routes(m_seed, RANDOM_PURPOSE_ROUTES, aircraftIndex);
+  routes.setPosition(flight);
+  uint32_t destination = routes.nextBelow(numSites - 1u);
+  return (destination >= siteIndex) ? (destination + 1u) : destination;
+}
+
+void NetworkSimulation::takeOff(uint32_t aircraftIndex, uint32_t siteIndex, uint32_t tick) {
+  Aircraft* pCurCraft = &m_aircrafts[aircraftIndex];
+  pCurCraft->m_state = AIRCRAFT_STATE_FLYING;
+  pCurCraft->m_numFlights++;
+  pCurCraft->m_stateStartTick = tick;
+  pCurCraft->m_legEndTick = tick + GetFlightTicks(pCurCraft->m_id, pCurCraft->m_stateOfCharge);
+  TraceTakeoff(aircraftIndex, tick, pCurCraft->m_numFlights);
+  m_sites[getDestination(aircraftIndex, pCurCraft->m_numFlights, siteIndex)]->land(aircraftIndex, pCurCraft->m_legEndTick);
+}
+
+void NetworkSimulation::run(uint32_t simulationTicks) {
+  // tick 0 of the tick loop, every aircraft takes off from its home vertiport
+  for (uint32_t i = 0; i < m_numAircraft; i++) {
+    uint32_t homeSite = i % getNumSites();
+    takeOff(i, homeSite, 0);
+    m_sites[homeSite]->countDeparture();
+  }
+
+  // the vertiports are split into one contiguous group per thread, and a window ends when every group is done
+  std::unique_ptr<ThreadPool> pool;
+  if (m_numThreads > 1) {
+    pool.reset(new ThreadPool(m_numThreads));
+  }
+  for (uint64_t windowStart = 0; windowStart <= simulationTicks; windowStart += m_lookaheadTicks) {
+    uint32_t windowEnd = (uint32_t) std::min<uint64_t>(windowStart + m_lookaheadTicks, (uint64_t) simulationTicks + 1u);
+    if (pool == nullptr) {
+      for (std::unique_ptr<Vertiport>& site : m_sites) {
+        site->runWindow(windowEnd, simulationTicks);
+      }
+      continue;
+    }
+    for (uint32_t group = 0; group < m_numThreads; group++) {
+      uint32_t firstSite = (uint32_t) (((uint64_t) group * getNumSites()) / m_numThreads);
+      uint32_t endSite = (uint32_t) (((uint64_t) (group + 1u) * getNumSites()) / m_numThreads);
+      pool->submit([this, firstSite, endSite, windowEnd, simulationTicks]() {
+        for (uint32_t siteIndex = firstSite; siteIndex < endSite; siteIndex++) {
+          m_sites[siteIndex]->runWindow(windowEnd, simulationTicks);
+        }
+      });
+    }
+    pool->wait();
+  }
+
+  for (std::unique_ptr<Vertiport>& site : m_sites) {
+    site->finish(simulationTicks);
+  }
+  CloseOutPartialLegs(m_aircrafts, m_numAircraft, simulationTicks);
+
+  // a fault draw doesn't depend on where the aircraft is, so every hour is drawn after the run
+  for (uint32_t hour = 1; hour <= (simulationTicks / LOOP_TICKS_PER_HOUR); hour++) {
+    GenerateHourlyFaults(m_aircrafts, m_numAircraft, hour, m_seed);
+  }
+}
+
+void RunNetworkSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats, std::vector<vertiport_summary_t>* sites) {
+  NetworkSimulation network(aircrafts, config);
+  network.run(config.simulationTicks);
+
+  // merged in vertiport order, so the floating point sums don't depend on the threads either
+  for (uint32_t siteIndex = 0; siteIndex < network.getNumSites(); siteIndex++) {
+    if (stats != nullptr) {
+      stats->merge(network.getSite(siteIndex).getStatistics());
+    }
+    if (sites != nullptr) {
+      sites->emplace_back();
+      network.getSite(siteIndex).summarize(&sites->back());
+    }
+  }
+}
+
+void WriteVertiportStatistics(std::ostream& out, const std::vector<vertiport_summary_t>& sites) {
+  for (uint32_t siteIndex = 0; siteIndex < sites.size(); siteIndex++) {
+    const vertiport_summary_t& site = sites[siteIndex];
+    DurationStatistic allWaits;
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+      allWaits.merge(site.stats.getCompany((aircraft_id_t) i).waits);
+    }
+    out << std::fixed << std::setprecision(2) <<
+      "Vertiport " << siteIndex << " - arrivals: " << site.arrivals << ", departures: " << site.departures <<
+      ", charger utilization: " << (100.0 * site.stats.getChargerUtilization()) << " %" <<
+      ", aircraft in line: mean " << site.stats.getChargeSite().queueLength.getMean() <<
+      ", max " << site.stats.getChargeSite().queueLength.getMax() <<
+      ", wait for charger: mean " << allWaits.getMinutes().getMean() << " min\n";
+  }
+  out << "----------------------------------------------------------------------------------------\n";
+}
+
+/** Function to test the network. A single vertiport has to give the same counters and
+ * statistics as the event engine. Eight vertiports have to give the same results on
+ * one thread as on four, and every flight has to take off and land somewhere: the
+ * departures add up to the flights, and the arrivals to the flights that ended. */
+void NetworkTest(void) {
+  simulation_config_t config = DefaultSimulationConfig();
+  config.simulationTicks = 24u * LOOP_TICKS_PER_HOUR;
+  config.seed = 7u;
+
+  Aircraft eventAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+  for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+    eventAircrafts[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+  }
+  Aircraft networkAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+  std::copy(eventAircrafts, eventAircrafts + DEFAULT_AIRCRAFTS_IN_SIMULATION, networkAircrafts);
+
+  SimulationStatistics eventStats, networkStats;
+  RunEventSimulation(eventAircrafts, config, &eventStats);
+  config.numVertiports = 1;
+  RunNetworkSimulation(networkAircrafts, config, &networkStats);
+  uint32_t mismatches = CountMismatchedAircraft(eventAircrafts, networkAircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION) +
+                        CountMismatchedStatistics(eventStats, networkStats);
+  std::cout << "Network test, 1 vertiport against the event engine: " << ((mismatches == 0) ? "PASS" : "FAIL") <<
+    " (" << mismatches << " mismatched aircraft)" << std::endl;
+
+  const uint32_t numAircraft = 200;
+  config.numAircraft = numAircraft;
+  config.numChargers = 2;
+  config.numVertiports = 8;
+  std::vector<Aircraft> serialAircrafts(numAircraft);
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    serialAircrafts[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+  }
+  std::vector<Aircraft> parallelAircrafts = serialAircrafts;
+
+  SimulationStatistics serialStats, parallelStats;
+  std::vector<vertiport_summary_t> sites;
+  config.numThreads = 1;
+  RunNetworkSimulation(serialAircrafts.data(), config, &serialStats, &sites);
+  config.numThreads = 4;
+  RunNetworkSimulation(parallelAircrafts.data(), config, &parallelStats);
+  mismatches = CountMismatchedAircraft(serialAircrafts.data(), parallelAircrafts.data(), numAircraft) +
+               CountMismatchedStatistics(serialStats, parallelStats);
+
+  uint64_t flights = 0, flightsEnded = 0, departures = 0, arrivals = 0;
+  for (const Aircraft& plane : serialAircrafts) {
+    flights += plane.m_numFlights;
+    flightsEnded += plane.m_numFlights - ((plane.m_state == AIRCRAFT_STATE_FLYING) ? 1u : 0u);
+  }
+  for (const vertiport_summary_t& site : sites) {
+    departures += site.departures;
+    arrivals += site.arrivals;
+  }
+  bool pass = (mismatches == 0) && (sites.size() == config.numVertiports) && (departures == flights) && (arrivals == flightsEnded);
+  std::cout << "Network test, 8 vertiports on 1 and 4 threads: " << (pass ? "PASS" : "FAIL") <<
+    " (" << mismatches << " mismatched aircraft, " << departures << " departures, " << arrivals << " arrivals)" << std::endl;
+}
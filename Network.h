@@ -0,0 +1,104 @@
+/** Defines the vertiport network mode. With --vertiports N above 1, the fleet flies
+ * between N vertiports instead of in place, and every vertiport owns its own charger
+ * pool (--chargers is per vertiport) and line for chargers.
+ *
+ * Aircraft start at vertiport (index % N). Every flight still lasts until the battery
+ * is dead, and lands at a destination drawn from the aircraft's own random stream,
+ * any vertiport but the one it took off from. It charges there and takes off again.
+ *
+ * Each vertiport is a partition with its own event heap, simulated by the same rules
+ * as EventSimulation.h. The partitions run in parallel in time windows as long as the
+ * shortest flight of the catalog, the lookahead: an aircraft that takes off inside a
+ * window can't land anywhere before the window ends, so no vertiport can affect
+ * another within a window. A takeoff hands the aircraft to the destination through
+ * its lock-free inbox, a ConcurrentChargeQueue holding the aircraft index and the
+ * landing tick, which is drained into the destination's heap when the next window
+ * starts. Events of a tick are handled in aircraft index order no matter when they
+ * were drained, so the results don't depend on the thread count, and with a single
+ * vertiport they are the same as the event engine's. */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Aircraft.h"
+#include "ChargeQueue.h"
+#include "ChargeStation.h"
+#include "Config.h"
+#include "EventSimulation.h"
+#include "Statistics.h"
+
+#define DEFAULT_VERTIPORTS (1u)
+
+typedef struct {
+  uint64_t arrivals; // flights that landed here
+  uint64_t departures; // flights that took off from here, the takeoffs at tick 0 included
+  SimulationStatistics stats; // flights that landed, charge sessions and waits here, and the charge site
+} vertiport_summary_t;
+
+class NetworkSimulation;
+
+// One vertiport and the aircraft on the ground there, simulated by one thread at a time
+class Vertiport
+{
+public:
+  Vertiport(NetworkSimulation* network, uint32_t siteIndex, const simulation_config_t& config);
+
+  void land(uint32_t aircraftIndex, uint32_t tick); // thread safe, hands an aircraft in flight to this vertiport
+  void runWindow(uint32_t windowEndTick, uint32_t simulationTicks); // handles every event before windowEndTick, up to simulationTicks
+  void finish(uint32_t simulationTicks);
+  void countDeparture(void) {m_departures++;}
+  void summarize(vertiport_summary_t* summary) const;
+  const SimulationStatistics& getStatistics(void) const {return m_stats;}
+
+private:
+  void scheduleEvent(uint32_t tick, uint32_t aircraftIndex, sim_event_type_t type) {ScheduleSimEvent(&m_events, tick, aircraftIndex, type);}
+  void handleEvent(const sim_event_t& event);
+
+  NetworkSimulation* m_network;
+  Aircraft* m_aircrafts;
+  uint32_t m_siteIndex;
+  float m_chargeTargetSoc; // state of charge every charge session ends at
+  uint64_t m_arrivals;
+  uint64_t m_departures;
+  ChargeStation m_battChargers;
+  ChargeQueue m_aircraftInLineToCharge;
+  ConcurrentChargeQueue m_inbox; // enqueueTick is the landing tick
+  std::pmr::vector<sim_event_t> m_events; // binary heap ordered by SimEventLater, on the heap since the sites run on pool threads
+  SimulationStatistics m_stats;
+};
+
+class NetworkSimulation
+{
+public:
+  NetworkSimulation(Aircraft* aircrafts, const simulation_config_t& config);
+  void run(uint32_t simulationTicks);
+
+  // Puts an aircraft into the air from the given vertiport and hands it to its destination
+  void takeOff(uint32_t aircraftIndex, uint32_t siteIndex, uint32_t tick); // flies on the aircraft's m_stateOfCharge
+  uint32_t getDestination(uint32_t aircraftIndex, uint32_t flight, uint32_t siteIndex) const; // of the given flight of the aircraft, 1 for the first
+  Aircraft* getAircrafts(void) const {return m_aircrafts;}
+  uint32_t getNumSites(void) const {return (uint32_t) m_sites.size();}
+  uint32_t getLookaheadTicks(void) const {return m_lookaheadTicks;}
+  const Vertiport& getSite(uint32_t siteIndex) const {return *m_sites[siteIndex];}
+
+private:
+  Aircraft* m_aircrafts;
+  uint32_t m_numAircraft;
+  uint64_t m_seed;
+  uint32_t m_numThreads;
+  uint32_t m_lookaheadTicks; // shortest flight of the catalog on a charge to the target
+  std::vector<std::unique_ptr<Vertiport>> m_sites;
+};
+
+/** Runs the network on config.numVertiports vertiports. Every site's statistics are
+ * merged into stats, when not null, and kept apart in sites, when not null. */
+void RunNetworkSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats = nullptr,
+                          std::vector<vertiport_summary_t>* sites = nullptr);
+void WriteVertiportStatistics(std::ostream& out, const std::vector<vertiport_summary_t>& sites);
+void NetworkTest(void);
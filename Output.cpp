@@ -10,22 +10,15 @@
 using namespace std;
 
 enum dataSumIndicies {
-  TOTAL_FLIGHT_TIME_MIN_IDX = 0u,
+  TOTAL_FLIGHT_TIME_TICKS_IDX = 0u,
   TOTAL_NUM_FLIGHTS_IDX,
-  TOTAL_CHARGE_TIME_MIN_IDX,
+  TOTAL_CHARGE_TIME_TICKS_IDX,
   TOTAL_CHARGE_SESSIONS_IDX,
   TOTAL_NUM_FAULTS_IDX,
 
   ALL_DATA_SUMS
 };
 
-typedef struct {
-  float avgMinPerFlight; // use this to calculate and write average miles per flight to the output
-  float avgMinPerChargeSession;
-  uint32_t totalNumFaults;
-  float totalPassengerMiles;
-} data_avgs_and_totals_t;
-
 /*
   Keep track of the following statistics per vehicle type: 
   - average flight time per flight
@@ -34,37 +27,45 @@ typedef struct {
   - total number of faults
   - total number of passenger miles.
 */
-void ComputeDataAveragesAndTotals(data_avgs_and_totals_t* averagesAndTotals, Aircraft* aircrafts) {
-  // first, sum up the data
-  float dataSums[TOTAL_AIRCRAFT_COMPANIES][ALL_DATA_SUMS] = {0};
-  // in this loop, i increments through the 20 aircraft in the simulation
-  for (uint8_t i = 0; i < TOTAL_AIRCRAFTS_IN_SIMULATION; i++) {
+void ComputeDataAveragesAndTotals(data_avgs_and_totals_t* averagesAndTotals, Aircraft* aircrafts, uint32_t numAircraft,
+                                  const double* passengerMiles) {
+  // first, sum up the data. The sums are kept in integer ticks so they stay exact for any
+  // fleet size and horizon; adding minutes into a float loses precision past 2^24.
+  uint64_t dataSums[MAX_AIRCRAFT_COMPANIES][ALL_DATA_SUMS] = {{0}};
+  // in this loop, i increments through every aircraft in the simulation
+  for (uint32_t i = 0; i < numAircraft; i++) {
     // add up flight times, num flights, time charging, num charge sessions, and faults
     aircraft_id_t curId = aircrafts[i].m_id; // aircraft id Alpha, Bravo, Charlie, Delta, or Echo
-    dataSums[curId][TOTAL_FLIGHT_TIME_MIN_IDX] += ((float) aircrafts[i].m_airTimeTicks / (float) LOOP_TICKS_PER_MIN);
-    dataSums[curId][TOTAL_NUM_FLIGHTS_IDX] += (float) aircrafts[i].m_numFlights;
-    dataSums[curId][TOTAL_CHARGE_TIME_MIN_IDX] += ((float) aircrafts[i].m_chargeTimeTicks / (float) LOOP_TICKS_PER_MIN);
-    dataSums[curId][TOTAL_CHARGE_SESSIONS_IDX] += (float) aircrafts[i].m_numChargeSessions;
-    dataSums[curId][TOTAL_NUM_FAULTS_IDX] += (float) aircrafts[i].m_numFaults;
+    dataSums[curId][TOTAL_FLIGHT_TIME_TICKS_IDX] += aircrafts[i].m_airTimeTicks;
+    dataSums[curId][TOTAL_NUM_FLIGHTS_IDX] += aircrafts[i].m_numFlights;
+    dataSums[curId][TOTAL_CHARGE_TIME_TICKS_IDX] += aircrafts[i].m_chargeTimeTicks;
+    dataSums[curId][TOTAL_CHARGE_SESSIONS_IDX] += aircrafts[i].m_numChargeSessions;
+    dataSums[curId][TOTAL_NUM_FAULTS_IDX] += aircrafts[i].m_numFaults;
   }
 
   // now compute the averages/totals
-  // in this loop, i increments through the 5 aircraft companies
-  for (uint8_t i = 0; i < TOTAL_AIRCRAFT_COMPANIES; i++) {
+  // in this loop, i increments through the aircraft companies of the catalog
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
     uint32_t curVehicleTypeCruiseSpeedMph = GetCruiseSpeedMph((aircraft_id_t) i);
+    double totalFlightTimeMin = dataSums[i][TOTAL_FLIGHT_TIME_TICKS_IDX] / (double) LOOP_TICKS_PER_MIN;
+    double totalChargeTimeMin = dataSums[i][TOTAL_CHARGE_TIME_TICKS_IDX] / (double) LOOP_TICKS_PER_MIN;
 
     averagesAndTotals[i].avgMinPerFlight =
-        dataSums[i][TOTAL_FLIGHT_TIME_MIN_IDX] / dataSums[i][TOTAL_NUM_FLIGHTS_IDX];
+        totalFlightTimeMin / (double) dataSums[i][TOTAL_NUM_FLIGHTS_IDX];
 
     averagesAndTotals[i].avgMinPerChargeSession =
-        dataSums[i][TOTAL_CHARGE_TIME_MIN_IDX] / dataSums[i][TOTAL_CHARGE_SESSIONS_IDX];
-
-    averagesAndTotals[i].totalNumFaults = dataSums[i][TOTAL_NUM_FAULTS_IDX]; // this is redundant, but here to simplify the passing of arguments around
-
-    // (cruiseSpeed miles/hour * (1hour / 60min) * totalFlightTimeMin * num passengers) = passenger miles
-    averagesAndTotals[i].totalPassengerMiles =
-        ((curVehicleTypeCruiseSpeedMph * dataSums[i][TOTAL_FLIGHT_TIME_MIN_IDX]) / 60.0f) *
-        GetPassengerCount((aircraft_id_t) i);
+        totalChargeTimeMin / (double) dataSums[i][TOTAL_CHARGE_SESSIONS_IDX];
+
+    averagesAndTotals[i].totalNumFaults = (uint32_t) dataSums[i][TOTAL_NUM_FAULTS_IDX]; // this is redundant, but here to simplify the passing of arguments around
+
+    if (passengerMiles != nullptr) {
+      averagesAndTotals[i].totalPassengerMiles = passengerMiles[i]; // the seats actually filled
+    } else {
+      // (cruiseSpeed miles/hour * (1hour / 60min) * totalFlightTimeMin * num passengers) = passenger miles
+      averagesAndTotals[i].totalPassengerMiles =
+          ((curVehicleTypeCruiseSpeedMph * totalFlightTimeMin) / 60.0) *
+          GetPassengerCount((aircraft_id_t) i);
+    }
   }
 }
 
@@ -85,9 +86,9 @@ void ComputeDataAveragesAndTotals(data_avgs_and_totals_t* averagesAndTotals, Air
  * Echo - 4 flights * 51.72 min/flight * 1/60 hr/min * 30 miles/hr * 2 passengers = 206.88
  */
 void TestCalculations(void) {
-  Aircraft aircrafts[TOTAL_AIRCRAFTS_IN_SIMULATION];
-  for (uint8_t i = 0; i < TOTAL_AIRCRAFTS_IN_SIMULATION; i++) {
-    aircraft_id_t newId = (aircraft_id_t) (i % TOTAL_AIRCRAFT_COMPANIES);
+  Aircraft aircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+  for (uint8_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+    aircraft_id_t newId = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
     aircrafts[i].m_id = newId;
     aircrafts[i].m_airTimeTicks = GetFlightDurTicks(newId);
     aircrafts[i].m_numFlights = 1;
@@ -96,12 +97,12 @@ void TestCalculations(void) {
     aircrafts[i].m_numFaults = 1;
   }
 
-  data_avgs_and_totals_t averagesAndTotals[TOTAL_AIRCRAFT_COMPANIES]; // results of calculations stored in this array
-  ComputeDataAveragesAndTotals(averagesAndTotals, aircrafts);
+  data_avgs_and_totals_t averagesAndTotals[MAX_AIRCRAFT_COMPANIES]; // results of calculations stored in this array
+  ComputeDataAveragesAndTotals(averagesAndTotals, aircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION);
 
   // output to terminal
-  for (uint8_t i = 0; i < TOTAL_AIRCRAFT_COMPANIES; i++) {
-    float avgDistanceTraveled = (GetCruiseSpeedMph((aircraft_id_t) i) * averagesAndTotals[i].avgMinPerFlight) / 60.0f;
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    double avgDistanceTraveled = (GetCruiseSpeedMph((aircraft_id_t) i) * averagesAndTotals[i].avgMinPerFlight) / 60.0;
     std::cout <<
       "vehicle type: " << +i << ", " <<
       "avg flight time: " << averagesAndTotals[i].avgMinPerFlight << " min, " <<
@@ -114,36 +115,101 @@ void TestCalculations(void) {
   }
 }
 
-void WriteDataToOutputFile(Aircraft* aircrafts) {
-  // mapping of aircraft id to name
-  std::string aircraftIdToString[TOTAL_AIRCRAFT_COMPANIES] = {
-    "Alpha", "Bravo", "Charlie", "Delta", "Echo"
-  };
+void WriteDurationStatistics(std::ostream& out, const company_statistics_t& company, bool withRepairs) {
+  const char* names[4] = {"flight time", "charge session", "wait for charger", "grounded by fault"};
+  const DurationStatistic* durations[4] = {&company.flights, &company.chargeSessions, &company.waits, &company.repairs};
+  for (uint8_t d = 0; d < (withRepairs ? 4 : 3); d++) {
+    out << fixed << setprecision(2) <<
+      "  " << left << setw(26) << names[d] << right <<
+      "mean " << durations[d]->getMinutes().getMean() << " min, " <<
+      "p50 " << durations[d]->getPercentileMin(50.0) << " min, " <<
+      "p99 " << durations[d]->getPercentileMin(99.0) << " min, " <<
+      "n = " << durations[d]->getMinutes().getCount() << "\n";
+  }
+}
 
-  data_avgs_and_totals_t averagesAndTotals[TOTAL_AIRCRAFT_COMPANIES]; // results of calculations stored in this array
-  ComputeDataAveragesAndTotals(averagesAndTotals, aircrafts);
+void WriteChargeSiteStatistics(std::ostream& out, const SimulationStatistics& stats) {
+  const charge_site_statistics_t& site = stats.getChargeSite();
+  DurationStatistic allWaits;
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    allWaits.merge(stats.getCompany((aircraft_id_t) i).waits);
+  }
+  out << fixed << setprecision(2) <<
+    "Charge site - charger utilization: " << (100.0 * stats.getChargerUtilization()) << " %\n" <<
+    "  " << left << setw(26) << "aircraft in line" << right <<
+    "mean " << site.queueLength.getMean() << ", " <<
+    "p50 " << site.queueLength.getPercentile(50.0) << ", " <<
+    "p99 " << site.queueLength.getPercentile(99.0) << ", " <<
+    "max " << site.queueLength.getMax() << "\n" <<
+    "  " << left << setw(26) << "wait for charger" << right <<
+    "mean " << allWaits.getMinutes().getMean() << " min, " <<
+    "p50 " << allWaits.getPercentileMin(50.0) << " min, " <<
+    "p99 " << allWaits.getPercentileMin(99.0) << " min, " <<
+    "n = " << allWaits.getMinutes().getCount() << "\n" <<
+    "----------------------------------------------------------------------------------------\n";
+}
+
+void WriteRepairSiteStatistics(std::ostream& out, const SimulationStatistics& stats) {
+  const charge_site_statistics_t& site = stats.getRepairSite();
+  DurationStatistic allRepairs;
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    allRepairs.merge(stats.getCompany((aircraft_id_t) i).repairs);
+  }
+  out << fixed << setprecision(2) <<
+    "Repair bays - bay utilization: " << (100.0 * stats.getRepairBayUtilization()) << " %\n" <<
+    "  " << left << setw(26) << "aircraft in line" << right <<
+    "mean " << site.queueLength.getMean() << ", " <<
+    "p50 " << site.queueLength.getPercentile(50.0) << ", " <<
+    "p99 " << site.queueLength.getPercentile(99.0) << ", " <<
+    "max " << site.queueLength.getMax() << "\n" <<
+    "  " << left << setw(26) << "grounded by fault" << right <<
+    "mean " << allRepairs.getMinutes().getMean() << " min, " <<
+    "p50 " << allRepairs.getPercentileMin(50.0) << " min, " <<
+    "p99 " << allRepairs.getPercentileMin(99.0) << " min, " <<
+    "n = " << allRepairs.getMinutes().getCount() << "\n" <<
+    "----------------------------------------------------------------------------------------\n";
+}
 
+void WriteDataToOutputFile(Aircraft* aircrafts, uint32_t numAircraft, const std::string& outputPath, const SimulationStatistics* stats,
+                           const double* passengerMiles) {
   ofstream myfile;
-  myfile.open ("SimulationOutput.txt");
+  myfile.open (outputPath);
+  WriteResults(myfile, aircrafts, numAircraft, stats, passengerMiles);
+  myfile.close();
+}
 
-  for (uint8_t i = 0; i < TOTAL_AIRCRAFT_COMPANIES; i++) {
-    float avgDistanceTraveled = (GetCruiseSpeedMph((aircraft_id_t) i) * averagesAndTotals[i].avgMinPerFlight) / 60.0f;
-    myfile << fixed << setprecision(2) <<
-      aircraftIdToString[i] << " - "  <<
+void WriteResults(std::ostream& out, Aircraft* aircrafts, uint32_t numAircraft, const SimulationStatistics* stats,
+                  const double* passengerMiles) {
+  data_avgs_and_totals_t averagesAndTotals[MAX_AIRCRAFT_COMPANIES]; // results of calculations stored in this array
+  ComputeDataAveragesAndTotals(averagesAndTotals, aircrafts, numAircraft, passengerMiles);
+
+  bool withRepairs = (stats != nullptr) && (stats->getRepairSite().chargerTicks > 0);
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    double avgDistanceTraveled = (GetCruiseSpeedMph((aircraft_id_t) i) * averagesAndTotals[i].avgMinPerFlight) / 60.0;
+    out << fixed << setprecision(2) <<
+      GetCompanyName((aircraft_id_t) i) << " - "  <<
       "avg flight time: " << averagesAndTotals[i].avgMinPerFlight << " min, " <<
       "avg distance traveled: " << avgDistanceTraveled << " miles,\n" <<
       "avg time charging: " << averagesAndTotals[i].avgMinPerChargeSession << " min, " <<
       "total num faults: " << averagesAndTotals[i].totalNumFaults << ", " <<
-      "total passenger miles: " << averagesAndTotals[i].totalPassengerMiles << " miles" <<
-      "\n----------------------------------------------------------------------------------------\n";
+      "total passenger miles: " << averagesAndTotals[i].totalPassengerMiles << " miles\n";
+    if (stats != nullptr) {
+      // completed legs only, a flight or charge still in progress at the end of the run isn't counted here
+      WriteDurationStatistics(out, stats->getCompany((aircraft_id_t) i), withRepairs);
+    }
+    out << "----------------------------------------------------------------------------------------\n";
+  }
+  if (stats != nullptr) {
+    WriteChargeSiteStatistics(out, *stats);
+  }
+  if (withRepairs) {
+    WriteRepairSiteStatistics(out, *stats);
   }
-
-  myfile.close();
 }
 
-void WriteRandomIdErrorToOutputFile(void) {
+void WriteRandomIdErrorToOutputFile(const std::string& outputPath) {
   ofstream myfile;
-  myfile.open ("SimulationOutput.txt");
+  myfile.open (outputPath);
   myfile << "ERROR - all aircraft IDs were not generated. Run simulation again.\n";
   myfile.flush();
   myfile.close();
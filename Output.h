@@ -2,8 +2,29 @@
 
 #pragma once
 
+#include <ostream>
+#include <string>
+
 #include "Aircraft.h"
+#include "Statistics.h"
+
+typedef struct {
+  double avgMinPerFlight; // use this to calculate and write average miles per flight to the output
+  double avgMinPerChargeSession;
+  uint32_t totalNumFaults;
+  double totalPassengerMiles;
+} data_avgs_and_totals_t;
 
+/** passengerMiles, when not null, holds the passenger miles of each company to report instead
+ * of the full-cabin figure worked out from the air time, e.g. the trips of the demand model. */
+void ComputeDataAveragesAndTotals(data_avgs_and_totals_t* averagesAndTotals, Aircraft* aircrafts, uint32_t numAircraft,
+                                  const double* passengerMiles = nullptr);
 void TestCalculations(void);
-void WriteDataToOutputFile(Aircraft* aircrafts);
-void WriteRandomIdErrorToOutputFile(void);
\ No newline at end of file
+void WriteDurationStatistics(std::ostream& out, const company_statistics_t& company, bool withRepairs = false); // mean, p50 and p99 of each duration
+void WriteChargeSiteStatistics(std::ostream& out, const SimulationStatistics& stats); // queue length, all waits and charger utilization
+void WriteRepairSiteStatistics(std::ostream& out, const SimulationStatistics& stats); // repair line length, all repairs and bay utilization
+void WriteDataToOutputFile(Aircraft* aircrafts, uint32_t numAircraft, const std::string& outputPath, const SimulationStatistics* stats = nullptr,
+                           const double* passengerMiles = nullptr);
+void WriteResults(std::ostream& out, Aircraft* aircrafts, uint32_t numAircraft, const SimulationStatistics* stats = nullptr,
+                  const double* passengerMiles = nullptr); // what WriteDataToOutputFile() writes
+void WriteRandomIdErrorToOutputFile(const std::string& outputPath);
@@ -1,55 +1,357 @@
-#include <ctime>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 #include <random>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PHILOX_SSE2
+#endif
 
 #include "RandomGen.h"
 
 #include "AircraftCompanyCommon.h"
-#include "Output.h"
+#include "Trace.h"
+
+#define PHILOX_M0 (0xD2511F53u)
+#define PHILOX_M1 (0xCD9E8D57u)
+#define PHILOX_W0 (0x9E3779B9u) // golden ratio
+#define PHILOX_W1 (0xBB67AE85u) // sqrt(3) - 1
+#define PHILOX_ROUNDS (10u)
+
+#define FAULT_DRAW_CHUNK (256u) // draws buffered on the stack per batched pass
+
+philox_block_t Philox4x32(const philox_block_t& counter, uint64_t key) {
+    uint32_t c0 = counter.v[0], c1 = counter.v[1], c2 = counter.v[2], c3 = counter.v[3];
+    uint32_t k0 = (uint32_t) key, k1 = (uint32_t) (key >> 32);
+    for (uint32_t round = 0; round < PHILOX_ROUNDS; round++) {
+        uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+        uint32_t next0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        uint32_t next2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t) p1;
+        c3 = (uint32_t) p0;
+        c0 = next0;
+        c2 = next2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    philox_block_t result = {{c0, c1, c2, c3}};
+    return result;
+}
+
+RandomStream::RandomStream(uint64_t seed, random_purpose_t purpose, uint32_t streamIndex) {
+    m_seed = seed;
+    m_purpose = purpose;
+    m_streamIndex = streamIndex;
+    m_position = 0;
+}
+
+uint32_t RandomStream::nextU32(void) {
+    uint64_t block = m_position / 4u;
+    philox_block_t counter = {{m_streamIndex, m_purpose, (uint32_t) block, (uint32_t) (block >> 32)}};
+    uint32_t value = Philox4x32(counter, m_seed).v[m_position % 4u];
+    m_position++;
+    return value;
+}
+
+uint32_t RandomStream::nextBelow(uint32_t bound) {
+    // multiply-shift maps a 32 bit draw onto [0, bound) without the skew of rand() % bound
+    return (uint32_t) (((uint64_t) nextU32() * bound) >> 32);
+}
+
+double RandomStream::nextUniform(void) {
+    return nextU32() * (1.0 / 4294967296.0);
+}
+
+uint64_t NewRandomSeed(void) {
+    std::random_device rd;
+    return ((uint64_t) rd() << 32) | rd();
+}
+
+uint64_t DeriveSeed(uint64_t masterSeed, uint32_t index, uint32_t attempt) {
+    philox_block_t counter = {{index, RANDOM_PURPOSE_REPLICATION_SEEDS, attempt, 0}};
+    philox_block_t block = Philox4x32(counter, masterSeed);
+    return ((uint64_t) block.v[1] << 32) | block.v[0];
+}
 
-void CreateRandomAircraftIds(Aircraft* aircrafts) {
-    // Use current time as seed for random generator
-    srand(time(0));
+bool CreateRandomAircraftIds(Aircraft* aircrafts, uint32_t numAircraft, uint64_t seed, const uint32_t* companyWeights) {
+    RandomStream stream(seed, RANDOM_PURPOSE_AIRCRAFT_IDS, 0);
 
-    bool verifyAllIdsGenerated[TOTAL_AIRCRAFT_COMPANIES] = {false};
-    for (uint8_t i = 0; i < TOTAL_AIRCRAFTS_IN_SIMULATION; i++) {
-        aircraft_id_t randomId = (aircraft_id_t) (rand() % 5);
+    uint32_t numCompanies = GetNumCompanies();
+    uint32_t totalWeight = numCompanies;
+    bool equalWeights = true;
+    if (companyWeights != nullptr) {
+        totalWeight = 0;
+        for (uint32_t i = 0; i < numCompanies; i++) {
+            totalWeight += companyWeights[i];
+            equalWeights = equalWeights && (companyWeights[i] == companyWeights[0]);
+        }
+    }
+
+    bool verifyAllIdsGenerated[MAX_AIRCRAFT_COMPANIES] = {false};
+    for (uint32_t i = 0; i < numAircraft; i++) {
+        aircraft_id_t randomId;
+        if (equalWeights) {
+            randomId = (aircraft_id_t) stream.nextBelow(numCompanies);
+        } else {
+            // the company whose share of [0, totalWeight) the draw falls in
+            uint32_t draw = stream.nextBelow(totalWeight);
+            uint32_t company = 0;
+            while (draw >= companyWeights[company]) {
+                draw -= companyWeights[company];
+                company++;
+            }
+            randomId = (aircraft_id_t) company;
+        }
         aircrafts[i].m_id = randomId;
         verifyAllIdsGenerated[randomId] = true;
     }
 
     /** Verify at least one of each aircraft company exists in the array. If this
-     * test fails, simply exit and rerun simulation. If this fails frequently, we
-     * can come up with a method to populate the array with the missing ID(s). */
-    for (uint8_t i = 0; i < TOTAL_AIRCRAFT_COMPANIES; i++) {
+     * test fails, the caller decides whether to stop or to draw again with a
+     * different seed. */
+    for (uint32_t i = 0; i < numCompanies; i++) {
         if (verifyAllIdsGenerated[i] == false) {
-            std::cout << "ERROR - all aircraft IDs were not generated." << std::endl;
-            std::cout.flush();
+            return false;
+        }
+    }
+    return true;
+}
+
+// A fault occurs when the 32 bit draw falls below the hourly probability scaled to 2^32
+static uint32_t FaultThreshold(aircraft_id_t id) {
+    double threshold = GetFaultProbabilityPerHour(id) * 4294967296.0;
+    return (threshold >= 4294967295.0) ? UINT32_MAX : (uint32_t) threshold; // a certain fault misses 1 draw in 2^32
+}
 
-            WriteRandomIdErrorToOutputFile();
+/** The fault draw of an aircraft for a given hour is the first word of block "hour"
+ * of the aircraft's fault stream, i.e. the same value RandomStream would return at
+ * position 4 * hour. */
+bool DrawHourlyFault(aircraft_id_t id, uint32_t aircraftIndex, uint32_t hour, uint64_t seed) {
+    philox_block_t counter = {{aircraftIndex, RANDOM_PURPOSE_HOURLY_FAULTS, hour, 0}};
+    return Philox4x32(counter, seed).v[0] < FaultThreshold(id);
+}
+
+void HourlyFaultGenerationPercentChance(Aircraft* plane, uint32_t aircraftIndex, uint32_t hour, uint64_t seed) {
+    if (DrawHourlyFault(plane->m_id, aircraftIndex, hour, seed)) {
+        plane->m_numFaults++;
+    }
+}
 
-            exit(EXIT_FAILURE);
+// Uniform in (0, 1) with 53 bits from two 32 bit words, never 0 so its log is finite
+static double OpenUniform(uint32_t high, uint32_t low) {
+    return (((((uint64_t) (high & 0x1fffffu)) << 32) | low) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/** A rate of -ln(1 - p) faults per flight hour gives at least one fault in an hour of
+ * flight with probability p, the same chance as the hourly draw. */
+uint32_t DrawFlightFaultTicks(aircraft_id_t id, uint32_t aircraftIndex, uint32_t flight, uint64_t seed) {
+    double probability = GetFaultProbabilityPerHour(id);
+    if (probability <= 0.0) {
+        return UINT32_MAX;
+    }
+    if (probability >= 1.0) {
+        return 1u;
+    }
+    philox_block_t counter = {{aircraftIndex, RANDOM_PURPOSE_FLIGHT_FAULTS, flight, 0}};
+    philox_block_t block = Philox4x32(counter, seed);
+    double hours = -std::log(OpenUniform(block.v[0], block.v[1])) / -std::log1p(-probability);
+    double ticks = std::ceil(hours * LOOP_TICKS_PER_HOUR);
+    return (ticks >= (double) UINT32_MAX) ? UINT32_MAX : std::max((uint32_t) ticks, 1u);
+}
+
+// Log-normal factor with a mean of 1 and a coefficient of variation of 1/2, from one Box-Muller normal draw
+static double LogNormalFactor(const philox_block_t& block) {
+    constexpr double pi = 3.14159265358979323846; // M_PI isn't standard C++, MSVC leaves it out
+    const double sigmaSquared = std::log(1.25);
+    double normal = std::sqrt(-2.0 * std::log(OpenUniform(block.v[0], block.v[1]))) *
+                    std::cos(2.0 * pi * OpenUniform(block.v[2], block.v[3]));
+    return std::exp((std::sqrt(sigmaSquared) * normal) - (sigmaSquared / 2.0));
+}
+
+uint32_t DrawRepairTicks(uint32_t aircraftIndex, uint32_t fault, uint32_t meanTicks, uint64_t seed) {
+    philox_block_t counter = {{aircraftIndex, RANDOM_PURPOSE_REPAIR_TIMES, fault, 0}};
+    double ticks = std::round(meanTicks * LogNormalFactor(Philox4x32(counter, seed)));
+    return (ticks >= (double) UINT32_MAX) ? UINT32_MAX : std::max((uint32_t) ticks, 1u);
+}
+
+void DrawTripRequest(uint64_t request, double meanGapTicks, double meanMiles, uint32_t maxPassengers, uint64_t seed,
+                     double* gapTicks, double* miles, uint32_t* passengers) {
+    philox_block_t counter = {{(uint32_t) request, RANDOM_PURPOSE_TRIP_REQUESTS, (uint32_t) (request >> 32), 0}};
+    *miles = meanMiles * LogNormalFactor(Philox4x32(counter, seed));
+    counter.v[3] = 1;
+    philox_block_t block = Philox4x32(counter, seed);
+    *gapTicks = -std::log(OpenUniform(block.v[0], block.v[1])) * meanGapTicks;
+    *passengers = 1u + (uint32_t) (((uint64_t) block.v[2] * maxPassengers) >> 32);
+}
+
+#ifdef PHILOX_SSE2
+// 32x32 -> 64 bit multiply of all four lanes by the same constant, split into high and low words
+static inline void MulHiLo4(__m128i a, __m128i m, __m128i* hi, __m128i* lo) {
+    __m128i p02 = _mm_mul_epu32(a, m); // words: lo0 hi0 lo2 hi2
+    __m128i p13 = _mm_mul_epu32(_mm_srli_epi64(a, 32), m); // words: lo1 hi1 lo3 hi3
+    __m128i a02 = _mm_shuffle_epi32(p02, _MM_SHUFFLE(3, 1, 2, 0)); // lo0 lo2 hi0 hi2
+    __m128i a13 = _mm_shuffle_epi32(p13, _MM_SHUFFLE(3, 1, 2, 0)); // lo1 lo3 hi1 hi3
+    *lo = _mm_unpacklo_epi32(a02, a13);
+    *hi = _mm_unpackhi_epi32(a02, a13);
+}
+#endif
+
+/** Fills draws[] with the fault draws of aircraft firstIndex .. firstIndex + count - 1.
+ * With SSE2, four Philox instances run side by side, one aircraft per lane. */
+static void HourlyFaultDraws(uint32_t firstIndex, uint32_t count, uint32_t hour, uint64_t seed, uint32_t* draws) {
+    uint32_t n = 0;
+#ifdef PHILOX_SSE2
+    const __m128i m0 = _mm_set1_epi32((int) PHILOX_M0);
+    const __m128i m1 = _mm_set1_epi32((int) PHILOX_M1);
+    for (; (n + 4) <= count; n += 4) {
+        uint32_t index = firstIndex + n;
+        __m128i c0 = _mm_setr_epi32((int) index, (int) (index + 1), (int) (index + 2), (int) (index + 3));
+        __m128i c1 = _mm_set1_epi32(RANDOM_PURPOSE_HOURLY_FAULTS);
+        __m128i c2 = _mm_set1_epi32((int) hour);
+        __m128i c3 = _mm_setzero_si128();
+        uint32_t k0 = (uint32_t) seed, k1 = (uint32_t) (seed >> 32);
+        for (uint32_t round = 0; round < PHILOX_ROUNDS; round++) {
+            __m128i hi0, lo0, hi1, lo1;
+            MulHiLo4(c0, m0, &hi0, &lo0);
+            MulHiLo4(c2, m1, &hi1, &lo1);
+            c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32((int) k0));
+            c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32((int) k1));
+            c1 = lo1;
+            c3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
         }
+        _mm_storeu_si128((__m128i*) &draws[n], c0);
+    }
+#endif
+    for (; n < count; n++) {
+        philox_block_t counter = {{firstIndex + n, RANDOM_PURPOSE_HOURLY_FAULTS, hour, 0}};
+        draws[n] = Philox4x32(counter, seed).v[0];
     }
 }
 
-void HourlyFaultGenerationPercentChance(Aircraft* plane) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::bernoulli_distribution d(GetFaultProbabilityPerHour(plane->m_id));
-    if (d(gen)) {
-        plane->m_numFaults++;
+/** The fault draw of both fleet layouts: companyOf(i) is the company of aircraft i and
+ * faultsOf(i) a reference to its fault count, so the AoS and SoA overloads below only
+ * differ in where those live. */
+template <typename CompanyOf, typename FaultsOf>
+static void DrawHourlyFaults(uint32_t numAircraft, uint32_t hour, uint64_t seed, CompanyOf companyOf, FaultsOf faultsOf) {
+    uint32_t thresholds[MAX_AIRCRAFT_COMPANIES];
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+        thresholds[i] = FaultThreshold((aircraft_id_t) i);
     }
+
+    uint32_t draws[FAULT_DRAW_CHUNK];
+    for (uint32_t first = 0; first < numAircraft; first += FAULT_DRAW_CHUNK) {
+        uint32_t count = ((numAircraft - first) < FAULT_DRAW_CHUNK) ? (numAircraft - first) : FAULT_DRAW_CHUNK;
+        HourlyFaultDraws(first, count, hour, seed, draws);
+        for (uint32_t n = 0; n < count; n++) {
+            uint32_t fault = (draws[n] < thresholds[companyOf(first + n)]);
+            uint32_t& numFaults = faultsOf(first + n);
+            numFaults += fault;
+            if constexpr (TRACE_ENABLED) {
+                if (fault != 0) {
+                    TraceFault(first + n, hour * LOOP_TICKS_PER_HOUR, numFaults);
+                }
+            }
+        }
+    }
+}
+
+void GenerateHourlyFaults(Aircraft* aircrafts, uint32_t numAircraft, uint32_t hour, uint64_t seed) {
+    DrawHourlyFaults(numAircraft, hour, seed,
+                     [aircrafts](uint32_t i) {return (uint32_t) aircrafts[i].m_id;},
+                     [aircrafts](uint32_t i) -> uint32_t& {return aircrafts[i].m_numFaults;});
+}
+
+void GenerateHourlyFaults(const uint32_t* ids, uint32_t* numFaults, uint32_t numAircraft, uint32_t hour, uint64_t seed) {
+    DrawHourlyFaults(numAircraft, hour, seed,
+                     [ids](uint32_t i) {return ids[i];},
+                     [numFaults](uint32_t i) -> uint32_t& {return numFaults[i];});
 }
 
 void FaultTest(void) {
     /** The alpha aircraft company has a 25% chance of a fault occurring.
      * Run this aircraft through the HourlyFaultGenerationPercentChance function
      * 1000 times. The number of faults should be about 250.
-     * 
+     *
      * This test is passing. */
     Aircraft plane(AIRCRAFT_ID_ALPHA);
-    for (int i = 0; i < 1000; i++) {
-        HourlyFaultGenerationPercentChance(&plane);
+    uint64_t seed = NewRandomSeed();
+    for (uint32_t hour = 0; hour < 1000; hour++) {
+        HourlyFaultGenerationPercentChance(&plane, 0, hour, seed);
     }
     std::cout << "Fault test should produce around 250 faults. Result: " << plane.m_numFaults << std::endl;
-}
\ No newline at end of file
+}
+
+/** Function to test the random number engine. Philox4x32-10 must match the published
+ * known-answer vectors, the batched fleet fault pass must match one draw at a time, and
+ * the same seed must reproduce the same aircraft IDs. */
+void RandomGenTest(void) {
+    bool pass = true;
+
+    philox_block_t zeros = {{0, 0, 0, 0}};
+    philox_block_t expectedZeros = {{0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}};
+    philox_block_t ones = {{0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu}};
+    philox_block_t expectedOnes = {{0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}};
+    philox_block_t resultZeros = Philox4x32(zeros, 0);
+    philox_block_t resultOnes = Philox4x32(ones, 0xffffffffffffffffull);
+    for (uint32_t i = 0; i < 4; i++) {
+        pass = pass && (resultZeros.v[i] == expectedZeros.v[i]) && (resultOnes.v[i] == expectedOnes.v[i]);
+    }
+    std::cout << "Philox known-answer test: " << (pass ? "PASS" : "FAIL") << std::endl;
+
+    const uint32_t numAircraft = 1003; // not a multiple of the lane count, to cover the scalar tail
+    const uint64_t seed = 0x0123456789abcdefull;
+    Aircraft batched[numAircraft];
+    Aircraft single[numAircraft];
+    for (uint32_t i = 0; i < numAircraft; i++) {
+        batched[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+        single[i].m_id = batched[i].m_id;
+    }
+    for (uint32_t hour = 1; hour <= 24; hour++) {
+        GenerateHourlyFaults(batched, numAircraft, hour, seed);
+        for (uint32_t i = 0; i < numAircraft; i++) {
+            HourlyFaultGenerationPercentChance(&single[i], i, hour, seed);
+        }
+    }
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < numAircraft; i++) {
+        mismatches += (batched[i].m_numFaults != single[i].m_numFaults);
+    }
+    std::cout << "Batched fault draw test: " << ((mismatches == 0) ? "PASS" : "FAIL") << std::endl;
+
+    Aircraft first[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+    Aircraft second[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+    CreateRandomAircraftIds(first, DEFAULT_AIRCRAFTS_IN_SIMULATION, 1);
+    CreateRandomAircraftIds(second, DEFAULT_AIRCRAFTS_IN_SIMULATION, 1);
+    mismatches = 0;
+    for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+        mismatches += (first[i].m_id != second[i].m_id);
+    }
+    std::cout << "Seeded aircraft ID test: " << ((mismatches == 0) ? "PASS" : "FAIL") << std::endl;
+
+    // equal weights draw the fleet as without, and a company weighted up takes its share
+    uint32_t weights[MAX_AIRCRAFT_COMPANIES];
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+        weights[i] = 3;
+    }
+    CreateRandomAircraftIds(second, DEFAULT_AIRCRAFTS_IN_SIMULATION, 1, weights);
+    mismatches = 0;
+    for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+        mismatches += (first[i].m_id != second[i].m_id);
+    }
+    const uint32_t numWeighted = 10000;
+    std::vector<Aircraft> weighted(numWeighted);
+    weights[0] = 3 * (GetNumCompanies() - 1); // half the fleet
+    bool allCompanies = CreateRandomAircraftIds(weighted.data(), numWeighted, 1, weights);
+    uint32_t numFirstCompany = 0;
+    for (const Aircraft& aircraft : weighted) {
+        numFirstCompany += (aircraft.m_id == 0);
+    }
+    bool weightPass = (mismatches == 0) && allCompanies && (numFirstCompany > 4800) && (numFirstCompany < 5200);
+    std::cout << "Weighted aircraft ID test: " << (weightPass ? "PASS" : "FAIL") << " (" << numFirstCompany << " of " <<
+        numWeighted << " from the company weighted to half)" << std::endl;
+}
@@ -1,9 +1,83 @@
-// Defines any function that generates random numbers to be used in the simulation
+/** Defines any function that generates random numbers to be used in the simulation.
+ *
+ * All random numbers come from the counter-based Philox4x32-10 generator. A draw is a
+ * pure function of (seed, purpose, stream index, position), so there is no generator
+ * state to construct, seed or share. Each aircraft gets its own independent stream per
+ * purpose, a whole run is reproducible from the single --seed value, and the engines
+ * can draw in any order and still get identical results. */
 
 #pragma once
 
+#include <cstdint>
+
 #include "Aircraft.h"
 
-void CreateRandomAircraftIds(Aircraft* aircrafts); // takes array of aircrafts as parameter
-void HourlyFaultGenerationPercentChance(Aircraft* plane); // takes one single plane as parameter
-void FaultTest(void);
\ No newline at end of file
+typedef enum {
+  RANDOM_PURPOSE_AIRCRAFT_IDS = 0u,
+  RANDOM_PURPOSE_HOURLY_FAULTS,
+  RANDOM_PURPOSE_REPLICATION_SEEDS,
+  RANDOM_PURPOSE_ROUTES, // destination of every flight in the vertiport network, see Network.h
+  RANDOM_PURPOSE_FLIGHT_FAULTS, // time from takeoff to the next fault, when faults ground aircraft, see Maintenance.h
+  RANDOM_PURPOSE_REPAIR_TIMES,
+  RANDOM_PURPOSE_TRIP_REQUESTS, // arrival, length and party size of every trip request, see Demand.h
+} random_purpose_t;
+
+typedef struct {
+  uint32_t v[4];
+} philox_block_t;
+
+// One Philox4x32-10 block for the given 128 bit counter and 64 bit key
+philox_block_t Philox4x32(const philox_block_t& counter, uint64_t key);
+
+/** A sequential stream of 32 bit random numbers. The stream is identified by the seed,
+ * the purpose and a stream index (the aircraft index for per-aircraft streams), and
+ * its position is a plain counter that can be saved and restored. */
+class RandomStream
+{
+public:
+  RandomStream(uint64_t seed, random_purpose_t purpose, uint32_t streamIndex);
+  uint32_t nextU32(void);
+  uint32_t nextBelow(uint32_t bound); // uniform in [0, bound)
+  double nextUniform(void); // uniform in [0, 1)
+  uint64_t getPosition(void) const {return m_position;}
+  void setPosition(uint64_t position) {m_position = position;}
+
+private:
+  uint64_t m_seed;
+  uint32_t m_purpose;
+  uint32_t m_streamIndex;
+  uint64_t m_position; // number of 32 bit values drawn so far
+};
+
+uint64_t NewRandomSeed(void); // nondeterministic seed for runs started without --seed
+uint64_t DeriveSeed(uint64_t masterSeed, uint32_t index, uint32_t attempt); // independent seed per replication
+/** Draws every aircraft's company from the seed, each company as likely as any other, or
+ * in proportion to companyWeights, one weight per company of the catalog, when given.
+ * Weights that are all equal draw the same fleet as none. Returns false if a company is
+ * missing. */
+bool CreateRandomAircraftIds(Aircraft* aircrafts, uint32_t numAircraft, uint64_t seed, const uint32_t* companyWeights = nullptr);
+bool DrawHourlyFault(aircraft_id_t id, uint32_t aircraftIndex, uint32_t hour, uint64_t seed); // returns true if a fault occurred this hour
+void HourlyFaultGenerationPercentChance(Aircraft* plane, uint32_t aircraftIndex, uint32_t hour, uint64_t seed); // takes one single plane as parameter
+
+/** Faults as a Poisson process in flight time: the ticks from the takeoff of the given
+ * flight, 1 for the first, to its first fault are exponentially distributed, with the
+ * rate that gives the company's fault probability per hour. UINT32_MAX if it never faults. */
+uint32_t DrawFlightFaultTicks(aircraft_id_t id, uint32_t aircraftIndex, uint32_t flight, uint64_t seed);
+// Log-normal repair time of the given fault, 1 for the first, with the given mean and half of it as the standard deviation
+uint32_t DrawRepairTicks(uint32_t aircraftIndex, uint32_t fault, uint32_t meanTicks, uint64_t seed);
+
+/** The given trip request of the demand model, 0 for the first, from one fleet-wide
+ * stream: the ticks since the previous request, exponential with the given mean, the
+ * trip length, log-normal with the given mean and half of it as the standard deviation,
+ * and the party size, uniform from 1 to maxPassengers. */
+void DrawTripRequest(uint64_t request, double meanGapTicks, double meanMiles, uint32_t maxPassengers, uint64_t seed,
+                     double* gapTicks, double* miles, uint32_t* passengers);
+
+/** Draws the fault for the given hour for every aircraft of the fleet in one batched
+ * pass, four aircraft per Philox evaluation where SSE2 is available. Same results as
+ * calling DrawHourlyFault() for each aircraft. */
+void GenerateHourlyFaults(Aircraft* aircrafts, uint32_t numAircraft, uint32_t hour, uint64_t seed);
+void GenerateHourlyFaults(const uint32_t* ids, uint32_t* numFaults, uint32_t numAircraft, uint32_t hour, uint64_t seed);
+
+void FaultTest(void);
+void RandomGenTest(void);
@@ -0,0 +1,608 @@
+/** Layout of a columnar result file, every integer in the byte order of the machine:
+ *  header   "EVTOLRES", u32 version, u32 company count, then each company name
+ *  schema   u32 table count, then per table the file holds its name, u32 column count,
+ *           and per column u32 result_column_type_t and the column name
+ *  chunks   until the end of the file: u32 table, u64 row count, then per column the
+ *           values of every row, 8 bytes each
+ * A string is a u32 byte count followed by the bytes, without a terminator. A table
+ * is the concatenation of its chunks in file order. */
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "ResultWriter.h"
+
+#include "AircraftCompanyCommon.h"
+#include "Output.h"
+
+static const result_column_t replicationColumns[] = {
+  {"replication", RESULT_COLUMN_U64}, {"seed", RESULT_COLUMN_U64}, {"fleet_redraws", RESULT_COLUMN_U64},
+  {"aircraft", RESULT_COLUMN_U64}, {"flights", RESULT_COLUMN_U64}, {"charge_sessions", RESULT_COLUMN_U64},
+  {"faults", RESULT_COLUMN_U64}, {"passenger_miles", RESULT_COLUMN_F64}, {"trip_requests", RESULT_COLUMN_U64},
+  {"trips_served", RESULT_COLUMN_U64}, {"trips_unserved", RESULT_COLUMN_U64}, {"seat_miles", RESULT_COLUMN_F64}
+};
+
+static const result_column_t companyColumns[] = {
+  {"replication", RESULT_COLUMN_U64}, {"company", RESULT_COLUMN_COMPANY}, {"aircraft", RESULT_COLUMN_U64},
+  {"flights", RESULT_COLUMN_U64}, {"flight_min", RESULT_COLUMN_F64}, {"avg_flight_min", RESULT_COLUMN_F64},
+  {"charge_sessions", RESULT_COLUMN_U64}, {"charge_min", RESULT_COLUMN_F64}, {"avg_charge_min", RESULT_COLUMN_F64},
+  {"faults", RESULT_COLUMN_U64}, {"passenger_miles", RESULT_COLUMN_F64}
+};
+
+static const result_column_t aircraftColumns[] = {
+  {"replication", RESULT_COLUMN_U64}, {"aircraft", RESULT_COLUMN_U64}, {"company", RESULT_COLUMN_COMPANY},
+  {"flights", RESULT_COLUMN_U64}, {"flight_min", RESULT_COLUMN_F64}, {"charge_sessions", RESULT_COLUMN_U64},
+  {"charge_min", RESULT_COLUMN_F64}, {"faults", RESULT_COLUMN_U64}, {"state", RESULT_COLUMN_U64},
+  {"leg_left_min", RESULT_COLUMN_F64}
+};
+
+static const result_column_t sweepColumns[] = {
+  {"aircraft", RESULT_COLUMN_U64}, {"mix", RESULT_COLUMN_U64}, {"chargers", RESULT_COLUMN_U64}, {"hours", RESULT_COLUMN_F64},
+  {"seed", RESULT_COLUMN_U64}, {"flights", RESULT_COLUMN_U64}, {"flight_hr", RESULT_COLUMN_F64},
+  {"charge_sessions", RESULT_COLUMN_U64}, {"charge_hr", RESULT_COLUMN_F64}, {"faults", RESULT_COLUMN_U64},
+  {"passenger_miles", RESULT_COLUMN_F64}, {"waits", RESULT_COLUMN_U64}, {"mean_wait_min", RESULT_COLUMN_F64},
+  {"p99_wait_min", RESULT_COLUMN_F64}, {"mean_queue", RESULT_COLUMN_F64}, {"charger_utilization", RESULT_COLUMN_F64}
+};
+
+static const char* const resultTableNames[TOTAL_RESULT_TABLES] = {
+  "replications", "companies", "aircraft", "sweep"
+};
+
+// What a run or a batch writes
+static const result_table_t runResultTables[] = {RESULT_TABLE_REPLICATIONS, RESULT_TABLE_COMPANIES, RESULT_TABLE_AIRCRAFT};
+
+const char* GetResultTableName(result_table_t table) {
+  return resultTableNames[table];
+}
+
+uint32_t GetResultColumnCount(result_table_t table) {
+  switch (table) {
+    case RESULT_TABLE_REPLICATIONS:
+      return sizeof(replicationColumns) / sizeof(replicationColumns[0]);
+    case RESULT_TABLE_COMPANIES:
+      return sizeof(companyColumns) / sizeof(companyColumns[0]);
+    case RESULT_TABLE_SWEEP:
+      return sizeof(sweepColumns) / sizeof(sweepColumns[0]);
+    case RESULT_TABLE_AIRCRAFT:
+    default:
+      return sizeof(aircraftColumns) / sizeof(aircraftColumns[0]);
+  }
+}
+
+const result_column_t* GetResultColumns(result_table_t table) {
+  switch (table) {
+    case RESULT_TABLE_REPLICATIONS:
+      return replicationColumns;
+    case RESULT_TABLE_COMPANIES:
+      return companyColumns;
+    case RESULT_TABLE_SWEEP:
+      return sweepColumns;
+    case RESULT_TABLE_AIRCRAFT:
+    default:
+      return aircraftColumns;
+  }
+}
+
+static result_value_t U64Value(uint64_t value) {
+  result_value_t result;
+  result.u64 = value;
+  return result;
+}
+
+static result_value_t F64Value(double value) {
+  result_value_t result;
+  result.f64 = value;
+  return result;
+}
+
+ResultChunk::ResultChunk(result_table_t table) : m_columns(GetResultColumnCount(table)) {
+  m_table = table;
+  m_numRows = 0;
+}
+
+void ResultChunk::addRow(const result_value_t* values) {
+  for (uint32_t c = 0; c < m_columns.size(); c++) {
+    m_columns[c].push_back(values[c]);
+  }
+  m_numRows++;
+}
+
+void ResultTables::addRun(uint32_t replication, uint64_t seed, uint32_t numFleetRedraws, const Aircraft* aircrafts, uint32_t numAircraft,
+                          uint32_t endTick, const demand_summary_t* demand) {
+  uint64_t numAircraftOf[MAX_AIRCRAFT_COMPANIES] = {0};
+  uint64_t flights[MAX_AIRCRAFT_COMPANIES] = {0};
+  uint64_t chargeSessions[MAX_AIRCRAFT_COMPANIES] = {0};
+  uint64_t airTimeTicks[MAX_AIRCRAFT_COMPANIES] = {0};
+  uint64_t chargeTimeTicks[MAX_AIRCRAFT_COMPANIES] = {0};
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    const Aircraft& aircraft = aircrafts[i];
+    numAircraftOf[aircraft.m_id]++;
+    flights[aircraft.m_id] += aircraft.m_numFlights;
+    chargeSessions[aircraft.m_id] += aircraft.m_numChargeSessions;
+    airTimeTicks[aircraft.m_id] += aircraft.m_airTimeTicks;
+    chargeTimeTicks[aircraft.m_id] += aircraft.m_chargeTimeTicks;
+
+    // the flight or charge session cut off by the horizon is counted, with the ticks flown or charged so far
+    uint32_t legLeftTicks = (IsLegInProgress(&aircraft) && (aircraft.m_legEndTick > endTick)) ? (aircraft.m_legEndTick - endTick) : 0u;
+    result_value_t row[] = {
+      U64Value(replication), U64Value(i), U64Value(aircraft.m_id), U64Value(aircraft.m_numFlights),
+      F64Value(aircraft.m_airTimeTicks / (double) LOOP_TICKS_PER_MIN), U64Value(aircraft.m_numChargeSessions),
+      F64Value(aircraft.m_chargeTimeTicks / (double) LOOP_TICKS_PER_MIN), U64Value(aircraft.m_numFaults),
+      U64Value(aircraft.m_state), F64Value(legLeftTicks / (double) LOOP_TICKS_PER_MIN)
+    };
+    m_aircraft.addRow(row);
+  }
+
+  // the averages and passenger miles are the same numbers as in the text summary
+  data_avgs_and_totals_t averagesAndTotals[MAX_AIRCRAFT_COMPANIES];
+  double passengerMiles[MAX_AIRCRAFT_COMPANIES];
+  if (demand != nullptr) {
+    GetDemandPassengerMiles(*demand, passengerMiles);
+  }
+  ComputeDataAveragesAndTotals(averagesAndTotals, (Aircraft*) aircrafts, numAircraft, (demand != nullptr) ? passengerMiles : nullptr);
+
+  uint64_t fleetFlights = 0, fleetChargeSessions = 0, fleetFaults = 0;
+  double fleetPassengerMiles = 0.0;
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    const data_avgs_and_totals_t& company = averagesAndTotals[i];
+    result_value_t row[] = {
+      U64Value(replication), U64Value(i), U64Value(numAircraftOf[i]), U64Value(flights[i]),
+      F64Value(airTimeTicks[i] / (double) LOOP_TICKS_PER_MIN), F64Value(company.avgMinPerFlight), U64Value(chargeSessions[i]),
+      F64Value(chargeTimeTicks[i] / (double) LOOP_TICKS_PER_MIN), F64Value(company.avgMinPerChargeSession),
+      U64Value(company.totalNumFaults), F64Value(company.totalPassengerMiles)
+    };
+    m_companies.addRow(row);
+    fleetFlights += flights[i];
+    fleetChargeSessions += chargeSessions[i];
+    fleetFaults += company.totalNumFaults;
+    fleetPassengerMiles += company.totalPassengerMiles;
+  }
+
+  // without demand every seat is full, so the seat miles are the passenger miles and nobody goes unserved
+  uint64_t tripRequests = 0, tripsServed = 0, tripsUnserved = 0;
+  double fleetSeatMiles = fleetPassengerMiles;
+  if (demand != nullptr) {
+    tripRequests = demand->requests;
+    tripsServed = demand->served;
+    tripsUnserved = demand->expired + demand->overflowed;
+    fleetSeatMiles = 0.0;
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+      fleetSeatMiles += demand->companies[i].seatMiles;
+    }
+  }
+  result_value_t row[] = {
+    U64Value(replication), U64Value(seed), U64Value(numFleetRedraws), U64Value(numAircraft), U64Value(fleetFlights),
+    U64Value(fleetChargeSessions), U64Value(fleetFaults), F64Value(fleetPassengerMiles), U64Value(tripRequests),
+    U64Value(tripsServed), U64Value(tripsUnserved), F64Value(fleetSeatMiles)
+  };
+  m_replications.addRow(row);
+}
+
+const ResultChunk& ResultTables::getChunk(result_table_t table) const {
+  switch (table) {
+    case RESULT_TABLE_REPLICATIONS:
+      return m_replications;
+    case RESULT_TABLE_COMPANIES:
+      return m_companies;
+    case RESULT_TABLE_AIRCRAFT:
+    default:
+      return m_aircraft;
+  }
+}
+
+std::string GetCsvTablePath(const std::string& outputPath, result_table_t table) {
+  size_t dot = outputPath.find_last_of('.');
+  size_t slash = outputPath.find_last_of("/\\");
+  std::string base = outputPath;
+  if ((dot != std::string::npos) && ((slash == std::string::npos) || (dot > slash))) {
+    base.erase(dot);
+  }
+  return base + "." + resultTableNames[table] + ".csv";
+}
+
+// Appends a CSV field, quoted if it has a separator or a quote in it
+static void AppendCsvText(std::vector<char>* buffer, const char* text) {
+  if (strpbrk(text, ",\"\n") == nullptr) {
+    buffer->insert(buffer->end(), text, text + strlen(text));
+    return;
+  }
+  buffer->push_back('"');
+  for (const char* c = text; *c != '\0'; c++) {
+    if (*c == '"') {
+      buffer->push_back('"');
+    }
+    buffer->push_back(*c);
+  }
+  buffer->push_back('"');
+}
+
+CsvResultWriter::CsvResultWriter() {
+  for (uint32_t t = 0; t < TOTAL_RESULT_TABLES; t++) {
+    m_files[t] = nullptr;
+  }
+  m_failed = false;
+}
+
+CsvResultWriter::~CsvResultWriter() {
+  close();
+}
+
+bool CsvResultWriter::open(const std::string& path, const result_table_t* tables, uint32_t numTables) {
+  m_failed = false;
+  for (uint32_t i = 0; i < numTables; i++) {
+    uint32_t t = tables[i];
+    std::string tablePath = GetCsvTablePath(path, (result_table_t) t);
+    m_files[t] = std::fopen(tablePath.c_str(), "wb");
+    if (m_files[t] == nullptr) {
+      std::cout << "ERROR - could not open " << tablePath << std::endl;
+      close();
+      return false;
+    }
+    m_buffers[t].clear();
+    m_buffers[t].reserve(RESULT_WRITE_BUFFER_BYTES);
+    const result_column_t* columns = GetResultColumns((result_table_t) t);
+    for (uint32_t c = 0; c < GetResultColumnCount((result_table_t) t); c++) {
+      if (c > 0) {
+        m_buffers[t].push_back(',');
+      }
+      AppendCsvText(&m_buffers[t], columns[c].name);
+    }
+    m_buffers[t].push_back('\n');
+  }
+  return true;
+}
+
+void CsvResultWriter::flushTable(uint32_t table) {
+  std::vector<char>& buffer = m_buffers[table];
+  if ((buffer.empty() == false) && (std::fwrite(buffer.data(), 1, buffer.size(), m_files[table]) != buffer.size())) {
+    m_failed = true;
+  }
+  buffer.clear();
+}
+
+void CsvResultWriter::writeChunk(const ResultChunk& chunk) {
+  uint32_t table = chunk.getTable();
+  if (m_files[table] == nullptr) {
+    return;
+  }
+  std::vector<char>& buffer = m_buffers[table];
+  const result_column_t* columns = GetResultColumns(chunk.getTable());
+  uint32_t numColumns = GetResultColumnCount(chunk.getTable());
+  char field[32];
+  for (uint64_t row = 0; row < chunk.getNumRows(); row++) {
+    for (uint32_t c = 0; c < numColumns; c++) {
+      if (c > 0) {
+        buffer.push_back(',');
+      }
+      result_value_t value = chunk.getColumn(c)[row];
+      if (columns[c].type == RESULT_COLUMN_COMPANY) {
+        AppendCsvText(&buffer, GetCompanyName((aircraft_id_t) value.u64));
+        continue;
+      }
+      std::to_chars_result written = (columns[c].type == RESULT_COLUMN_F64) ?
+        std::to_chars(field, field + sizeof(field), value.f64) : std::to_chars(field, field + sizeof(field), value.u64);
+      buffer.insert(buffer.end(), field, written.ptr);
+    }
+    buffer.push_back('\n');
+    if (buffer.size() >= RESULT_WRITE_BUFFER_BYTES) {
+      flushTable(table);
+    }
+  }
+}
+
+bool CsvResultWriter::close(void) {
+  for (uint32_t t = 0; t < TOTAL_RESULT_TABLES; t++) {
+    if (m_files[t] != nullptr) {
+      flushTable(t);
+      m_failed = (std::fclose(m_files[t]) != 0) || m_failed;
+      m_files[t] = nullptr;
+    }
+  }
+  return (m_failed == false);
+}
+
+ColumnarResultWriter::ColumnarResultWriter() {
+  m_file = nullptr;
+  m_failed = false;
+}
+
+ColumnarResultWriter::~ColumnarResultWriter() {
+  close();
+}
+
+void ColumnarResultWriter::append(const void* data, size_t bytes) {
+  if ((m_buffer.size() + bytes) > RESULT_WRITE_BUFFER_BYTES) {
+    flush();
+  }
+  if (bytes >= RESULT_WRITE_BUFFER_BYTES) {
+    // a whole column of a big chunk goes straight to the file
+    m_failed = (std::fwrite(data, 1, bytes, m_file) != bytes) || m_failed;
+    return;
+  }
+  const char* bytesIn = (const char*) data;
+  m_buffer.insert(m_buffer.end(), bytesIn, bytesIn + bytes);
+}
+
+void ColumnarResultWriter::appendString(const char* text) {
+  uint32_t length = (uint32_t) strlen(text);
+  append(&length, sizeof(length));
+  append(text, length);
+}
+
+void ColumnarResultWriter::flush(void) {
+  if ((m_buffer.empty() == false) && (std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size())) {
+    m_failed = true;
+  }
+  m_buffer.clear();
+}
+
+bool ColumnarResultWriter::open(const std::string& path, const result_table_t* tables, uint32_t numTables) {
+  m_file = std::fopen(path.c_str(), "wb");
+  if (m_file == nullptr) {
+    std::cout << "ERROR - could not open " << path << std::endl;
+    return false;
+  }
+  m_failed = false;
+  m_buffer.clear();
+  m_buffer.reserve(RESULT_WRITE_BUFFER_BYTES);
+
+  uint32_t version = RESULT_VERSION;
+  uint32_t numCompanies = GetNumCompanies();
+  append(RESULT_MAGIC, 8);
+  append(&version, sizeof(version));
+  append(&numCompanies, sizeof(numCompanies));
+  for (uint32_t i = 0; i < numCompanies; i++) {
+    appendString(GetCompanyName((aircraft_id_t) i));
+  }
+
+  append(&numTables, sizeof(numTables));
+  for (uint32_t i = 0; i < numTables; i++) {
+    uint32_t t = tables[i];
+    uint32_t numColumns = GetResultColumnCount((result_table_t) t);
+    const result_column_t* columns = GetResultColumns((result_table_t) t);
+    appendString(resultTableNames[t]);
+    append(&numColumns, sizeof(numColumns));
+    for (uint32_t c = 0; c < numColumns; c++) {
+      uint32_t type = columns[c].type;
+      append(&type, sizeof(type));
+      appendString(columns[c].name);
+    }
+  }
+  return true;
+}
+
+void ColumnarResultWriter::writeChunk(const ResultChunk& chunk) {
+  if ((m_file == nullptr) || (chunk.getNumRows() == 0)) {
+    return;
+  }
+  uint32_t table = chunk.getTable();
+  uint64_t numRows = chunk.getNumRows();
+  append(&table, sizeof(table));
+  append(&numRows, sizeof(numRows));
+  for (uint32_t c = 0; c < GetResultColumnCount(chunk.getTable()); c++) {
+    append(chunk.getColumn(c).data(), numRows * sizeof(result_value_t));
+  }
+}
+
+bool ColumnarResultWriter::close(void) {
+  if (m_file == nullptr) {
+    return (m_failed == false);
+  }
+  flush();
+  m_failed = (std::fclose(m_file) != 0) || m_failed;
+  m_file = nullptr;
+  return (m_failed == false);
+}
+
+std::unique_ptr<ResultWriter> CreateResultWriter(output_format_t format) {
+  switch (format) {
+    case OUTPUT_FORMAT_CSV:
+      return std::unique_ptr<ResultWriter>(new CsvResultWriter());
+    case OUTPUT_FORMAT_COLUMNAR:
+      return std::unique_ptr<ResultWriter>(new ColumnarResultWriter());
+    case OUTPUT_FORMAT_TEXT:
+    default:
+      return nullptr;
+  }
+}
+
+static bool CloseResultWriter(const simulation_config_t& config, ResultWriter* writer) {
+  if (writer->close() == false) {
+    std::cout << "ERROR - writing the result tables to " << config.outputPath << " failed" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool WriteResultTables(const simulation_config_t& config, const std::vector<ResultTables>& taskTables) {
+  std::unique_ptr<ResultWriter> writer = CreateResultWriter(config.outputFormat);
+  uint32_t numTables = sizeof(runResultTables) / sizeof(runResultTables[0]);
+  if ((writer == nullptr) || (writer->open(config.outputPath, runResultTables, numTables) == false)) {
+    return false;
+  }
+  for (const ResultTables& tables : taskTables) {
+    for (result_table_t table : runResultTables) {
+      writer->writeChunk(tables.getChunk(table));
+    }
+  }
+  return CloseResultWriter(config, writer.get());
+}
+
+bool WriteSweepResultTable(const simulation_config_t& config, const ResultChunk& sweep) {
+  std::unique_ptr<ResultWriter> writer = CreateResultWriter(config.outputFormat);
+  result_table_t table = RESULT_TABLE_SWEEP;
+  if ((writer == nullptr) || (writer->open(config.outputPath, &table, 1u) == false)) {
+    return false;
+  }
+  writer->writeChunk(sweep);
+  return CloseResultWriter(config, writer.get());
+}
+
+bool WriteRunResultTables(const simulation_config_t& config, const Aircraft* aircrafts, const demand_summary_t* demand) {
+  std::vector<ResultTables> tables(1);
+  tables[0].addRun(0, config.seed, 0, aircrafts, config.numAircraft, config.simulationTicks, demand);
+  return WriteResultTables(config, tables);
+}
+
+// Reads count bytes at offset, false past the end of the data
+static bool ReadBytes(const std::vector<char>& data, size_t* offset, void* out, size_t count) {
+  if ((data.size() - *offset) < count) {
+    return false;
+  }
+  memcpy(out, data.data() + *offset, count);
+  *offset += count;
+  return true;
+}
+
+static bool ReadString(const std::vector<char>& data, size_t* offset, std::string* out) {
+  uint32_t length;
+  if ((ReadBytes(data, offset, &length, sizeof(length)) == false) || ((data.size() - *offset) < length)) {
+    return false;
+  }
+  out->assign(data.data() + *offset, length);
+  *offset += length;
+  return true;
+}
+
+bool ReadColumnarResults(const std::string& path, std::vector<ResultChunk>* tables) {
+  std::ifstream file(path, std::ios::binary);
+  std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  size_t offset = 0;
+  char magic[8];
+  uint32_t version, numCompanies, numTables;
+  std::string text;
+  bool valid = ReadBytes(data, &offset, magic, sizeof(magic)) && (memcmp(magic, RESULT_MAGIC, sizeof(magic)) == 0) &&
+               ReadBytes(data, &offset, &version, sizeof(version)) && (version == RESULT_VERSION) &&
+               ReadBytes(data, &offset, &numCompanies, sizeof(numCompanies));
+  for (uint32_t i = 0; valid && (i < numCompanies); i++) {
+    valid = ReadString(data, &offset, &text);
+  }
+
+  // every table the file holds has to match that table of this build, and only those can have chunks
+  bool inFile[TOTAL_RESULT_TABLES] = {false};
+  valid = valid && ReadBytes(data, &offset, &numTables, sizeof(numTables)) && (numTables <= TOTAL_RESULT_TABLES);
+  for (uint32_t i = 0; valid && (i < numTables); i++) {
+    uint32_t numColumns;
+    uint32_t t = 0;
+    valid = ReadString(data, &offset, &text);
+    while (valid && (t < TOTAL_RESULT_TABLES) && (text != resultTableNames[t])) {
+      t++;
+    }
+    valid = valid && (t < TOTAL_RESULT_TABLES) && (inFile[t] == false) &&
+            ReadBytes(data, &offset, &numColumns, sizeof(numColumns)) && (numColumns == GetResultColumnCount((result_table_t) t));
+    inFile[t] = valid;
+    for (uint32_t c = 0; valid && (c < numColumns); c++) {
+      uint32_t type;
+      valid = ReadBytes(data, &offset, &type, sizeof(type)) && (type == GetResultColumns((result_table_t) t)[c].type) &&
+              ReadString(data, &offset, &text) && (text == GetResultColumns((result_table_t) t)[c].name);
+    }
+  }
+
+  tables->clear();
+  for (uint32_t t = 0; t < TOTAL_RESULT_TABLES; t++) {
+    tables->push_back(ResultChunk((result_table_t) t));
+  }
+  std::vector<result_value_t> row;
+  while (valid && (offset < data.size())) {
+    uint32_t table;
+    uint64_t numRows;
+    valid = ReadBytes(data, &offset, &table, sizeof(table)) && (table < TOTAL_RESULT_TABLES) && inFile[table] &&
+            ReadBytes(data, &offset, &numRows, sizeof(numRows));
+    uint32_t numColumns = valid ? GetResultColumnCount((result_table_t) table) : 0;
+    valid = valid && (((data.size() - offset) / sizeof(result_value_t) / numColumns) >= numRows);
+    if (valid) {
+      row.resize(numColumns);
+      for (uint64_t r = 0; r < numRows; r++) {
+        for (uint32_t c = 0; c < numColumns; c++) {
+          memcpy(&row[c], data.data() + offset + (c * numRows + r) * sizeof(result_value_t), sizeof(result_value_t));
+        }
+        (*tables)[table].addRow(row.data());
+      }
+      offset += numColumns * numRows * sizeof(result_value_t);
+    }
+  }
+  if (valid == false) {
+    std::cout << "ERROR - " << path << " is not a columnar result file of this version" << std::endl;
+  }
+  return valid;
+}
+
+static uint32_t CountLines(const std::string& path) {
+  std::ifstream file(path);
+  return (uint32_t) std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
+}
+
+void ResultWriterTest(void) {
+  const uint32_t numTasks = 3;
+  const uint32_t runsPerTask = 2;
+  const uint32_t numAircraft = DEFAULT_AIRCRAFTS_IN_SIMULATION;
+
+  // fixed counters per run, each run and aircraft different so misplaced rows are caught
+  std::vector<ResultTables> taskTables(numTasks);
+  for (uint32_t task = 0; task < numTasks; task++) {
+    for (uint32_t run = 0; run < runsPerTask; run++) {
+      uint32_t replication = task * runsPerTask + run;
+      Aircraft aircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+      for (uint32_t i = 0; i < numAircraft; i++) {
+        aircrafts[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+        aircrafts[i].m_numFlights = replication + i;
+        aircrafts[i].m_airTimeTicks = (replication + i) * 1001u;
+        aircrafts[i].m_numChargeSessions = replication;
+        aircrafts[i].m_chargeTimeTicks = replication * 333u;
+        aircrafts[i].m_numFaults = i;
+        aircrafts[i].m_state = AIRCRAFT_STATE_FLYING;
+        aircrafts[i].m_legEndTick = LOOP_TICKS_PER_HOUR + i;
+      }
+      taskTables[task].addRun(replication, 1000u + replication, 0, aircrafts, numAircraft, LOOP_TICKS_PER_HOUR);
+    }
+  }
+
+  simulation_config_t config = DefaultSimulationConfig();
+  config.outputPath = "ResultWriterTest.bin";
+  config.outputFormat = OUTPUT_FORMAT_COLUMNAR;
+  std::vector<ResultChunk> tables;
+  bool pass = WriteResultTables(config, taskTables) && ReadColumnarResults(config.outputPath, &tables);
+  uint32_t numRuns = numTasks * runsPerTask;
+  pass = pass && (tables[RESULT_TABLE_REPLICATIONS].getNumRows() == numRuns) &&
+         (tables[RESULT_TABLE_COMPANIES].getNumRows() == (uint64_t) numRuns * GetNumCompanies()) &&
+         (tables[RESULT_TABLE_AIRCRAFT].getNumRows() == (uint64_t) numRuns * numAircraft);
+  for (uint64_t r = 0; pass && (r < tables[RESULT_TABLE_AIRCRAFT].getNumRows()); r++) {
+    // rows come back in task order: replication major, then aircraft
+    const ResultChunk& aircraft = tables[RESULT_TABLE_AIRCRAFT];
+    uint64_t replication = r / numAircraft, i = r % numAircraft;
+    pass = (aircraft.getColumn(0)[r].u64 == replication) && (aircraft.getColumn(1)[r].u64 == i) &&
+           (aircraft.getColumn(3)[r].u64 == replication + i) &&
+           (aircraft.getColumn(4)[r].f64 == ((replication + i) * 1001u) / (double) LOOP_TICKS_PER_MIN) &&
+           (aircraft.getColumn(9)[r].f64 == i / (double) LOOP_TICKS_PER_MIN);
+  }
+  for (uint32_t r = 0; pass && (r < numRuns); r++) {
+    pass = (tables[RESULT_TABLE_REPLICATIONS].getColumn(1)[r].u64 == 1000u + r);
+  }
+  std::cout << "Columnar result writer test: " << (pass ? "PASS" : "FAIL") << std::endl;
+  std::remove(config.outputPath.c_str());
+
+  config.outputPath = "ResultWriterTest.csv";
+  config.outputFormat = OUTPUT_FORMAT_CSV;
+  pass = WriteResultTables(config, taskTables);
+  // a header line, then a line per row
+  pass = pass && (CountLines(GetCsvTablePath(config.outputPath, RESULT_TABLE_REPLICATIONS)) == numRuns + 1) &&
+         (CountLines(GetCsvTablePath(config.outputPath, RESULT_TABLE_COMPANIES)) == numRuns * GetNumCompanies() + 1) &&
+         (CountLines(GetCsvTablePath(config.outputPath, RESULT_TABLE_AIRCRAFT)) == numRuns * numAircraft + 1);
+  std::string firstRow;
+  if (pass) {
+    std::ifstream file(GetCsvTablePath(config.outputPath, RESULT_TABLE_AIRCRAFT));
+    std::getline(file, firstRow);
+    std::getline(file, firstRow);
+  }
+  // aircraft 0 of replication 0: no flights, flying, with its leg ending on the horizon, and the shortest round-trip format drops the zeros
+  std::string expected = std::string("0,0,") + GetCompanyName((aircraft_id_t) 0) + ",0,0,0,0,0,1,0";
+  pass = pass && (firstRow == expected);
+  std::cout << "CSV result writer test: " << (pass ? "PASS" : "FAIL") << std::endl;
+  for (uint32_t t = 0; t < TOTAL_RESULT_TABLES; t++) {
+    std::remove(GetCsvTablePath(config.outputPath, (result_table_t) t).c_str());
+  }
+}
@@ -0,0 +1,162 @@
+/** Defines the machine-readable result tables and the writers for them. --format csv
+ * or --format columnar writes these tables instead of the text summary:
+ *  replications  one row per replication: seed, fleet redraws and fleet totals, with --demand the
+ *                trip requests served and unserved and the seat miles flown
+ *  companies     one row per replication and company: totals and averages
+ *  aircraft      one row per replication and aircraft: the counters of the aircraft, its state at
+ *                the horizon and the minutes left of a flight or charge session it cut off
+ *  sweep         one row per grid point of a sweep, see Sweep.h; the mix is the index into
+ *                --sweep-mix, 0 without it
+ * A single run is written as replication 0. A run or a batch writes the first three tables,
+ * a sweep only the sweep table.
+ *
+ * Rows are collected in ResultChunk column chunks. Every batch task fills chunks of
+ * its own, so parallel replications never share a buffer, and the chunks are handed
+ * to the writer in task order once the batch is done, so the files don't depend on
+ * the thread count. Values are kept as 64 bit integers or doubles; the CSV writer
+ * formats doubles with std::to_chars, shortest round-trip, not through iostreams.
+ *
+ * The CSV writer writes one file per table, the output path with the table name
+ * before the extension, e.g. out.companies.csv. The columnar writer writes one file,
+ * see the top of ResultWriter.cpp for its layout. Both buffer their appends and write
+ * to the file a block at a time. */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Aircraft.h"
+#include "Config.h"
+#include "Demand.h"
+
+#define RESULT_MAGIC "EVTOLRES"
+#define RESULT_VERSION (4u)
+#define RESULT_WRITE_BUFFER_BYTES (1u << 20)
+
+typedef enum {
+  RESULT_COLUMN_U64 = 0u,
+  RESULT_COLUMN_F64,
+  RESULT_COLUMN_COMPANY, // company index, written by name in CSV
+} result_column_type_t;
+
+typedef enum {
+  RESULT_TABLE_REPLICATIONS = 0u,
+  RESULT_TABLE_COMPANIES,
+  RESULT_TABLE_AIRCRAFT,
+  RESULT_TABLE_SWEEP,
+
+  TOTAL_RESULT_TABLES
+} result_table_t;
+
+typedef struct {
+  const char* name;
+  result_column_type_t type;
+} result_column_t;
+
+typedef union {
+  uint64_t u64; // RESULT_COLUMN_U64 and RESULT_COLUMN_COMPANY
+  double f64;
+} result_value_t;
+
+const char* GetResultTableName(result_table_t table);
+uint32_t GetResultColumnCount(result_table_t table);
+const result_column_t* GetResultColumns(result_table_t table);
+
+// Rows of one table, stored column by column
+class ResultChunk
+{
+public:
+  explicit ResultChunk(result_table_t table);
+
+  result_table_t getTable(void) const {return m_table;}
+  uint64_t getNumRows(void) const {return m_numRows;}
+  const std::vector<result_value_t>& getColumn(uint32_t column) const {return m_columns[column];}
+  void addRow(const result_value_t* values); // one value per column of the table
+
+private:
+  result_table_t m_table;
+  uint64_t m_numRows;
+  std::vector<std::vector<result_value_t>> m_columns;
+};
+
+// One chunk of every table, filled by a single thread
+class ResultTables
+{
+public:
+  ResultTables() : m_replications(RESULT_TABLE_REPLICATIONS), m_companies(RESULT_TABLE_COMPANIES), m_aircraft(RESULT_TABLE_AIRCRAFT) {}
+
+  // Adds the rows of one finished run that ended on endTick, demand is its summary with --demand
+  void addRun(uint32_t replication, uint64_t seed, uint32_t numFleetRedraws, const Aircraft* aircrafts, uint32_t numAircraft, uint32_t endTick,
+              const demand_summary_t* demand = nullptr);
+  const ResultChunk& getChunk(result_table_t table) const;
+
+private:
+  ResultChunk m_replications;
+  ResultChunk m_companies;
+  ResultChunk m_aircraft;
+};
+
+class ResultWriter
+{
+public:
+  virtual ~ResultWriter() {}
+
+  virtual bool open(const std::string& path, const result_table_t* tables, uint32_t numTables) = 0; // the tables the output will hold
+  virtual void writeChunk(const ResultChunk& chunk) = 0; // appends the rows of the chunk to its table
+  virtual bool close(void) = 0; // flushes the buffered rows, false on any write error
+};
+
+class CsvResultWriter : public ResultWriter
+{
+public:
+  CsvResultWriter();
+  ~CsvResultWriter() override;
+
+  bool open(const std::string& path, const result_table_t* tables, uint32_t numTables) override;
+  void writeChunk(const ResultChunk& chunk) override;
+  bool close(void) override;
+
+private:
+  void flushTable(uint32_t table);
+
+  std::FILE* m_files[TOTAL_RESULT_TABLES];
+  std::vector<char> m_buffers[TOTAL_RESULT_TABLES];
+  bool m_failed;
+};
+
+class ColumnarResultWriter : public ResultWriter
+{
+public:
+  ColumnarResultWriter();
+  ~ColumnarResultWriter() override;
+
+  bool open(const std::string& path, const result_table_t* tables, uint32_t numTables) override;
+  void writeChunk(const ResultChunk& chunk) override;
+  bool close(void) override;
+
+private:
+  void append(const void* data, size_t bytes);
+  void appendString(const char* text);
+  void flush(void);
+
+  std::FILE* m_file;
+  std::vector<char> m_buffer;
+  bool m_failed;
+};
+
+std::unique_ptr<ResultWriter> CreateResultWriter(output_format_t format); // nullptr for the text summary
+std::string GetCsvTablePath(const std::string& outputPath, result_table_t table);
+
+// Writes the chunks of every task in order to config.outputPath in config.outputFormat
+bool WriteResultTables(const simulation_config_t& config, const std::vector<ResultTables>& taskTables);
+bool WriteRunResultTables(const simulation_config_t& config, const Aircraft* aircrafts,
+                          const demand_summary_t* demand = nullptr); // a single run, as replication 0
+bool WriteSweepResultTable(const simulation_config_t& config, const ResultChunk& sweep); // the rows of a sweep, alone
+
+// Reads a columnar file back, one chunk per table with every row, empty for a table the file doesn't hold; false if it isn't a valid file
+bool ReadColumnarResults(const std::string& path, std::vector<ResultChunk>* tables);
+void ResultWriterTest(void);
@@ -1,15 +1,30 @@
-/** E-Vtol simulation of 20 planes flying and recharging using only
- * 3 available chargers. */
+/** E-Vtol simulation of a fleet of planes flying and recharging using a
+ * limited number of chargers. 20 planes and 3 chargers by default. */
 
-#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
 #include <iostream>
-#include <queue>
+#include <vector>
 
 #include "AircraftCompanyCommon.h"
 #include "Aircraft.h"
+#include "AnalyticSimulation.h"
+#include "Arena.h"
+#include "ChargeQueue.h"
 #include "ChargeStation.h"
+#include "Checkpoint.h"
+#include "Demand.h"
+#include "EventSimulation.h"
+#include "Fleet.h"
+#include "Maintenance.h"
+#include "Metrics.h"
+#include "Network.h"
 #include "Output.h"
 #include "RandomGen.h"
+#include "ResultWriter.h"
+#include "Simulation.h"
 #include "Trace.h"
 
 /** Use these definitions to test the simulation for different
@@ -19,64 +34,192 @@
 #define SIMULATION_TICKS_2HR (120u * LOOP_TICKS_PER_MIN)
 #define SIMULATION_TICKS_3HR (180u * LOOP_TICKS_PER_MIN)
 
-void RunSimulation(void) {
-    /** Create the array of 20 aircraft with random IDs. This runs a test to ensure
+bool RunSimulation(const simulation_config_t& config) {
+    /** Create the fleet of aircraft with random IDs. This runs a test to ensure
      * at least 1 of each aircraft company was generated. If that test fails, the
-     * simulation exits immediately, and must be rerun.
+     * simulation stops right away, and must be rerun with a different seed.
      * 
-     * So far, after many trials, we have always generated an ID for each company. */
-    Aircraft aircrafts[TOTAL_AIRCRAFTS_IN_SIMULATION];
-    CreateRandomAircraftIds(aircrafts);
+     * With 20 aircraft this happens for roughly 1 in 17 seeds. Batch runs draw the
+     * fleet again instead, see BatchRunner.cpp. */
+    if ((config.checkpointPath.empty() == false) || (config.resumePath.empty() == false)) {
+        return RunCheckpointedSimulation(config); // always event-driven, the tick loops keep their state on the stack
+    }
+    std::cout << "seed: " << config.seed << std::endl; // rerun with --seed to reproduce this run
+
+    std::vector<Aircraft> aircrafts(config.numAircraft);
+    if (CreateRandomAircraftIds(aircrafts.data(), config.numAircraft, config.seed) == false) {
+        std::cout << "ERROR - all aircraft IDs were not generated." << std::endl;
+        WriteRandomIdErrorToOutputFile(config.outputPath);
+        return false;
+    }
+
+    MetricsBatchStart(1);
+    MetricsRunStart(config);
+    SimulationStatistics stats;
+    std::unique_ptr<TimelineRecorder> timeline;
+    if (config.timelinePath.empty() == false) {
+        timeline.reset(new TimelineRecorder(config.numAircraft));
+    }
+    std::vector<vertiport_summary_t> vertiports;
+    demand_summary_t demand;
+    RunSimulationEngine(aircrafts.data(), config, &stats, timeline.get(), &demand, &vertiports);
+    MetricsRunFinish(aircrafts.data(), config.numAircraft, config.simulationTicks);
+    if (timeline != nullptr) {
+        WriteTimelineStateCounts(*timeline, config.timelinePath, config.simulationTicks, config.timelineTicks);
+        std::cout << "timeline: " << timeline->getNumTransitions() << " transitions in " << timeline->getEncodedBytes() << " bytes, " <<
+            (timeline->getBytesUsed() >> 10) << " KiB in memory" << std::endl;
+        if (timeline->getRecordedUntilTick() != UINT32_MAX) {
+            std::cout << "ERROR - the timeline ran out of memory and stops at " <<
+                (timeline->getRecordedUntilTick() / (double) LOOP_TICKS_PER_MIN) << " min" << std::endl;
+        }
+    }
+
+    // Simulation has finished. Write data to output file.
+    bool withDemand = (config.tripRequestsPerHour > 0.0);
+    if (config.outputFormat != OUTPUT_FORMAT_TEXT) {
+        WriteRunResultTables(config, aircrafts.data(), withDemand ? &demand : nullptr);
+        return true;
+    }
+    bool haveStats = (config.mode != SIMULATION_MODE_ANALYTIC);
+    double passengerMiles[MAX_AIRCRAFT_COMPANIES];
+    if (withDemand) {
+        GetDemandPassengerMiles(demand, passengerMiles); // the seats actually filled, not every seat of every flight
+    }
+    WriteDataToOutputFile(aircrafts.data(), config.numAircraft, config.outputPath, haveStats ? &stats : nullptr,
+                          withDemand ? passengerMiles : nullptr);
+    if (vertiports.empty() == false) {
+        std::ofstream myfile(config.outputPath, std::ios::app);
+        WriteVertiportStatistics(myfile, vertiports);
+    }
+    if (withDemand) {
+        std::ofstream myfile(config.outputPath, std::ios::app);
+        WriteDemandStatistics(myfile, demand);
+    }
+    return true;
+}
 
-    ChargeStation battChargers;
-    std::queue<uint8_t> aircraftInLineToCharge;
+void RunSimulationEngine(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats, TimelineRecorder* timeline,
+                         demand_summary_t* demand, std::vector<vertiport_summary_t>* vertiports) {
+    if (config.numVertiports > 1) {
+        RunNetworkSimulation(aircrafts, config, stats, vertiports); // no timeline, the vertiports record in parallel
+    } else if (config.tripRequestsPerHour > 0.0) {
+        RunDemandSimulation(aircrafts, config, stats, demand);
+    } else if (config.mode == SIMULATION_MODE_EVENT) {
+        RunEventSimulation(aircrafts, config, stats, timeline);
+    } else if (config.mode == SIMULATION_MODE_SOA) {
+        RunSoaSimulation(aircrafts, config, stats, timeline);
+    } else if (config.mode == SIMULATION_MODE_ANALYTIC) {
+        RunAnalyticSimulation(aircrafts, config);
+    } else {
+        RunTickSimulation(aircrafts, config, stats, timeline);
+    }
+}
+
+void RunEventSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats, TimelineRecorder* timeline) {
+    EventSimulation sim(aircrafts, config, stats);
+    sim.setTimeline(timeline);
+    sim.run(config.simulationTicks);
+}
+
+void RunTickSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats, TimelineRecorder* timeline) {
+    ChargeStation battChargers(config.numChargers);
+    ChargeQueue aircraftInLineToCharge(config.numAircraft, config.policy);
+    ChargeStation repairBays(config.numRepairBays);
+    ChargeQueue aircraftInLineForRepair((config.numRepairBays > 0) ? config.numAircraft : 0u);
 
     uint32_t tickCount = 0;
     /** Loop 1 extra time to initialize all aircraft into the flying state.
      * Then all recorded ticks will either be from flying, charging, or waiting
      * to charge. */
-    while (tickCount <= SIMULATION_TICKS_3HR) {
-        float timeMin = tickCount / (float) LOOP_TICKS_PER_MIN; // for tracing state transitions
-
-        for (uint8_t i = 0; i < TOTAL_AIRCRAFTS_IN_SIMULATION; i++) {
+    while (tickCount <= config.simulationTicks) {
+        for (uint32_t i = 0; i < config.numAircraft; i++) {
             Aircraft* pCurCraft = &aircrafts[i];
             switch (pCurCraft->m_state) {
                 case AIRCRAFT_STATE_IDLE:
                     pCurCraft->m_state = AIRCRAFT_STATE_FLYING;
                     pCurCraft->m_numFlights++;
+                    pCurCraft->m_stateStartTick = tickCount;
+                    pCurCraft->m_legEndTick = tickCount + GetFlightLegTicks(pCurCraft, i, (config.numRepairBays > 0), config.seed);
+                    TraceTakeoff(i, tickCount, pCurCraft->m_numFlights);
+                    if (timeline != nullptr) {
+                        timeline->record(i, tickCount, AIRCRAFT_STATE_FLYING);
+                    }
                     break;
                 case AIRCRAFT_STATE_FLYING:
                     pCurCraft->m_airTimeTicks++;
-                    if (IsBatteryDead(pCurCraft)) {
+                    if (IsBatteryDead(pCurCraft, tickCount)) {
+                        if (stats != nullptr) {
+                            stats->recordFlight(pCurCraft->m_id, tickCount - pCurCraft->m_stateStartTick);
+                        }
+                        if ((config.numRepairBays > 0) && IsFaultLanding(pCurCraft, tickCount)) {
+                            LandForRepair(pCurCraft, tickCount);
+                            TraceFault(i, tickCount, pCurCraft->m_numFaults);
+                            if (aircraftInLineForRepair.push(i, pCurCraft->m_id, tickCount) == false) {
+                                std::cout << "ERROR - repair line is full, it should have room for the whole fleet." << std::endl;
+                            }
+                            break;
+                        }
+                        TraceBatteryDead(i, tickCount, tickCount - pCurCraft->m_stateStartTick);
                         // place every aircraft in line while waiting for the loop cycle to complete
-                        aircraftInLineToCharge.push(i);
+                        if (aircraftInLineToCharge.push(i, pCurCraft->m_id, tickCount) == false) {
+                            std::cout << "ERROR - charge line is full, it should have room for the whole fleet." << std::endl;
+                        }
+                        TraceAddedToChargingLine(i, tickCount, aircraftInLineToCharge.size());
+                        if (timeline != nullptr) {
+                            timeline->record(i, tickCount, AIRCRAFT_STATE_WAITING_TO_CHARGE);
+                        }
                         pCurCraft->m_state = AIRCRAFT_STATE_WAITING_TO_CHARGE;
+                        pCurCraft->m_stateStartTick = tickCount;
+                        pCurCraft->m_stateOfCharge = 0.0f;
                     }
                     break;
                 case AIRCRAFT_STATE_CHARGING:
                     pCurCraft->m_chargeTimeTicks++;
-                    if (IsChargingComplete(pCurCraft)) {
-                        if (battChargers.removeAircraft() == false) {
+                    if (IsChargingComplete(pCurCraft, tickCount)) {
+                        if (battChargers.removeAircraft(tickCount) == false) {
                             std::cout << "ERROR - removing aircraft from charger failed because no chargers are in use." << std::endl;
                         }
-                        TraceFinishCharging(i, timeMin, battChargers.getNumChargersInUse());
+                        if (stats != nullptr) {
+                            stats->recordChargeSession(pCurCraft->m_id, tickCount - pCurCraft->m_stateStartTick);
+                        }
+                        TraceFinishCharging(i, tickCount, battChargers.getNumChargersInUse());
                         pCurCraft->m_state = AIRCRAFT_STATE_FLYING;
                         pCurCraft->m_numFlights++;
+                        pCurCraft->m_stateStartTick = tickCount;
+                        pCurCraft->m_stateOfCharge = config.chargeTargetSoc;
+                        pCurCraft->m_legEndTick = tickCount + GetFlightLegTicks(pCurCraft, i, (config.numRepairBays > 0), config.seed);
+                        TraceTakeoff(i, tickCount, pCurCraft->m_numFlights);
+                        if (timeline != nullptr) {
+                            timeline->record(i, tickCount, AIRCRAFT_STATE_FLYING);
+                        }
                     }
                     break;
                 case AIRCRAFT_STATE_WAITING_TO_CHARGE:
                     /** Nothing happens when waiting to charge. Once the loop cycle completes,
                      * planes in line are added to chargers that may have become available. */
                     break;
+                case AIRCRAFT_STATE_MAINTENANCE:
+                    // the leg only ends once the aircraft is in a repair bay, its end tick is UINT32_MAX until then
+                    pCurCraft->m_maintenanceTimeTicks++;
+                    if (tickCount >= pCurCraft->m_legEndTick) {
+                        if (repairBays.removeAircraft(tickCount) == false) {
+                            std::cout << "ERROR - removing aircraft from repair bay failed because no bays are in use." << std::endl;
+                        }
+                        if (stats != nullptr) {
+                            stats->recordRepair(pCurCraft->m_id, tickCount - pCurCraft->m_stateStartTick);
+                        }
+                        JoinChargeLine(aircrafts, i, tickCount, &aircraftInLineToCharge);
+                    }
+                    break;
                 default:
                     std::cout << "ERROR - default case should never execute." << std::endl;
                     break;
             }
+        }
 
-            if ((tickCount > 0) && ((tickCount % SIMULATION_TICKS_1HR) == 0)) {
-                // Use hourly percent chance to potentially generate a fault
-                HourlyFaultGenerationPercentChance(pCurCraft);
-            }
+        if ((config.numRepairBays == 0) && (tickCount > 0) && ((tickCount % SIMULATION_TICKS_1HR) == 0)) {
+            // Use hourly percent chance to potentially generate a fault, for the whole fleet in one pass
+            GenerateHourlyFaults(aircrafts, config.numAircraft, tickCount / SIMULATION_TICKS_1HR, config.seed);
         }
 
         /** Now that the loop cycle has completed, add aircraft to chargers if any are available.
@@ -89,22 +232,238 @@ void RunSimulation(void) {
          * trace that an aircraft finished charging at 63.98 minutes for example, when the
          * expected time to finish charging was 64 minutes.
          */
-        while ((battChargers.getNumChargersInUse() < TOTAL_CHARGERS) && (aircraftInLineToCharge.size() > 0)) {
-            uint8_t aircraftIndex = aircraftInLineToCharge.front();
-            if (battChargers.addAircraft()) {
-                TraceStartCharging(aircraftIndex, timeMin, battChargers.getNumChargersInUse());
+        while (battChargers.isChargerAvailable() && (aircraftInLineToCharge.empty() == false)) {
+            charge_queue_entry_t entry = aircraftInLineToCharge.front();
+            uint32_t aircraftIndex = entry.aircraftIndex;
+            if (battChargers.addAircraft(tickCount)) {
+                TraceStartCharging(aircraftIndex, tickCount, battChargers.getNumChargersInUse());
+                if (timeline != nullptr) {
+                    timeline->record(aircraftIndex, tickCount, AIRCRAFT_STATE_CHARGING);
+                }
+                // pop the queue item now that we know an aircraft was successfully added to the charge station
+                aircraftInLineToCharge.pop(tickCount, &entry);
+                if (stats != nullptr) {
+                    stats->recordWait(aircrafts[aircraftIndex].m_id, tickCount - entry.enqueueTick);
+                }
                 aircrafts[aircraftIndex].m_state = AIRCRAFT_STATE_CHARGING;
                 aircrafts[aircraftIndex].m_numChargeSessions++;
-                // pop the queue item now that we know an aircraft was successfully added to the charge station
-                aircraftInLineToCharge.pop();
+                aircrafts[aircraftIndex].m_stateStartTick = tickCount;
+                aircrafts[aircraftIndex].m_legEndTick = tickCount +
+                    GetChargeTicks(aircrafts[aircraftIndex].m_id, aircrafts[aircraftIndex].m_stateOfCharge, config.chargeTargetSoc);
             } else {
                 std::cout << "ERROR - adding aircraft to charger failed even though a charger should be available." << std::endl;
             }
         }
 
+        // grounded aircraft are put in repair bays the same way
+        charge_queue_entry_t repairEntry;
+        while (repairBays.isChargerAvailable() && aircraftInLineForRepair.pop(tickCount, &repairEntry)) {
+            repairBays.addAircraft(tickCount);
+            Aircraft* pGroundedCraft = &aircrafts[repairEntry.aircraftIndex];
+            pGroundedCraft->m_legEndTick = tickCount + GetRepairTicks(pGroundedCraft, repairEntry.aircraftIndex, config.repairTicks, config.seed);
+        }
+
+        MetricsTick(tickCount, aircrafts, config.numAircraft);
         tickCount++;
     }
-    
-    // Simulation has finished. Write data to output file.
-    WriteDataToOutputFile(aircrafts);
-}
\ No newline at end of file
+
+    RecordChargeSiteStatistics(stats, aircraftInLineToCharge, battChargers, config.simulationTicks);
+    if (config.numRepairBays > 0) {
+        RecordRepairSiteStatistics(stats, aircraftInLineForRepair, repairBays, config.simulationTicks);
+    }
+}
+
+/** Same tick loop as RunTickSimulation(), over structure-of-arrays fleet storage.
+ * FleetTickKernel() does the per-tick counting for the whole fleet without branching
+ * on the state, and only the aircraft whose flight or charge session ended on this
+ * tick go through the scalar queue logic below, in the same index order as the tick
+ * loop. The results are stored back into the aircraft array when the run ends. */
+void RunSoaSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats, TimelineRecorder* timeline) {
+    FleetSoA fleet(aircrafts, config.numAircraft);
+    ChargeStation battChargers(config.numChargers);
+    ChargeQueue aircraftInLineToCharge(config.numAircraft, config.policy);
+    std::pmr::vector<uint32_t> crossedIndices(config.numAircraft, GetSimulationMemory());
+
+    // tick 0 of the tick loop, every idle aircraft takes off
+    for (uint32_t i = 0; i < fleet.size(); i++) {
+        if (fleet.m_states[i] == AIRCRAFT_STATE_IDLE) {
+            fleet.startLeg(i, AIRCRAFT_STATE_FLYING, GetFlightTicks((aircraft_id_t) fleet.m_ids[i], fleet.m_stateOfCharge[i]));
+            fleet.m_numFlights[i]++;
+            TraceTakeoff(i, 0, fleet.m_numFlights[i]);
+            if (timeline != nullptr) {
+                timeline->record(i, 0, AIRCRAFT_STATE_FLYING);
+            }
+        }
+    }
+
+    for (uint32_t tickCount = 1; tickCount <= config.simulationTicks; tickCount++) {
+        uint32_t numCrossed = FleetTickKernel(fleet, tickCount, crossedIndices.data());
+        for (uint32_t n = 0; n < numCrossed; n++) {
+            uint32_t i = crossedIndices[n];
+            // a leg ends on its end tick, so it lasted exactly as long as worked out when it started
+            aircraft_id_t id = (aircraft_id_t) fleet.m_ids[i];
+            if (fleet.m_states[i] == AIRCRAFT_STATE_FLYING) {
+                uint32_t legTicks = GetFlightTicks(id, fleet.m_stateOfCharge[i]);
+                if (stats != nullptr) {
+                    stats->recordFlight(id, legTicks);
+                }
+                TraceBatteryDead(i, tickCount, legTicks);
+                fleet.m_stateOfCharge[i] = 0.0f;
+                if (aircraftInLineToCharge.push(i, (aircraft_id_t) fleet.m_ids[i], tickCount) == false) {
+                    std::cout << "ERROR - charge line is full, it should have room for the whole fleet." << std::endl;
+                }
+                fleet.m_states[i] = AIRCRAFT_STATE_WAITING_TO_CHARGE;
+                TraceAddedToChargingLine(i, tickCount, aircraftInLineToCharge.size());
+                if (timeline != nullptr) {
+                    timeline->record(i, tickCount, AIRCRAFT_STATE_WAITING_TO_CHARGE);
+                }
+            } else {
+                if (battChargers.removeAircraft(tickCount) == false) {
+                    std::cout << "ERROR - removing aircraft from charger failed because no chargers are in use." << std::endl;
+                }
+                if (stats != nullptr) {
+                    stats->recordChargeSession(id, GetChargeTicks(id, fleet.m_stateOfCharge[i], config.chargeTargetSoc));
+                }
+                TraceFinishCharging(i, tickCount, battChargers.getNumChargersInUse());
+                fleet.m_stateOfCharge[i] = config.chargeTargetSoc;
+                fleet.startLeg(i, AIRCRAFT_STATE_FLYING, tickCount + GetFlightTicks(id, fleet.m_stateOfCharge[i]));
+                fleet.m_numFlights[i]++;
+                TraceTakeoff(i, tickCount, fleet.m_numFlights[i]);
+                if (timeline != nullptr) {
+                    timeline->record(i, tickCount, AIRCRAFT_STATE_FLYING);
+                }
+            }
+        }
+
+        if ((tickCount % SIMULATION_TICKS_1HR) == 0) {
+            GenerateHourlyFaults(fleet.m_ids.data(), fleet.m_numFaults.data(), fleet.size(), tickCount / SIMULATION_TICKS_1HR, config.seed);
+        }
+
+        while (battChargers.isChargerAvailable() && (aircraftInLineToCharge.empty() == false)) {
+            charge_queue_entry_t entry = aircraftInLineToCharge.front();
+            uint32_t aircraftIndex = entry.aircraftIndex;
+            if (battChargers.addAircraft(tickCount)) {
+                TraceStartCharging(aircraftIndex, tickCount, battChargers.getNumChargersInUse());
+                if (timeline != nullptr) {
+                    timeline->record(aircraftIndex, tickCount, AIRCRAFT_STATE_CHARGING);
+                }
+                aircraftInLineToCharge.pop(tickCount, &entry);
+                if (stats != nullptr) {
+                    stats->recordWait((aircraft_id_t) fleet.m_ids[aircraftIndex], tickCount - entry.enqueueTick);
+                }
+                fleet.startLeg(aircraftIndex, AIRCRAFT_STATE_CHARGING, tickCount +
+                    GetChargeTicks((aircraft_id_t) fleet.m_ids[aircraftIndex], fleet.m_stateOfCharge[aircraftIndex], config.chargeTargetSoc));
+                fleet.m_numChargeSessions[aircraftIndex]++;
+            } else {
+                std::cout << "ERROR - adding aircraft to charger failed even though a charger should be available." << std::endl;
+            }
+        }
+    }
+
+    RecordChargeSiteStatistics(stats, aircraftInLineToCharge, battChargers, config.simulationTicks);
+    fleet.storeTo(aircrafts);
+}
+
+uint32_t CountMismatchedAircraft(const Aircraft* expected, const Aircraft* actual, uint32_t numAircraft) {
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < numAircraft; i++) {
+        const Aircraft& a = expected[i];
+        const Aircraft& b = actual[i];
+        if ((a.m_state != b.m_state) || (a.m_airTimeTicks != b.m_airTimeTicks) ||
+            (a.m_numFlights != b.m_numFlights) || (a.m_chargeTimeTicks != b.m_chargeTimeTicks) ||
+            (a.m_numChargeSessions != b.m_numChargeSessions) || (a.m_numFaults != b.m_numFaults) ||
+            (a.m_maintenanceTimeTicks != b.m_maintenanceTimeTicks) || (a.m_stateOfCharge != b.m_stateOfCharge) || (IsLegInProgress(&a) && (a.m_legEndTick != b.m_legEndTick))) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+static bool DurationsMatch(const DurationStatistic& a, const DurationStatistic& b) {
+    return (a.getHistogram().getCount() == b.getHistogram().getCount()) &&
+           (a.getHistogram().getTotalTicks() == b.getHistogram().getTotalTicks()) &&
+           (a.getHistogram().getPercentileTicks(99.0) == b.getHistogram().getPercentileTicks(99.0));
+}
+
+static bool SitesMatch(const charge_site_statistics_t& a, const charge_site_statistics_t& b) {
+    return (a.queueLength.getLevelTicks() == b.queueLength.getLevelTicks()) &&
+           (a.queueLength.getMax() == b.queueLength.getMax()) &&
+           (a.chargersInUse.getLevelTicks() == b.chargersInUse.getLevelTicks()) &&
+           (a.chargerTicks == b.chargerTicks);
+}
+
+// Returns the number of companies whose recorded flights, charge sessions, waits or repairs differ, plus one for each site that differs
+uint32_t CountMismatchedStatistics(const SimulationStatistics& a, const SimulationStatistics& b) {
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+        const company_statistics_t& companyA = a.getCompany((aircraft_id_t) i);
+        const company_statistics_t& companyB = b.getCompany((aircraft_id_t) i);
+        if (!DurationsMatch(companyA.flights, companyB.flights) ||
+            !DurationsMatch(companyA.chargeSessions, companyB.chargeSessions) ||
+            !DurationsMatch(companyA.waits, companyB.waits) ||
+            !DurationsMatch(companyA.repairs, companyB.repairs)) {
+            mismatches++;
+        }
+    }
+    mismatches += !SitesMatch(a.getChargeSite(), b.getChargeSite());
+    mismatches += !SitesMatch(a.getRepairSite(), b.getRepairSite());
+    return mismatches;
+}
+
+/** Function to test that the event-driven, SoA and analytic engines match the tick
+ * loop. All engines run the same fleet, one of each company in turn, with the same seed
+ * for several horizons, and every per-aircraft counter must match, faults included.
+ * Every charger scheduling policy other than FIFO is checked over a 24 hr horizon. */
+void SimulationEngineTest(void) {
+    typedef struct {
+        uint32_t horizon;
+        charge_policy_t policy;
+        float chargeTargetSoc;
+    } engine_test_case_t;
+    const engine_test_case_t testCases[] = {
+        {SIMULATION_TICKS_1HR, CHARGE_POLICY_FIFO, 1.0f}, {SIMULATION_TICKS_2HR, CHARGE_POLICY_FIFO, 1.0f},
+        {SIMULATION_TICKS_3HR, CHARGE_POLICY_FIFO, 1.0f}, {24u * SIMULATION_TICKS_1HR, CHARGE_POLICY_FIFO, 1.0f},
+        {24u * SIMULATION_TICKS_1HR, CHARGE_POLICY_SHORTEST_CHARGE_FIRST, 1.0f},
+        {24u * SIMULATION_TICKS_1HR, CHARGE_POLICY_MOST_PASSENGER_MILES, 1.0f},
+        {24u * SIMULATION_TICKS_1HR, CHARGE_POLICY_AGING, 1.0f},
+        {24u * SIMULATION_TICKS_1HR, CHARGE_POLICY_FIFO, 0.8f},
+        {24u * SIMULATION_TICKS_1HR, CHARGE_POLICY_AGING, 0.5f},
+    };
+
+    for (const engine_test_case_t& testCase : testCases) {
+        simulation_config_t config = DefaultSimulationConfig();
+        config.simulationTicks = testCase.horizon;
+        config.policy = testCase.policy;
+        config.chargeTargetSoc = testCase.chargeTargetSoc;
+
+        Aircraft tickAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+        for (uint8_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+            tickAircrafts[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+        }
+        Aircraft eventAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+        Aircraft soaAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+        Aircraft analyticAircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+        std::copy(tickAircrafts, tickAircrafts + DEFAULT_AIRCRAFTS_IN_SIMULATION, eventAircrafts);
+        std::copy(tickAircrafts, tickAircrafts + DEFAULT_AIRCRAFTS_IN_SIMULATION, soaAircrafts);
+        std::copy(tickAircrafts, tickAircrafts + DEFAULT_AIRCRAFTS_IN_SIMULATION, analyticAircrafts);
+
+        SimulationStatistics tickStats, eventStats, soaStats;
+        RunTickSimulation(tickAircrafts, config, &tickStats);
+        RunEventSimulation(eventAircrafts, config, &eventStats);
+        RunSoaSimulation(soaAircrafts, config, &soaStats);
+        RunAnalyticSimulation(analyticAircrafts, config);
+
+        // the streaming statistics have to agree too, so a mismatched company counts as a mismatched aircraft
+        uint32_t eventMismatches = CountMismatchedAircraft(tickAircrafts, eventAircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION) +
+                                   CountMismatchedStatistics(tickStats, eventStats);
+        uint32_t soaMismatches = CountMismatchedAircraft(tickAircrafts, soaAircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION) +
+                                 CountMismatchedStatistics(tickStats, soaStats);
+        uint32_t analyticMismatches = CountMismatchedAircraft(tickAircrafts, analyticAircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION); // no statistics in analytic mode
+        std::cout << "Engine test, " << testCase.horizon / SIMULATION_TICKS_1HR << " hr, " << GetChargePolicyName(config.policy) << ", " <<
+            config.chargeTargetSoc * 100.0f << " % charge: " <<
+            "event engine " << ((eventMismatches == 0) ? "PASS" : "FAIL") << " (" << eventMismatches << " mismatched aircraft), " <<
+            "SoA engine " << ((soaMismatches == 0) ? "PASS" : "FAIL") << " (" << soaMismatches << " mismatched aircraft), " <<
+            "analytic " << ((analyticMismatches == 0) ? "PASS" : "FAIL") << " (" << analyticMismatches << " mismatched aircraft)" <<
+            std::endl;
+    }
+}
@@ -2,4 +2,32 @@
 
 #pragma once
 
-void RunSimulation(void);
\ No newline at end of file
+#include <cstdint>
+#include <vector>
+
+#include "Aircraft.h"
+#include "Config.h"
+#include "Demand.h"
+#include "Network.h"
+#include "Statistics.h"
+#include "Timeline.h"
+
+bool RunSimulation(const simulation_config_t& config); // runs and writes the output file, false if the run couldn't start
+
+/** The engines record every completed flight, charge session and wait in line into
+ * stats as it happens, when stats is not null. The analytic fast path doesn't step
+ * through every transition and records nothing into stats. Likewise every state
+ * transition is recorded into timeline when it is not null, except by the analytic
+ * fast path and the vertiport network. With more than one vertiport in the config,
+ * RunSimulationEngine() runs the network of Network.h whatever the mode, whose per-site
+ * summaries go to vertiports when not null, and with config.tripRequestsPerHour the
+ * demand model, whose summary goes to demand when not null. */
+void RunSimulationEngine(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats = nullptr,
+                         TimelineRecorder* timeline = nullptr, demand_summary_t* demand = nullptr,
+                         std::vector<vertiport_summary_t>* vertiports = nullptr); // runs the engine selected by config.mode
+void RunTickSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats = nullptr, TimelineRecorder* timeline = nullptr);
+void RunEventSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats = nullptr, TimelineRecorder* timeline = nullptr);
+void RunSoaSimulation(Aircraft* aircrafts, const simulation_config_t& config, SimulationStatistics* stats = nullptr, TimelineRecorder* timeline = nullptr);
+uint32_t CountMismatchedAircraft(const Aircraft* expected, const Aircraft* actual, uint32_t numAircraft); // aircraft whose state or any counter differs
+uint32_t CountMismatchedStatistics(const SimulationStatistics& a, const SimulationStatistics& b); // companies whose durations differ, plus one for each of the charge and repair sites
+void SimulationEngineTest(void);
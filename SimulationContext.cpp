@@ -0,0 +1,223 @@
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "SimulationContext.h"
+
+#include "AircraftCompanyCommon.h"
+#include "RandomGen.h"
+#include "Simulation.h"
+
+SimulationContext::SimulationContext()
+{
+  m_config = DefaultSimulationConfig();
+  m_demand = demand_summary_t();
+  m_created = false;
+  m_finished = false;
+}
+
+bool SimulationContext::create(const simulation_config_t& config) {
+  m_eventSim.reset();
+  m_aircrafts.clear();
+  m_vertiports.clear();
+  m_created = false;
+  m_finished = false;
+
+  if (config.numAircraft < GetNumCompanies()) {
+    std::cout << "ERROR - " << config.numAircraft << " aircraft can't cover the " << GetNumCompanies() << " companies of the catalog" << std::endl;
+    return false;
+  }
+  if ((config.numRepairBays > 0) && ((config.mode == SIMULATION_MODE_ANALYTIC) || (config.numVertiports > 1) || (config.tripRequestsPerHour > 0.0))) {
+    std::cout << "ERROR - repair bays run on the tick, event or soa engine at a single site, without demand" << std::endl;
+    return false;
+  }
+  if ((config.tripRequestsPerHour > 0.0) && (config.numVertiports > 1)) {
+    std::cout << "ERROR - the demand model runs at a single site" << std::endl;
+    return false;
+  }
+
+  m_config = config;
+  m_aircrafts.assign(config.numAircraft, Aircraft());
+  if (CreateRandomAircraftIds(m_aircrafts.data(), config.numAircraft, config.seed) == false) {
+    std::cout << "ERROR - the fleet drawn from seed " << config.seed << " misses a company, draw it from another seed" << std::endl;
+    m_aircrafts.clear();
+    return false;
+  }
+  m_stats = SimulationStatistics(); // sized for the catalog loaded now
+  m_demand = demand_summary_t();
+
+  bool runsToCompletion = (config.mode == SIMULATION_MODE_ANALYTIC) || (config.numVertiports > 1) || (config.tripRequestsPerHour > 0.0);
+  if (runsToCompletion == false) {
+    m_eventSim.reset(new EventSimulation(m_aircrafts.data(), m_config, &m_stats));
+    m_eventSim->start(true);
+  }
+  m_created = true;
+  return true;
+}
+
+void SimulationContext::finish(void) {
+  if (m_eventSim != nullptr) {
+    m_eventSim->finish(m_config.simulationTicks);
+  } else {
+    RunSimulationEngine(m_aircrafts.data(), m_config, &m_stats, nullptr, &m_demand, &m_vertiports);
+  }
+  m_finished = true;
+}
+
+bool SimulationContext::step(void) {
+  if ((m_created == false) || m_finished) {
+    return false;
+  }
+  if ((m_eventSim != nullptr) && m_eventSim->step(m_config.simulationTicks)) {
+    return true;
+  }
+  finish();
+  return false;
+}
+
+bool SimulationContext::advanceTo(uint32_t tick) {
+  if ((m_created == false) || m_finished) {
+    return false;
+  }
+  if ((m_eventSim != nullptr) && (tick < m_config.simulationTicks)) {
+    while (m_eventSim->step(tick)) {
+    }
+    return true;
+  }
+  run();
+  return false;
+}
+
+void SimulationContext::run(void) {
+  while (step()) {
+  }
+}
+
+uint32_t SimulationContext::getCurrentTick(void) const {
+  if (m_finished) {
+    return m_config.simulationTicks;
+  }
+  return (m_eventSim != nullptr) ? m_eventSim->getCurrentTick() : 0u;
+}
+
+void SimulationContext::getResults(data_avgs_and_totals_t results[MAX_AIRCRAFT_COMPANIES]) const {
+  // only reads the fleet, the const_cast is for the output code's signature
+  double passengerMiles[MAX_AIRCRAFT_COMPANIES];
+  bool withDemand = (m_config.tripRequestsPerHour > 0.0);
+  if (withDemand) {
+    GetDemandPassengerMiles(m_demand, passengerMiles);
+  }
+  ComputeDataAveragesAndTotals(results, const_cast<Aircraft*>(m_aircrafts.data()), getNumAircraft(), withDemand ? passengerMiles : nullptr);
+}
+
+void SimulationContext::writeResults(std::ostream& out) const {
+  bool haveStats = (m_config.mode != SIMULATION_MODE_ANALYTIC) || (m_config.numVertiports > 1);
+  double passengerMiles[MAX_AIRCRAFT_COMPANIES];
+  bool withDemand = (m_config.tripRequestsPerHour > 0.0);
+  if (withDemand) {
+    GetDemandPassengerMiles(m_demand, passengerMiles);
+  }
+  WriteResults(out, const_cast<Aircraft*>(m_aircrafts.data()), getNumAircraft(), haveStats ? &m_stats : nullptr,
+               withDemand ? passengerMiles : nullptr);
+  if (m_vertiports.empty() == false) {
+    WriteVertiportStatistics(out, m_vertiports);
+  }
+  if (withDemand) {
+    WriteDemandStatistics(out, m_demand);
+  }
+}
+
+/** Function to test the library entry point. A context stepped one tick at a time, and
+ * one advanced an hour at a time, must match the tick loop, statistics included. Eight
+ * contexts run at once on their own threads must write the same results as when they
+ * run one after another. A config that can't run is refused without exiting. */
+void SimulationContextTest(void) {
+  simulation_config_t config = DefaultSimulationConfig();
+  config.numAircraft = 200;
+  config.numChargers = 12;
+  config.simulationTicks = 24u * LOOP_TICKS_PER_HOUR;
+  config.seed = 11;
+
+  std::vector<Aircraft> tickAircrafts(config.numAircraft);
+  CreateRandomAircraftIds(tickAircrafts.data(), config.numAircraft, config.seed);
+  SimulationStatistics tickStats;
+  RunTickSimulation(tickAircrafts.data(), config, &tickStats);
+
+  SimulationContext stepped;
+  bool stepPass = stepped.create(config) && stepped.isSteppable();
+  uint32_t previousTick = 0;
+  uint32_t numSteps = 0;
+  while (stepPass && stepped.step()) {
+    stepPass = (stepped.getCurrentTick() > previousTick) && (stepped.getCurrentTick() <= config.simulationTicks);
+    previousTick = stepped.getCurrentTick();
+    numSteps++;
+  }
+  stepPass = stepPass && stepped.isFinished() && (numSteps > 0) && (stepped.step() == false) &&
+             (CountMismatchedAircraft(tickAircrafts.data(), stepped.getAircrafts(), config.numAircraft) == 0) &&
+             (CountMismatchedStatistics(tickStats, stepped.getStatistics()) == 0);
+
+  SimulationContext hourly;
+  bool advancePass = hourly.create(config);
+  for (uint32_t hour = 1; advancePass && (hour < 24u); hour++) {
+    advancePass = hourly.advanceTo(hour * LOOP_TICKS_PER_HOUR) && (hourly.getCurrentTick() <= hour * LOOP_TICKS_PER_HOUR);
+  }
+  advancePass = advancePass && (hourly.advanceTo(config.simulationTicks) == false) && hourly.isFinished() &&
+                (CountMismatchedAircraft(tickAircrafts.data(), hourly.getAircrafts(), config.numAircraft) == 0) &&
+                (CountMismatchedStatistics(tickStats, hourly.getStatistics()) == 0);
+  std::cout << "Simulation context step test: " << ((stepPass && advancePass) ? "PASS" : "FAIL") <<
+    " (" << numSteps << " steps)" << std::endl;
+
+  // every engine, run at once and one after another
+  const uint32_t numContexts = 8;
+  simulation_config_t configs[numContexts];
+  for (uint32_t i = 0; i < numContexts; i++) {
+    configs[i] = config;
+    configs[i].seed = DeriveSeed(config.seed, i, 0);
+    configs[i].mode = (i % 3 == 0) ? SIMULATION_MODE_TICK : ((i % 3 == 1) ? SIMULATION_MODE_EVENT : SIMULATION_MODE_ANALYTIC);
+  }
+  configs[3].numVertiports = 3;
+  configs[4].tripRequestsPerHour = 300.0;
+  configs[5].numRepairBays = 2;
+  configs[5].mode = SIMULATION_MODE_EVENT;
+
+  std::string serialResults[numContexts];
+  bool createPass = true;
+  for (uint32_t i = 0; i < numContexts; i++) {
+    SimulationContext context;
+    createPass = createPass && context.create(configs[i]);
+    context.run();
+    std::ostringstream out;
+    context.writeResults(out);
+    serialResults[i] = out.str();
+  }
+  std::string parallelResults[numContexts];
+  {
+    SimulationContext contexts[numContexts];
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < numContexts; i++) {
+      createPass = createPass && contexts[i].create(configs[i]);
+    }
+    for (uint32_t i = 0; i < numContexts; i++) {
+      threads.emplace_back([&contexts, &parallelResults, i] {
+        contexts[i].run();
+        std::ostringstream out;
+        contexts[i].writeResults(out);
+        parallelResults[i] = out.str();
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+  bool parallelPass = createPass;
+  for (uint32_t i = 0; i < numContexts; i++) {
+    parallelPass = parallelPass && (serialResults[i].empty() == false) && (parallelResults[i] == serialResults[i]);
+  }
+  std::cout << "Simulation context parallel test: " << (parallelPass ? "PASS" : "FAIL") << std::endl;
+
+  simulation_config_t badConfig = config;
+  badConfig.numAircraft = GetNumCompanies() - 1;
+  SimulationContext refused;
+  bool refusePass = (refused.create(badConfig) == false) && (refused.isCreated() == false) && (refused.step() == false);
+  std::cout << "Simulation context refused config test: " << (refusePass ? "PASS" : "FAIL") << std::endl;
+}
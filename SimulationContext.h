@@ -0,0 +1,78 @@
+/** Defines SimulationContext, the way into libevtolsim for programs that embed the
+ * simulator instead of running it as a process. A context owns everything one run
+ * needs: a copy of the config, the fleet, the engine with its chargers and charge line,
+ * and the statistics it records into. The random draws are counter-based streams of
+ * config.seed, so a context's randomness is its seed and nothing else. Contexts share
+ * no state, so any number of them can run at once, one per thread. The library never
+ * exits the process; a context that can't be created says why and create() returns
+ * false.
+ *
+ * What the process shares is set up once before the contexts start: the company
+ * catalog (LoadCompanyCatalog() in AircraftCompanyCommon.h), and the trace and metrics
+ * page if the program wants them. The output, checkpoint, sweep, timeline, metrics and
+ * trace fields of the config are options of the program and a context ignores them.
+ *
+ * The tick, event and SoA modes give the same results, so a context runs all three
+ * with the event engine and can step it one tick with transitions at a time, or up to
+ * a given tick, and look at the fleet in between. Until the run finishes, the counters
+ * only hold completed legs. The analytic mode, the demand model and the vertiport
+ * network only run to completion, on the first step() or run(). */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "Aircraft.h"
+#include "Config.h"
+#include "Demand.h"
+#include "EventSimulation.h"
+#include "Network.h"
+#include "Output.h"
+#include "Statistics.h"
+
+class SimulationContext
+{
+public:
+  SimulationContext();
+  SimulationContext(const SimulationContext&) = delete; // the engine points at the fleet and statistics
+  SimulationContext& operator=(const SimulationContext&) = delete;
+
+  /** Draws the fleet from config.seed and takes off every aircraft at tick 0. Prints an
+   * error and returns false, leaving the context empty, if the config can't be run or
+   * the fleet drawn from the seed misses a company; the batch runner draws again from
+   * DeriveSeed() in that case, a caller can do the same. */
+  bool create(const simulation_config_t& config);
+  bool step(void); // handles the next tick with any transition, false once the run has finished
+  bool advanceTo(uint32_t tick); // handles every transition up to tick, false once the run has finished
+  void run(void); // to the horizon
+
+  bool isCreated(void) const {return m_created;}
+  bool isFinished(void) const {return m_finished;}
+  bool isSteppable(void) const {return (m_eventSim != nullptr);} // false for the engines that only run to completion
+  uint32_t getCurrentTick(void) const; // last tick handled, the horizon once finished
+  const simulation_config_t& getConfig(void) const {return m_config;}
+  uint32_t getNumAircraft(void) const {return (uint32_t) m_aircrafts.size();}
+  const Aircraft* getAircrafts(void) const {return m_aircrafts.data();}
+  const SimulationStatistics& getStatistics(void) const {return m_stats;} // empty in analytic mode
+  const demand_summary_t& getDemandSummary(void) const {return m_demand;} // with config.tripRequestsPerHour, once finished
+  const std::vector<vertiport_summary_t>& getVertiports(void) const {return m_vertiports;} // with vertiports, once finished
+  void getResults(data_avgs_and_totals_t results[MAX_AIRCRAFT_COMPANIES]) const; // per company, as in the output file
+  void writeResults(std::ostream& out) const; // what the program writes to its output file for a single run
+
+private:
+  void finish(void);
+
+  simulation_config_t m_config;
+  std::vector<Aircraft> m_aircrafts;
+  SimulationStatistics m_stats;
+  std::unique_ptr<EventSimulation> m_eventSim; // null for the engines that only run to completion
+  demand_summary_t m_demand;
+  std::vector<vertiport_summary_t> m_vertiports;
+  bool m_created;
+  bool m_finished;
+};
+
+void SimulationContextTest(void);
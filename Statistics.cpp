@@ -0,0 +1,209 @@
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "Statistics.h"
+
+void WelfordAccumulator::add(double value, uint64_t count) {
+  WelfordAccumulator repeated;
+  repeated.m_count = count;
+  repeated.m_mean = value;
+  merge(repeated);
+}
+
+void WelfordAccumulator::merge(const WelfordAccumulator& other) {
+  if (other.m_count == 0) {
+    return;
+  }
+  uint64_t count = m_count + other.m_count;
+  double delta = other.m_mean - m_mean;
+  m_mean += delta * ((double) other.m_count / count);
+  m_sumSquaredDiffs += other.m_sumSquaredDiffs + delta * delta * (((double) m_count * other.m_count) / count);
+  m_count = count;
+}
+
+double WelfordAccumulator::getConfidenceHalfWidth95(void) const {
+  if (m_count < 2) {
+    return 0.0;
+  }
+  return 1.96 * std::sqrt(getVariance() / m_count);
+}
+
+DurationHistogram::DurationHistogram() {
+  memset(m_buckets, 0, sizeof(m_buckets));
+  m_count = 0;
+  m_totalTicks = 0;
+  m_minTicks = UINT32_MAX;
+  m_maxTicks = 0;
+}
+
+uint32_t DurationHistogram::bucketIndex(uint32_t ticks) {
+  if (ticks < (2u * DURATION_HISTOGRAM_SUB_BUCKETS)) {
+    return ticks;
+  }
+  uint32_t msb = 31u - __builtin_clz(ticks);
+  uint32_t shift = msb - DURATION_HISTOGRAM_SUB_BUCKET_BITS;
+  uint32_t subBucket = (ticks >> shift) - DURATION_HISTOGRAM_SUB_BUCKETS;
+  return (2u * DURATION_HISTOGRAM_SUB_BUCKETS) + ((msb - DURATION_HISTOGRAM_SUB_BUCKET_BITS - 1u) * DURATION_HISTOGRAM_SUB_BUCKETS) + subBucket;
+}
+
+uint32_t DurationHistogram::bucketLowestTicks(uint32_t index) {
+  if (index < (2u * DURATION_HISTOGRAM_SUB_BUCKETS)) {
+    return index;
+  }
+  uint32_t offset = index - (2u * DURATION_HISTOGRAM_SUB_BUCKETS);
+  uint32_t shift = (offset / DURATION_HISTOGRAM_SUB_BUCKETS) + 1u;
+  uint32_t subBucket = DURATION_HISTOGRAM_SUB_BUCKETS + (offset % DURATION_HISTOGRAM_SUB_BUCKETS);
+  return subBucket << shift;
+}
+
+void DurationHistogram::add(uint32_t ticks, uint64_t count) {
+  if (count == 0) {
+    return;
+  }
+  m_buckets[bucketIndex(ticks)] += count;
+  m_count += count;
+  m_totalTicks += (uint64_t) ticks * count;
+  if (ticks < m_minTicks) {
+    m_minTicks = ticks;
+  }
+  if (ticks > m_maxTicks) {
+    m_maxTicks = ticks;
+  }
+}
+
+void DurationHistogram::merge(const DurationHistogram& other) {
+  for (uint32_t i = 0; i < DURATION_HISTOGRAM_BUCKETS; i++) {
+    m_buckets[i] += other.m_buckets[i];
+  }
+  m_count += other.m_count;
+  m_totalTicks += other.m_totalTicks;
+  if (other.m_minTicks < m_minTicks) {
+    m_minTicks = other.m_minTicks;
+  }
+  if (other.m_maxTicks > m_maxTicks) {
+    m_maxTicks = other.m_maxTicks;
+  }
+}
+
+/** Walks the buckets up to the requested rank and reports the middle of that bucket,
+ * clamped to the smallest and largest recorded values. */
+uint32_t DurationHistogram::getPercentileTicks(double percentile) const {
+  if (m_count == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t) std::ceil((percentile / 100.0) * m_count);
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < DURATION_HISTOGRAM_BUCKETS; i++) {
+    seen += m_buckets[i];
+    if (seen >= rank) {
+      uint32_t low = bucketLowestTicks(i);
+      uint32_t width = 1u;
+      if (i >= (2u * DURATION_HISTOGRAM_SUB_BUCKETS)) {
+        width = 1u << (((i - (2u * DURATION_HISTOGRAM_SUB_BUCKETS)) / DURATION_HISTOGRAM_SUB_BUCKETS) + 1u);
+      }
+      uint64_t value = low + (width / 2u);
+      if (value < m_minTicks) {
+        value = m_minTicks;
+      }
+      if (value > m_maxTicks) {
+        value = m_maxTicks;
+      }
+      return (uint32_t) value;
+    }
+  }
+  return m_maxTicks;
+}
+
+void DurationStatistic::add(uint32_t ticks, uint64_t count) {
+  m_minutes.add(ticks / (double) LOOP_TICKS_PER_MIN, count);
+  m_histogram.add(ticks, count);
+}
+
+void DurationStatistic::merge(const DurationStatistic& other) {
+  m_minutes.merge(other.m_minutes);
+  m_histogram.merge(other.m_histogram);
+}
+
+void SimulationStatistics::recordChargeSite(const TimeWeightedStatistic& queueLength, const TimeWeightedStatistic& chargersInUse, uint32_t numChargers) {
+  m_chargeSite.queueLength.merge(queueLength);
+  m_chargeSite.chargersInUse.merge(chargersInUse);
+  m_chargeSite.chargerTicks += chargersInUse.getTotalTicks() * numChargers;
+}
+
+void SimulationStatistics::recordRepairSite(const TimeWeightedStatistic& queueLength, const TimeWeightedStatistic& baysInUse, uint32_t numBays) {
+  m_repairSite.queueLength.merge(queueLength);
+  m_repairSite.chargersInUse.merge(baysInUse);
+  m_repairSite.chargerTicks += baysInUse.getTotalTicks() * numBays;
+}
+
+void SimulationStatistics::merge(const SimulationStatistics& other) {
+  for (size_t i = 0; i < m_companies.size(); i++) {
+    m_companies[i].flights.merge(other.m_companies[i].flights);
+    m_companies[i].chargeSessions.merge(other.m_companies[i].chargeSessions);
+    m_companies[i].waits.merge(other.m_companies[i].waits);
+    m_companies[i].repairs.merge(other.m_companies[i].repairs);
+  }
+  m_chargeSite.queueLength.merge(other.m_chargeSite.queueLength);
+  m_chargeSite.chargersInUse.merge(other.m_chargeSite.chargersInUse);
+  m_chargeSite.chargerTicks += other.m_chargeSite.chargerTicks;
+  m_repairSite.queueLength.merge(other.m_repairSite.queueLength);
+  m_repairSite.chargersInUse.merge(other.m_repairSite.chargersInUse);
+  m_repairSite.chargerTicks += other.m_repairSite.chargerTicks;
+}
+
+double SimulationStatistics::getChargerUtilization(void) const {
+  if (m_chargeSite.chargerTicks == 0) {
+    return 0.0;
+  }
+  return m_chargeSite.chargersInUse.getLevelTicks() / (double) m_chargeSite.chargerTicks;
+}
+
+double SimulationStatistics::getRepairBayUtilization(void) const {
+  if (m_repairSite.chargerTicks == 0) {
+    return 0.0;
+  }
+  return m_repairSite.chargersInUse.getLevelTicks() / (double) m_repairSite.chargerTicks;
+}
+
+/** Function to test the accumulators. Merging two halves must give the same mean and
+ * variance as adding everything to one accumulator, and the histogram percentiles of
+ * 1..10000 ticks must be within the bucket precision of the exact values. */
+void StatisticsTest(void) {
+  WelfordAccumulator all, firstHalf, secondHalf;
+  DurationHistogram histogram, histogramFirstHalf, histogramSecondHalf;
+  for (uint32_t ticks = 1; ticks <= 10000; ticks++) {
+    all.add(ticks);
+    histogram.add(ticks);
+    if (ticks <= 5000) {
+      firstHalf.add(ticks);
+      histogramFirstHalf.add(ticks);
+    } else {
+      secondHalf.add(ticks);
+      histogramSecondHalf.add(ticks);
+    }
+  }
+  firstHalf.merge(secondHalf);
+  histogramFirstHalf.merge(histogramSecondHalf);
+
+  bool welfordPass = (std::fabs(firstHalf.getMean() - all.getMean()) < 1e-9) &&
+                     (std::fabs(firstHalf.getVariance() - all.getVariance()) < 1e-6 * all.getVariance()) &&
+                     (std::fabs(all.getMean() - 5000.5) < 1e-9);
+
+  bool histogramPass = (histogram.getTotalTicks() == 50005000ull) && (histogramFirstHalf.getCount() == 10000u);
+  const double percentiles[] = {1.0, 50.0, 90.0, 99.0, 99.9};
+  for (double percentile : percentiles) {
+    double exact = percentile * 100.0;
+    double relativeError = std::fabs(histogram.getPercentileTicks(percentile) - exact) / exact;
+    histogramPass = histogramPass && (relativeError <= (1.0 / DURATION_HISTOGRAM_SUB_BUCKETS)) &&
+                    (histogram.getPercentileTicks(percentile) == histogramFirstHalf.getPercentileTicks(percentile));
+  }
+
+  std::cout << "Welford merge test: " << (welfordPass ? "PASS" : "FAIL") << std::endl;
+  std::cout << "Duration histogram test: " << (histogramPass ? "PASS" : "FAIL") <<
+    " (p50 " << histogram.getPercentileTicks(50.0) << ", p99 " << histogram.getPercentileTicks(99.0) << " ticks)" << std::endl;
+}
@@ -0,0 +1,153 @@
+/** Defines the streaming statistics accumulators. Instead of summing per-aircraft
+ * counters into floats after the run, the engines report every completed flight,
+ * charge session and wait in line as it happens. Every accumulator uses a fixed
+ * amount of memory no matter how long the run is, can be read at any time during
+ * the run, and can be merged with the accumulators of other threads or replications.
+ *
+ * Durations are recorded in integer loop ticks, so totals stay exact and are only
+ * converted to minutes when they are read. */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "AircraftCompanyCommon.h"
+
+// Mean and variance using Welford's update; merging uses the parallel form by Chan et al.
+class WelfordAccumulator
+{
+public:
+  WelfordAccumulator() {m_count = 0; m_mean = 0.0; m_sumSquaredDiffs = 0.0;}
+  void add(double value) {
+    m_count++;
+    double delta = value - m_mean;
+    m_mean += delta / m_count;
+    m_sumSquaredDiffs += delta * (value - m_mean);
+  }
+  void add(double value, uint64_t count); // same as calling add(value) count times
+  void merge(const WelfordAccumulator& other);
+  uint64_t getCount(void) const {return m_count;}
+  double getMean(void) const {return m_mean;}
+  double getVariance(void) const {return (m_count > 1) ? (m_sumSquaredDiffs / (m_count - 1)) : 0.0;}
+  double getConfidenceHalfWidth95(void) const; // normal approximation, 1.96 standard errors
+
+private:
+  uint64_t m_count;
+  double m_mean;
+  double m_sumSquaredDiffs;
+};
+
+/** Log-linear histogram of tick durations in the style of HdrHistogram. Values below
+ * 2 * DURATION_HISTOGRAM_SUB_BUCKETS are counted exactly; above that every power of two
+ * is split into DURATION_HISTOGRAM_SUB_BUCKETS buckets, so a percentile is within
+ * 1 / DURATION_HISTOGRAM_SUB_BUCKETS (about 3%) of the true value. */
+#define DURATION_HISTOGRAM_SUB_BUCKET_BITS (5u)
+#define DURATION_HISTOGRAM_SUB_BUCKETS (1u << DURATION_HISTOGRAM_SUB_BUCKET_BITS)
+#define DURATION_HISTOGRAM_BUCKETS (2u * DURATION_HISTOGRAM_SUB_BUCKETS + (31u - DURATION_HISTOGRAM_SUB_BUCKET_BITS) * DURATION_HISTOGRAM_SUB_BUCKETS)
+
+class DurationHistogram
+{
+public:
+  DurationHistogram();
+  void add(uint32_t ticks, uint64_t count = 1);
+  void merge(const DurationHistogram& other);
+  uint64_t getCount(void) const {return m_count;}
+  uint64_t getTotalTicks(void) const {return m_totalTicks;}
+  uint32_t getMinTicks(void) const {return m_minTicks;}
+  uint32_t getMaxTicks(void) const {return m_maxTicks;}
+  uint32_t getPercentileTicks(double percentile) const; // percentile in [0, 100], 0 when empty
+
+private:
+  static uint32_t bucketIndex(uint32_t ticks);
+  static uint32_t bucketLowestTicks(uint32_t index);
+
+  uint64_t m_buckets[DURATION_HISTOGRAM_BUCKETS];
+  uint64_t m_count;
+  uint64_t m_totalTicks;
+  uint32_t m_minTicks;
+  uint32_t m_maxTicks;
+};
+
+// Everything tracked for one kind of duration: exact total, mean/variance in minutes and the distribution
+class DurationStatistic
+{
+public:
+  void add(uint32_t ticks, uint64_t count = 1);
+  void merge(const DurationStatistic& other);
+  const WelfordAccumulator& getMinutes(void) const {return m_minutes;}
+  const DurationHistogram& getHistogram(void) const {return m_histogram;}
+  double getPercentileMin(double percentile) const {return m_histogram.getPercentileTicks(percentile) / (double) LOOP_TICKS_PER_MIN;}
+
+private:
+  WelfordAccumulator m_minutes;
+  DurationHistogram m_histogram;
+};
+
+/** Time-weighted distribution of a level that changes over time, such as the charge
+ * queue length or the number of chargers in use. Each level is weighted by the number
+ * of ticks it was held, so a level that only lasted within a single tick counts for
+ * nothing. update() must be called with non-decreasing ticks, and finish() closes the
+ * last interval at the end of the run. */
+class TimeWeightedStatistic
+{
+public:
+  TimeWeightedStatistic() {m_lastTick = 0; m_level = 0;}
+  void update(uint32_t tick, uint32_t level) {
+    m_levels.add(m_level, tick - m_lastTick);
+    m_lastTick = tick;
+    m_level = level;
+  }
+  void finish(uint32_t tick) {update(tick, m_level);}
+  void merge(const TimeWeightedStatistic& other) {m_levels.merge(other.m_levels);}
+  uint64_t getTotalTicks(void) const {return m_levels.getCount();}
+  uint64_t getLevelTicks(void) const {return m_levels.getTotalTicks();} // sum of level * ticks held
+  double getMean(void) const {return (m_levels.getCount() > 0) ? (m_levels.getTotalTicks() / (double) m_levels.getCount()) : 0.0;}
+  uint32_t getPercentile(double percentile) const {return m_levels.getPercentileTicks(percentile);}
+  uint32_t getMax(void) const {return (m_levels.getCount() > 0) ? m_levels.getMaxTicks() : 0;}
+
+private:
+  DurationHistogram m_levels; // the histogram values are levels, and the counts are ticks spent at that level
+  uint32_t m_lastTick;
+  uint32_t m_level;
+};
+
+typedef struct {
+  TimeWeightedStatistic queueLength; // aircraft waiting in line for a charger
+  TimeWeightedStatistic chargersInUse;
+  uint64_t chargerTicks; // number of chargers times the ticks simulated, the denominator of utilization
+} charge_site_statistics_t; // also used for the repair bays, see Maintenance.h
+
+typedef struct {
+  DurationStatistic flights; // completed flights, takeoff to battery dead
+  DurationStatistic chargeSessions; // completed charge sessions
+  DurationStatistic waits; // time in line from battery dead until a charger was free
+  DurationStatistic repairs; // time grounded from a fault in flight until repaired, the wait for a repair bay included
+} company_statistics_t;
+
+class SimulationStatistics
+{
+public:
+  SimulationStatistics() : m_companies(GetNumCompanies()) {m_chargeSite.chargerTicks = 0; m_repairSite.chargerTicks = 0;} // one entry per company of the loaded catalog
+  void recordFlight(aircraft_id_t id, uint32_t ticks) {m_companies[id].flights.add(ticks);}
+  void recordChargeSession(aircraft_id_t id, uint32_t ticks) {m_companies[id].chargeSessions.add(ticks);}
+  void recordWait(aircraft_id_t id, uint32_t ticks) {m_companies[id].waits.add(ticks);}
+  void recordRepair(aircraft_id_t id, uint32_t ticks) {m_companies[id].repairs.add(ticks);}
+  void recordChargeSite(const TimeWeightedStatistic& queueLength, const TimeWeightedStatistic& chargersInUse, uint32_t numChargers);
+  void recordRepairSite(const TimeWeightedStatistic& queueLength, const TimeWeightedStatistic& baysInUse, uint32_t numBays);
+  void merge(const SimulationStatistics& other);
+  const company_statistics_t& getCompany(aircraft_id_t id) const {return m_companies[id];}
+  const charge_site_statistics_t& getChargeSite(void) const {return m_chargeSite;}
+  const charge_site_statistics_t& getRepairSite(void) const {return m_repairSite;} // chargerTicks counts bay ticks, 0 unless faults ground aircraft
+  void setCompany(aircraft_id_t id, const company_statistics_t& company) {m_companies[id] = company;} // restoring a checkpoint
+  void setChargeSite(const charge_site_statistics_t& chargeSite) {m_chargeSite = chargeSite;}
+  double getChargerUtilization(void) const; // fraction of charger time spent charging, 0 to 1
+  double getRepairBayUtilization(void) const; // fraction of repair bay time spent repairing, 0 to 1
+
+private:
+  std::vector<company_statistics_t> m_companies; // heap backed, the histograms are several KB each
+  charge_site_statistics_t m_chargeSite;
+  charge_site_statistics_t m_repairSite;
+};
+
+void StatisticsTest(void);
@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include "Sweep.h"
+
+#include "AircraftCompanyCommon.h"
+#include "EventSimulation.h"
+#include "Metrics.h"
+#include "Output.h"
+#include "RandomGen.h"
+#include "Statistics.h"
+#include "ThreadPool.h"
+
+typedef struct {
+  std::vector<uint32_t> aircraft; // each axis sorted ascending without repeats
+  std::vector<uint32_t> chargers;
+  std::vector<uint32_t> ticks;
+  std::vector<std::vector<uint32_t>> mixes; // in the given order, a single empty one without the axis
+} sweep_axes_t;
+
+// Shared by every run of a sweep. Each grid point is written by exactly one run.
+typedef struct {
+  const simulation_config_t* config;
+  sweep_axes_t axes;
+  std::vector<sweep_point_t>* points;
+  ThreadPool* pool;
+  std::atomic<uint32_t> numForks;
+  std::atomic<uint64_t> steps;
+} sweep_context_t;
+
+static std::vector<uint32_t> SortedAxis(const std::vector<uint32_t>& values, uint32_t single) {
+  std::vector<uint32_t> axis = values;
+  if (axis.empty()) {
+    axis.push_back(single);
+  }
+  std::sort(axis.begin(), axis.end());
+  axis.erase(std::unique(axis.begin(), axis.end()), axis.end());
+  return axis;
+}
+
+static void SummarizePoint(Aircraft* aircrafts, uint32_t numAircraft, const SimulationStatistics& stats, sweep_point_t* point) {
+  point->flights = 0;
+  point->airTimeTicks = 0;
+  point->chargeSessions = 0;
+  point->chargeTimeTicks = 0;
+  point->faults = 0;
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    point->flights += aircrafts[i].m_numFlights;
+    point->airTimeTicks += aircrafts[i].m_airTimeTicks;
+    point->chargeSessions += aircrafts[i].m_numChargeSessions;
+    point->chargeTimeTicks += aircrafts[i].m_chargeTimeTicks;
+    point->faults += aircrafts[i].m_numFaults;
+  }
+
+  data_avgs_and_totals_t averagesAndTotals[MAX_AIRCRAFT_COMPANIES];
+  ComputeDataAveragesAndTotals(averagesAndTotals, aircrafts, numAircraft);
+  DurationStatistic allWaits;
+  point->passengerMiles = 0.0;
+  for (uint32_t i = 0; i < GetNumCompanies(); i++) {
+    point->passengerMiles += averagesAndTotals[i].totalPassengerMiles;
+    allWaits.merge(stats.getCompany((aircraft_id_t) i).waits);
+  }
+  point->waits = allWaits.getHistogram().getCount();
+  point->waitTicks = allWaits.getHistogram().getTotalTicks();
+  point->p99WaitTicks = allWaits.getHistogram().getPercentileTicks(99.0);
+  point->meanQueueLength = stats.getChargeSite().queueLength.getMean();
+  point->chargerUtilization = stats.getChargerUtilization();
+}
+
+/** One run of the sweep: a fleet with its own aircraft, statistics and event engine.
+ * The run is simulated with the largest charger count it still stands in for; the
+ * smaller counts it shares its timeline with are split off as they hit contention. */
+class SweepBranch
+{
+public:
+  SweepBranch(const std::vector<Aircraft>& fleet, const simulation_config_t& config, uint32_t aircraftIndex, uint32_t mixIndex,
+              sweep_context_t* context) :
+    m_aircrafts(fleet), m_sim(m_aircrafts.data(), config, &m_stats)
+  {
+    m_context = context;
+    m_aircraftIndex = aircraftIndex;
+    m_mixIndex = mixIndex;
+    m_chargerIndex = (uint32_t) context->axes.chargers.size() - 1u;
+    for (uint32_t c = 0; c < m_chargerIndex; c++) {
+      m_sharedChargerIndices.push_back(c);
+    }
+    m_horizonIndex = 0;
+    m_pendingDispatch = false;
+    m_steps = 0;
+    m_seed = config.seed;
+    m_sim.start(true);
+  }
+
+  // Forks a copy of the parent that goes on with fewer chargers, before this tick's chargers are handed out
+  SweepBranch(const SweepBranch& parent, uint32_t chargerIndex) :
+    m_aircrafts(parent.m_aircrafts), m_stats(parent.m_stats), m_sim(parent.m_sim)
+  {
+    m_sim.rebind(m_aircrafts.data(), &m_stats);
+    m_sim.setNumChargers(parent.m_context->axes.chargers[chargerIndex]);
+    m_context = parent.m_context;
+    m_aircraftIndex = parent.m_aircraftIndex;
+    m_mixIndex = parent.m_mixIndex;
+    m_chargerIndex = chargerIndex;
+    m_horizonIndex = parent.m_horizonIndex;
+    m_pendingDispatch = true;
+    m_steps = parent.m_steps;
+    m_seed = parent.m_seed;
+  }
+
+  SweepBranch(const SweepBranch&) = delete;
+  SweepBranch& operator=(const SweepBranch&) = delete;
+
+  void run(void);
+  const Aircraft* getAircrafts(void) const {return m_aircrafts.data();}
+
+private:
+  void forkContendedChargerCounts(void);
+  void recordPoint(uint32_t chargerIndex);
+
+  std::vector<Aircraft> m_aircrafts;
+  SimulationStatistics m_stats;
+  EventSimulation m_sim; // points at m_aircrafts and m_stats, so it is declared after them
+  sweep_context_t* m_context;
+  uint32_t m_aircraftIndex;
+  uint32_t m_mixIndex;
+  uint32_t m_chargerIndex; // the charger count this run simulates
+  std::vector<uint32_t> m_sharedChargerIndices; // smaller counts that haven't hit contention yet, ascending
+  uint32_t m_horizonIndex; // next horizon to record
+  bool m_pendingDispatch; // forked between handling a tick and handing out its chargers
+  uint64_t m_steps; // ticks with events handled since tick 0, the parent's included
+  uint64_t m_seed; // fleet and fault seed
+};
+
+void SweepBranch::run(void) {
+  const std::vector<uint32_t>& horizons = m_context->axes.ticks;
+  uint64_t ownSteps = 0;
+
+  if (m_pendingDispatch) {
+    m_sim.dispatch();
+    m_pendingDispatch = false;
+  }
+  for (; m_horizonIndex < horizons.size(); m_horizonIndex++) {
+    while (m_sim.handleNextTick(horizons[m_horizonIndex])) {
+      m_steps++;
+      ownSteps++;
+      forkContendedChargerCounts();
+      m_sim.dispatch();
+      MetricsTick(m_sim.getCurrentTick(), m_aircrafts.data(), (uint32_t) m_aircrafts.size());
+    }
+    recordPoint(m_chargerIndex);
+    for (uint32_t chargerIndex : m_sharedChargerIndices) {
+      recordPoint(chargerIndex);
+    }
+  }
+  m_context->steps += ownSteps;
+}
+
+/** Every aircraft that wants a charger gets one as long as the demand fits the smaller
+ * count, so that count only starts to differ once the demand is above it. The smallest
+ * count always hits contention first. */
+void SweepBranch::forkContendedChargerCounts(void) {
+  uint32_t demand = m_sim.getChargerDemand();
+  while ((m_sharedChargerIndices.empty() == false) && (demand > m_context->axes.chargers[m_sharedChargerIndices.front()])) {
+    std::shared_ptr<SweepBranch> fork = std::make_shared<SweepBranch>(*this, m_sharedChargerIndices.front());
+    m_sharedChargerIndices.erase(m_sharedChargerIndices.begin());
+    m_context->numForks++;
+    m_context->pool->submit([fork] {fork->run();});
+  }
+}
+
+// Finishes a copy at the current horizon, so the run itself can go on to the next one
+void SweepBranch::recordPoint(uint32_t chargerIndex) {
+  const sweep_axes_t& axes = m_context->axes;
+  uint32_t simulationTicks = axes.ticks[m_horizonIndex];
+  SweepBranch finished(*this, chargerIndex);
+  finished.m_sim.finish(simulationTicks);
+
+  size_t fleetIndex = ((size_t) m_aircraftIndex * axes.mixes.size()) + m_mixIndex;
+  size_t pointIndex = ((fleetIndex * axes.chargers.size()) + chargerIndex) * axes.ticks.size() + m_horizonIndex;
+  sweep_point_t* point = &(*m_context->points)[pointIndex];
+  point->numAircraft = axes.aircraft[m_aircraftIndex];
+  point->mixIndex = m_mixIndex;
+  point->numChargers = axes.chargers[chargerIndex];
+  point->simulationTicks = simulationTicks;
+  point->seed = m_seed;
+  point->steps = m_steps;
+  SummarizePoint(finished.m_aircrafts.data(), point->numAircraft, finished.m_stats, point);
+}
+
+/** Draws the fleet from the seed like a single run does, so the rows can be checked
+ * against one. A fleet missing a company is drawn again from the next derived seed. */
+static void RunSweepFleet(sweep_context_t* context, uint32_t aircraftIndex, uint32_t mixIndex) {
+  simulation_config_t fleetConfig = *context->config;
+  fleetConfig.numAircraft = context->axes.aircraft[aircraftIndex];
+  fleetConfig.numChargers = context->axes.chargers.back();
+  fleetConfig.simulationTicks = context->axes.ticks.back();
+
+  const std::vector<uint32_t>& mix = context->axes.mixes[mixIndex];
+  uint32_t fleetIndex = aircraftIndex * (uint32_t) context->axes.mixes.size() + mixIndex;
+  std::vector<Aircraft> fleet(fleetConfig.numAircraft);
+  uint32_t attempt = 0;
+  while (CreateRandomAircraftIds(fleet.data(), fleetConfig.numAircraft, fleetConfig.seed, mix.empty() ? nullptr : mix.data()) == false) {
+    attempt++;
+    fleetConfig.seed = DeriveSeed(context->config->seed, fleetIndex, attempt);
+  }
+
+  // the fleet is what the metrics page counts as a replication, forks on other threads don't publish
+  MetricsRunStart(fleetConfig);
+  SweepBranch root(fleet, fleetConfig, aircraftIndex, mixIndex, context);
+  root.run();
+  MetricsRunFinish(root.getAircrafts(), fleetConfig.numAircraft, fleetConfig.simulationTicks);
+}
+
+void RunSweep(const simulation_config_t& config, sweep_result_t* result) {
+  sweep_context_t context;
+  context.config = &config;
+  context.axes.aircraft = SortedAxis(config.sweepAircraft, config.numAircraft);
+  context.axes.chargers = SortedAxis(config.sweepChargers, config.numChargers);
+  context.axes.ticks = SortedAxis(config.sweepTicks, config.simulationTicks);
+  context.axes.mixes = config.sweepMixes;
+  if (context.axes.mixes.empty()) {
+    context.axes.mixes.push_back(std::vector<uint32_t>());
+  }
+  context.numForks = 0;
+  context.steps = 0;
+
+  result->points.resize(context.axes.aircraft.size() * context.axes.mixes.size() * context.axes.chargers.size() * context.axes.ticks.size());
+  context.points = &result->points;
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    ThreadPool pool(config.numThreads);
+    context.pool = &pool;
+    MetricsBatchStart((uint32_t) (context.axes.aircraft.size() * context.axes.mixes.size()));
+    for (uint32_t a = 0; a < context.axes.aircraft.size(); a++) {
+      for (uint32_t m = 0; m < context.axes.mixes.size(); m++) {
+        pool.submit([&context, a, m] {RunSweepFleet(&context, a, m);});
+      }
+    }
+    pool.wait();
+  }
+  result->elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  result->numForks = context.numForks;
+  result->steps = context.steps;
+  result->unsharedSteps = 0;
+  for (const sweep_point_t& point : result->points) {
+    result->unsharedSteps += point.steps;
+  }
+}
+
+// The weights of a mix separated by colons as on the command line, "equal" without the axis
+static std::string MixName(const simulation_config_t& config, uint32_t mixIndex) {
+  if (config.sweepMixes.empty()) {
+    return "equal";
+  }
+  std::string name;
+  for (uint32_t weight : config.sweepMixes[mixIndex]) {
+    name += (name.empty() ? "" : ":") + std::to_string(weight);
+  }
+  return name;
+}
+
+void WriteSweepTable(const std::string& outputPath, const simulation_config_t& config, const sweep_result_t& result) {
+  std::ofstream myfile;
+  myfile.open(outputPath);
+  myfile << std::fixed << std::setprecision(2) <<
+    std::setw(9) << "aircraft" << std::setw(9) << "chargers" << std::setw(10) << "hours" << std::setw(22) << "seed" <<
+    std::setw(10) << "flights" << std::setw(12) << "flight hr" << std::setw(10) << "charges" << std::setw(12) << "charge hr" <<
+    std::setw(8) << "faults" << std::setw(16) << "passenger mi" << std::setw(10) << "waits" << std::setw(14) << "mean wait min" <<
+    std::setw(13) << "p99 wait min" << std::setw(12) << "mean queue" << std::setw(13) << "utilization" << "  mix\n";
+
+  for (const sweep_point_t& point : result.points) {
+    double meanWaitMin = (point.waits > 0) ? (point.waitTicks / (double) point.waits / LOOP_TICKS_PER_MIN) : 0.0;
+    myfile <<
+      std::setw(9) << point.numAircraft << std::setw(9) << point.numChargers <<
+      std::setw(10) << (point.simulationTicks / (double) LOOP_TICKS_PER_HOUR) << std::setw(22) << point.seed <<
+      std::setw(10) << point.flights << std::setw(12) << (point.airTimeTicks / (double) LOOP_TICKS_PER_HOUR) <<
+      std::setw(10) << point.chargeSessions << std::setw(12) << (point.chargeTimeTicks / (double) LOOP_TICKS_PER_HOUR) <<
+      std::setw(8) << point.faults << std::setw(16) << point.passengerMiles << std::setw(10) << point.waits <<
+      std::setw(14) << meanWaitMin << std::setw(13) << (point.p99WaitTicks / (double) LOOP_TICKS_PER_MIN) <<
+      std::setw(12) << point.meanQueueLength << std::setw(12) << (100.0 * point.chargerUtilization) << "%  " <<
+      MixName(config, point.mixIndex) << "\n";
+  }
+  myfile.close();
+}
+
+ResultChunk GetSweepResultChunk(const sweep_result_t& result) {
+  ResultChunk chunk(RESULT_TABLE_SWEEP);
+  result_value_t row[16];
+  for (const sweep_point_t& point : result.points) {
+    row[0].u64 = point.numAircraft;
+    row[1].u64 = point.mixIndex;
+    row[2].u64 = point.numChargers;
+    row[3].f64 = point.simulationTicks / (double) LOOP_TICKS_PER_HOUR;
+    row[4].u64 = point.seed;
+    row[5].u64 = point.flights;
+    row[6].f64 = point.airTimeTicks / (double) LOOP_TICKS_PER_HOUR;
+    row[7].u64 = point.chargeSessions;
+    row[8].f64 = point.chargeTimeTicks / (double) LOOP_TICKS_PER_HOUR;
+    row[9].u64 = point.faults;
+    row[10].f64 = point.passengerMiles;
+    row[11].u64 = point.waits;
+    row[12].f64 = (point.waits > 0) ? (point.waitTicks / (double) point.waits / LOOP_TICKS_PER_MIN) : 0.0;
+    row[13].f64 = point.p99WaitTicks / (double) LOOP_TICKS_PER_MIN;
+    row[14].f64 = point.meanQueueLength;
+    row[15].f64 = point.chargerUtilization;
+    chunk.addRow(row);
+  }
+  return chunk;
+}
+
+void RunSweepSimulation(const simulation_config_t& config) {
+  std::cout << "seed: " << config.seed << std::endl; // rerun with --seed to reproduce this sweep
+
+  sweep_result_t result;
+  RunSweep(config, &result);
+  if (config.outputFormat == OUTPUT_FORMAT_TEXT) {
+    WriteSweepTable(config.outputPath, config, result);
+  } else {
+    WriteSweepResultTable(config, GetSweepResultChunk(result));
+  }
+
+  std::cout << result.points.size() << " sweep points in " << result.elapsedSec << " s, " << result.numForks <<
+    " forks, " << result.steps << " ticks with events handled instead of " << result.unsharedSteps << " for separate runs" << std::endl;
+}
+
+static bool PointsMatch(const sweep_point_t& a, const sweep_point_t& b) {
+  return (a.numAircraft == b.numAircraft) && (a.mixIndex == b.mixIndex) && (a.numChargers == b.numChargers) && (a.simulationTicks == b.simulationTicks) &&
+         (a.seed == b.seed) && (a.flights == b.flights) && (a.airTimeTicks == b.airTimeTicks) &&
+         (a.chargeSessions == b.chargeSessions) && (a.chargeTimeTicks == b.chargeTimeTicks) && (a.faults == b.faults) &&
+         (a.passengerMiles == b.passengerMiles) && (a.waits == b.waits) && (a.waitTicks == b.waitTicks) &&
+         (a.p99WaitTicks == b.p99WaitTicks) && (a.meanQueueLength == b.meanQueueLength) &&
+         (a.chargerUtilization == b.chargerUtilization);
+}
+
+/** Function to test the sweep against separate event-driven runs of every grid point.
+ * The grid has two fleet sizes, an equal and a skewed fleet mix, charger counts from
+ * contended to one per aircraft, and horizons from 1 to 24 hr. Every row must match exactly, and the sweep must have
+ * handled fewer ticks than the separate runs, otherwise nothing was shared. A columnar
+ * file of the sweep must read back with a row per point and no other table. */
+void SweepTest(void) {
+  simulation_config_t config = DefaultSimulationConfig();
+  config.seed = 7;
+  config.numThreads = 4;
+  config.sweepAircraft = {40u, 20u};
+  config.sweepChargers = {1u, 2u, 3u, 5u, 20u};
+  config.sweepTicks = {LOOP_TICKS_PER_HOUR, 3u * LOOP_TICKS_PER_HOUR, 24u * LOOP_TICKS_PER_HOUR};
+  config.sweepMixes = {std::vector<uint32_t>(GetNumCompanies(), 1u), std::vector<uint32_t>(GetNumCompanies(), 1u)};
+  config.sweepMixes[1][0] = 4u;
+
+  sweep_result_t result;
+  RunSweep(config, &result);
+
+  uint32_t mismatches = 0;
+  for (const sweep_point_t& point : result.points) {
+    simulation_config_t pointConfig = config;
+    pointConfig.numAircraft = point.numAircraft;
+    pointConfig.numChargers = point.numChargers;
+    pointConfig.simulationTicks = point.simulationTicks;
+    pointConfig.seed = point.seed;
+
+    std::vector<Aircraft> aircrafts(point.numAircraft);
+    CreateRandomAircraftIds(aircrafts.data(), point.numAircraft, point.seed, config.sweepMixes[point.mixIndex].data());
+    SimulationStatistics stats;
+    EventSimulation sim(aircrafts.data(), pointConfig, &stats);
+    sim.run(pointConfig.simulationTicks);
+
+    sweep_point_t expected = point;
+    SummarizePoint(aircrafts.data(), point.numAircraft, stats, &expected);
+    if (PointsMatch(point, expected) == false) {
+      mismatches++;
+    }
+  }
+
+  config.outputPath = "SweepTest.bin";
+  config.outputFormat = OUTPUT_FORMAT_COLUMNAR;
+  std::vector<ResultChunk> tables;
+  bool written = WriteSweepResultTable(config, GetSweepResultChunk(result)) && ReadColumnarResults(config.outputPath, &tables) &&
+                 (tables[RESULT_TABLE_SWEEP].getNumRows() == result.points.size()) && (tables[RESULT_TABLE_AIRCRAFT].getNumRows() == 0) &&
+                 (tables[RESULT_TABLE_SWEEP].getColumn(2)[1].u64 == result.points[1].numChargers);
+  std::remove(config.outputPath.c_str());
+
+  bool pass = (result.points.size() == 60u) && (mismatches == 0) && (result.steps < result.unsharedSteps) && written;
+  std::cout << "Sweep test: " << (pass ? "PASS" : "FAIL") << " (" << mismatches << " mismatched points, " <<
+    result.numForks << " forks, " << result.steps << " of " << result.unsharedSteps << " ticks handled)" << std::endl;
+}
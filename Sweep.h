@@ -0,0 +1,60 @@
+/** Defines the parameter sweep. A sweep runs every combination of fleet size, fleet
+ * mix, charger count and horizon given with --sweep-aircraft, --sweep-mix,
+ * --sweep-chargers and --sweep-hours, and writes one table with a row per grid point to
+ * the output file, or the sweep result table with --format csv or columnar. A fleet mix weights the draw of each aircraft's company, see
+ * CreateRandomAircraftIds() in RandomGen.h; without the axis every company is as likely.
+ *
+ * Points share the work they have in common instead of each running from tick 0:
+ *  - every horizon of a fleet and charger count is read off the same run, from a copy
+ *    of the simulation finished at that horizon, while the run itself goes on
+ *  - all charger counts of a fleet start as one run with the most chargers. A smaller
+ *    count follows exactly the same timeline until more aircraft want a charger than
+ *    it has; at that tick the run is forked, and the copy goes on with fewer chargers
+ *  - forked runs and fleets are independent, so they run in parallel on a thread pool
+ *
+ * Each fleet is drawn from the seed like a single run, or from the next derived seed
+ * when a company is missing, and the faults come from the same counter-based streams,
+ * so every row matches a separate event-driven run of that point exactly. */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "ResultWriter.h"
+
+typedef struct {
+  uint32_t numAircraft;
+  uint32_t mixIndex; // into config.sweepMixes, 0 without a mix axis
+  uint32_t numChargers;
+  uint32_t simulationTicks;
+  uint64_t seed; // fleet and fault seed of the point
+  uint64_t flights;
+  uint64_t airTimeTicks;
+  uint64_t chargeSessions;
+  uint64_t chargeTimeTicks;
+  uint64_t faults;
+  double passengerMiles;
+  uint64_t waits; // charge sessions that started after waiting in line, including a wait of 0 ticks
+  uint64_t waitTicks;
+  uint32_t p99WaitTicks;
+  double meanQueueLength;
+  double chargerUtilization; // 0 to 1
+  uint64_t steps; // ticks with events handled to reach this point, shared ones included
+} sweep_point_t;
+
+typedef struct {
+  std::vector<sweep_point_t> points; // fleet size major, then mix in the given order, then charger count and horizon, ascending
+  uint32_t numForks; // runs split off for a smaller charger count
+  uint64_t steps; // ticks with events the sweep handled, each shared tick once
+  uint64_t unsharedSteps; // ticks with events separate runs of every point would have handled
+  double elapsedSec;
+} sweep_result_t;
+
+void RunSweep(const simulation_config_t& config, sweep_result_t* result);
+void RunSweepSimulation(const simulation_config_t& config); // runs the sweep and writes the table to the output file
+void WriteSweepTable(const std::string& outputPath, const simulation_config_t& config, const sweep_result_t& result);
+ResultChunk GetSweepResultChunk(const sweep_result_t& result); // the sweep table for --format csv or columnar
+void SweepTest(void);
@@ -0,0 +1,103 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t numThreads)
+{
+  m_queuedTasks = 0;
+  m_unfinishedTasks = 0;
+  m_nextQueue = 0;
+  m_stop = false;
+
+  if (numThreads == 0) {
+    numThreads = 1;
+  }
+  for (uint32_t i = 0; i < numThreads; i++) {
+    m_queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+  }
+  for (uint32_t i = 0; i < numThreads; i++) {
+    m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_stop = true;
+  }
+  m_workAvailable.notify_all();
+  for (std::thread& thread : m_threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  uint32_t queueIndex;
+  {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    queueIndex = m_nextQueue;
+    m_nextQueue = (m_nextQueue + 1) % m_queues.size();
+    m_unfinishedTasks++;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_queues[queueIndex]->mutex);
+    m_queues[queueIndex]->tasks.push_back(std::move(task));
+  }
+  {
+    // only counted as queued once it can actually be taken, so a woken worker always finds it
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_queuedTasks++;
+  }
+  m_workAvailable.notify_one();
+}
+
+void ThreadPool::wait(void) {
+  std::unique_lock<std::mutex> lock(m_stateMutex);
+  m_allDone.wait(lock, [this] {return m_unfinishedTasks == 0;});
+}
+
+// Own deque first, newest task first, then the oldest task of every other worker in turn
+bool ThreadPool::takeTask(uint32_t workerIndex, std::function<void()>* task) {
+  {
+    WorkerQueue& own = *m_queues[workerIndex];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.tasks.empty() == false) {
+      *task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (uint32_t offset = 1; offset < m_queues.size(); offset++) {
+    WorkerQueue& victim = *m_queues[(workerIndex + offset) % m_queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.tasks.empty() == false) {
+      *task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::workerLoop(uint32_t workerIndex) {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_stateMutex);
+      m_workAvailable.wait(lock, [this] {return m_stop || (m_queuedTasks > 0);});
+      if (m_queuedTasks == 0) {
+        return; // stopping and nothing left to run
+      }
+      m_queuedTasks--; // reserves one task, takeTask() below is guaranteed to find one
+    }
+
+    std::function<void()> task;
+    while (takeTask(workerIndex, &task) == false) {
+      std::this_thread::yield(); // the reserved task is still being pushed by submit()
+    }
+    task();
+
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_unfinishedTasks--;
+    if (m_unfinishedTasks == 0) {
+      m_allDone.notify_all();
+    }
+  }
+}
@@ -0,0 +1,48 @@
+/** Defines a work-stealing thread pool. Each worker owns a task deque; it takes new
+ * work from the back of its own deque and, when that is empty, steals from the front
+ * of the other workers' deques. Submitted tasks are spread round-robin, so a worker
+ * that finishes its share early keeps busy on the others' leftovers. */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+  explicit ThreadPool(uint32_t numThreads);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  uint32_t size(void) const {return (uint32_t) m_threads.size();}
+  void submit(std::function<void()> task);
+  void wait(void); // blocks until every submitted task has finished
+
+private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void workerLoop(uint32_t workerIndex);
+  bool takeTask(uint32_t workerIndex, std::function<void()>* task);
+
+  std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+  std::vector<std::thread> m_threads;
+  std::mutex m_stateMutex;
+  std::condition_variable m_workAvailable;
+  std::condition_variable m_allDone;
+  uint32_t m_queuedTasks; // guarded by m_stateMutex
+  uint32_t m_unfinishedTasks; // guarded by m_stateMutex
+  uint32_t m_nextQueue; // guarded by m_stateMutex
+  bool m_stop; // guarded by m_stateMutex
+};
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "Timeline.h"
+
+#include "AircraftCompanyCommon.h"
+#include "Config.h"
+#include "EventSimulation.h"
+#include "RandomGen.h"
+#include "Simulation.h"
+
+#define TIMELINE_REPEAT_FLAG (1u)
+#define TIMELINE_MAX_RECORD_BYTES (5u) // a 32 bit duration with the state bits is at most 35 bits
+
+static uint32_t EncodeVarint(uint64_t value, uint8_t* out) {
+  uint32_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (uint8_t) (value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t) value;
+  return length;
+}
+
+/** Calls visit(tick, state) for every transition stored in the block, starting from the
+ * tick and state the block starts from. Stops early when visit returns false. */
+template <typename Visitor>
+static bool DecodeBlock(const timeline_block_t* block, Visitor visit) {
+  uint32_t lastDurations[TIMELINE_TOTAL_STATES] = {UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX};
+  uint32_t tick = block->startTick;
+  uint8_t state = block->startState;
+  uint32_t offset = 0;
+  while (offset < block->used) {
+    uint32_t duration;
+    uint8_t nextState;
+    if ((block->data[offset] & TIMELINE_REPEAT_FLAG) != 0) {
+      nextState = (uint8_t) (block->data[offset] >> 1);
+      duration = lastDurations[state];
+      offset++;
+    } else {
+      uint64_t value = 0;
+      uint32_t shift = 0;
+      do {
+        value |= (uint64_t) (block->data[offset] & 0x7F) << shift;
+        shift += 7;
+      } while ((block->data[offset++] & 0x80) != 0);
+      nextState = (uint8_t) ((value >> 1) & 0x3);
+      duration = (uint32_t) (value >> 3);
+    }
+    lastDurations[state] = duration;
+    tick += duration;
+    state = nextState;
+    if (visit(tick, (aircraft_state_t) state) == false) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TimelineRecorder::TimelineRecorder(uint32_t numAircraft, uint64_t maxBytes) {
+  timeline_cursor_t start;
+  start.firstBlock = TIMELINE_NO_BLOCK;
+  start.lastBlock = TIMELINE_NO_BLOCK;
+  start.lastTick = 0;
+  for (uint32_t s = 0; s < TIMELINE_TOTAL_STATES; s++) {
+    start.lastDurations[s] = UINT32_MAX;
+  }
+  start.state = AIRCRAFT_STATE_IDLE;
+  m_cursors.assign(numAircraft, start);
+  m_numBlocks = 0;
+  m_maxBlocks = std::min<uint64_t>(maxBytes / TIMELINE_BLOCK_BYTES, TIMELINE_NO_BLOCK);
+  m_numTransitions = 0;
+  m_encodedBytes = 0;
+  m_recordedUntilTick = UINT32_MAX;
+}
+
+uint32_t TimelineRecorder::allocateBlock(void) {
+  if (m_numBlocks >= m_maxBlocks) {
+    return TIMELINE_NO_BLOCK;
+  }
+  if ((m_numBlocks % TIMELINE_BLOCKS_PER_PAGE) == 0) {
+    m_pages.emplace_back(new timeline_block_t[TIMELINE_BLOCKS_PER_PAGE]);
+  }
+  return m_numBlocks++;
+}
+
+void TimelineRecorder::record(uint32_t aircraftIndex, uint32_t tick, aircraft_state_t state) {
+  if (m_recordedUntilTick != UINT32_MAX) {
+    return; // the pool is full, the timeline ends at m_recordedUntilTick
+  }
+  timeline_cursor_t& cursor = m_cursors[aircraftIndex];
+  uint32_t duration = tick - cursor.lastTick;
+
+  timeline_block_t* block = (cursor.lastBlock == TIMELINE_NO_BLOCK) ? nullptr : getBlock(cursor.lastBlock);
+  if ((block == nullptr) || ((block->used + TIMELINE_MAX_RECORD_BYTES) > TIMELINE_BLOCK_DATA_BYTES)) {
+    uint32_t index = allocateBlock();
+    if (index == TIMELINE_NO_BLOCK) {
+      m_recordedUntilTick = tick;
+      return;
+    }
+    timeline_block_t* next = getBlock(index);
+    next->next = TIMELINE_NO_BLOCK;
+    next->startTick = cursor.lastTick;
+    next->startState = cursor.state;
+    next->used = 0;
+    if (block == nullptr) {
+      cursor.firstBlock = index;
+    } else {
+      block->next = index;
+    }
+    cursor.lastBlock = index;
+    // a block decodes on its own, so the first leg in each state is written out in full again
+    for (uint32_t s = 0; s < TIMELINE_TOTAL_STATES; s++) {
+      cursor.lastDurations[s] = UINT32_MAX;
+    }
+    block = next;
+  }
+
+  if (duration == cursor.lastDurations[cursor.state]) {
+    block->data[block->used] = (uint8_t) ((state << 1) | TIMELINE_REPEAT_FLAG);
+    m_encodedBytes++;
+    block->used++;
+  } else {
+    uint32_t length = EncodeVarint(((uint64_t) duration << 3) | (state << 1), &block->data[block->used]);
+    m_encodedBytes += length;
+    block->used += length;
+  }
+  cursor.lastDurations[cursor.state] = duration;
+  cursor.lastTick = tick;
+  cursor.state = (uint8_t) state;
+  m_numTransitions++;
+}
+
+template <typename Visitor>
+void TimelineRecorder::forEachTransition(uint32_t aircraftIndex, Visitor visit) const {
+  for (uint32_t index = m_cursors[aircraftIndex].firstBlock; index != TIMELINE_NO_BLOCK; index = getBlock(index)->next) {
+    DecodeBlock(getBlock(index), [&visit](uint32_t tick, aircraft_state_t state) {
+      visit(tick, state);
+      return true;
+    });
+  }
+}
+
+aircraft_state_t TimelineRecorder::getStateAt(uint32_t aircraftIndex, uint32_t tick) const {
+  uint32_t index = m_cursors[aircraftIndex].firstBlock;
+  if (index == TIMELINE_NO_BLOCK) {
+    return AIRCRAFT_STATE_IDLE;
+  }
+  // skip every block that starts at or before the tick, the state it starts from is known
+  while ((getBlock(index)->next != TIMELINE_NO_BLOCK) && (getBlock(getBlock(index)->next)->startTick <= tick)) {
+    index = getBlock(index)->next;
+  }
+  aircraft_state_t state = (aircraft_state_t) getBlock(index)->startState;
+  DecodeBlock(getBlock(index), [tick, &state](uint32_t transitionTick, aircraft_state_t nextState) {
+    if (transitionTick > tick) {
+      return false;
+    }
+    state = nextState;
+    return true;
+  });
+  return state;
+}
+
+void TimelineRecorder::getStateCounts(uint32_t startTick, uint32_t stepTicks, uint32_t numSamples, std::vector<timeline_state_counts_t>* samples) const {
+  // first sample at or after a tick
+  auto firstSampleAt = [startTick, stepTicks, numSamples](uint64_t tick) -> uint32_t {
+    if (tick <= startTick) {
+      return 0;
+    }
+    uint64_t sample = ((tick - startTick) + stepTicks - 1) / stepTicks;
+    return (uint32_t) std::min<uint64_t>(sample, numSamples);
+  };
+
+  /** Each leg covers the samples from the tick it started up to the tick the next one
+   * started, so it adds one to the count of its state at the first of them and takes it
+   * away after the last. */
+  std::vector<int64_t> changes[TIMELINE_TOTAL_STATES];
+  for (uint32_t s = 0; s < TIMELINE_TOTAL_STATES; s++) {
+    changes[s].assign(numSamples + 1, 0);
+  }
+  for (uint32_t i = 0; i < getNumAircraft(); i++) {
+    uint32_t legTick = 0;
+    aircraft_state_t legState = AIRCRAFT_STATE_IDLE;
+    forEachTransition(i, [&](uint32_t tick, aircraft_state_t state) {
+      changes[legState][firstSampleAt(legTick)]++;
+      changes[legState][firstSampleAt(tick)]--;
+      legTick = tick;
+      legState = state;
+    });
+    changes[legState][firstSampleAt(legTick)]++;
+  }
+
+  samples->resize(numSamples);
+  int64_t counts[TIMELINE_TOTAL_STATES] = {0};
+  for (uint32_t k = 0; k < numSamples; k++) {
+    for (uint32_t s = 0; s < TIMELINE_TOTAL_STATES; s++) {
+      counts[s] += changes[s][k];
+      (*samples)[k].counts[s] = (uint32_t) counts[s];
+    }
+  }
+}
+
+uint64_t TimelineRecorder::getBytesUsed(void) const {
+  return (uint64_t) m_pages.size() * TIMELINE_BLOCKS_PER_PAGE * sizeof(timeline_block_t) +
+         (uint64_t) m_cursors.capacity() * sizeof(timeline_cursor_t);
+}
+
+bool WriteTimelineStateCounts(const TimelineRecorder& timeline, const std::string& path, uint32_t simulationTicks, uint32_t stepTicks) {
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    std::cout << "ERROR - could not open " << path << std::endl;
+    return false;
+  }
+  uint32_t numSamples = simulationTicks / stepTicks + 1;
+  std::vector<timeline_state_counts_t> samples;
+  timeline.getStateCounts(0, stepTicks, numSamples, &samples);
+
+  bool failed = (std::fputs("minute,idle,flying,charging,waiting_to_charge\n", file) < 0);
+  for (uint32_t k = 0; k < numSamples; k++) {
+    const uint32_t* counts = samples[k].counts;
+    failed = (std::fprintf(file, "%g,%u,%u,%u,%u\n", (k * (double) stepTicks) / LOOP_TICKS_PER_MIN, counts[AIRCRAFT_STATE_IDLE],
+                           counts[AIRCRAFT_STATE_FLYING], counts[AIRCRAFT_STATE_CHARGING], counts[AIRCRAFT_STATE_WAITING_TO_CHARGE]) < 0) || failed;
+  }
+  failed = (std::fclose(file) != 0) || failed;
+  if (failed) {
+    std::cout << "ERROR - writing the timeline to " << path << " failed" << std::endl;
+  }
+  return (failed == false);
+}
+
+/** Function to test the timeline recorder. The event engine's timeline of a day must
+ * give the same state as separate runs stopped at many ticks along the way, the tick
+ * loop and SoA engines must record the same timeline, and the fleet state counts must
+ * add up the per-aircraft states. A recorder that runs out of room must stay correct up
+ * to the tick it stopped at. */
+void TimelineTest(void) {
+  simulation_config_t config = DefaultSimulationConfig();
+  config.seed = 7;
+  config.simulationTicks = 24u * LOOP_TICKS_PER_HOUR;
+  Aircraft fleet[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+  for (uint8_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+    fleet[i].m_id = (aircraft_id_t) (i % TOTAL_BUILTIN_AIRCRAFT_COMPANIES);
+  }
+
+  Aircraft aircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+  std::copy(fleet, fleet + DEFAULT_AIRCRAFTS_IN_SIMULATION, aircrafts);
+  TimelineRecorder eventTimeline(DEFAULT_AIRCRAFTS_IN_SIMULATION);
+  RunEventSimulation(aircrafts, config, nullptr, &eventTimeline);
+
+  uint32_t mismatches = 0;
+  for (uint32_t tick = 1; tick <= config.simulationTicks; tick += 97) {
+    simulation_config_t shortConfig = config;
+    shortConfig.simulationTicks = tick;
+    std::copy(fleet, fleet + DEFAULT_AIRCRAFTS_IN_SIMULATION, aircrafts);
+    RunEventSimulation(aircrafts, shortConfig);
+    for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+      mismatches += (eventTimeline.getStateAt(i, tick) != aircrafts[i].m_state);
+    }
+  }
+  std::cout << "Timeline state query test: " << ((mismatches == 0) ? "PASS" : "FAIL") << std::endl;
+
+  mismatches = 0;
+  const simulation_mode_t modes[] = {SIMULATION_MODE_TICK, SIMULATION_MODE_SOA};
+  for (simulation_mode_t mode : modes) {
+    simulation_config_t modeConfig = config;
+    modeConfig.mode = mode;
+    std::copy(fleet, fleet + DEFAULT_AIRCRAFTS_IN_SIMULATION, aircrafts);
+    TimelineRecorder timeline(DEFAULT_AIRCRAFTS_IN_SIMULATION);
+    RunSimulationEngine(aircrafts, modeConfig, nullptr, &timeline);
+    mismatches += (timeline.getNumTransitions() != eventTimeline.getNumTransitions());
+    for (uint32_t tick = 0; tick <= config.simulationTicks; tick += 10) {
+      for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+        mismatches += (timeline.getStateAt(i, tick) != eventTimeline.getStateAt(i, tick));
+      }
+    }
+  }
+  std::cout << "Timeline engine agreement test: " << ((mismatches == 0) ? "PASS" : "FAIL") << std::endl;
+
+  mismatches = 0;
+  std::vector<timeline_state_counts_t> samples;
+  uint32_t stepTicks = 7u * LOOP_TICKS_PER_MIN;
+  uint32_t numSamples = config.simulationTicks / stepTicks + 1;
+  eventTimeline.getStateCounts(0, stepTicks, numSamples, &samples);
+  for (uint32_t k = 0; k < numSamples; k++) {
+    uint32_t counts[TIMELINE_TOTAL_STATES] = {0};
+    for (uint32_t i = 0; i < DEFAULT_AIRCRAFTS_IN_SIMULATION; i++) {
+      counts[eventTimeline.getStateAt(i, k * stepTicks)]++;
+    }
+    mismatches += (memcmp(counts, samples[k].counts, sizeof(counts)) != 0);
+  }
+  // flights and charges repeat, so most transitions take a single byte
+  double bytesPerTransition = eventTimeline.getEncodedBytes() / (double) eventTimeline.getNumTransitions();
+  std::cout << "Timeline state count test: " << (((mismatches == 0) && (bytesPerTransition < 2.0)) ? "PASS" : "FAIL") <<
+    " (" << bytesPerTransition << " bytes per transition)" << std::endl;
+
+  // room for three blocks per aircraft, not a whole week of 2000 aircraft
+  const uint32_t numAircraft = 2000;
+  std::vector<Aircraft> bigFleet(numAircraft);
+  CreateRandomAircraftIds(bigFleet.data(), numAircraft, config.seed);
+  std::vector<Aircraft> bigAircrafts = bigFleet;
+  simulation_config_t bigConfig = config;
+  bigConfig.numAircraft = numAircraft;
+  bigConfig.numChargers = 300;
+  bigConfig.simulationTicks = 168u * LOOP_TICKS_PER_HOUR;
+  TimelineRecorder full(numAircraft);
+  TimelineRecorder bounded(numAircraft, (numAircraft * 3) * TIMELINE_BLOCK_BYTES);
+  RunEventSimulation(bigAircrafts.data(), bigConfig, nullptr, &full);
+  bigAircrafts = bigFleet;
+  RunEventSimulation(bigAircrafts.data(), bigConfig, nullptr, &bounded);
+  uint32_t stopTick = bounded.getRecordedUntilTick();
+  bool pass = (stopTick > 0) && (stopTick < bigConfig.simulationTicks) && (bounded.getNumTransitions() < full.getNumTransitions());
+  for (uint32_t tick = 0; pass && (tick < stopTick); tick += 13) {
+    for (uint32_t i = 0; i < numAircraft; i++) {
+      pass = pass && (bounded.getStateAt(i, tick) == full.getStateAt(i, tick));
+    }
+  }
+  std::cout << "Timeline memory bound test: " << (pass ? "PASS" : "FAIL") << std::endl;
+}
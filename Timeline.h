@@ -0,0 +1,97 @@
+/** Defines the per-aircraft timeline recorder. With --timeline, every state transition
+ * of every aircraft is recorded, so the state of any aircraft at any tick, and the
+ * number of aircraft in each state over time, can be queried after the run instead of
+ * only the end-of-run counters on Aircraft.
+ *
+ * A transition is stored as the ticks since the previous transition of the aircraft
+ * and the state entered, in a varint: (ticks << 3) | (state << 1). Legs repeat, every
+ * flight of a company lasts as long as the last one and so does every charge, so when
+ * the leg just ended lasted exactly as long as the previous leg in the same state the
+ * transition is a single byte, (state << 1) | 1. Only waits in line vary.
+ *
+ * The bytes of each aircraft go into fixed-size blocks from a shared pool, chained per
+ * aircraft. A block starts from the tick and state before its first transition, so a
+ * query skips whole blocks and only decodes the one it needs. The pool stops growing
+ * at maxBytes; transitions after that are not recorded and getRecordedUntilTick()
+ * tells the tick it stopped at; the timeline is complete before it. */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Aircraft.h"
+
+#define TIMELINE_BLOCK_BYTES (64u)
+#define TIMELINE_BLOCK_DATA_BYTES (TIMELINE_BLOCK_BYTES - 10u)
+#define TIMELINE_BLOCKS_PER_PAGE (1u << 14) // the pool grows a page at a time, 1 MiB
+#define TIMELINE_NO_BLOCK (UINT32_MAX)
+#define TIMELINE_TOTAL_STATES (4u) // every aircraft_state_t up to AIRCRAFT_STATE_MAINTENANCE, which --timeline rejects
+#define DEFAULT_TIMELINE_MAX_BYTES (1ull << 30)
+#define DEFAULT_TIMELINE_SAMPLE_MIN (10u)
+
+typedef struct {
+  uint32_t next; // next block of the same aircraft, TIMELINE_NO_BLOCK for the last one
+  uint32_t startTick; // tick of the last transition before the block
+  uint8_t startState; // state entered at startTick
+  uint8_t used; // bytes of data in use
+  uint8_t data[TIMELINE_BLOCK_DATA_BYTES];
+} timeline_block_t;
+
+static_assert(sizeof(timeline_block_t) == TIMELINE_BLOCK_BYTES, "timeline blocks fill the pool pages without padding");
+
+typedef struct {
+  uint32_t counts[TIMELINE_TOTAL_STATES]; // aircraft in each aircraft_state_t
+} timeline_state_counts_t;
+
+class TimelineRecorder
+{
+public:
+  explicit TimelineRecorder(uint32_t numAircraft, uint64_t maxBytes = DEFAULT_TIMELINE_MAX_BYTES);
+  TimelineRecorder(const TimelineRecorder&) = delete;
+  TimelineRecorder& operator=(const TimelineRecorder&) = delete;
+
+  // Every aircraft starts idle at tick 0. Transitions of an aircraft come in tick order.
+  void record(uint32_t aircraftIndex, uint32_t tick, aircraft_state_t state);
+
+  aircraft_state_t getStateAt(uint32_t aircraftIndex, uint32_t tick) const; // state after every transition up to and including tick
+  // Aircraft in each state at startTick, startTick + stepTicks, ... numSamples ticks in all
+  void getStateCounts(uint32_t startTick, uint32_t stepTicks, uint32_t numSamples, std::vector<timeline_state_counts_t>* samples) const;
+
+  uint32_t getNumAircraft(void) const {return (uint32_t) m_cursors.size();}
+  uint64_t getNumTransitions(void) const {return m_numTransitions;}
+  uint64_t getEncodedBytes(void) const {return m_encodedBytes;} // transitions only, without block headers and free room
+  uint64_t getBytesUsed(void) const; // pool pages and per-aircraft cursors
+  uint32_t getRecordedUntilTick(void) const {return m_recordedUntilTick;} // UINT32_MAX unless the pool hit maxBytes
+
+private:
+  typedef struct {
+    uint32_t firstBlock;
+    uint32_t lastBlock;
+    uint32_t lastTick; // tick of the last transition
+    uint32_t lastDurations[TIMELINE_TOTAL_STATES]; // of the last leg in each state within lastBlock, UINT32_MAX if none
+    uint8_t state;
+  } timeline_cursor_t;
+
+  // Calls visit(tick, state) for every transition of the aircraft, in order
+  template <typename Visitor>
+  void forEachTransition(uint32_t aircraftIndex, Visitor visit) const;
+
+  timeline_block_t* getBlock(uint32_t index) {return &m_pages[index / TIMELINE_BLOCKS_PER_PAGE][index % TIMELINE_BLOCKS_PER_PAGE];}
+  const timeline_block_t* getBlock(uint32_t index) const {return &m_pages[index / TIMELINE_BLOCKS_PER_PAGE][index % TIMELINE_BLOCKS_PER_PAGE];}
+  uint32_t allocateBlock(void); // TIMELINE_NO_BLOCK once the pool is at maxBytes
+
+  std::vector<timeline_cursor_t> m_cursors;
+  std::vector<std::unique_ptr<timeline_block_t[]>> m_pages;
+  uint32_t m_numBlocks;
+  uint64_t m_maxBlocks;
+  uint64_t m_numTransitions;
+  uint64_t m_encodedBytes;
+  uint32_t m_recordedUntilTick;
+};
+
+// Writes the aircraft in each state every stepTicks from tick 0 to simulationTicks as CSV
+bool WriteTimelineStateCounts(const TimelineRecorder& timeline, const std::string& path, uint32_t simulationTicks, uint32_t stepTicks);
+void TimelineTest(void);
@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Trace.h"
+
+#include "AircraftCompanyCommon.h"
+#include "RandomGen.h"
+#include "Simulation.h"
+
+#define TRACE_RING_MASK (TRACE_RING_RECORDS - 1u)
+#define TRACE_DRAIN_IDLE_MS (1u) // the drain thread sleeps this long when every ring is empty
+#define TRACE_MAX_RINGS (1u << 16) // the thread number of a record is 16 bits
+
+static_assert((TRACE_RING_RECORDS & TRACE_RING_MASK) == 0, "TRACE_RING_RECORDS must be a power of 2");
+
+/** Ring buffer of one thread. The thread that owns it is the only one to move head and
+ * the drain thread the only one to move tail, so neither needs a lock. A ring outlives
+ * its thread; once drained it is handed to the next thread that starts tracing, which
+ * keeps the number of rings at the most threads tracing at once. */
+struct TraceRing {
+  std::atomic<uint64_t> head; // records written
+  std::atomic<uint64_t> tail; // records drained
+  std::atomic<bool> inUse;
+  uint16_t thread;
+  trace_record_t records[TRACE_RING_RECORDS];
+};
+
+// Gives the calling thread's ring back when the thread exits
+class TraceRingHandle
+{
+public:
+  ~TraceRingHandle() {
+    if (m_ring != nullptr) {
+      m_ring->inUse.store(false, std::memory_order_release);
+    }
+  }
+
+  TraceRing* m_ring = nullptr;
+};
+
+static std::mutex ringsMutex; // guards rings, held by the drain thread while it drains
+static std::vector<std::unique_ptr<TraceRing>> rings;
+static thread_local TraceRingHandle threadRing;
+static std::atomic<bool> traceActive(false);
+static std::atomic<bool> drainStop(false);
+static std::thread drainThread;
+static std::FILE* traceFile = nullptr;
+static bool traceWriteFailed = false; // only touched by the drain thread while it runs
+
+static const char* const traceEventNames[TOTAL_TRACE_EVENTS] = {
+  "takeoff", "battery dead", "enqueue", "charge start", "charge end", "fault"
+};
+
+static const char* const traceValueNames[TOTAL_TRACE_EVENTS] = {
+  "flight", "leg ticks", "in line", "chargers in use", "chargers in use", "faults"
+};
+
+static TraceRing* AcquireRing(void) {
+  std::lock_guard<std::mutex> lock(ringsMutex);
+  for (std::unique_ptr<TraceRing>& ring : rings) {
+    bool drained = (ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_relaxed));
+    if ((ring->inUse.load(std::memory_order_acquire) == false) && drained) {
+      ring->inUse.store(true, std::memory_order_relaxed);
+      return ring.get();
+    }
+  }
+  if (rings.size() >= TRACE_MAX_RINGS) {
+    return nullptr;
+  }
+  std::unique_ptr<TraceRing> ring(new TraceRing);
+  ring->head.store(0, std::memory_order_relaxed);
+  ring->tail.store(0, std::memory_order_relaxed);
+  ring->inUse.store(true, std::memory_order_relaxed);
+  ring->thread = (uint16_t) rings.size();
+  rings.push_back(std::move(ring));
+  return rings.back().get();
+}
+
+void TraceRecord(trace_event_type_t type, uint32_t tick, uint32_t aircraftIndex, uint32_t value) {
+  if (traceActive.load(std::memory_order_relaxed) == false) {
+    return;
+  }
+  TraceRing* ring = threadRing.m_ring;
+  if (ring == nullptr) {
+    ring = AcquireRing();
+    if (ring == nullptr) {
+      return; // more threads than a record can number
+    }
+    threadRing.m_ring = ring;
+  }
+
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  while ((head - ring->tail.load(std::memory_order_acquire)) >= TRACE_RING_RECORDS) {
+    std::this_thread::yield(); // a full ring waits for the drain thread instead of losing records
+  }
+  trace_record_t& record = ring->records[head & TRACE_RING_MASK];
+  record.tick = tick;
+  record.aircraftIndex = aircraftIndex;
+  record.value = value;
+  record.type = (uint8_t) type;
+  record.reserved = 0;
+  record.thread = ring->thread;
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+// Writes every record written so far to the trace file, returns how many there were
+static uint64_t DrainRings(void) {
+  std::lock_guard<std::mutex> lock(ringsMutex);
+  uint64_t numDrained = 0;
+  for (std::unique_ptr<TraceRing>& ring : rings) {
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    numDrained += head - tail;
+    while (tail != head) {
+      // at most two writes, the second one when the records wrap around the end of the ring
+      uint32_t first = (uint32_t) (tail & TRACE_RING_MASK);
+      size_t count = (size_t) std::min<uint64_t>(head - tail, TRACE_RING_RECORDS - first);
+      if (std::fwrite(&ring->records[first], sizeof(trace_record_t), count, traceFile) != count) {
+        traceWriteFailed = true;
+      }
+      tail += count;
+    }
+    ring->tail.store(tail, std::memory_order_release);
+  }
+  return numDrained;
+}
+
+static void DrainLoop(void) {
+  while (drainStop.load(std::memory_order_acquire) == false) {
+    if (DrainRings() == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(TRACE_DRAIN_IDLE_MS));
+    }
+  }
+}
+
+bool StartTrace(const char* path) {
+  if (traceActive.load(std::memory_order_relaxed)) {
+    std::cout << "ERROR - a trace is already being written" << std::endl;
+    return false;
+  }
+  traceFile = std::fopen(path, "wb");
+  if (traceFile == nullptr) {
+    std::cout << "ERROR - could not open trace file " << path << std::endl;
+    return false;
+  }
+
+  trace_file_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.recordBytes = sizeof(trace_record_t);
+  header.ticksPerMin = LOOP_TICKS_PER_MIN;
+  traceWriteFailed = (std::fwrite(&header, sizeof(header), 1, traceFile) != 1);
+
+  drainStop.store(false, std::memory_order_relaxed);
+  drainThread = std::thread(DrainLoop);
+  traceActive.store(true, std::memory_order_release);
+  return true;
+}
+
+void StopTrace(void) {
+  if (traceActive.load(std::memory_order_relaxed) == false) {
+    return;
+  }
+  traceActive.store(false, std::memory_order_relaxed);
+  drainStop.store(true, std::memory_order_release);
+  drainThread.join();
+  DrainRings(); // what was written after the last pass of the drain thread
+
+  bool failed = traceWriteFailed || (std::fclose(traceFile) != 0);
+  traceFile = nullptr;
+  if (failed) {
+    std::cout << "ERROR - writing the trace file failed, the trace is incomplete" << std::endl;
+  }
+}
+
+static bool ReadTraceFile(const char* path, trace_file_header_t* header, std::vector<trace_record_t>* records) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "ERROR - could not open trace file " << path << std::endl;
+    return false;
+  }
+  if ((!file.read((char*) header, sizeof(*header))) || (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0)) {
+    std::cout << "ERROR - " << path << " is not a trace file" << std::endl;
+    return false;
+  }
+  if ((header->version != TRACE_VERSION) || (header->recordBytes != sizeof(trace_record_t)) || (header->ticksPerMin == 0)) {
+    std::cout << "ERROR - " << path << " is trace version " << header->version << ", this build reads version " << TRACE_VERSION << std::endl;
+    return false;
+  }
+
+  records->clear();
+  trace_record_t record;
+  while (file.read((char*) &record, sizeof(record))) {
+    if (record.type >= TOTAL_TRACE_EVENTS) {
+      std::cout << "ERROR - " << path << " has a record of unknown type " << +record.type << std::endl;
+      return false;
+    }
+    records->push_back(record);
+  }
+  if (file.gcount() != 0) {
+    std::cout << "ERROR - " << path << " ends in a partial record, the trace was cut short" << std::endl;
+  }
+  return true;
+}
+
+static void WriteChromeEvent(std::ofstream& out, const char* name, const char* phase, uint64_t timeUs, const trace_record_t& record, bool* first) {
+  char line[256];
+  snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%llu,\"pid\":%u,\"tid\":%u%s,\"args\":{\"%s\":%u}}",
+           (*first) ? "" : ",\n", name, phase, (unsigned long long) timeUs, (unsigned) record.thread, (unsigned) record.aircraftIndex,
+           (phase[0] == 'i') ? ",\"s\":\"t\"" : "", traceValueNames[record.type], (unsigned) record.value);
+  out << line;
+  *first = false;
+}
+
+bool DecodeTrace(const char* inputPath, const char* outputPath, trace_format_t format) {
+  trace_file_header_t header;
+  std::vector<trace_record_t> records;
+  if (ReadTraceFile(inputPath, &header, &records) == false) {
+    return false;
+  }
+  // threads were drained interleaved; a stable sort keeps the order of each thread's records within a tick
+  std::stable_sort(records.begin(), records.end(), [](const trace_record_t& a, const trace_record_t& b) {
+    return a.tick < b.tick;
+  });
+
+  std::ofstream out(outputPath);
+  if (!out.is_open()) {
+    std::cout << "ERROR - could not open " << outputPath << std::endl;
+    return false;
+  }
+  char line[256];
+  if (format == TRACE_FORMAT_TEXT) {
+    for (const trace_record_t& record : records) {
+      snprintf(line, sizeof(line), "%12.2f min  thread %3u  aircraft %6u  %-12s  %s %u\n",
+               record.tick / (double) header.ticksPerMin, (unsigned) record.thread, (unsigned) record.aircraftIndex,
+               traceEventNames[record.type], traceValueNames[record.type], (unsigned) record.value);
+      out << line;
+    }
+  } else {
+    /** One track per aircraft, grouped by the thread that ran it: a span for every flight,
+     * wait in line and charge session, and an instant for every fault. Simulated time is
+     * shown as trace time. */
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const trace_record_t& record : records) {
+      uint64_t timeUs = (uint64_t) record.tick * 60000000ull / header.ticksPerMin;
+      switch (record.type) {
+        case TRACE_EVENT_TAKEOFF:
+          WriteChromeEvent(out, "flight", "B", timeUs, record, &first);
+          break;
+        case TRACE_EVENT_BATTERY_DEAD:
+          WriteChromeEvent(out, "flight", "E", timeUs, record, &first);
+          break;
+        case TRACE_EVENT_ENQUEUE:
+          WriteChromeEvent(out, "waiting", "B", timeUs, record, &first);
+          break;
+        case TRACE_EVENT_CHARGE_START:
+          WriteChromeEvent(out, "waiting", "E", timeUs, record, &first);
+          WriteChromeEvent(out, "charging", "B", timeUs, record, &first);
+          break;
+        case TRACE_EVENT_CHARGE_END:
+          WriteChromeEvent(out, "charging", "E", timeUs, record, &first);
+          break;
+        case TRACE_EVENT_FAULT:
+        default:
+          WriteChromeEvent(out, "fault", "i", timeUs, record, &first);
+          break;
+      }
+    }
+    out << "\n]}\n";
+  }
+  out.close();
+  if (out.fail()) {
+    std::cout << "ERROR - writing " << outputPath << " failed" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static uint32_t CountOccurrences(const std::string& text, const char* pattern) {
+  uint32_t count = 0;
+  size_t length = strlen(pattern);
+  for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + length)) {
+    count++;
+  }
+  return count;
+}
+
+void TraceTest(void) {
+  const char* path = "TraceTest.bin";
+  const char* decodedPath = "TraceTest.json";
+  const uint32_t numThreads = 4;
+  // several times the ring size, so the threads also wait on the drain thread
+  const uint32_t cyclesPerThread = TRACE_RING_RECORDS;
+
+  /** The ring buffers and the drain thread are tested directly, so this runs whether the
+   * trace points are compiled in or not. Every thread traces the full cycle of one
+   * aircraft: takeoff, battery dead, enqueue, charge start, charge end and a fault. */
+  bool pass = StartTrace(path);
+  if (pass) {
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < numThreads; t++) {
+      threads.emplace_back([t, cyclesPerThread] {
+        for (uint32_t c = 0; c < cyclesPerThread; c++) {
+          for (uint32_t type = 0; type < TOTAL_TRACE_EVENTS; type++) {
+            TraceRecord((trace_event_type_t) type, c * TOTAL_TRACE_EVENTS + type, t, c);
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    StopTrace();
+  }
+
+  trace_file_header_t header;
+  std::vector<trace_record_t> records;
+  pass = pass && ReadTraceFile(path, &header, &records) && (records.size() == (size_t) numThreads * cyclesPerThread * TOTAL_TRACE_EVENTS);
+  std::vector<uint32_t> nextTick(numThreads, 0);
+  for (const trace_record_t& record : records) {
+    // every thread's records arrive complete and in the order they were written
+    if ((record.aircraftIndex >= numThreads) || (record.tick != nextTick[record.aircraftIndex]) ||
+        (record.type != (record.tick % TOTAL_TRACE_EVENTS))) {
+      pass = false;
+      break;
+    }
+    nextTick[record.aircraftIndex]++;
+  }
+  std::cout << "Trace ring buffer test: " << (pass ? "PASS" : "FAIL") << std::endl;
+
+  pass = pass && DecodeTrace(path, decodedPath, TRACE_FORMAT_CHROME);
+  std::string json;
+  if (pass) {
+    std::ifstream decoded(decodedPath);
+    json.assign(std::istreambuf_iterator<char>(decoded), std::istreambuf_iterator<char>());
+  }
+  uint32_t numCycles = numThreads * cyclesPerThread;
+  pass = pass && (CountOccurrences(json, "\"ph\":\"B\"") == 3 * numCycles) && (CountOccurrences(json, "\"ph\":\"E\"") == 3 * numCycles) &&
+         (CountOccurrences(json, "\"ph\":\"i\"") == numCycles);
+  std::cout << "Trace Chrome JSON decoder test: " << (pass ? "PASS" : "FAIL") << std::endl;
+
+  if constexpr (TRACE_ENABLED) {
+    // with the trace points compiled in, every engine traces each transition of the run exactly once
+    const simulation_mode_t modes[] = {SIMULATION_MODE_TICK, SIMULATION_MODE_EVENT, SIMULATION_MODE_SOA};
+    const char* modeNames[] = {"tick", "event", "soa"};
+    for (uint32_t m = 0; m < 3; m++) {
+      simulation_config_t config = DefaultSimulationConfig();
+      config.mode = modes[m];
+      config.seed = 7;
+      config.simulationTicks = 24u * LOOP_TICKS_PER_HOUR;
+      Aircraft aircrafts[DEFAULT_AIRCRAFTS_IN_SIMULATION];
+      CreateRandomAircraftIds(aircrafts, DEFAULT_AIRCRAFTS_IN_SIMULATION, config.seed);
+
+      bool modePass = StartTrace(path);
+      RunSimulationEngine(aircrafts, config);
+      StopTrace();
+      modePass = modePass && ReadTraceFile(path, &header, &records);
+
+      uint64_t counts[TOTAL_TRACE_EVENTS] = {0};
+      for (const trace_record_t& record : records) {
+        counts[record.type]++;
+      }
+      uint64_t flights = 0, chargeSessions = 0, faults = 0;
+      for (const Aircraft& aircraft : aircrafts) {
+        flights += aircraft.m_numFlights;
+        chargeSessions += aircraft.m_numChargeSessions;
+        faults += aircraft.m_numFaults;
+      }
+      modePass = modePass && (counts[TRACE_EVENT_TAKEOFF] == flights) && (counts[TRACE_EVENT_CHARGE_START] == chargeSessions) &&
+                 (counts[TRACE_EVENT_FAULT] == faults) && (counts[TRACE_EVENT_BATTERY_DEAD] == counts[TRACE_EVENT_ENQUEUE]);
+      std::cout << "Traced simulation test (" << modeNames[m] << "): " << (modePass ? "PASS" : "FAIL") << std::endl;
+    }
+  }
+
+  std::remove(path);
+  std::remove(decodedPath);
+}
@@ -1,37 +1,111 @@
-// Define functions to trace state transitions for debug purposes
+/** Defines the trace of aircraft state transitions for debug purposes. Every takeoff,
+ * dead battery, entry into the charge line, charge start and end, and fault becomes a
+ * fixed-size binary record. A thread appends its records to a ring buffer of its own,
+ * without locks, and a background thread drains the rings to the trace file, so
+ * tracing a run doesn't wait on the file.
+ *
+ * The trace points are compiled in only when the program is built with EVTOL_TRACE=1,
+ * e.g. -DEVTOL_TRACE=1. Otherwise TRACE_ENABLED is false, every Trace* call below is an
+ * empty inline function and the engines compile to the same code as without them.
+ * With the trace points compiled in, --trace PATH starts the drain thread; without it
+ * a trace point costs one relaxed load.
+ *
+ * A trace file is a trace_file_header_t followed by trace_record_t records. The
+ * records of each thread are in the order they happened, the threads are interleaved
+ * in the order they were drained. --decode-trace turns a trace file into text, or
+ * into the Chrome trace event JSON format for chrome://tracing or Perfetto. */
 
 #pragma once
 
 #include <cstdint>
-#include <iostream>
-
-// #define ENABLE_TRACE // uncomment to enable trace output to the terminal
-
-inline void TraceStartCharging(uint8_t arrayIndex, float timeMin, uint8_t numChargersInUse) {
-    #ifdef ENABLE_TRACE
-        std::cout <<
-            "start charging - array index: " << +arrayIndex <<
-            ", time: " << timeMin << " min" <<
-            ", chargers in use: " << +numChargersInUse <<
-            std::endl;
-    #endif
+
+#include "Config.h"
+
+#ifndef EVTOL_TRACE
+#define EVTOL_TRACE 0
+#endif
+
+constexpr bool TRACE_ENABLED = (EVTOL_TRACE != 0);
+
+#define TRACE_MAGIC "EVTOLTRC"
+#define TRACE_VERSION (1u)
+#define TRACE_RING_RECORDS (1u << 14) // per thread, a power of 2
+
+typedef enum {
+  TRACE_EVENT_TAKEOFF = 0u, // value: flight number of the aircraft
+  TRACE_EVENT_BATTERY_DEAD, // value: ticks flown on the leg
+  TRACE_EVENT_ENQUEUE, // value: aircraft in line, this one included
+  TRACE_EVENT_CHARGE_START, // value: chargers in use, this one included
+  TRACE_EVENT_CHARGE_END, // value: chargers still in use
+  TRACE_EVENT_FAULT, // value: faults of the aircraft so far, this one included
+
+  TOTAL_TRACE_EVENTS
+} trace_event_type_t;
+
+typedef struct {
+  uint32_t tick;
+  uint32_t aircraftIndex;
+  uint32_t value; // see trace_event_type_t
+  uint8_t type; // trace_event_type_t
+  uint8_t reserved;
+  uint16_t thread; // ring the record came from, the same number for one thread at a time
+} trace_record_t;
+
+static_assert(sizeof(trace_record_t) == 16, "trace records are written to the file as they are");
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordBytes;
+  uint32_t ticksPerMin; // LOOP_TICKS_PER_MIN of the build that wrote the file
+  uint32_t reserved;
+} trace_file_header_t;
+
+/** Starts draining every thread's records to path. Records are dropped while no trace
+ * is started. StopTrace drains what is left and closes the file; call it once every
+ * thread that traces has finished. */
+bool StartTrace(const char* path);
+void StopTrace(void);
+
+// Appends a record to the calling thread's ring, waiting for the drain thread if the ring is full
+void TraceRecord(trace_event_type_t type, uint32_t tick, uint32_t aircraftIndex, uint32_t value);
+
+// Writes a trace file as text or Chrome trace JSON, returns false with an error printed if it can't be read
+bool DecodeTrace(const char* inputPath, const char* outputPath, trace_format_t format);
+void TraceTest(void);
+
+inline void TraceTakeoff(uint32_t aircraftIndex, uint32_t tick, uint32_t numFlights) {
+  if constexpr (TRACE_ENABLED) {
+    TraceRecord(TRACE_EVENT_TAKEOFF, tick, aircraftIndex, numFlights);
+  }
+}
+
+inline void TraceBatteryDead(uint32_t aircraftIndex, uint32_t tick, uint32_t legTicks) {
+  if constexpr (TRACE_ENABLED) {
+    TraceRecord(TRACE_EVENT_BATTERY_DEAD, tick, aircraftIndex, legTicks);
+  }
 }
 
-inline void TraceFinishCharging(uint8_t arrayIndex, float timeMin, uint8_t numChargersInUse) {
-    #ifdef ENABLE_TRACE
-        std::cout <<
-            "completed charging - array index: " << +arrayIndex <<
-            ", time: " << timeMin << " min" <<
-            ", chargers in use: " << +numChargersInUse <<
-            std::endl;
-    #endif
+inline void TraceAddedToChargingLine(uint32_t aircraftIndex, uint32_t tick, uint32_t lineLength) {
+  if constexpr (TRACE_ENABLED) {
+    TraceRecord(TRACE_EVENT_ENQUEUE, tick, aircraftIndex, lineLength);
+  }
 }
 
-inline void TraceAddedToChargingLine(uint8_t arrayIndex, float timeMin) {
-    #ifdef ENABLE_TRACE
-        std::cout <<
-            "placed in line - array index: " << +arrayIndex <<
-            ", time: " << timeMin << " min" <<
-            std::endl;
-    #endif
-}
\ No newline at end of file
+inline void TraceStartCharging(uint32_t aircraftIndex, uint32_t tick, uint32_t numChargersInUse) {
+  if constexpr (TRACE_ENABLED) {
+    TraceRecord(TRACE_EVENT_CHARGE_START, tick, aircraftIndex, numChargersInUse);
+  }
+}
+
+inline void TraceFinishCharging(uint32_t aircraftIndex, uint32_t tick, uint32_t numChargersInUse) {
+  if constexpr (TRACE_ENABLED) {
+    TraceRecord(TRACE_EVENT_CHARGE_END, tick, aircraftIndex, numChargersInUse);
+  }
+}
+
+inline void TraceFault(uint32_t aircraftIndex, uint32_t tick, uint32_t numFaults) {
+  if constexpr (TRACE_ENABLED) {
+    TraceRecord(TRACE_EVENT_FAULT, tick, aircraftIndex, numFaults);
+  }
+}
@@ -0,0 +1,239 @@
+/** Google Benchmark suite of the simulation, built by bench/CMakeLists.txt when the
+ * library is installed. The macro benchmarks run a whole simulation with each engine
+ * over fleet size, charger count and horizon, the micro benchmarks time the pieces
+ * the tick loop spends its time in: the hourly fault draw, the battery and charge
+ * checks, the charge line dispatch and the final averages. BM_DemandEngine runs a day
+ * of passenger requests, see Demand.h, and reports requests_per_sec.
+ *
+ * The engine benchmarks report two counters besides the time per run:
+ *  ns_per_aircraft_tick  wall time divided by aircraft times simulated ticks
+ *  events_per_sec        flights, charge starts and ends and faults simulated per second
+ * Save a run with --benchmark_out=FILE --benchmark_out_format=json and compare it to
+ * baseline.json with compare.py, see the README. */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "Aircraft.h"
+#include "AircraftCompanyCommon.h"
+#include "ChargeQueue.h"
+#include "ChargeStation.h"
+#include "Config.h"
+#include "Demand.h"
+#include "Output.h"
+#include "RandomGen.h"
+#include "Simulation.h"
+
+static const uint64_t benchSeed = 7u;
+static const int64_t maxTickLoopAircraftHours = 1000 * 24; // the tick loops take seconds per run above this
+
+// Every company in turn, so a benchmark doesn't depend on the random fleet draw
+static std::vector<Aircraft> CreateBenchFleet(uint32_t numAircraft) {
+  std::vector<Aircraft> aircrafts(numAircraft);
+  for (uint32_t i = 0; i < numAircraft; i++) {
+    aircrafts[i].m_id = (aircraft_id_t) (i % GetNumCompanies());
+  }
+  return aircrafts;
+}
+
+static simulation_config_t CreateBenchConfig(const benchmark::State& state) {
+  simulation_config_t config = DefaultSimulationConfig();
+  config.numAircraft = (uint32_t) state.range(0);
+  config.numChargers = (uint32_t) state.range(1);
+  config.simulationTicks = (uint32_t) state.range(2) * LOOP_TICKS_PER_HOUR;
+  config.seed = benchSeed;
+  return config;
+}
+
+// Flights, charge starts, charge ends and faults of a finished run
+static uint64_t CountEvents(const std::vector<Aircraft>& aircrafts) {
+  uint64_t events = 0;
+  for (const Aircraft& plane : aircrafts) {
+    events += plane.m_numFlights + 2ull * plane.m_numChargeSessions + plane.m_numFaults;
+  }
+  return events;
+}
+
+typedef void (*engine_function_t)(Aircraft*, const simulation_config_t&, SimulationStatistics*, TimelineRecorder*);
+
+static void RunEngineBenchmark(benchmark::State& state, engine_function_t engine) {
+  const simulation_config_t config = CreateBenchConfig(state);
+  const std::vector<Aircraft> fleet = CreateBenchFleet(config.numAircraft);
+  uint64_t events = 0;
+
+  for (auto _ : state) {
+    std::vector<Aircraft> aircrafts = fleet;
+    engine(aircrafts.data(), config, nullptr, nullptr);
+    events = CountEvents(aircrafts);
+    benchmark::DoNotOptimize(aircrafts.data());
+  }
+
+  const double aircraftTicks = (double) config.numAircraft * config.simulationTicks;
+  state.counters["ns_per_aircraft_tick"] = benchmark::Counter(aircraftTicks * 1e-9,
+    benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+  state.counters["events_per_sec"] = benchmark::Counter((double) events, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void BM_TickLoop(benchmark::State& state) {
+  RunEngineBenchmark(state, RunTickSimulation);
+}
+
+static void BM_SoaTickLoop(benchmark::State& state) {
+  RunEngineBenchmark(state, RunSoaSimulation);
+}
+
+static void BM_EventEngine(benchmark::State& state) {
+  RunEngineBenchmark(state, RunEventSimulation);
+}
+
+// fleet, chargers, hours: the default 3 chargers and one charger per 5 aircraft
+static void EngineArgs(benchmark::internal::Benchmark* bench, bool tickLoop) {
+  bench->ArgNames({"aircraft", "chargers", "hours"});
+  for (int64_t numAircraft : {20, 1000, 10000}) {
+    for (int64_t numChargers : {(int64_t) DEFAULT_CHARGERS, numAircraft / 5}) {
+      for (int64_t hours : {3, 24}) {
+        if (tickLoop && (numAircraft * hours > maxTickLoopAircraftHours)) {
+          continue;
+        }
+        bench->Args({numAircraft, numChargers, hours});
+      }
+    }
+  }
+  bench->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK(BM_TickLoop)->Apply([](benchmark::internal::Benchmark* bench) {EngineArgs(bench, true);});
+BENCHMARK(BM_SoaTickLoop)->Apply([](benchmark::internal::Benchmark* bench) {EngineArgs(bench, true);});
+BENCHMARK(BM_EventEngine)->Apply([](benchmark::internal::Benchmark* bench) {EngineArgs(bench, false);});
+
+// A day of passenger requests at each rate, matched to a fleet of 1000 with one charger per 5 aircraft
+static void BM_DemandEngine(benchmark::State& state) {
+  simulation_config_t config = DefaultSimulationConfig();
+  config.numAircraft = 1000;
+  config.numChargers = config.numAircraft / 5;
+  config.simulationTicks = 24u * LOOP_TICKS_PER_HOUR;
+  config.seed = benchSeed;
+  config.tripRequestsPerHour = (double) state.range(0);
+  const std::vector<Aircraft> fleet = CreateBenchFleet(config.numAircraft);
+  demand_summary_t summary;
+
+  for (auto _ : state) {
+    std::vector<Aircraft> aircrafts = fleet;
+    RunDemandSimulation(aircrafts.data(), config, nullptr, &summary);
+    benchmark::DoNotOptimize(aircrafts.data());
+  }
+  state.counters["requests_per_sec"] = benchmark::Counter((double) summary.requests, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_DemandEngine)->ArgName("requests_per_hour")->Arg(1000)->Arg(50000)->Unit(benchmark::kMillisecond);
+
+// One hour of fault draws, one call per aircraft as the tick loop makes them
+static void BM_HourlyFaultGeneration(benchmark::State& state) {
+  std::vector<Aircraft> aircrafts = CreateBenchFleet((uint32_t) state.range(0));
+  uint32_t hour = 1;
+
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < aircrafts.size(); i++) {
+      HourlyFaultGenerationPercentChance(&aircrafts[i], i, hour, benchSeed);
+    }
+    hour++;
+    benchmark::DoNotOptimize(aircrafts.data());
+  }
+  state.SetItemsProcessed((int64_t) state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HourlyFaultGeneration)->ArgName("aircraft")->Arg(20)->Arg(1000)->Arg(100000);
+
+// The same draws batched over the fleet, as the SoA engine makes them
+static void BM_GenerateHourlyFaults(benchmark::State& state) {
+  std::vector<Aircraft> aircrafts = CreateBenchFleet((uint32_t) state.range(0));
+  uint32_t hour = 1;
+
+  for (auto _ : state) {
+    GenerateHourlyFaults(aircrafts.data(), (uint32_t) aircrafts.size(), hour, benchSeed);
+    hour++;
+    benchmark::DoNotOptimize(aircrafts.data());
+  }
+  state.SetItemsProcessed((int64_t) state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GenerateHourlyFaults)->ArgName("aircraft")->Arg(20)->Arg(1000)->Arg(100000);
+
+// One tick worth of IsBatteryDead() and IsChargingComplete() over the fleet
+static void BM_BatteryChargeChecks(benchmark::State& state) {
+  std::vector<Aircraft> aircrafts = CreateBenchFleet((uint32_t) state.range(0));
+  for (uint32_t i = 0; i < aircrafts.size(); i++) {
+    aircrafts[i].m_legEndTick = 1u + 3u * i;
+  }
+
+  uint32_t tick = 0;
+  for (auto _ : state) {
+    uint32_t done = 0;
+    for (Aircraft& plane : aircrafts) {
+      plane.m_airTimeTicks++;
+      plane.m_chargeTimeTicks++;
+      done += IsBatteryDead(&plane, tick) + IsChargingComplete(&plane, tick);
+    }
+    tick++;
+    benchmark::DoNotOptimize(done);
+  }
+  state.SetItemsProcessed((int64_t) state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BatteryChargeChecks)->ArgName("aircraft")->Arg(20)->Arg(1000)->Arg(100000);
+
+/** The whole fleet gets in line at once and is dispatched to the chargers until the
+ * line is empty, every charge session lasting one tick, so only the line and the
+ * station are timed. */
+static void BM_ChargeQueueDispatch(benchmark::State& state) {
+  const uint32_t numAircraft = (uint32_t) state.range(0);
+  const uint32_t numChargers = (uint32_t) state.range(1);
+  const charge_policy_t policy = (charge_policy_t) state.range(2);
+  const std::vector<Aircraft> aircrafts = CreateBenchFleet(numAircraft);
+  state.SetLabel(GetChargePolicyName(policy));
+
+  for (auto _ : state) {
+    ChargeQueue queue(numAircraft, policy);
+    ChargeStation chargers(numChargers);
+    for (uint32_t i = 0; i < numAircraft; i++) {
+      queue.push(i, aircrafts[i].m_id, 0);
+    }
+    uint32_t tick = 1;
+    charge_queue_entry_t entry;
+    while (!queue.empty()) {
+      while (chargers.isChargerAvailable() && queue.pop(tick, &entry)) {
+        chargers.addAircraft(tick);
+      }
+      tick++;
+      while (chargers.removeAircraft(tick)) {}
+    }
+    benchmark::DoNotOptimize(entry);
+  }
+  state.SetItemsProcessed((int64_t) state.iterations() * numAircraft);
+}
+BENCHMARK(BM_ChargeQueueDispatch)->ArgNames({"aircraft", "chargers", "policy"})->Apply([](benchmark::internal::Benchmark* bench) {
+  for (int64_t numAircraft : {20, 10000}) {
+    for (int64_t policy = 0; policy < TOTAL_CHARGE_POLICIES; policy++) {
+      bench->Args({numAircraft, (int64_t) DEFAULT_CHARGERS, policy});
+      bench->Args({numAircraft, numAircraft / 5, policy});
+    }
+  }
+});
+
+// Averages and totals of a fleet that flew a 3 hour run
+static void BM_ComputeDataAveragesAndTotals(benchmark::State& state) {
+  simulation_config_t config = DefaultSimulationConfig();
+  config.numAircraft = (uint32_t) state.range(0);
+  config.numChargers = (config.numAircraft * DEFAULT_CHARGERS) / DEFAULT_AIRCRAFTS_IN_SIMULATION;
+  config.seed = benchSeed;
+  std::vector<Aircraft> aircrafts = CreateBenchFleet(config.numAircraft);
+  RunEventSimulation(aircrafts.data(), config);
+
+  data_avgs_and_totals_t averagesAndTotals[MAX_AIRCRAFT_COMPANIES];
+  for (auto _ : state) {
+    ComputeDataAveragesAndTotals(averagesAndTotals, aircrafts.data(), config.numAircraft);
+    benchmark::DoNotOptimize(averagesAndTotals);
+  }
+  state.SetItemsProcessed((int64_t) state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ComputeDataAveragesAndTotals)->ArgName("aircraft")->Arg(20)->Arg(1000)->Arg(100000);
+
+BENCHMARK_MAIN();
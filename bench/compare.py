@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Compares two Google Benchmark JSON files, e.g. bench/baseline.json and a new run.
+
+  python3 bench/compare.py bench/baseline.json new.json [--threshold 10]
+
+Prints the change of the time and of every counter of each benchmark found in both
+files. Exits with status 1 when any benchmark got slower by more than the threshold
+percent: a higher time or ns_per_aircraft_tick, or lower events_per_sec or
+items_per_second. When the files hold repetitions, only the mean is compared.
+
+Timings are only comparable from the same setup, so a warning is printed for every
+host or build field of the two contexts that differs, and for a file whose Google
+Benchmark library reports a debug build.
+"""
+
+import argparse
+import json
+import sys
+
+# counters where a larger value is better, every other counter and the time should shrink
+HIGHER_IS_BETTER = {"events_per_sec", "items_per_second", "bytes_per_second"}
+
+# context fields that describe the host and the build rather than the run
+SETUP_FIELDS = ("host_name", "num_cpus", "mhz_per_cpu", "cpu_scaling_enabled", "library_build_type", "evtolsim_build_type")
+
+
+def load_benchmarks(path):
+    with open(path) as f:
+        data = json.load(f)
+    benchmarks = {}
+    for bench in data["benchmarks"]:
+        if bench.get("run_type") == "aggregate" and bench.get("aggregate_name") != "mean":
+            continue
+        benchmarks[bench.get("run_name", bench["name"])] = bench
+    return data.get("context", {}), benchmarks
+
+
+def warn_setup(baseline_path, baseline, contender_path, contender):
+    for path, context in ((baseline_path, baseline), (contender_path, contender)):
+        if context.get("library_build_type") == "debug":
+            print("warning: %s was run against a debug build of Google Benchmark" % path)
+    for field in SETUP_FIELDS:
+        if baseline.get(field) != contender.get(field):
+            print("warning: %s differs, %s in the baseline and %s in the contender" %
+                  (field, baseline.get(field), contender.get(field)))
+
+
+def measures(bench):
+    values = {"real_time": bench["real_time"]}
+    for key, value in bench.items():
+        if key in HIGHER_IS_BETTER or key == "ns_per_aircraft_tick":
+            values[key] = value
+    return values
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("contender")
+    parser.add_argument("--threshold", type=float, default=10.0, help="percent a benchmark may get slower, 10 by default")
+    args = parser.parse_args()
+
+    baseline_context, baseline = load_benchmarks(args.baseline)
+    contender_context, contender = load_benchmarks(args.contender)
+    warn_setup(args.baseline, baseline_context, args.contender, contender_context)
+    regressions = 0
+    print("%-60s %-22s %14s %14s %9s" % ("benchmark", "measure", "baseline", "contender", "change"))
+    for name, bench in baseline.items():
+        if name not in contender:
+            print("%-60s missing from %s" % (name, args.contender))
+            continue
+        new_values = measures(contender[name])
+        for key, old in measures(bench).items():
+            new = new_values.get(key)
+            if new is None or old == 0:
+                continue
+            change = 100.0 * (new - old) / old
+            worse = -change if key in HIGHER_IS_BETTER else change
+            flag = ""
+            if worse > args.threshold:
+                flag = "  REGRESSION"
+                regressions += 1
+            print("%-60s %-22s %14.6g %14.6g %+8.1f%%%s" % (name, key, old, new, change, flag))
+
+    for name in contender:
+        if name not in baseline:
+            print("%-60s not in the baseline" % name)
+    if regressions:
+        print("%d measures regressed by more than %.1f%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
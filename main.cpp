@@ -1,16 +1,107 @@
 // main file to execute the simulation
 
+#include <cstdlib>
+#include <iostream>
+
+#include "AircraftCompanyCommon.h"
+#include "AnalyticSimulation.h"
+#include "Arena.h"
+#include "BatchRunner.h"
+#include "Benchmark.h"
+#include "ChargeQueue.h"
+#include "Checkpoint.h"
+#include "Config.h"
+#include "Demand.h"
+#include "HeapCounter.h"
+#include "Maintenance.h"
+#include "Metrics.h"
+#include "Network.h"
 #include "Output.h"
 #include "RandomGen.h"
+#include "ResultWriter.h"
 #include "Simulation.h"
+#include "SimulationContext.h"
+#include "Sweep.h"
+#include "Timeline.h"
+#include "Trace.h"
 
-int main()
+int main(int argc, char* argv[])
 {
-    // call this function to test the fault generation code
-    // FaultTest(); // test is passing!
+    simulation_config_t config = DefaultSimulationConfig();
+    if (ParseCommandLine(argc, argv, &config) == false) {
+        return EXIT_FAILURE;
+    }
+    if ((config.tracePath.empty() == false) && (StartTrace(config.tracePath.c_str()) == false)) {
+        return EXIT_FAILURE;
+    }
+    if ((config.metricsPath.empty() == false) && (StartMetrics(config.metricsPath.c_str()) == false)) {
+        return EXIT_FAILURE;
+    }
 
-    // call this function to test the output calculations
-    // TestCalculations(); // test is passing!
+    switch (config.action) {
+        case PROGRAM_ACTION_SELF_TEST:
+            CompanyCatalogTest(); // tests the company catalog, and puts the built-in catalog back for the other tests
+            FaultTest(); // tests the fault generation code
+            RandomGenTest(); // tests the random number engine
+            TestCalculations(); // tests the output calculations
+            ResultWriterTest(); // tests the CSV and columnar result writers
+            StatisticsTest(); // tests the streaming statistics accumulators
+            ChargeQueueTest(); // tests the charge queue ring buffer, the scheduling policies and the concurrent queue
+            SimulationEngineTest(); // tests the event-driven, SoA and analytic engines against the tick loop
+            AnalyticSimulationTest(); // tests the analytic fast path against the event engine over long horizons
+            SweepTest(); // tests the parameter sweep against separate runs of every point
+            NetworkTest(); // tests the vertiport network against the event engine and across thread counts
+            MaintenanceTest(); // tests the grounding fault draws and the repair bays of the tick loop against the event engine
+            DemandTest(); // tests the trip request draws and the matching of requests to aircraft
+            MetricsTest(); // tests the live metrics page against the runs that published to it
+            ArenaTest(); // tests the simulation arena and that a replication in a reset arena never touches the heap
+            SimulationContextTest(); // tests the library entry point against the tick loop and across threads
+            CheckpointTest(); // tests that a run restored from a checkpoint goes on exactly as before
+            TimelineTest(); // tests the timeline recorder against the engines
+            TraceTest(); // tests the trace ring buffers, the drain thread and the decoder
+            break;
+        case PROGRAM_ACTION_SCALING_BENCHMARK:
+            RunScalingBenchmark(config);
+            break;
+        case PROGRAM_ACTION_SOA_BENCHMARK:
+            RunSoaBenchmark(config);
+            break;
+        case PROGRAM_ACTION_BATCH_BENCHMARK:
+            RunBatchBenchmark(config);
+            break;
+        case PROGRAM_ACTION_POLICY_BENCHMARK:
+            RunPolicyBenchmark(config);
+            break;
+        case PROGRAM_ACTION_ANALYTIC_BENCHMARK:
+            RunAnalyticBenchmark(config);
+            break;
+        case PROGRAM_ACTION_SWEEP:
+            RunSweepSimulation(config);
+            break;
+        case PROGRAM_ACTION_DECODE_TRACE:
+            if (DecodeTrace(config.decodeTracePath.c_str(), config.outputPath.c_str(), config.traceFormat) == false) {
+                return EXIT_FAILURE;
+            }
+            break;
+        case PROGRAM_ACTION_READ_METRICS: {
+            metrics_snapshot_t snapshot;
+            if (ReadMetricsPage(config.readMetricsPath.c_str(), &snapshot) == false) {
+                return EXIT_FAILURE;
+            }
+            WriteMetricsPrometheus(std::cout, snapshot);
+            break;
+        }
+        case PROGRAM_ACTION_SIMULATE:
+        default:
+            if (config.numReplications > 1) {
+                RunBatchSimulation(config);
+            } else if (RunSimulation(config) == false) {
+                return EXIT_FAILURE;
+            }
+            break;
+    }
 
-    RunSimulation();
-}
\ No newline at end of file
+    StopTrace(); // drains the records still in the ring buffers, if --trace started a trace
+    StopMetrics(); // leaves the page with the final values for readers
+    return EXIT_SUCCESS;
+}